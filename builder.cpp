@@ -17,7 +17,7 @@
 * https://kohiengine.com
 */
 
-HdaBuilder::HdaBuilder(HdaInstanceGpu& dev, HdaWindow& win, HdaSwapchain& swa, HdaPipeline& pip) : device{ dev }, window{ win }, swapchain{ swa }, pipeline{ pip } {
+HdaBuilder::HdaBuilder(HdaInstanceGpu& dev, HdaWindow& win, HdaSwapchain& swa, HdaPipeline& pip, HdaJobs& job) : device{ dev }, window{ win }, swapchain{ swa }, pipeline{ pip }, jobs{ job }, upload{ dev } {
 	
 	//cout << "HdaBuilder(): constructor\n";
 	cout << ". ";
@@ -55,9 +55,66 @@ HdaBuilder::~HdaBuilder() {
 
 		cleanupSceneObjects(sceneObjects);
 
+		device.getDevice().destroyPipeline(cullPipeline);
+		device.getDevice().destroyPipelineLayout(cullPipelineLayout);
+		device.getDevice().destroyDescriptorSetLayout(cullDescriptSetLay);
+		device.getDevice().destroyPipeline(pyramidPipeline);
+		device.getDevice().destroyPipelineLayout(pyramidPipelineLayout);
+		device.getDevice().destroyDescriptorSetLayout(pyramidDescriptSetLay);
+		device.getDevice().destroySampler(depthPyramidSampler);
+		device.getDevice().destroyQueryPool(statisticsQueryPool);
+		device.getDevice().destroyPipeline(lightCullPipeline);
+		device.getDevice().destroyPipelineLayout(lightCullPipelineLayout);
+		device.getDevice().destroyDescriptorSetLayout(lightCullDescriptSetLay);
+		device.getDevice().destroyPipeline(lightingPipeline);
+		device.getDevice().destroyPipelineLayout(lightingPipelineLayout);
+		device.getDevice().destroyDescriptorSetLayout(lightingDescriptSetLay);
+		device.getDevice().destroyPipeline(bloomDownPipeline);
+		device.getDevice().destroyPipeline(bloomUpPipeline);
+		device.getDevice().destroyPipelineLayout(bloomPipelineLayout);
+		device.getDevice().destroyDescriptorSetLayout(bloomDescriptSetLay);
+		device.getDevice().destroySampler(bloomSampler);
+		device.getDevice().destroyPipeline(tonemapPipeline);
+		device.getDevice().destroyPipelineLayout(tonemapPipelineLayout);
+		device.getDevice().destroyDescriptorSetLayout(tonemapDescriptSetLay);
+		device.getDevice().destroyQueryPool(bloomQueryPool);
+		destroyTonemapLut();
+		device.getDevice().destroyPipeline(localGridPipeline);
+		device.getDevice().destroyPipeline(localBlurPipeline);
+		device.getDevice().destroyPipelineLayout(localPipelineLayout);
+		device.getDevice().unmapMemory(tileStatsMemory);
+		device.getDevice().destroyBuffer(tileStatsBuff);
+		device.getDevice().freeMemory(tileStatsMemory);
+
+		for (int i = 0; i < deferredUniformBuffs.size(); i++) {
+			device.getDevice().destroyBuffer(deferredUniformBuffs[i]);
+			device.getDevice().freeMemory(deferredUniformBuffsMemory[i]);
+		}
+
+		for (int i = 0; i < lightBuffs.size(); i++) {
+			device.getDevice().destroyBuffer(lightBuffs[i]);
+			device.getDevice().freeMemory(lightBuffsMemory[i]);
+			device.getDevice().destroyBuffer(clusterBuffs[i]);
+			device.getDevice().freeMemory(clusterBuffsMemory[i]);
+			device.getDevice().destroyBuffer(clusterUniformBuffs[i]);
+			device.getDevice().freeMemory(clusterUniformBuffsMemory[i]);
+		}
+
 		for (int i = 0; i < commandPools.size(); i++)
 			device.getDevice().destroyCommandPool(commandPools[i]);
 
+		for (auto& framePools : recordPools)
+			for (auto& p : framePools)
+				device.getDevice().destroyCommandPool(p.pool);
+
+		for (auto& framePools : staticPools)
+			for (auto& p : framePools)
+				device.getDevice().destroyCommandPool(p.pool);
+
+		for (auto& p : computePools)
+			device.getDevice().destroyCommandPool(p);
+		device.getDevice().destroyQueryPool(timestampQueryPool);
+
 	}
 }
 
@@ -65,7 +122,9 @@ void HdaBuilder::initBuilder() {
 
 	ch = 1;
 
-	for (int i = 0; i < OBJECTS_NUMBER; i++) {
+	// objects of manifest and the skybox, uniform buffers are sized by their number
+	sceneDesc = HdaManifest::parseManifest(scenePath);
+	for (size_t i = 0; i <= sceneDesc.objects.size(); i++) {
 
 		HdaModel::SceneObject obj;
 		sceneObjects.push_back(obj);
@@ -73,17 +132,37 @@ void HdaBuilder::initBuilder() {
 
 
 	createCommandPool();
+	createRecordPools(recordPools);
+	createRecordPools(staticPools);
 		
 	createUniformBuffers();
 	createDynamicUniformBuffer();
 	createDescriptorPool();
+	createMeshletCullPipeline();
+	createDepthPyramidPipeline();
+	createStatisticsQuery();
+	createLightCulling();
+	createAsyncCompute();
+	createDeferredLighting();
+	createBloom();
+	createLocalTonemap();
 
 	createCommandBuffer();
 	initSyncObjects();
+	upload.initUpload();
 
 	loadScene();
+	createSceneEntities();
+	for (auto& o : sceneObjects)
+		createDrawArgsBuffers(&o);
+	loadLights();
+	updateOcclusionDescriptors();
+	updateDeferredDescriptors();
 
 	calculateAdditionalData();
+
+	// the first frame waits for uploads of loadScene() on the GPU
+	upload.printStatistics();
 }
 
 
@@ -105,8 +184,40 @@ void HdaBuilder::cleanupSceneObjects(vector<HdaModel::SceneObject> o) {
 		device.getDevice().destroyBuffer(o[k].objectMesh.indexBuff);
 		device.getDevice().freeMemory(o[k].objectMesh.indexBuffMemory);
 
+		for (int i = 0; i < o[k].instanceBuffs.size(); i++) {
+			device.getDevice().destroyBuffer(o[k].instanceBuffs[i]);
+			device.getDevice().freeMemory(o[k].instanceBuffsMemory[i]);
+		}
+
+		for (int i = 0; i < o[k].drawArgsBuffs.size(); i++) {
+			device.getDevice().destroyBuffer(o[k].drawArgsBuffs[i]);
+			device.getDevice().freeMemory(o[k].drawArgsBuffsMemory[i]);
+		}
+
+		if (!o[k].cullDescriptSets.empty()) {
+
+			device.getDevice().destroyBuffer(o[k].meshletBuff);
+			device.getDevice().freeMemory(o[k].meshletBuffMemory);
+			device.getDevice().destroyBuffer(o[k].drawTemplateBuff);
+			device.getDevice().freeMemory(o[k].drawTemplateBuffMemory);
+			device.getDevice().destroyBuffer(o[k].visibilityBuff);
+			device.getDevice().freeMemory(o[k].visibilityBuffMemory);
+
+			for (int i = 0; i < PARALLEL_FRAMES; i++) {
+				device.getDevice().destroyBuffer(o[k].culledIndexBuffs[i]);
+				device.getDevice().freeMemory(o[k].culledIndexBuffsMemory[i]);
+				device.getDevice().destroyBuffer(o[k].drawCmdBuffs[i]);
+				device.getDevice().freeMemory(o[k].drawCmdBuffsMemory[i]);
+				device.getDevice().destroyBuffer(o[k].cullUniformBuffs[i]);
+				device.getDevice().freeMemory(o[k].cullUniformBuffsMemory[i]);
+			}
+		}
+
 		device.getDevice().destroyDescriptorSetLayout(o[k].objectDescriptSetLay);
 		device.getDevice().destroyPipeline(o[k].objectPipeline);
+		device.getDevice().destroyPipeline(o[k].depthPrepassPipeline);
+		device.getDevice().destroyPipeline(o[k].depthEqualPipeline);
+		device.getDevice().destroyPipeline(o[k].deferredPipeline);
 		device.getDevice().destroyPipelineLayout(o[k].objectPipelineLayout);
 	}
 }
@@ -168,21 +279,6 @@ void HdaBuilder::createSemaphores() {
 }
 
 
-void HdaBuilder::createFences() {
-
-	renderCompleteFences.resize(PARALLEL_FRAMES);
-
-	for (int i = 0; i < PARALLEL_FRAMES; i++) {
-		renderCompleteFences[i] =
-			device.getDevice().createFence(
-				vk::FenceCreateInfo(
-					vk::FenceCreateFlagBits::eSignaled
-				)
-			);
-	}
-}
-
-
 void HdaBuilder::recreateSwapchain() {
 
 	int width = 0, height = 0;
@@ -197,15 +293,37 @@ void HdaBuilder::recreateSwapchain() {
 
 	for (int i = 0; i < sceneObjects.size(); i++) {
 		device.getDevice().destroyPipeline(sceneObjects[i].objectPipeline);
+		device.getDevice().destroyPipeline(sceneObjects[i].depthPrepassPipeline);
+		device.getDevice().destroyPipeline(sceneObjects[i].depthEqualPipeline);
+		device.getDevice().destroyPipeline(sceneObjects[i].deferredPipeline);
 	}
+	device.getDevice().destroyPipeline(lightingPipeline);
+	device.getDevice().destroyPipeline(tonemapPipeline);
 
+	// semaphores are not recreated, an acquired image is always presented before the resize
 	swapchain.cleanupSwapchain();
-	cleanupSyncObjects();
 	swapchain.initSwapchain();
-
-	for (int i = 0; i < sceneObjects.size()-1; i++)
-		sceneObjects[i].objectPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
-			sceneObjects[i].objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+	swapchainGeneration++;
+
+	// depth pyramid, G-buffer, scene color and bloom chain were created again with the new size
+	updateOcclusionDescriptors();
+	updateDeferredDescriptors();
+	updateBloomDescriptors();
+	updateLocalDescriptors();
+	createLightingPipeline();
+	createTonemapPipeline();
+
+	for (int i = 0; i < sceneObjects.size()-1; i++) {
+		if (!sceneObjects[i].instances.empty())
+			createInstancedPipelines(&sceneObjects[i]);
+		else {
+			sceneObjects[i].objectPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+				sceneObjects[i].objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+			createPrepassPipelines(&sceneObjects[i]);
+		}
+		createDeferredPipeline(&sceneObjects[i], false);
+	}
+	createDeferredPipeline(&sceneObjects[sceneObjects.size()-1], true);
 
 	// pipeline for skybox requires different parameters
 	sceneObjects[sceneObjects.size()-1].objectPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX,
@@ -238,22 +356,19 @@ void HdaBuilder::recreateSwapchain() {
 					0.f,  // depthBiasSlopeFactor
 					1.f   // lineWidth
 		}, nullptr, nullptr, nullptr, nullptr, sceneObjects[sceneObjects.size()-1].objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
-	
-	initSyncObjects();
 }
 
 
 void HdaBuilder::initSyncObjects() {
 
 	createSemaphores();
-	createFences();
+	frameTimelineValues.assign(PARALLEL_FRAMES, 0);
 }
 
 void HdaBuilder::cleanupSyncObjects() {
 
-	if (!renderCompleteFences.empty() && !renderCompleteSemaphores.empty() && !presentCompleteSemaphores.empty())
+	if (!renderCompleteSemaphores.empty() && !presentCompleteSemaphores.empty())
 		for (int i = 0; i < PARALLEL_FRAMES; i++) {
-			device.getDevice().destroyFence(renderCompleteFences[i]);
 			device.getDevice().destroySemaphore(renderCompleteSemaphores[i]);
 			device.getDevice().destroySemaphore(presentCompleteSemaphores[i]);
 		}
@@ -271,32 +386,14 @@ void HdaBuilder::cleanupSyncObjects() {
 */
 void HdaBuilder::createVertexBuffer(HdaModel::Mesh& mesh) {
 
-	vk::Buffer hostBuff;
-	vk::DeviceMemory hostBuffMemory;
+	vk::DeviceSize size = sizeof(mesh.meshVertices[0]) * mesh.meshVertices.size();
 
-	// creating buffer with cpu access memory type
-	createBuffer((sizeof(mesh.meshVertices[0]) * mesh.meshVertices.size()), vk::BufferUsageFlagBits::eTransferSrc,
-		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, hostBuff, hostBuffMemory);
+	// creating vertex buffer in device local memory on gpu
+	createBuffer(size, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+		vk::MemoryPropertyFlagBits::eDeviceLocal, mesh.vertexBuff, mesh.vertexBuffMemory);
 
-	try {
-		void* data = device.getDevice().mapMemory(hostBuffMemory, 0, sizeof(mesh.meshVertices[0]) * mesh.meshVertices.size(), vk::MemoryMapFlags());
-		memcpy(data, mesh.meshVertices.data(), (size_t)sizeof(mesh.meshVertices[0]) * mesh.meshVertices.size());
-		device.getDevice().unmapMemory(hostBuffMemory);
-
-		// creating vertex buffer in device local memory on gpu
-		createBuffer((sizeof(mesh.meshVertices[0]) * mesh.meshVertices.size()), vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-			vk::MemoryPropertyFlagBits::eDeviceLocal, mesh.vertexBuff, mesh.vertexBuffMemory);
-
-		// copying data from hostBuffer to vertexBuffer
-		copyBuffers(hostBuff, mesh.vertexBuff, sizeof(mesh.meshVertices[0]) * mesh.meshVertices.size());
-	}
-	catch (...) {
-		device.getDevice().destroyBuffer(hostBuff);
-		device.getDevice().freeMemory(hostBuffMemory);
-		throw runtime_error("Unspecified error in createVertexBuffer().");
-	}
-	device.getDevice().destroyBuffer(hostBuff);
-	device.getDevice().freeMemory(hostBuffMemory);
+	// copying data through staging arena to vertexBuffer
+	upload.copyToBuffer(mesh.meshVertices.data(), size, mesh.vertexBuff, 0);
 
 	cout << "createVertexBuffer(): Vertex buffer is created.\n";
 }
@@ -313,31 +410,15 @@ void HdaBuilder::createVertexBuffer(HdaModel::Mesh& mesh) {
 */
 void HdaBuilder::createIndexBuffer(HdaModel::Mesh& mesh) {
 
-	vk::Buffer hostBuff;
-	vk::DeviceMemory hostBuffMemory;
-
-	// creating buffer with cpu access memory type
-	createBuffer((sizeof(mesh.meshIndices[0]) * mesh.meshIndices.size()), vk::BufferUsageFlagBits::eTransferSrc,
-		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, hostBuff, hostBuffMemory);
-	try {
-		void* data = device.getDevice().mapMemory(hostBuffMemory, 0, sizeof(mesh.meshIndices[0]) * mesh.meshIndices.size(), vk::MemoryMapFlags());
-		memcpy(data, mesh.meshIndices.data(), (size_t)sizeof(mesh.meshIndices[0]) * mesh.meshIndices.size());
-		device.getDevice().unmapMemory(hostBuffMemory);
+	vk::DeviceSize size = sizeof(mesh.meshIndices[0]) * mesh.meshIndices.size();
 
-		// creating vertex buffer in device local memory on gpu
-		createBuffer((sizeof(mesh.meshIndices[0]) * mesh.meshIndices.size()), vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-			vk::MemoryPropertyFlagBits::eDeviceLocal, mesh.indexBuff, mesh.indexBuffMemory);
+	// creating index buffer in device local memory on gpu
+	// index buffer is also the source of meshlet culling in compute shader
+	createBuffer(size, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+		vk::MemoryPropertyFlagBits::eDeviceLocal, mesh.indexBuff, mesh.indexBuffMemory);
 
-		// copying data from hostBuffer to vertexBuffer
-		copyBuffers(hostBuff, mesh.indexBuff, sizeof(mesh.meshIndices[0]) * mesh.meshIndices.size());
-	}
-	catch (...) {
-		device.getDevice().destroyBuffer(hostBuff);
-		device.getDevice().freeMemory(hostBuffMemory);
-		throw runtime_error("Unspecified error in createIndexBuffer().");
-	}
-	device.getDevice().destroyBuffer(hostBuff);
-	device.getDevice().freeMemory(hostBuffMemory);
+	// copying data through staging arena to indexBuffer
+	upload.copyToBuffer(mesh.meshIndices.data(), size, mesh.indexBuff, 0);
 
 	cout << "createIndexBuffer(): Index buffer is created.\n";
 }
@@ -372,8 +453,9 @@ void HdaBuilder::createUniformBuffers() {
 	uint32_t submeshCount = 0;	// every submesh has own texture
 
 	// TODO TODO	NUM_OF_PARTS_WITH_SAME_TEX 
-	// DYNAMIC uniform buffers
-	createBuffer((NUM_OF_PARTS_WITH_SAME_TEX + sceneObjects.size()) * calcRequiredAligment(sizeof(HdaModel::SceneUniformData)), vk::BufferUsageFlagBits::eUniformBuffer,		// 24
+	// DYNAMIC uniform buffers, scene data change every frame, so every frame has its own
+	sceneUniformSlots = static_cast<uint32_t>(NUM_OF_PARTS_WITH_SAME_TEX + sceneObjects.size());
+	createBuffer(PARALLEL_FRAMES * sceneUniformSlots * calcRequiredAligment(sizeof(HdaModel::SceneUniformData)), vk::BufferUsageFlagBits::eUniformBuffer,		// 24
 		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, sceneUniformBuff, sceneUniformBuffMemory);
 
 	// TODO TODO DELETE
@@ -413,15 +495,19 @@ void HdaBuilder::createDescriptorPool() {
 			vk::DescriptorPoolCreateInfo(
 				vk::DescriptorPoolCreateFlags(),
 				static_cast<uint32_t>(PARALLEL_FRAMES * (sceneObjects.size()*106)),
-				static_cast < uint32_t>(4),	// CHANGED
+				static_cast < uint32_t>(7),	// CHANGED
 				array{ 
-					vk::DescriptorPoolSize(
+					vk::DescriptorPoolSize(		// projection and cluster grid
 						vk::DescriptorType::eUniformBuffer,
-						static_cast<uint32_t>(PARALLEL_FRAMES * (sceneObjects.size() * 106))
+						static_cast<uint32_t>(PARALLEL_FRAMES * (sceneObjects.size() * 106 * 2))
 					),
-					vk::DescriptorPoolSize(
+					vk::DescriptorPoolSize(		// textures of objects, bloom levels, local grids and sources of tone mapping
 						vk::DescriptorType::eCombinedImageSampler,
-						static_cast<uint32_t>(PARALLEL_FRAMES * (sceneObjects.size() * 106))
+						static_cast<uint32_t>(PARALLEL_FRAMES * (sceneObjects.size() * 106) + 2 * BLOOM_MAX_MIPS + 6)
+					),
+					vk::DescriptorPoolSize(		// G-buffer and depth of the lighting subpass
+						vk::DescriptorType::eInputAttachment,
+						static_cast<uint32_t>(PARALLEL_FRAMES * 3)
 					),
 					vk::DescriptorPoolSize(		// CHANGED
 						vk::DescriptorType::eUniformBufferDynamic,
@@ -430,6 +516,14 @@ void HdaBuilder::createDescriptorPool() {
 					vk::DescriptorPoolSize(		// CHANGED
 						vk::DescriptorType::eUniformBufferDynamic,
 						static_cast<uint32_t>(PARALLEL_FRAMES * (sceneObjects.size() * 106))
+					),
+					vk::DescriptorPoolSize(		// light lists of objects, compute shaders and histograms of tone mapping
+						vk::DescriptorType::eStorageBuffer,
+						static_cast<uint32_t>(PARALLEL_FRAMES * (sceneObjects.size() * (106 * 2 + 5)) + 1)
+					),
+					vk::DescriptorPoolSize(		// levels of depth pyramid, bloom chain and local grids
+						vk::DescriptorType::eStorageImage,
+						static_cast<uint32_t>(DEPTH_PYRAMID_MAX_LEVELS + 2 * BLOOM_MAX_MIPS + 2)
 					)
 				}.data()
 			)
@@ -532,6 +626,54 @@ vector<vk::DescriptorSet> HdaBuilder::createDescriptorSets(vk::DescriptorSetLayo
 					descrImage,
 					nullptr,
 					nullptr
+				),
+				vk::WriteDescriptorSet(
+					descrSets[i],
+					4,
+					0,
+					1,
+					vk::DescriptorType::eStorageBuffer,
+					nullptr,
+					array{
+						vk::DescriptorBufferInfo(
+							lightBuffs[i],
+							0,
+							sizeof(HdaLights::Light) * LIGHTS_MAX
+						)
+					}.data(),
+					nullptr
+				),
+				vk::WriteDescriptorSet(
+					descrSets[i],
+					5,
+					0,
+					1,
+					vk::DescriptorType::eStorageBuffer,
+					nullptr,
+					array{
+						vk::DescriptorBufferInfo(
+							clusterBuffs[i],
+							0,
+							sizeof(uint32_t) * CLUSTER_COUNT * CLUSTER_STRIDE
+						)
+					}.data(),
+					nullptr
+				),
+				vk::WriteDescriptorSet(
+					descrSets[i],
+					6,
+					0,
+					1,
+					vk::DescriptorType::eUniformBuffer,
+					nullptr,
+					array{
+						vk::DescriptorBufferInfo(
+							clusterUniformBuffs[i],
+							0,
+							sizeof(HdaLights::ClusterUniformData)
+						)
+					}.data(),
+					nullptr
 				)
 			},
 			nullptr
@@ -553,13 +695,22 @@ vector<vk::DescriptorSet> HdaBuilder::createDescriptorSets(vk::DescriptorSetLayo
 */
 void HdaBuilder::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buff, vk::DeviceMemory& buffMemory) {
 
+	createBuffer(size, usage, properties, buff, buffMemory, {});
+}
+
+
+// buffer of more queue families is shared concurrently, so it needs no ownership transfers
+void HdaBuilder::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer& buff, vk::DeviceMemory& buffMemory, const vector<uint32_t>& families) {
+
 	buff =
 		device.getDevice().createBuffer(
 			vk::BufferCreateInfo(
 				vk::BufferCreateFlags(),
 				size,
 				usage,
-				vk::SharingMode::eExclusive
+				families.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+				families.size() > 1 ? static_cast<uint32_t>(families.size()) : 0,	// queueFamilyIndexCount
+				families.size() > 1 ? families.data() : nullptr						// pQueueFamilyIndices
 			)
 		);
 
@@ -591,86 +742,37 @@ void HdaBuilder::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, v
 }
 
 
-void HdaBuilder::copyBuffers(vk::Buffer srcBuff, vk::Buffer dstBuff, vk::DeviceSize size) {
-
-	vk::CommandBuffer commandBuff =
-		device.getDevice().allocateCommandBuffers(
-			vk::CommandBufferAllocateInfo(
-				commandPools[actual_frame],
-				vk::CommandBufferLevel::ePrimary,
-				1
-			)
-		)[0];
-
-	commandBuff.begin(
-		vk::CommandBufferBeginInfo(
-			vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
-			nullptr  // pInheritanceInfo
-		)
-	);
-
-	commandBuff.copyBuffer(srcBuff, dstBuff, 1, &vk::BufferCopy({0,0, size }));
-
-	commandBuff.end();
-
-	device.getGraphicsQueue().submit(
-		vk::ArrayProxy<const vk::SubmitInfo>(
-			1,
-			&(const vk::SubmitInfo&)vk::SubmitInfo(
-				0, nullptr,
-				nullptr,
-				1, &commandBuff, 
-				0, nullptr 
-			)
-		)
-	);
-
-	device.getGraphicsQueue().waitIdle();
-	device.getDevice().freeCommandBuffers(commandPools[actual_frame], commandBuff);
-}
-
 // TODO TODO 
 void HdaBuilder::loadMesh(HdaModel::Mesh& mesh, const char* filename, string mtlBaseDir) {
 
 	mesh.loadObjFormat(filename, mtlBaseDir);
-	createVertexBuffer(mesh);
-	//createIndexBuffer(mesh);
+	HdaMeshOptimizer::optimizeMesh(mesh, filename);
+	HdaMeshLod::generateLods(mesh, filename);
+	HdaMeshlet::buildMeshlets(mesh, filename);
 
-	cout << "loadMesh(): Mesh" << filename << " is loaded.\n";
+	cout << "loadMesh(): Mesh " << filename << " is loaded.\n";
 }
 
 
-void HdaBuilder::loadTexture(HdaModel::Texture& texture, const char* filename) {
+// buffers are created on the main thread, loadMesh() can run on worker threads
+void HdaBuilder::uploadMesh(HdaModel::Mesh& mesh, string name) {
+
+	createVertexBuffer(mesh);
+	createIndexBuffer(mesh);
 
-	int texWidth, texHeight, texChannels;
-	//float* pixels{};
+	cout << "uploadMesh(): Mesh " << name << " is uploaded.\n";
+}
 
-	// TODO TODO    PUVODNI
-	stbi_uc* pixels = stbi_load(filename, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
 
-	if (!pixels) {
-		throw runtime_error("Failed to load texture file.\n");
-	}
+void HdaBuilder::uploadTexture(HdaModel::Texture& texture, HdaManifest::ImageData& image, string name) {
 
-	/*if (!(pixels = stbi_loadf(filename, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha))) {
-		throw runtime_error("Failed to load cubemap texture file.\n");
-	}*/
+	int texWidth = image.width, texHeight = image.height;
 
 	//vk::DeviceSize teximageSize = static_cast<uint32_t>(texWidth * texHeight * 4 * 4);
 	vk::DeviceSize teximageSize = static_cast<uint32_t>(texWidth * texHeight * 4);
 
-	vk::Buffer hostBuff;
-	vk::DeviceMemory hostBuffMemory;
-
-	// creating buffer with cpu access memory type
-	createBuffer(teximageSize, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, hostBuff, hostBuffMemory);
-
 	try {
 
-		void* data = device.getDevice().mapMemory(hostBuffMemory, 0, teximageSize, vk::MemoryMapFlags());
-		memcpy(data, pixels, static_cast<size_t>(teximageSize));
-		device.getDevice().unmapMemory(hostBuffMemory);
-		stbi_image_free(pixels);
 																		  // vk::Format::eR8G8B8A8Srgb
 		texture.textureImage = swapchain.createImage(texWidth, texHeight, vk::Format::eR8G8B8A8Srgb, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
 			vk::MemoryPropertyFlagBits::eDeviceLocal, texture.textureImageMemory, static_cast<uint32_t>(1), vk::ImageCreateFlagBits::e2DArrayCompatible);
@@ -699,257 +801,84 @@ void HdaBuilder::loadTexture(HdaModel::Texture& texture, const char* filename) {
 				)
 			);
 
-		layoutConversion(texture.textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
-			{ vk::AccessFlagBits::eNone, vk::AccessFlagBits::eTransferWrite }, { vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer }, static_cast<uint32_t>(1), static_cast<uint32_t>(0));
-
-		copyBuffToImage(hostBuff, texture.textureImage, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), static_cast<uint32_t>(1), static_cast<uint32_t>(0));
-	
+		// pixels are copied into staging arena, so the image is freed before the batch is submitted
+		upload.recordImageUpload(name, texture.textureImage, static_cast<uint32_t>(1), [&]() {
+			upload.copyToImage(image.pixels, teximageSize, texture.textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), static_cast<uint32_t>(0));
+		});
+		HdaManifest::freeImage(image);
 	}
 	catch (...) {
-		stbi_image_free(pixels);
-		device.getDevice().destroyBuffer(hostBuff);
-		device.getDevice().freeMemory(hostBuffMemory);
-		throw runtime_error("Unspecified error in loadTexture().\n");
-	}
-	
-	device.getDevice().destroyBuffer(hostBuff);
-	device.getDevice().freeMemory(hostBuffMemory);
-
-	layoutConversion(texture.textureImage, vk::Format::eR8G8B8A8Srgb, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
-					{ vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead }, { vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader }, static_cast<uint32_t>(1), static_cast<uint32_t>(0));
-
-	cout << "loadTexture(): Texture " << filename << " is loaded.\n";
-}
-
-
-void HdaBuilder::loadTextureCubemap(vector<const char*> filename, HdaModel::Texture& texture) {
-	
-	for (size_t i = 0; i < filename.size(); i++) {
-
-		//stbi_uc* tex{nullptr};
-		float* tex{ nullptr };
-		int texWidth = 0, texHeight = 0, texChannels = 0;
-		//int texWidthH = 0, texHeightH = 0, texChannelsH = 0;
-
-		if (!(tex = stbi_loadf(filename[i], &texWidth, &texHeight, &texChannels, STBI_rgb_alpha))) {
-			throw runtime_error("Failed to load cubemap texture file.\n");
-		}
-		// TODO TODO puvodni funkce nacitani textur v celych cislech stbi_load()
-		/*if (!(texHdr = stbi_loadf(filename[i], &texWidthH, &texHeightH, &texChannelsH, STBI_rgb_alpha))) {
-			throw runtime_error("Failed to load cubemap texture file.\n");
-		}*/
-		//cout << "texChannels: " << texChannels << endl;
-		
-		vk::DeviceSize layerSize = static_cast<uint64_t>(texWidth * texHeight * 4 * 2 * 2);
-		vk::DeviceSize teximageSize = static_cast<uint64_t>(layerSize * 6);
-		vk::Buffer hostBuff;
-		vk::DeviceMemory hostBuffMemory;
-
-		if (i == 0) {																// eR8G8B8A8Srgb eR16G16B16A16Sfloat
-			texture.textureImage = swapchain.createImage(texWidth, texHeight, vk::Format::eR32G32B32A32Sfloat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-				vk::MemoryPropertyFlagBits::eDeviceLocal, texture.textureImageMemory, static_cast<uint32_t>(filename.size()), vk::ImageCreateFlagBits::eCubeCompatible);
-		
-			texture.textureImageView = swapchain.createImageView(texture.textureImage, vk::Format::eR32G32B32A32Sfloat, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(filename.size()), vk::ImageViewType::eCube);
-
-			texture.textureSampler =
-				device.getDevice().createSampler(
-					vk::SamplerCreateInfo(
-						vk::SamplerCreateFlags(),
-						vk::Filter::eLinear,
-						vk::Filter::eLinear,
-						vk::SamplerMipmapMode::eNearest,
-						vk::SamplerAddressMode::eClampToEdge,
-						vk::SamplerAddressMode::eClampToEdge,
-						vk::SamplerAddressMode::eClampToEdge,
-						0.0f,
-						VK_TRUE, //VK_TRUE,	// nebo false
-						device.getPhysDevice().getProperties().limits.maxSamplerAnisotropy, // 1.0f
-						VK_FALSE,
-						vk::CompareOp::eAlways,
-						0.0f,
-						1.0f,
-						vk::BorderColor::eFloatOpaqueBlack,
-						VK_FALSE
-					)
-				);
-		}
-
-		// creating buffer + AllocateAndBindMemoryObjectToBuffer
-		createBuffer(layerSize, vk::BufferUsageFlagBits::eTransferSrc,
-			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, hostBuff, hostBuffMemory);
-
-		try {
-			// MapUpdateAndUnmapHostVisibleMemory
-			void* data = device.getDevice().mapMemory(hostBuffMemory, 0, layerSize, vk::MemoryMapFlags());
-			memcpy(data, tex, static_cast<size_t>(layerSize));
-			device.getDevice().unmapMemory(hostBuffMemory);
-			stbi_image_free(tex);
-
-			// BeginCommandBufferRecordingOperation + SetImageMemoryBarrier
-			layoutConversion(texture.textureImage, vk::Format::eR32G32B32A32Sfloat, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
-				{ vk::AccessFlagBits::eNone, vk::AccessFlagBits::eTransferWrite }, { vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer }, static_cast<uint32_t>(1), static_cast<uint32_t>(i));
-
-			// CopyDataFromBufferToImage
-			copyBuffToImage(hostBuff, texture.textureImage, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), static_cast<uint32_t>(1), static_cast<uint32_t>(i));
-
-		}
-		catch (...) {
-			stbi_image_free(tex);
-			device.getDevice().destroyBuffer(hostBuff);
-			device.getDevice().freeMemory(hostBuffMemory);
-			throw runtime_error("Unspecified error in loadTextureCubemap.");
-		}
-		
-		device.getDevice().destroyBuffer(hostBuff);
-		device.getDevice().freeMemory(hostBuffMemory);
-
-		layoutConversion(texture.textureImage, vk::Format::eR32G32B32A32Sfloat, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
-			{ vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead }, { vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader }, static_cast<uint32_t>(1), static_cast<uint32_t>(i));
-
+		HdaManifest::freeImage(image);
+		throw runtime_error("Unspecified error in uploadTexture().\n");
 	}
 
-	cout << "loadTextureCubemap(): Textures ";
-	for (size_t i = 0; i < filename.size(); i++)
-		cout  << filename[i] << " | ";
-	cout << "are loaded.\n";
+	cout << "uploadTexture(): Texture " << name << " is uploaded.\n";
 }
 
 
-void HdaBuilder::layoutConversion(vk::Image img, vk::Format form, vk::ImageLayout oldLay, vk::ImageLayout newLay,
-								  array<vk::AccessFlagBits, 2> accessMasks, array<vk::PipelineStageFlagBits, 2> stageMasks, uint32_t layerCount, uint32_t baseArr) {
-
-	vk::CommandBuffer commandBuff =
-		device.getDevice().allocateCommandBuffers(
-			vk::CommandBufferAllocateInfo(
-				commandPools[actual_frame],
-				vk::CommandBufferLevel::ePrimary,
-				1
-			)
-		)[0];
-
-	commandBuff.begin(
-		vk::CommandBufferBeginInfo(
-			vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
-			nullptr  // pInheritanceInfo
-		)
-	);
-	
-	commandBuff.pipelineBarrier(
-		stageMasks[0], stageMasks[1],
-		vk::DependencyFlags(),
-		0, {},
-		0, {},
-		1,
-		&(const vk::ImageMemoryBarrier&)vk::ImageMemoryBarrier(
-			accessMasks[0], accessMasks[1],
-			oldLay, newLay,
-			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
-			img,
-			vk::ImageSubresourceRange(
-				vk::ImageAspectFlagBits::eColor,
-				0, 1,	// baseMipLevel + levelCount 
-				baseArr, layerCount //1	// baseArrayLayer + layerCount 
-			)
-		)
-	);
+void HdaBuilder::uploadTextureCubemap(vector<HdaManifest::ImageData>& images, HdaModel::Texture& texture) {
 	
-	commandBuff.end();
-
-	device.getGraphicsQueue().submit(
-		vk::ArrayProxy<const vk::SubmitInfo>(
-			1,
-			&(const vk::SubmitInfo&)vk::SubmitInfo(
-				0, nullptr,
-				nullptr,
-				1, &commandBuff,
-				0, nullptr
-			)
-		)
-	);
-
-	device.getGraphicsQueue().waitIdle();
-	device.getDevice().freeCommandBuffers(commandPools[actual_frame], commandBuff);
-}
-
-
-void HdaBuilder::copyBuffToImage(vk::Buffer srcBuff, vk::Image dstImg, vk::ImageLayout dstImgLay, uint32_t width, uint32_t height, uint32_t layerCount, uint32_t baseArr) {
-
-	vk::CommandBuffer commandBuff =
-		device.getDevice().allocateCommandBuffers(
-			vk::CommandBufferAllocateInfo(
-				commandPools[actual_frame],
-				vk::CommandBufferLevel::ePrimary,
-				1
+	uint32_t layerCount = static_cast<uint32_t>(images.size());
+																	// eR8G8B8A8Srgb eR16G16B16A16Sfloat
+	texture.textureImage = swapchain.createImage(images[0].width, images[0].height, vk::Format::eR32G32B32A32Sfloat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+		vk::MemoryPropertyFlagBits::eDeviceLocal, texture.textureImageMemory, layerCount, vk::ImageCreateFlagBits::eCubeCompatible);
+
+	texture.textureImageView = swapchain.createImageView(texture.textureImage, vk::Format::eR32G32B32A32Sfloat, vk::ImageAspectFlagBits::eColor, layerCount, vk::ImageViewType::eCube);
+
+	texture.textureSampler =
+		device.getDevice().createSampler(
+			vk::SamplerCreateInfo(
+				vk::SamplerCreateFlags(),
+				vk::Filter::eLinear,
+				vk::Filter::eLinear,
+				vk::SamplerMipmapMode::eNearest,
+				vk::SamplerAddressMode::eClampToEdge,
+				vk::SamplerAddressMode::eClampToEdge,
+				vk::SamplerAddressMode::eClampToEdge,
+				0.0f,
+				VK_TRUE, //VK_TRUE,	// nebo false
+				device.getPhysDevice().getProperties().limits.maxSamplerAnisotropy, // 1.0f
+				VK_FALSE,
+				vk::CompareOp::eAlways,
+				0.0f,
+				1.0f,
+				vk::BorderColor::eFloatOpaqueBlack,
+				VK_FALSE
 			)
-		)[0];
+		);
 
-	commandBuff.begin(
-		vk::CommandBufferBeginInfo(
-			vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
-			nullptr  // pInheritanceInfo
-		)
-	);
+	// all faces share the barriers of one copy pass, the faces are freed when they are in staging arena
+	upload.recordImageUpload("cubemap", texture.textureImage, layerCount, [&]() {
 
+		for (size_t i = 0; i < images.size(); i++) {
 
-	commandBuff.copyBufferToImage(
-		srcBuff,	
-		dstImg,
-		dstImgLay,
-		1,				// region count
-		&(const vk::BufferImageCopy&)vk::BufferImageCopy(	// region
-			0, 0, 0,			// buffer offset + buffer row length + buffer image height
-			vk::ImageSubresourceLayers(
-				vk::ImageAspectFlagBits::eColor,
-				0, baseArr, layerCount // 1			// mip level + base array layer + layer count
-			),
-			vk::Offset3D(0, 0, 0),
-			vk::Extent3D(width, height, 1)
-		)
-	);
+			float* tex = images[i].hdrPixels;
+			int texWidth = images[i].width, texHeight = images[i].height;
 
+			vk::DeviceSize layerSize = static_cast<uint64_t>(texWidth * texHeight * 4 * 2 * 2);
 
-	commandBuff.end();
-	
-	device.getGraphicsQueue().submit(
-		vk::ArrayProxy<const vk::SubmitInfo>(
-			1,
-			&(const vk::SubmitInfo&)vk::SubmitInfo(
-				0, nullptr,
-				nullptr,
-				1, &commandBuff,
-				0, nullptr
-			)
-		)
-	);
+			try {
+				upload.copyToImage(tex, layerSize, texture.textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), static_cast<uint32_t>(i));
+				HdaManifest::freeImage(images[i]);
+			}
+			catch (...) {
+				HdaManifest::freeImage(images[i]);
+				throw runtime_error("Unspecified error in uploadTextureCubemap().");
+			}
+		}
+	});
 
-	device.getGraphicsQueue().waitIdle();
-	device.getDevice().freeCommandBuffers(commandPools[actual_frame], commandBuff);
+	cout << "uploadTextureCubemap(): " << images.size() << " faces of cubemap are uploaded.\n";
 }
 
 
-void HdaBuilder::loadCubemapSkybox(HdaModel::SceneObject* obj) {
-
-	// TODO TODO lOADING
-	vector<const char*> skyboxImagesSky3{
-		"..\\models\\textures\\sky-8k\\px.hdr",		//skybox-right 
-		"..\\models\\textures\\sky-8k\\nx.hdr",		//skybox-left" 
-		"..\\models\\textures\\sky-8k\\py.hdr",		//skybox-top" 
-		"..\\models\\textures\\sky-8k\\ny.hdr",		//skybox-bot" 
-		"..\\models\\textures\\sky-8k\\pz.hdr",		//skybox-front"
-		"..\\models\\textures\\sky-8k\\nz.hdr" };		//= sky-8k\\nz.hdr  skybox-back" };
-	vector<const char*> skyboxImagesSky4{
-		"..\\models\\textures\\skybox\\px.hdr",		//skybox-right 
-		"..\\models\\textures\\skybox\\nx.hdr",		//skybox-left" 
-		"..\\models\\textures\\skybox\\py.hdr",		//skybox-top" 
-		"..\\models\\textures\\skybox\\ny.hdr",		//skybox-bot" 
-		"..\\models\\textures\\skybox\\pz.hdr",		//skybox-front"
-		"..\\models\\textures\\skybox\\nz.hdr" };		//= sky-8k\\nz.hdr  skybox-back" };
+// mesh and faces of skybox were decoded by the asset graph of loadScene()
+void HdaBuilder::createSkybox(HdaModel::SceneObject* obj, vector<HdaManifest::ImageData>& faces) {
 
-	loadMesh(obj->objectMesh, "..\\models\\sky-cube-def.obj", "..\\models");
+	uploadMesh(obj->objectMesh, sceneDesc.skybox.mesh.string());
 	obj->objectTexture.resize(1);
-	loadTextureCubemap(skyboxImagesSky4, obj->objectTexture[0]);
-	obj->modelMatrix = glm::translate(glm::mat4{ 1.0f }, { 0, 0, 0 });
-	obj->modelMatrix = glm::scale(obj->modelMatrix, { 300, 300, 300 });		// TODO TODO
+	uploadTextureCubemap(faces, obj->objectTexture[0]);
+	obj->modelMatrix = glm::scale(glm::mat4{ 1.0f }, glm::vec3(sceneDesc.skybox.scale));
 	obj->objectDescriptSetLay = pipeline.createDescriptorSetLayout(0, 1);
 	obj->objectPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &obj->objectDescriptSetLay, UINT32_MAX, nullptr);
 	obj->objectPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX,
@@ -982,6 +911,7 @@ void HdaBuilder::loadCubemapSkybox(HdaModel::SceneObject* obj) {
 					0.f,  // depthBiasSlopeFactor
 					1.f   // lineWidth
 		}, nullptr, nullptr, nullptr, nullptr, obj->objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+	createDeferredPipeline(obj, true);
 	obj->objectDescriptSets =
 		createDescriptorSets(
 			obj->objectDescriptSetLay,
@@ -999,126 +929,201 @@ void HdaBuilder::loadCubemapSkybox(HdaModel::SceneObject* obj) {
 }
 
 
+/**
+*	@brief Load the scene of manifest.
+*
+*	Meshes and images are decoded by the asset graph on worker threads, textures named
+*	by .mtl file are added to the graph when their mesh is loaded. Buffers, images and
+*	pipelines are created on the main thread afterwards. The skybox is always loaded
+*	and rendered last.
+*
+*/
 void HdaBuilder::loadScene() {
 
-	size_t s = sceneObjects.size();
-	size_t idx = sceneObjects.size() - (s--);
+	HdaManifest::AssetGraph graph;
+	vector<vector<HdaManifest::ImageData>> images(sceneObjects.size());
+	vector<uint32_t> meshAssets(sceneObjects.size());
 
-	// TODO TODO 
-	//sceneObjs[idx].createSceneObject(loadMesh(sceneObjs[idx].objMesh, "..\\models\\monkey_smooth.obj"), );
-	
+	for (size_t idx = 0; idx < sceneDesc.objects.size(); idx++) {
 
-	//idx = sceneObjects.size() - (s--);
-	loadMesh(sceneObjects[idx].objectMesh, "..\\models\\m-1.obj", "..\\models"); //"..\\models\\sponza\\sponza.obj", "..\\models\\sponza"
-	sceneObjects[idx].objectTexture.resize(sceneObjects[idx].objectMesh.numMat);
-	
-	// TODO TODO make separated function
-	for (uint32_t i = 0; i < sceneObjects[idx].objectMesh.numMat; i++) {
-		cout << "texName[" << i << "]:" << sceneObjects[idx].objectMesh.texNames[i] << endl;
-		if (sceneObjects[idx].objectMesh.texNames[i].empty())
-			loadTexture(sceneObjects[idx].objectTexture[i], "..\\models\\textures\\default.png");
-		else
-			loadTexture(sceneObjects[idx].objectTexture[i], ("..\\models\\textures\\m-1tex\\" + sceneObjects[idx].objectMesh.texNames[i].replace(8, 1, "\\")).c_str());
-		// TODO TODO smazat
-		//loadTexture(sceneObjects[idx].objectTexture[i], ("..\\models\\sponza\\" + sceneObjects[idx].objectMesh.texNames[i].replace(8, 1, "\\").replace(sceneObjects[idx].objectMesh.texNames[i].size() - 3, 3, "png")).c_str());
-	}
-	sceneObjects[idx].multiTextureFlag = 1;
-	sceneObjects[idx].nonRotateFlag = 1;
-	sceneObjects[idx].texObjIndex = 1;
-	sceneObjects[idx].modelMatrix = glm::rotate(glm::mat4{ 1.0f }, glm::radians(0.0f), glm::vec3(1, 0, 0));
-	sceneObjects[idx].modelMatrix = glm::translate(sceneObjects[idx].modelMatrix, { 0, -10, 0 });
-	sceneObjects[idx].modelMatrix = glm::scale(sceneObjects[idx].modelMatrix, glm::vec3(0.05f));
-	sceneObjects[idx].objectDescriptSetLay = pipeline.createDescriptorSetLayout(0, 1);
-	sceneObjects[idx].objectPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &sceneObjects[idx].objectDescriptSetLay, UINT32_MAX, nullptr);
-	sceneObjects[idx].objectPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
-															   sceneObjects[idx].objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
-
-	// Create one descriptor for each model texture. The number of textures is predefined in the .mtl file, so it is possible to create a vector of descriptors with a given size. 
-	// The loop loops through all the subfaces and creates a descriptor for all those with the same texture, which is stored at position currentTexIdx in the descriptor vector, 
-	// which is the texture index. The same currentTexIdx index is used for the objectTexture vector created above.
-	sceneObjects[idx].dsv.resize(sceneObjects[idx].objectMesh.numMat);
-	auto currentTexIdx = UINT32_MAX;
-	for (int32_t i = 0; i < sceneObjects[idx].objectMesh.info.size(); i++) {
-		
-		auto thisTexIdx = sceneObjects[idx].objectMesh.info[i].textureIndex;
-		if (thisTexIdx != currentTexIdx && thisTexIdx <= sceneObjects[idx].objectMesh.numMat) {
-			currentTexIdx = thisTexIdx;
+		const HdaManifest::ObjectDesc* desc = &sceneDesc.objects[idx];
+		HdaModel::Mesh* mesh = &sceneObjects[idx].objectMesh;
+		vector<HdaManifest::ImageData>* objImages = &images[idx];
 
-			sceneObjects[idx].dsv[currentTexIdx] = createDescriptorSets(
-				sceneObjects[idx].objectDescriptSetLay,
-				array{
-					vk::DescriptorImageInfo(
-						sceneObjects[idx].objectTexture[currentTexIdx].textureSampler,
-						sceneObjects[idx].objectTexture[currentTexIdx].textureImageView,
-						vk::ImageLayout::eShaderReadOnlyOptimal
-					)
-				}.data(),
-				0,
-				1,
-				1
-			);
-		}
-	}
-	
+		meshAssets[idx] = graph.add(desc->name + ": " + desc->mesh.filename().string(), [this, &graph, &meshAssets, idx, desc, mesh, objImages]() {
 
-	idx = sceneObjects.size() - (s--);
-	loadMesh(sceneObjects[idx].objectMesh, "..\\models\\m-2.obj", "..\\models");
-	sceneObjects[idx].objectTexture.resize(1);
-	loadTexture(sceneObjects[idx].objectTexture[0], "..\\models\\textures\\default.png");
-	sceneObjects[idx].nonTextureFlag = 1;
-
-	sceneObjects[idx].modelMatrix = glm::rotate(glm::mat4{ 1.0f }, glm::radians(0.0f), glm::vec3(1, 0, 0));
-	sceneObjects[idx].modelMatrix = glm::translate(sceneObjects[idx].modelMatrix, { -35.0f, 25.0f, 0.0f });
-	sceneObjects[idx].objectDescriptSetLay = pipeline.createDescriptorSetLayout(0, 1);
-	sceneObjects[idx].objectPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &sceneObjects[idx].objectDescriptSetLay, UINT32_MAX, nullptr);
-	sceneObjects[idx].objectPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
-		sceneObjects[idx].objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
-	sceneObjects[idx].objectDescriptSets =
-		createDescriptorSets(
-			sceneObjects[idx].objectDescriptSetLay,
-			array{
-				vk::DescriptorImageInfo(
-					sceneObjects[idx].objectTexture[0].textureSampler,
-					sceneObjects[idx].objectTexture[0].textureImageView,
-					vk::ImageLayout::eShaderReadOnlyOptimal
-				)
-			}.data(), 0, 1, 1
-		);
+			loadMesh(*mesh, desc->mesh.string().c_str(), desc->materialDir.string());
+			if (!desc->multiTexture)
+				return;
 
-	// skybox is always loaded and rendered last
-	idx = sceneObjects.size() - (s--);
-	loadCubemapSkybox(&sceneObjects[idx]);
-	
-	// reset variable s
-	s = sceneObjects.size();
-}
+			// workers start by run(), so the index of this asset is already stored
+			objImages->resize(mesh->numMat);
+			for (uint32_t i = 0; i < mesh->numMat; i++) {
 
+				filesystem::path file = mesh->texNames[i].empty() ? sceneDesc.defaultTexture : HdaManifest::portablePath(desc->textureDir, mesh->texNames[i]);
+				graph.add(desc->name + ": " + file.filename().string(), [objImages, i, file]() { (*objImages)[i] = HdaManifest::loadImage(file, false); }, { meshAssets[idx] });
+			}
+		}, {});
 
-void HdaBuilder::calculateLightColor(glm::vec4 lightC, glm::vec4 diffuse, glm::vec4 ambient) {
+		if (!desc->multiTexture) {
 
-	lightColor = lightC;
-	diffuseColor = lightColor * diffuse;
-	ambientColor = diffuseColor * ambient;
-}
+			filesystem::path file = desc->texture.empty() ? sceneDesc.defaultTexture : desc->texture;
+			objImages->resize(1);
+			graph.add(desc->name + ": " + file.filename().string(), [objImages, file]() { (*objImages)[0] = HdaManifest::loadImage(file, false); }, {});
+		}
+	}
 
+	HdaModel::SceneObject* skybox = &sceneObjects.back();
+	vector<HdaManifest::ImageData>* faces = &images.back();
+	faces->resize(sceneDesc.skybox.faces.size());
 
-void HdaBuilder::calculateAdditionalData() {
+	graph.add("skybox: " + sceneDesc.skybox.mesh.filename().string(), [this, skybox]() {
+		loadMesh(skybox->objectMesh, sceneDesc.skybox.mesh.string().c_str(), sceneDesc.skybox.mesh.parent_path().string());
+	}, {});
+	for (uint32_t i = 0; i < faces->size(); i++) {
 
-	requiredAlignmentScene = static_cast<uint32_t>(calcRequiredAligment(sizeof(HdaModel::SceneUniformData)));
-	requiredAlignmentMaterial = static_cast<uint32_t>(calcRequiredAligment(sizeof(HdaModel::MaterialLightUniformData)));
-	sceneUniformSize = sizeof(HdaModel::SceneUniformData);
-	materialUniformSize = sizeof(HdaModel::MaterialLightUniformData);
+		filesystem::path file = sceneDesc.skybox.faces[i];
+		graph.add("skybox: " + file.filename().string(), [faces, i, file]() { (*faces)[i] = HdaManifest::loadImage(file, true); }, {});
+	}
 
-	// light colors
-	calculateLightColor(glm::vec4(10.0f, 9.985f, 9.990f, 1.0f), glm::vec4(2.5f, 2.5f, 2.5f, 1.0f), glm::vec4(0.12f, 0.12f, 0.12f, 1.0f));
-	// glm::vec4(1.0f, 0.985f, 0.990f, 1.0f) puvodni		glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)
-	sceneObjectsSize = static_cast<uint32_t>(sceneObjects.size());
+	try {
+		graph.run(jobs);
+	}
+	catch (...) {
+		for (auto& objImages : images)
+			for (auto& image : objImages)
+				HdaManifest::freeImage(image);
+		throw;
+	}
+	graph.printLoadTimes();
+	jobs.printUtilization();
+
+	// copies of all objects are one batch, it is copied while the rest of initialization runs
+	upload.begin();
+	nextMaterialSlot = static_cast<uint32_t>(sceneObjects.size());
+	for (size_t idx = 0; idx < sceneDesc.objects.size(); idx++)
+		createSceneObject(&sceneObjects[idx], sceneDesc.objects[idx], images[idx]);
+	createSkybox(skybox, *faces);
+	upload.submit();
 }
 
 
-void HdaBuilder::setUniformStructures(HdaModel::SceneObject* o, vk::CommandBuffer* cmdBuffs, float t, uint32_t dynamicUniformOffset, uint32_t dynamicMaterialLightUniformOffset, HdaModel::MaterialLightUniformData* matlightData, HdaModel::SceneUniformData* sceneD) {
-
-	HdaModel::PushConstants constants{};
+/**
+*	@brief Create GPU resources of object described by manifest.
+*
+*	Decoded images are uploaded and freed. Instanced objects get the benchmark
+*	instances and the instanced pipelines, the others the pipelines of depth prepass.
+*
+*/
+void HdaBuilder::createSceneObject(HdaModel::SceneObject* o, const HdaManifest::ObjectDesc& desc, vector<HdaManifest::ImageData>& images) {
+
+	uploadMesh(o->objectMesh, desc.mesh.string());
+	o->objectTexture.resize(images.size());
+	for (size_t i = 0; i < images.size(); i++)
+		uploadTexture(o->objectTexture[i], images[i], desc.name + " " + to_string(i));
+
+	o->multiTextureFlag = desc.multiTexture ? 1 : 0;
+	o->nonRotateFlag = desc.rotating ? 0 : 1;
+	o->nonTextureFlag = desc.textured ? 0 : 1;
+	o->texObjIndex = desc.multiTexture ? 1 : 0;
+	o->materialOverrideFlag = desc.materialOverride ? 1 : 0;
+	o->overrideMaterial = desc.material;
+	o->modelMatrix = HdaManifest::modelMatrix(desc);
+	o->objectDescriptSetLay = pipeline.createDescriptorSetLayout(0, 1);
+	o->objectPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &o->objectDescriptSetLay, UINT32_MAX, nullptr);
+
+	// instanced object is the benchmark scene of instancing, one instance is the original object
+	if (desc.instanced) {
+		o->instances = HdaInstancing::createBenchmarkInstances(instanceCounts[instanceCountIdx], INSTANCE_SPACING);
+		o->instanceSphere = HdaInstancing::meshBoundingSphere(o->objectMesh);
+		createInstancedPipelines(o);
+		createInstanceBuffers(o);
+	}
+	else {
+		o->objectPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+												   o->objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+		createPrepassPipelines(o);
+	}
+	createDeferredPipeline(o, false);
+
+	if (desc.multiTexture) {
+
+		// Create one descriptor for each model texture. The number of textures is predefined in the .mtl file, so it is possible to create a vector of descriptors with a given size. 
+		// The loop loops through all the subfaces and creates a descriptor for all those with the same texture, which is stored at position currentTexIdx in the descriptor vector, 
+		// which is the texture index. The same currentTexIdx index is used for the objectTexture vector created above.
+		o->dsv.resize(o->objectMesh.numMat);
+		o->materialSlotBase = nextMaterialSlot;
+		auto currentTexIdx = UINT32_MAX;
+		for (int32_t i = 0; i < o->objectMesh.info.size(); i++) {
+
+			auto thisTexIdx = o->objectMesh.info[i].textureIndex;
+			if (thisTexIdx != currentTexIdx && thisTexIdx <= o->objectMesh.numMat) {
+				currentTexIdx = thisTexIdx;
+				nextMaterialSlot++;
+
+				o->dsv[currentTexIdx] = createDescriptorSets(
+					o->objectDescriptSetLay,
+					array{
+						vk::DescriptorImageInfo(
+							o->objectTexture[currentTexIdx].textureSampler,
+							o->objectTexture[currentTexIdx].textureImageView,
+							vk::ImageLayout::eShaderReadOnlyOptimal
+						)
+					}.data(),
+					0,
+					1,
+					1
+				);
+			}
+		}
+
+		// the range of materials follows the ranges of previous multitextured objects
+		if (nextMaterialSlot > NUM_OF_PARTS_WITH_SAME_TEX + sceneObjects.size())
+			throw runtime_error("createSceneObject(): Materials of multitextured objects do not fit into the dynamic uniform buffer.\n");
+	}
+	else
+		o->objectDescriptSets =
+			createDescriptorSets(
+				o->objectDescriptSetLay,
+				array{
+					vk::DescriptorImageInfo(
+						o->objectTexture[0].textureSampler,
+						o->objectTexture[0].textureImageView,
+						vk::ImageLayout::eShaderReadOnlyOptimal
+					)
+				}.data(), 0, 1, 1
+			);
+
+	if (desc.meshlets)
+		createMeshletCulling(o);
+}
+
+
+void HdaBuilder::calculateLightColor(glm::vec4 lightC, glm::vec4 diffuse, glm::vec4 ambient) {
+
+	lightColor = lightC;
+	diffuseColor = lightColor * diffuse;
+	ambientColor = diffuseColor * ambient;
+}
+
+
+void HdaBuilder::calculateAdditionalData() {
+
+	requiredAlignmentScene = static_cast<uint32_t>(calcRequiredAligment(sizeof(HdaModel::SceneUniformData)));
+	requiredAlignmentMaterial = static_cast<uint32_t>(calcRequiredAligment(sizeof(HdaModel::MaterialLightUniformData)));
+	sceneUniformSize = sizeof(HdaModel::SceneUniformData);
+	materialUniformSize = sizeof(HdaModel::MaterialLightUniformData);
+
+	// light colors
+	calculateLightColor(glm::vec4(10.0f, 9.985f, 9.990f, 1.0f), glm::vec4(2.5f, 2.5f, 2.5f, 1.0f), glm::vec4(0.12f, 0.12f, 0.12f, 1.0f));
+	// glm::vec4(1.0f, 0.985f, 0.990f, 1.0f) puvodni		glm::vec4(0.5f, 0.5f, 0.5f, 1.0f)
+	sceneObjectsSize = static_cast<uint32_t>(sceneObjects.size());
+}
+
+
+void HdaBuilder::setUniformStructures(HdaModel::SceneObject* o, HdaModel::MaterialLightUniformData* matlightData, HdaModel::SceneUniformData* sceneD) {
+
+	HdaModel::PushConstants constants{};
 	array<string, 5> methodNames;
 	methodNames[0] = "\nALGORITHM: Reinhard\n";
 	methodNames[1] = "\nALGORITHM: Hejl-Dawson\n";
@@ -1126,275 +1131,3240 @@ void HdaBuilder::setUniformStructures(HdaModel::SceneObject* o, vk::CommandBuffe
 	methodNames[3] = "\nALGORITHM: ACES TMO\n";
 	methodNames[4] = "\nALGORITHM: Modified Reinhard\n";
 
-	// TODO TODO hodit do vlastni funkce
-	if (window.getKeyPressedXFlag() == true) {
+	// TODO TODO hodit do vlastni funkce
+	if (window.getKeyPressedXFlag() == true) {
+
+		hdrOnFlag == 0 ? hdrOnFlag = 1 : hdrOnFlag = 0;
+		hdrOnFlag == 1 ? cout << "\nHDR: ON" << endl : cout << "\nHDR: OFF" << endl;
+		cout << methodNames[chooseMethodFlag];
+		window.setKeyPressedXFlag();
+	}
+	sceneD->hdrOnFlag = hdrOnFlag;
+
+	if (window.getKeyPressedMFlag() == true) {
+
+		if (chooseMethodFlag == 4)
+			chooseMethodFlag = 0;
+		else
+			chooseMethodFlag += 1;
+		window.setKeyPressedMFlag();
+
+		cout << methodNames[chooseMethodFlag];
+	}
+	sceneD->chooseMethodFlag = chooseMethodFlag;
+
+	sceneD->nontextureFlag = 0;
+
+	// STATIC uniform buffer with model view projection data
+	glm::vec3 cameraPos{ 0.0f, 0.0f, 0.0f };
+	glm::mat4 skyboxView;
+	HdaModel::ProjectionUniformData modelviewProjection = HdaModel::projectionCalculation(o->modelMatrix, window.getGLFWwindow(), &skyboxView, cameraPos, sceneD, window.getKeyPressedXFlag(), &exposure);
+	memcpy(uniformBuffsMemoryPointer[actual_frame], &modelviewProjection, sizeof(modelviewProjection));
+	sceneD->exposure = exposure;
+
+	// DYNAMIC uniform structure bind to dynamic uniform buffer with lighting and material data
+	HdaModel::loadLightData(matlightData, ambientColor, diffuseColor, glm::vec4(1.0f));
+
+	// world transform of object was computed by the scene for this frame
+	uint32_t idx = static_cast<uint32_t>(o - sceneObjects.data());
+
+	// selection of objects that should not be textured
+	if (o->nonTextureFlag == 1) {
+		sceneD->nontextureFlag = 1;
+	}
+
+	constants.cameraPosition = cameraPos;
+	o->pushConstants = constants;
+
+	// prepare matricies for calculation of normal matrix in vertex shader
+	sceneD->modelMatrix = scene.getWorldTransform(sceneEntities[idx]);
+	sceneD->modelView = modelviewProjection.view * sceneD->modelMatrix;
+	sceneD->normalMatrix = glm::transpose(glm::inverse(sceneD->modelView));
+	sceneD->normalMatrixWorld = glm::transpose(glm::inverse(sceneD->modelMatrix));
+
+	if (uploadSceneData(idx, *sceneD))
+		mapMemoryToUniformBuffer(sceneUniformBuffMemory, sceneUniformSize, PARALLEL_FRAMES * sceneUniformSlots, *matlightData, sceneUniformSlot(idx), *sceneD, SELECT_SCENEDATA);
+	if (scene.isDirty(sceneEntities[idx], SCENE_DIRTY_MATERIAL))
+		mapMemoryToUniformBuffer(materialLightUniformBuffMemory, materialUniformSize, sceneObjectsSize, *matlightData, idx, *sceneD, SELECT_MATLIGHTDATA);
+
+	// flags of keys held in this frame are used by the lighting pass of deferred shading
+	frameSceneData = *sceneD;
+}
+
+
+void HdaBuilder::mapMemoryToUniformBuffer(vk::DeviceMemory devMem, size_t sizeofStructure, uint32_t numOfSizes, HdaModel::MaterialLightUniformData matlightData, uint32_t offsetN, HdaModel::SceneUniformData sceneData, uint32_t structSelect) {
+
+	char* data{};
+	if (device.getDevice().mapMemory(devMem, 0, calcRequiredAligment(sizeofStructure) * numOfSizes, vk::MemoryMapFlags(), (void**)&data) != vk::Result::eSuccess)
+		throw runtime_error("Function vk::Device::mapMemory() crash.\n");
+	data += calcRequiredAligment(sizeofStructure) * offsetN;
+	if (structSelect == 1)
+		memcpy(data, &sceneData, sizeofStructure);
+	else
+		memcpy(data, &matlightData, sizeofStructure);
+	device.getDevice().unmapMemory(devMem);
+}
+
+
+// uniform data and levels of detail of submeshes, descriptor sets are bound by recordObject()
+void HdaBuilder::prepareMultiTexturedObject(HdaModel::SceneObject* o) {
+
+	uint32_t currentTexIdx = UINT32_MAX;
+
+	HdaModel::MaterialLightUniformData matlightData{};
+	HdaModel::SceneUniformData sceneData{};
+
+	uint32_t infoSize = static_cast<uint32_t>(o->objectMesh.info.size());
+
+	setUniformStructures(o, &matlightData, &sceneData);
+	updateMeshletCullData(o, sceneData.modelView);
+
+	o->selectedLods.resize(infoSize);
+	o->submeshMaterialSlots.resize(infoSize);
+
+	// materials do not change, they are uploaded only for the first drawing
+	HdaScene::Handle entity = sceneEntities[o - sceneObjects.data()];
+	bool materialDirty = scene.isDirty(entity, SCENE_DIRTY_MATERIAL);
+	scene.clearDirty(entity, SCENE_DIRTY_MATERIAL);
+
+	// loop through grouoped faces (triangles)
+	for (uint32_t i = 0, k = 0; i < infoSize; i++) {
+
+		auto thisTexIdx = o->objectMesh.info[i].textureIndex;
+		if (thisTexIdx != currentTexIdx && thisTexIdx <= o->objectMesh.numMat) {
+
+			currentTexIdx = thisTexIdx;
+
+			// set material properties
+			const HdaModel::Material& mat = o->materialOverrideFlag == 1 ? o->overrideMaterial : o->objectMesh.mats[currentTexIdx];
+			HdaModel::loadMaterialData(&matlightData, mat.ambient, mat.diffuse, mat.specular, mat.shi);
+
+			if (materialDirty)
+				mapMemoryToUniformBuffer(materialLightUniformBuffMemory, materialUniformSize, nextMaterialSlot, matlightData, o->materialSlotBase + k, sceneData, SELECT_MATLIGHTDATA);
+			
+			k++;
+		}
+
+		// submeshes with the same texture share the material slot of dynamic uniform buffer
+		o->submeshMaterialSlots[i] = o->materialSlotBase + (k == 0 ? 0 : k - 1);
+		o->selectedLods[i] = selectLod(o->objectMesh.info[i], o->modelMatrix);
+	}
+}
+
+
+// TODO TODO
+void HdaBuilder::prepareSingleTexturedObject(HdaModel::SceneObject* o, int i) {
+
+	// DYNAMIC uniform structure bind to dynamic uniform buffer with additional scene data
+	HdaModel::SceneUniformData sceneData;
+	array<string, 5> methodNames;
+	methodNames[0] = "\nALGORITHM: Reinhard TMO\n";
+	methodNames[1] = "\nALGORITHM: Hejl-Dawson TMO\n";
+	methodNames[2] = "\nALGORITHM: Hable - Uncharted 2 TMO\n";
+	methodNames[3] = "\nALGORITHM: ACES TMO\n";
+	methodNames[4] = "\nALGORITHM: Modified Reinhard TMO\n";
+
+	// TODO TODO hodi do vlastn funkce
+	if (window.getKeyPressedXFlag() == true) {
+
+		hdrOnFlag == 0 ? hdrOnFlag = 1 : hdrOnFlag = 0;
+		hdrOnFlag == 1 ? cout << "\nHDR: ON" << endl : cout << "\nHDR: OFF" << endl;
+		cout << methodNames[chooseMethodFlag];
+		window.setKeyPressedXFlag();
+	}
+	sceneData.hdrOnFlag = hdrOnFlag;
+
+	if (window.getKeyPressedMFlag() == true) {
+
+		if (chooseMethodFlag == 4)
+			chooseMethodFlag = 0;
+		else
+			chooseMethodFlag += 1;
+
+		window.setKeyPressedMFlag();
+		
+		cout << methodNames[chooseMethodFlag];
+	}
+	sceneData.chooseMethodFlag = chooseMethodFlag;
+	sceneData.nontextureFlag = 0;
+	
+	// STATIC uniform buffer with model view projection data
+	glm::vec3 cameraPos{ 0.0f, 0.0f, 0.0f };
+	glm::mat4 skyboxView;
+	HdaModel::ProjectionUniformData modelviewProjection = HdaModel::projectionCalculation(o->modelMatrix, window.getGLFWwindow(), &skyboxView, cameraPos, &sceneData, window.getKeyPressedXFlag(), &exposure);
+	memcpy(uniformBuffsMemoryPointer[actual_frame], &modelviewProjection, sizeof(modelviewProjection));
+	sceneData.exposure = exposure;
+
+	// DYNAMIC uniform structure bind to dynamic uniform buffer with lighting and material data
+	HdaModel::MaterialLightUniformData matlightData;
+	HdaModel::loadLightData(&matlightData, ambientColor, diffuseColor, glm::vec4(1.0f));
+	if (o->materialOverrideFlag == 1)
+		HdaModel::loadMaterialData(&matlightData, o->overrideMaterial.ambient, o->overrideMaterial.diffuse, o->overrideMaterial.specular, o->overrideMaterial.shi);
+	else
+		HdaModel::loadMaterialData(&matlightData, glm::vec4(0.6f, 0.6f, 0.6f, 0.0f), glm::vec4(0.6f, 0.6f, 0.6f, 0.0f), glm::vec4(0.5f, 0.5f, 0.5f, 0.0f), 16.0f);
+
+
+	HdaModel::PushConstants constants{};
+
+	// the skybox requires its own view matrix, which lacks a translational component
+	// because the skybox must always be in the middle of the camera and we are not allowed to approach it,
+	// skybox.vert takes it from the view matrix of the frame
+	// 
+	// depending on the type of the object, we choose different structures for push constants
+	if (i == (sceneObjectsSize - 1))	// skybox is rendered as last object because depth testing 
+		o->skyboxConstants.modelMatrix = o->modelMatrix;
+	else {
+
+		// world transform of object was computed by the scene for this frame
+		sceneData.modelMatrix = scene.getWorldTransform(sceneEntities[i]);
+
+		// selection of objects that should not be textured
+		if (o->nonTextureFlag == 1) {
+			sceneData.nontextureFlag = 1;
+		}
+
+		constants.cameraPosition = cameraPos;
+		o->pushConstants = constants;
+
+		// prepare matricies for calculation of normal matrix in vertex shader
+		sceneData.modelView = modelviewProjection.view * sceneData.modelMatrix;
+		sceneData.normalMatrix = glm::transpose(glm::inverse(sceneData.modelView));
+		sceneData.normalMatrixWorld = glm::transpose(glm::inverse(sceneData.modelMatrix));
+	}
+
+	if (uploadSceneData(i, sceneData))
+		mapMemoryToUniformBuffer(sceneUniformBuffMemory, sceneUniformSize, PARALLEL_FRAMES * sceneUniformSlots, matlightData, sceneUniformSlot(i), sceneData, SELECT_SCENEDATA);
+	if (scene.isDirty(sceneEntities[i], SCENE_DIRTY_MATERIAL)) {
+		mapMemoryToUniformBuffer(materialLightUniformBuffMemory, materialUniformSize, sceneObjectsSize, matlightData, i, sceneData, SELECT_MATLIGHTDATA);
+		scene.clearDirty(sceneEntities[i], SCENE_DIRTY_MATERIAL);
+	}
+
+	if (!o->instances.empty()) {
+		cullObjectInstances(o);
+		return;
+	}
+
+	// index buffer contains levels of detail behind the submeshes, so every submesh is drawn separately
+	o->selectedLods.resize(o->objectMesh.info.size());
+	for (size_t s = 0; s < o->objectMesh.info.size(); s++)
+		o->selectedLods[s] = selectLod(o->objectMesh.info[s], o->modelMatrix);
+}
+
+
+uint32_t HdaBuilder::selectLod(const HdaModel::IndexInfo& inf, const glm::mat4& model) {
+
+	float pixelScale = renderExtent.height * 0.5f / tan(glm::radians(CAMERA_FOV) * 0.5f);
+	uint32_t lod = HdaMeshLod::selectLod(inf, model, HdaModel::getCameraPosition(), pixelScale, LOD_PIXEL_ERROR);
+	lodHistogram[lod]++;
+
+	return lod;
+}
+
+void HdaBuilder::createMeshletCullPipeline() {
+
+	// uniform data + meshlets, source indices, culled indices, draw commands, visibility + depth pyramid
+	cullDescriptSetLay = pipeline.createComputeDescriptorSetLayout({ vk::DescriptorType::eUniformBuffer, vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eCombinedImageSampler });
+
+	// culling phase
+	vk::PushConstantRange pushRange{ vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t) };
+	cullPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &cullDescriptSetLay, 1, &pushRange);
+	cullPipeline = pipeline.createComputePipeline(pipeline.getMeshletCullShaderModule(), cullPipelineLayout);
+}
+
+
+void HdaBuilder::createDepthPyramidPipeline() {
+
+	// source depth or previous level + destination level
+	pyramidDescriptSetLay = pipeline.createComputeDescriptorSetLayout({ vk::DescriptorType::eCombinedImageSampler, vk::DescriptorType::eStorageImage });
+
+	// source and destination size
+	vk::PushConstantRange pushRange{ vk::ShaderStageFlagBits::eCompute, 0, sizeof(glm::ivec4) };
+	pyramidPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &pyramidDescriptSetLay, 1, &pushRange);
+	pyramidPipeline = pipeline.createComputePipeline(pipeline.getDepthPyramidShaderModule(), pyramidPipelineLayout);
+
+	// texels are read by texelFetch(), so no filtering is needed
+	depthPyramidSampler =
+		device.getDevice().createSampler(
+			vk::SamplerCreateInfo(
+				vk::SamplerCreateFlags(),
+				vk::Filter::eNearest,  // magFilter
+				vk::Filter::eNearest,  // minFilter
+				vk::SamplerMipmapMode::eNearest,  // mipmapMode
+				vk::SamplerAddressMode::eClampToEdge,  // addressModeU
+				vk::SamplerAddressMode::eClampToEdge,  // addressModeV
+				vk::SamplerAddressMode::eClampToEdge,  // addressModeW
+				0.0f,  // mipLodBias
+				VK_FALSE,  // anisotropyEnable
+				1.0f,  // maxAnisotropy
+				VK_FALSE,  // compareEnable
+				vk::CompareOp::eAlways,  // compareOp
+				0.0f,  // minLod
+				static_cast<float>(DEPTH_PYRAMID_MAX_LEVELS),  // maxLod
+				vk::BorderColor::eFloatOpaqueWhite,  // borderColor
+				VK_FALSE  // unnormalizedCoordinates
+			)
+		);
+
+	pyramidDescriptSets =
+		device.getDevice().allocateDescriptorSets(
+			vk::DescriptorSetAllocateInfo(
+				descriptorPool,
+				static_cast<uint32_t>(DEPTH_PYRAMID_MAX_LEVELS),
+				vector<vk::DescriptorSetLayout>(DEPTH_PYRAMID_MAX_LEVELS, pyramidDescriptSetLay).data()
+			)
+		);
+
+	cout << "createDepthPyramidPipeline(): Depth pyramid pipeline is created.\n";
+}
+
+
+/**
+*	@brief Write views of depth attachment and depth pyramid into descriptor sets.
+*
+*	The views are created together with swapchain, so the sets are updated again
+*	after the swapchain is recreated.
+*
+*/
+void HdaBuilder::updateOcclusionDescriptors() {
+
+	uint32_t levels = swapchain.getDepthPyramidLevels();
+
+	for (uint32_t l = 0; l < levels; l++) {
+
+		// level 0 reads the depth attachment left by the early render pass
+		vk::DescriptorImageInfo srcInfo(depthPyramidSampler, l == 0 ? swapchain.getDepthImageView() : swapchain.getDepthPyramidLevelView(l - 1),
+										l == 0 ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eGeneral);
+		vk::DescriptorImageInfo dstInfo(nullptr, swapchain.getDepthPyramidLevelView(l), vk::ImageLayout::eGeneral);
+
+		device.getDevice().updateDescriptorSets(
+			array{
+				vk::WriteDescriptorSet(pyramidDescriptSets[l], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &srcInfo, nullptr, nullptr),
+				vk::WriteDescriptorSet(pyramidDescriptSets[l], 1, 0, 1, vk::DescriptorType::eStorageImage, &dstInfo, nullptr, nullptr)
+			},
+			nullptr
+		);
+	}
+
+	vk::DescriptorImageInfo pyramidInfo(depthPyramidSampler, swapchain.getDepthPyramidView(), vk::ImageLayout::eGeneral);
+	for (auto& o : sceneObjects)
+		for (size_t i = 0; i < o.cullDescriptSets.size(); i++)
+			device.getDevice().updateDescriptorSets(
+				vk::WriteDescriptorSet(o.cullDescriptSets[i], 6, 0, 1, vk::DescriptorType::eCombinedImageSampler, &pyramidInfo, nullptr, nullptr),
+				nullptr
+			);
+}
+
+
+/**
+*	@brief Create buffers for culling of meshlets of object.
+*
+*	Every frame has its own culled index buffer and draw command buffer. The culled index
+*	buffer is a copy of the index buffer, the compute shader rewrites only level 0 ranges
+*	of submeshes with visible meshlets and the levels of detail behind them stay untouched.
+*	Draw command buffer is host visible, so the number of visible meshlets can be read back.
+*	It holds draw commands of the early phase followed by the late phase of occlusion culling.
+*	Visibility of meshlets is shared by frames, as it is used in the order of frames.
+*
+*/
+void HdaBuilder::createMeshletCulling(HdaModel::SceneObject* o) {
+
+	HdaModel::Mesh& mesh = o->objectMesh;
+	if (mesh.meshlets.empty())
+		return;
+
+	vk::DeviceSize meshletSize = sizeof(mesh.meshlets[0]) * mesh.meshlets.size();
+	vk::DeviceSize indexSize = sizeof(mesh.meshIndices[0]) * mesh.meshIndices.size();
+	vk::DeviceSize drawSize = MESHLET_DRAW_OFFSET + sizeof(vk::DrawIndexedIndirectCommand) * mesh.info.size() * 2;
+	vk::DeviceSize visibilitySize = sizeof(uint32_t) * mesh.meshlets.size();
+
+	createBuffer(meshletSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer,
+		vk::MemoryPropertyFlagBits::eDeviceLocal, o->meshletBuff, o->meshletBuffMemory);
+	upload.copyToBuffer(mesh.meshlets.data(), meshletSize, o->meshletBuff, 0);
+
+	// draw commands of all submeshes with zero index count, region of submesh starts at its level 0,
+	// the first index of late phase is written by the compute shader
+	vector<char> drawTemplate(drawSize, 0);
+	for (size_t i = 0; i < mesh.info.size() * 2; i++) {
+		vk::DrawIndexedIndirectCommand cmd(0, 1, i < mesh.info.size() ? mesh.info[i].firstVertex : 0, 0, 0);
+		memcpy(drawTemplate.data() + MESHLET_DRAW_OFFSET + i * sizeof(cmd), &cmd, sizeof(cmd));
+	}
+	createBuffer(drawSize, vk::BufferUsageFlagBits::eTransferSrc,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, o->drawTemplateBuff, o->drawTemplateBuffMemory);
+	void* data = device.getDevice().mapMemory(o->drawTemplateBuffMemory, 0, drawSize, vk::MemoryMapFlags());
+	memcpy(data, drawTemplate.data(), static_cast<size_t>(drawSize));
+	device.getDevice().unmapMemory(o->drawTemplateBuffMemory);
+
+	// nothing is visible before the first frame, the late phase draws everything which is not occluded
+	createBuffer(visibilitySize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer,
+		vk::MemoryPropertyFlagBits::eDeviceLocal, o->visibilityBuff, o->visibilityBuffMemory);
+	upload.fillBuffer(o->visibilityBuff, visibilitySize, 0);
+
+	o->culledIndexBuffs.resize(PARALLEL_FRAMES);
+	o->culledIndexBuffsMemory.resize(PARALLEL_FRAMES);
+	o->drawCmdBuffs.resize(PARALLEL_FRAMES);
+	o->drawCmdBuffsMemory.resize(PARALLEL_FRAMES);
+	o->drawCmdBuffsPointer.resize(PARALLEL_FRAMES);
+	o->cullUniformBuffs.resize(PARALLEL_FRAMES);
+	o->cullUniformBuffsMemory.resize(PARALLEL_FRAMES);
+	o->cullUniformBuffsPointer.resize(PARALLEL_FRAMES);
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		createBuffer(indexSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal, o->culledIndexBuffs[i], o->culledIndexBuffsMemory[i]);
+		upload.copyBuffer(mesh.indexBuff, o->culledIndexBuffs[i], indexSize);
+
+		createBuffer(drawSize, vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, o->drawCmdBuffs[i], o->drawCmdBuffsMemory[i]);
+		o->drawCmdBuffsPointer[i] = device.getDevice().mapMemory(o->drawCmdBuffsMemory[i], 0, drawSize, vk::MemoryMapFlags());
+		memcpy(o->drawCmdBuffsPointer[i], drawTemplate.data(), static_cast<size_t>(drawSize));
+
+		createBuffer(sizeof(HdaMeshlet::CullUniformData), vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, o->cullUniformBuffs[i], o->cullUniformBuffsMemory[i]);
+		o->cullUniformBuffsPointer[i] = device.getDevice().mapMemory(o->cullUniformBuffsMemory[i], 0, sizeof(HdaMeshlet::CullUniformData), vk::MemoryMapFlags());
+		HdaMeshlet::CullUniformData cullData{};
+		memcpy(o->cullUniformBuffsPointer[i], &cullData, sizeof(cullData));
+	}
+
+	o->cullDescriptSets =
+		device.getDevice().allocateDescriptorSets(
+			vk::DescriptorSetAllocateInfo(
+				descriptorPool,
+				static_cast<uint32_t>(PARALLEL_FRAMES),
+				vector<vk::DescriptorSetLayout>(PARALLEL_FRAMES, cullDescriptSetLay).data()
+			)
+		);
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		// depth pyramid in binding 6 is written by updateOcclusionDescriptors()
+		array<vk::DescriptorBufferInfo, 6> buffInfos = {
+			vk::DescriptorBufferInfo(o->cullUniformBuffs[i], 0, sizeof(HdaMeshlet::CullUniformData)),
+			vk::DescriptorBufferInfo(o->meshletBuff, 0, meshletSize),
+			vk::DescriptorBufferInfo(mesh.indexBuff, 0, indexSize),
+			vk::DescriptorBufferInfo(o->culledIndexBuffs[i], 0, indexSize),
+			vk::DescriptorBufferInfo(o->drawCmdBuffs[i], 0, drawSize),
+			vk::DescriptorBufferInfo(o->visibilityBuff, 0, visibilitySize)
+		};
+
+		vector<vk::WriteDescriptorSet> writes;
+		for (uint32_t b = 0; b < buffInfos.size(); b++)
+			writes.push_back(
+				vk::WriteDescriptorSet(
+					o->cullDescriptSets[i],
+					b,
+					0,
+					1,
+					b == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer,
+					nullptr,
+					&buffInfos[b],
+					nullptr
+				)
+			);
+
+		device.getDevice().updateDescriptorSets(writes, nullptr);
+	}
+
+	meshletTotal += static_cast<uint32_t>(mesh.meshlets.size());
+
+	cout << "createMeshletCulling(): Meshlet culling buffers are created.\n";
+}
+
+
+/**
+*	@brief Record culling of meshlets of all objects.
+*
+*	One workgroup per meshlet appends visible meshlets into the culled index buffer, the index
+*	counts were reset by resetMeshletDraws() before the single or early phase. The late phase
+*	appends behind the early phase and is recorded after the depth pyramid is built. Barriers
+*	around the culling are derived by the scene graph of recordScenePasses().
+*
+*/
+void HdaBuilder::recordMeshletCulling(vk::CommandBuffer* cmdBuffs, uint32_t phase) {
+
+	cmdBuffs->bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+	cmdBuffs->pushConstants(cullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t), &phase);
+
+	for (auto& o : sceneObjects) {
+
+		if (o.cullDescriptSets.empty())
+			continue;
+
+		cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipelineLayout, 0, 1, &o.cullDescriptSets[actual_frame], 0, nullptr);
+		uint32_t meshletCnt = static_cast<uint32_t>(o.objectMesh.meshlets.size());
+		cmdBuffs->dispatch(std::min<uint32_t>(meshletCnt, MESHLET_DISPATCH_ROW), (meshletCnt + MESHLET_DISPATCH_ROW - 1) / MESHLET_DISPATCH_ROW, 1);
+	}
+}
+
+
+// index counts of draw commands are copied from the template buffer, all objects share one barrier before the culling
+void HdaBuilder::resetMeshletDraws(vk::CommandBuffer* cmdBuffs) {
+
+	for (auto& o : sceneObjects) {
+
+		if (o.cullDescriptSets.empty())
+			continue;
+
+		vk::DeviceSize drawSize = MESHLET_DRAW_OFFSET + sizeof(vk::DrawIndexedIndirectCommand) * o.objectMesh.info.size() * 2;
+		cmdBuffs->copyBuffer(o.drawTemplateBuff, o.drawCmdBuffs[actual_frame], vk::BufferCopy(0, 0, drawSize));
+	}
+}
+
+
+/**
+*	@brief Record building of depth pyramid from depth of the early render pass.
+*
+*	Every level is reduced from the previous one. The scene graph discards the old content
+*	by the transition into eGeneral and makes the last level visible to the late culling,
+*	the barriers between levels stay in the pass, because the graph tracks the whole image.
+*
+*/
+void HdaBuilder::recordDepthPyramid(vk::CommandBuffer* cmdBuffs) {
+
+	uint32_t levels = swapchain.getDepthPyramidLevels();
+	glm::uvec2 size = swapchain.getDepthPyramidExtent();
+
+	cmdBuffs->bindPipeline(vk::PipelineBindPoint::eCompute, pyramidPipeline);
+
+	// the depth has the size of render extent in the corner of attachment, the pyramid covers only it
+	glm::ivec2 srcSize{ renderExtent.width, renderExtent.height };
+	for (uint32_t l = 0; l < levels; l++) {
+
+		glm::ivec2 dstSize{ std::max(size.x >> l, 1u), std::max(size.y >> l, 1u) };
+		glm::ivec4 sizes{ srcSize, dstSize };
+
+		cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eCompute, pyramidPipelineLayout, 0, 1, &pyramidDescriptSets[l], 0, nullptr);
+		cmdBuffs->pushConstants(pyramidPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(sizes), &sizes);
+		cmdBuffs->dispatch((dstSize.x + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, (dstSize.y + DEPTH_PYRAMID_GROUP_SIZE - 1) / DEPTH_PYRAMID_GROUP_SIZE, 1);
+
+		// the next level reads this one
+		if (l + 1 < levels)
+			cmdBuffs->pipelineBarrier(
+				vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+				vk::DependencyFlags(),
+				vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+				nullptr, nullptr
+			);
+
+		srcSize = dstSize;
+	}
+}
+
+
+// toggles are handled before recording, so all passes of one frame use the same mode
+void HdaBuilder::handleCullingKeys() {
+
+	if (window.getKeyPressedKFlag() == true) {
+
+		array<string, 3> cullNames = { "OFF", "frustum", "frustum + backface cones" };
+		meshletCullMode = (meshletCullMode + 1) % 3;
+		cout << "\nMESHLET CULLING: " << cullNames[meshletCullMode] << endl;
+		window.setKeyPressedKFlag();
+	}
+
+	if (window.getKeyPressedJFlag() == true) {
+
+		depthPrepass = !depthPrepass;
+		depthPrepass ? cout << "\nDEPTH PREPASS: ON" << endl : cout << "\nDEPTH PREPASS: OFF" << endl;
+		window.setKeyPressedJFlag();
+	}
+
+	if (window.getKeyPressedLFlag() == true) {
+
+		occlusionCulling = !occlusionCulling;
+		occlusionCulling ? cout << "\nOCCLUSION CULLING: ON" << endl : cout << "\nOCCLUSION CULLING: OFF" << endl;
+		window.setKeyPressedLFlag();
+	}
+}
+
+
+// uniform data are written during recording, the compute shader reads them after submit
+void HdaBuilder::updateMeshletCullData(HdaModel::SceneObject* o, const glm::mat4& modelView) {
+
+	if (o->cullDescriptSets.empty())
+		return;
+
+	float aspect = static_cast<float>(swapchain.getSurfaceExtent().width) / static_cast<float>(swapchain.getSurfaceExtent().height);
+	HdaMeshlet::CullUniformData cullData = HdaMeshlet::prepareCullData(modelView, aspect, meshletCullMode, static_cast<uint32_t>(o->objectMesh.meshlets.size()));
+	cullData.submeshCnt = static_cast<uint32_t>(o->objectMesh.info.size());
+	cullData.pyramidSize = glm::vec2(swapchain.getDepthPyramidExtent());
+	memcpy(o->cullUniformBuffsPointer[actual_frame], &cullData, sizeof(cullData));
+}
+
+
+/**
+*	@brief Read the number of visible meshlets of the finished frame.
+*
+*	Called after the timeline wait of actual frame, so its uniform data are still the ones used
+*	by the GPU. Once per FPS report the CPU culling runs with the same data as reference,
+*	it does not include the occlusion test.
+*
+*/
+void HdaBuilder::readMeshletStatistics() {
+
+	if (meshletCullMode == MESHLET_CULL_OFF)
+		return;
+
+	uint32_t visible = 0, late = 0, occluded = 0, reference = 0;
+	for (auto& o : sceneObjects) {
+
+		if (o.cullDescriptSets.empty())
+			continue;
+
+		// early (or single), late and occluded meshlet counters
+		const uint32_t* counters = static_cast<uint32_t*>(o.drawCmdBuffsPointer[actual_frame]);
+		visible += counters[0] + counters[1];
+		late += counters[1];
+		occluded += counters[2];
+		if (frames == 0)
+			reference += HdaMeshlet::cullMeshlets(o.objectMesh, *static_cast<HdaMeshlet::CullUniformData*>(o.cullUniformBuffsPointer[actual_frame]), nullptr);
+	}
+
+	gpuVisibleMeshlets = visible;
+	gpuLateMeshlets = late;
+	gpuOccludedMeshlets = occluded;
+	if (frames == 0)
+		cpuVisibleMeshlets = reference;
+}
+
+
+// uniform data, levels of detail and visible instances of all objects, the recording of frame only reads them
+void HdaBuilder::prepareScene() {
+
+	// time counter
+	static auto startT = std::chrono::high_resolution_clock::now();
+	auto currentT = std::chrono::high_resolution_clock::now();
+	float t = std::chrono::duration<float, std::chrono::seconds::period>(currentT - startT).count();
+
+	lodHistogram.fill(0);
+	uniformUploads = 0;
+	uniformSkips = 0;
+	updateSceneTransforms(t);
+
+	for (uint32_t i = 0; i < sceneObjectsSize; i++) {
+		if (sceneObjects[i].multiTextureFlag == 1)
+			prepareMultiTexturedObject(&sceneObjects[i]);
+		else
+			prepareSingleTexturedObject(&sceneObjects[i], i);
+
+		if (staticCommands)
+			writeDrawArgs(&sceneObjects[i]);
+	}
+}
+
+
+/**
+*	@brief Split the draws of mode into chunks.
+*
+*	A chunk is a range of submeshes of one object with its pipeline, objects with more
+*	than maxDraws submeshes are split. Instanced objects and the skybox are one chunk.
+*	With occlusion culling the early phase draws everything except the skybox, the late
+*	phase draws only the meshlets which became visible and the skybox as the last object.
+*
+*/
+vector<HdaBuilder::DrawChunk> HdaBuilder::createDrawChunks(uint32_t phase, uint32_t mode, uint32_t maxDraws) {
+
+	vector<DrawChunk> chunks;
+
+	for (uint32_t i = 0; i < sceneObjectsSize; i++) {
+
+		// skybox does not occlude anything, it is drawn only by the last shading
+		bool skybox = i == (sceneObjectsSize - 1);
+		if (skybox && (phase == MESHLET_PHASE_EARLY || mode == DRAW_MODE_DEPTH || mode == DRAW_MODE_GBUFFER))
+			continue;
+		if (!skybox && mode == DRAW_MODE_SKYBOX)
+			continue;
+		if (phase == MESHLET_PHASE_LATE && !skybox && sceneObjects[i].cullDescriptSets.empty())
+			continue;
+
+		// instances are culled on CPU, so they are drawn only by the shading
+		bool instanced = !sceneObjects[i].instances.empty();
+		if (instanced && mode == DRAW_MODE_DEPTH)
+			continue;
+
+		vk::Pipeline objectPipe = sceneObjects[i].objectPipeline;
+		if (!skybox && mode == DRAW_MODE_DEPTH)
+			objectPipe = sceneObjects[i].depthPrepassPipeline;
+		else if (!skybox && !instanced && mode == DRAW_MODE_EQUAL)
+			objectPipe = sceneObjects[i].depthEqualPipeline;
+		else if (mode == DRAW_MODE_GBUFFER || mode == DRAW_MODE_SKYBOX)
+			objectPipe = sceneObjects[i].deferredPipeline;
+
+		uint32_t infoSize = static_cast<uint32_t>(sceneObjects[i].objectMesh.info.size());
+		uint32_t step = (skybox || instanced) ? infoSize : maxDraws;
+		for (uint32_t first = 0; first < infoSize; first += step)
+			chunks.push_back(DrawChunk{ i, first, min(infoSize, first + step), objectPipe });
+	}
+
+	return chunks;
+}
+
+
+// pipeline and buffers are bound again only when they change
+void HdaBuilder::recordChunks(vk::CommandBuffer* cmdBuffs, const vector<DrawChunk>& chunks, uint32_t first, uint32_t end, uint32_t phase) {
+
+	vk::Pipeline currentPipe{};
+	vk::Buffer currentVertexBuff{};
+
+	for (uint32_t c = first; c < end; c++) {
+
+		HdaModel::SceneObject* o = &sceneObjects[chunks[c].object];
+
+		// check if last pipe and vertex buffer is not same for higher performance
+		if (chunks[c].pipeline != currentPipe) {
+
+			cmdBuffs->bindPipeline(vk::PipelineBindPoint::eGraphics, chunks[c].pipeline);
+
+			currentPipe = chunks[c].pipeline;
+		}
+
+		if (o->objectMesh.vertexBuff != currentVertexBuff) {
+
+			vk::Buffer vertexBuffers[] = { o->objectMesh.vertexBuff };
+			vk::DeviceSize offsets[] = { 0 };
+			cmdBuffs->bindVertexBuffers(0, 1, vertexBuffers, offsets);
+
+			// culled index buffer contains the static levels of detail as well
+			if (meshletCullMode != MESHLET_CULL_OFF && !o->cullDescriptSets.empty())
+				cmdBuffs->bindIndexBuffer(o->culledIndexBuffs[actual_frame], 0, vk::IndexType::eUint32);
+			else
+				cmdBuffs->bindIndexBuffer(o->objectMesh.indexBuff, 0, vk::IndexType::eUint32);
+
+			currentVertexBuff = o->objectMesh.vertexBuff;
+		}
+
+		recordObject(o, cmdBuffs, chunks[c].object, phase, chunks[c].first, chunks[c].end);
+	}
+}
+
+
+/**
+*	@brief Record the scene into the render pass begun by beginRenderpass().
+*
+*	With inline contents the whole scene goes into the primary command buffer. With
+*	secondary command buffers every chunk is recorded by a job and the primary
+*	executes them in the order of chunks, so the result does not depend on threads.
+*
+*/
+void HdaBuilder::drawScene(vk::CommandBuffer* cmdBuffs, uint32_t phase, uint32_t mode) {
+
+	if (recordingContents == vk::SubpassContents::eInline) {
+
+		vector<DrawChunk> chunks = createDrawChunks(phase, mode, UINT32_MAX);
+		recordChunks(cmdBuffs, chunks, 0, static_cast<uint32_t>(chunks.size()), phase);
+		return;
+	}
+
+	if (staticCommands) {
+		drawStaticScene(cmdBuffs, phase, mode);
+		return;
+	}
+
+	vector<DrawChunk> chunks = createDrawChunks(phase, mode, RECORD_CHUNK_DRAWS);
+	vector<vk::CommandBuffer> secondaries = recordSecondaries(chunks, phase, static_cast<uint32_t>(chunks.size()), false);
+	if (!secondaries.empty())
+		cmdBuffs->executeCommands(secondaries);
+}
+
+
+/**
+*	@brief Record draws of object with the state prepared for the frame.
+*
+*	Uniform data were already written by prepareScene(), so only the push constants,
+*	descriptor sets and levels of detail are used. Submeshes [first, end) are drawn,
+*	so one object can be recorded by more threads. The late phase draws only
+*	the meshlets which were not drawn by the early phase.
+*
+*/
+void HdaBuilder::recordObject(HdaModel::SceneObject* o, vk::CommandBuffer* cmdBuffs, uint32_t idx, uint32_t phase, uint32_t first, uint32_t end) {
+
+	uint32_t infoSize = static_cast<uint32_t>(o->objectMesh.info.size());
+	if (o->selectedLods.size() != infoSize && o->instances.empty())
+		return;
+
+	bool meshletCulled = meshletCullMode != MESHLET_CULL_OFF && !o->cullDescriptSets.empty();
+
+	if (idx == sceneObjectsSize - 1)
+		cmdBuffs->pushConstants(o->objectPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(HdaModel::SkyboxPushConstants), &o->skyboxConstants);
+	else
+		cmdBuffs->pushConstants(o->objectPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(HdaModel::PushConstants), &o->pushConstants);
+
+	// every object has its own slot of scene data, multitextured objects bind their range of materials below
+	uint32_t offsets[] = { requiredAlignmentScene * sceneUniformSlot(idx), 0 };
+	if (o->multiTextureFlag == 1)
+		cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, o->objectPipelineLayout, 0, 1, &o->dsv[0][actual_frame], 2, offsets);
+	else {
+		offsets[1] = requiredAlignmentMaterial * idx;
+		cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, o->objectPipelineLayout, 0, 1, &o->objectDescriptSets[actual_frame], 2, offsets);
+	}
+
+	if (!o->instances.empty()) {
+		drawInstances(o, cmdBuffs);
+		return;
+	}
+
+	uint32_t currentTexIdx = UINT32_MAX;
+	for (uint32_t i = first; i < end; i++) {
+
+		auto thisTexIdx = o->objectMesh.info[i].textureIndex;
+		if (o->multiTextureFlag == 1 && thisTexIdx != currentTexIdx && thisTexIdx <= o->objectMesh.numMat) {
+
+			currentTexIdx = thisTexIdx;
+			offsets[1] = static_cast<uint32_t>(requiredAlignmentMaterial * o->submeshMaterialSlots[i]);
+			cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, o->objectPipelineLayout, 0, 1, &o->dsv[currentTexIdx][actual_frame], 2, offsets);
+		}
+
+		// visible meshlets of level 0 were compacted by compute shader, the index count is known only on GPU
+		uint32_t lod = o->selectedLods[i];
+		if (lod == 0 && meshletCulled)
+			cmdBuffs->drawIndexedIndirect(
+				o->drawCmdBuffs[actual_frame],
+				MESHLET_DRAW_OFFSET + (phase == MESHLET_PHASE_LATE ? infoSize + i : i) * sizeof(vk::DrawIndexedIndirectCommand),  // offset
+				1,  // drawCount
+				sizeof(vk::DrawIndexedIndirectCommand)  // stride
+			);
+		else if (phase != MESHLET_PHASE_LATE && recordingStatic)	// level of detail of the frame is in the draw arguments
+			cmdBuffs->drawIndexedIndirect(
+				o->drawArgsBuffs[actual_frame],
+				i * sizeof(vk::DrawIndexedIndirectCommand),  // offset
+				1,  // drawCount
+				sizeof(vk::DrawIndexedIndirectCommand)  // stride
+			);
+		else if (phase != MESHLET_PHASE_LATE)	// the other levels of detail were drawn completely by the early phase
+			cmdBuffs->drawIndexed(
+				o->objectMesh.info[i].lodIndexCnt[lod],  // indexCount
+				1,  // instanceCount
+				o->objectMesh.info[i].lodFirstIndex[lod],  // firstIndex
+				0,  // vertexOffset
+				0   // firstInstance
+			);
+	}
+}
+
+
+// depth prepass is recorded in the same render pass before the shading
+void HdaBuilder::recordScene(vk::CommandBuffer* cmdBuffs, uint32_t phase) {
+
+	if (depthPrepass) {
+		drawScene(cmdBuffs, phase, DRAW_MODE_DEPTH);
+		drawScene(cmdBuffs, phase, DRAW_MODE_EQUAL);
+	}
+	else
+		drawScene(cmdBuffs, phase, DRAW_MODE_FULL);
+}
+
+
+/**
+*	@brief Create pipelines of object for the depth prepass mode.
+*
+*	The prepass pipeline has only the vertex shader with position and writes no color.
+*	The shading pipeline tests depth with eEqual, so every pixel is shaded only once.
+*	Both use the layout of the object pipeline.
+*
+*/
+void HdaBuilder::createPrepassPipelines(HdaModel::SceneObject* o) {
+
+	o->depthPrepassPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), 1,
+		array{  // pStages
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eVertex,  // stage
+				pipeline.getDepthPrepassVertexShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+		}.data(),
+		&(const vk::PipelineVertexInputStateCreateInfo&)vk::PipelineVertexInputStateCreateInfo{  // pVertexInputState
+			vk::PipelineVertexInputStateCreateFlags(),
+			1,  // vertexBindingDescriptionCount
+			&(HdaModel::Vertex::getBindingDescription()),  // pVertexBindingDescriptions
+			1,  // vertexAttributeDescriptionCount - position only
+			HdaModel::Vertex::getAttributeDescription().data()  // pVertexAttributeDescriptions
+		}, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+		&(const vk::PipelineColorBlendStateCreateInfo&)vk::PipelineColorBlendStateCreateInfo{  // pColorBlendState
+			vk::PipelineColorBlendStateCreateFlags(),
+			VK_FALSE,  // logicOpEnable
+			vk::LogicOp::eClear,  // logicOp
+			1,  // attachmentCount
+			array{  // pAttachments
+				vk::PipelineColorBlendAttachmentState{
+					VK_FALSE,  // blendEnable
+					vk::BlendFactor::eZero,  // srcColorBlendFactor
+					vk::BlendFactor::eZero,  // dstColorBlendFactor
+					vk::BlendOp::eAdd,       // colorBlendOp
+					vk::BlendFactor::eZero,  // srcAlphaBlendFactor
+					vk::BlendFactor::eZero,  // dstAlphaBlendFactor
+					vk::BlendOp::eAdd,       // alphaBlendOp
+					vk::ColorComponentFlags()  // colorWriteMask
+				},
+			}.data(),
+			array<float,4>{0.f,0.f,0.f,0.f}  // blendConstants
+		}, nullptr, o->objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+
+	o->depthEqualPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+		&(const vk::PipelineDepthStencilStateCreateInfo&)vk::PipelineDepthStencilStateCreateInfo{
+			vk::PipelineDepthStencilStateCreateFlags(),
+			VK_TRUE,  // depthTestEnable
+			VK_FALSE,  // depthWriteEnable
+			vk::CompareOp::eEqual,  // depthCompareOp
+			VK_FALSE,
+			VK_FALSE,
+			{},
+			{},
+			0.0f,
+			1.0f
+		}, nullptr, nullptr, o->objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+}
+
+
+/**
+*	@brief Create query pool for the overdraw ratio.
+*
+*	Fragment shader invocations of the whole frame are divided by the number of pixels.
+*	The depth prepass has no fragment shader, so it is not counted.
+*
+*/
+void HdaBuilder::createStatisticsQuery() {
+
+	if (!device.getPipelineStatisticsSupport())
+		return;
+
+	statisticsQueryPool =
+		device.getDevice().createQueryPool(
+			vk::QueryPoolCreateInfo(
+				vk::QueryPoolCreateFlags(),
+				vk::QueryType::ePipelineStatistics,
+				static_cast<uint32_t>(PARALLEL_FRAMES),
+				vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations
+			)
+		);
+
+	cout << "createStatisticsQuery(): Query pool is created.\n";
+}
+
+
+// called after the timeline wait of actual frame, so the query is available
+void HdaBuilder::readOverdrawStatistics() {
+
+	// no query around secondary command buffers without inherited queries
+	if (!statisticsRecorded[actual_frame]) {
+		overdrawRatio = 0.0;
+		return;
+	}
+
+	uint64_t invocations = 0;
+	vk::Result result = device.getDevice().getQueryPoolResults(statisticsQueryPool, static_cast<uint32_t>(actual_frame), 1, sizeof(invocations), &invocations,
+															   sizeof(invocations), vk::QueryResultFlagBits::e64);
+	if (result != vk::Result::eSuccess)
+		return;
+
+	double pixels = static_cast<double>(frameRenderExtents[actual_frame].width) * frameRenderExtents[actual_frame].height;
+	overdrawRatio = static_cast<double>(invocations) / pixels;
+}
+
+
+// clear values are used only by render passes which clear the attachments, secondary command buffers inherit the render pass
+void HdaBuilder::beginRenderpass(vk::CommandBuffer* cmdBuffs, vk::RenderPass rp, vk::SubpassContents contents) {
+
+	recordingRenderpass = rp;
+	recordingFramebuffer = swapchain.getSceneFramebuffer();
+	recordingContents = contents;
+
+	cmdBuffs->beginRenderPass(
+		vk::RenderPassBeginInfo(
+			rp,
+			swapchain.getSceneFramebuffer(),  // HDR scene color, the swapchain image is written by tone mapping
+			vk::Rect2D(vk::Offset2D(0, 0), renderExtent),  // renderArea, the scaled viewport
+			2,  // clearValueCount
+			array{  // pClearValues
+				vk::ClearValue(array<float,4>{0.447f, 0.451f, 0.565f, 1.f}),	// {0.678f, 0.973f, 0.992f, 1.f})
+				vk::ClearValue({1.0f, 0}),	// The initial value at each point in the depth buffer should be the furthest possible depth, which is 1.0.
+			}.data()
+			),
+		contents
+	);
+}
+
+
+/**
+*	@brief Record culling and render passes of the scene by the scene graph.
+*
+*	Light culling, reset and culling of meshlets, the depth pyramid and the render passes
+*	declare what they read and write, the graph derives barriers between them. Render passes
+*	keep transitions of their attachments, so depth and scene color are declared as buffers
+*	and only the hazards are synchronized. The last pass records nothing, its read makes the
+*	counters of meshlet culling visible to host. Light indices of async compute are acquired
+*	by acquireClusters() before the graph, the graph has no ownership transfers.
+*
+*/
+void HdaBuilder::recordScenePasses(vk::CommandBuffer* cmdBuffs, vk::SubpassContents contents) {
+
+	using Stage = vk::PipelineStageFlagBits2;
+	using Acc = vk::AccessFlagBits2;
+	using Layout = vk::ImageLayout;
+
+	const HdaGraph::Access computeRead{ Stage::eComputeShader, Acc::eShaderRead, Layout::eUndefined };
+	const HdaGraph::Access computeWrite{ Stage::eComputeShader, Acc::eShaderWrite, Layout::eUndefined };
+	const HdaGraph::Access drawRead{ Stage::eDrawIndirect | Stage::eVertexInput, Acc::eIndirectCommandRead | Acc::eIndexRead, Layout::eUndefined };
+	const HdaGraph::Access fragmentRead{ Stage::eFragmentShader, Acc::eShaderRead, Layout::eUndefined };
+	const HdaGraph::Access depthWrite{ Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, Acc::eDepthStencilAttachmentWrite, Layout::eUndefined };
+	const HdaGraph::Access colorWrite{ Stage::eColorAttachmentOutput, Acc::eColorAttachmentWrite, Layout::eUndefined };
+	const HdaGraph::Access pyramidRead{ Stage::eComputeShader, Acc::eShaderRead, Layout::eGeneral };
+	const HdaGraph::Access pyramidWrite{ Stage::eComputeShader, Acc::eShaderWrite, Layout::eGeneral };
+
+	bool culled = meshletCullMode != MESHLET_CULL_OFF;
+	bool twoPhase = !deferredShading && occlusionCulling && culled;
+
+	sceneGraph.clear();
+
+	// light indices and draw commands belong to the frame, their previous frame was waited by host
+	uint32_t clusters = sceneGraph.addResource({ "light clusters", vk::Image(), {}, {} });
+	uint32_t draws = sceneGraph.addResource({ "meshlet draws", vk::Image(), {}, {} });
+	uint32_t visibility = sceneGraph.addResource({ "meshlet visibility", vk::Image(), {}, visibilityState });
+	uint32_t depth = sceneGraph.addResource({ "scene depth", vk::Image(), {}, {} });
+	// the late culling of the previous frame sampled the pyramid, its content is not needed
+	uint32_t pyramid = sceneGraph.addResource({ "depth pyramid", swapchain.getDepthPyramidImage(),
+												vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, swapchain.getDepthPyramidLevels(), 0, 1),
+												{ Stage::eComputeShader, Acc::eShaderRead, Layout::eUndefined } });
+	// post processing reads scene color, host reads counters of meshlet culling after the frame
+	uint32_t scene = sceneGraph.addResource({ "scene color", vk::Image(), {}, {}, false, true });
+	uint32_t host = sceneGraph.addResource({ "host readback", vk::Image(), {}, {}, false, true });
+
+	// render passes draw the culled meshlets and read light indices in fragment shaders
+	auto sceneUses = [&](uint32_t p) {
+
+		if (culled)
+			sceneGraph.read(p, draws, drawRead);
+		sceneGraph.read(p, clusters, fragmentRead);
+		sceneGraph.write(p, depth, depthWrite);
+		sceneGraph.write(p, scene, colorWrite);
+	};
+
+	uint32_t pass;
+	if (!asyncFrame) {
+
+		pass = sceneGraph.addPass("light culling", [this](vk::CommandBuffer* cmd) { recordLightCulling(cmd, false); });
+		sceneGraph.write(pass, clusters, computeWrite);
+	}
+
+	if (culled) {
+
+		pass = sceneGraph.addPass("meshlet reset", [this](vk::CommandBuffer* cmd) { resetMeshletDraws(cmd); });
+		sceneGraph.write(pass, draws, { Stage::eTransfer, Acc::eTransferWrite, Layout::eUndefined });
+
+		uint32_t phase = twoPhase ? MESHLET_PHASE_EARLY : MESHLET_PHASE_SINGLE;
+		pass = sceneGraph.addPass(twoPhase ? "meshlet culling early" : "meshlet culling", [this, phase](vk::CommandBuffer* cmd) { recordMeshletCulling(cmd, phase); });
+		sceneGraph.read(pass, draws, computeRead);
+		sceneGraph.write(pass, draws, computeWrite);
+		sceneGraph.read(pass, visibility, computeRead);
+		sceneGraph.write(pass, visibility, computeWrite);
+	}
+
+	// two phase occlusion culling - draw meshlets visible in the last frame, build depth pyramid
+	// from their depth and draw meshlets which are not occluded and were not drawn yet
+	if (deferredShading) {
+
+		pass = sceneGraph.addPass("deferred scene", [this, contents](vk::CommandBuffer* cmd) {
+			recordDeferred(cmd, contents);
+			cmd->endRenderPass();
+		});
+		sceneUses(pass);
+	}
+	else if (twoPhase) {
+
+		pass = sceneGraph.addPass("early scene", [this, contents](vk::CommandBuffer* cmd) {
+			beginRenderpass(cmd, device.getEarlyRenderpass(), contents);
+			recordScene(cmd, MESHLET_PHASE_EARLY);
+			cmd->endRenderPass();
+		});
+		sceneUses(pass);
+
+		pass = sceneGraph.addPass("depth pyramid", [this](vk::CommandBuffer* cmd) { recordDepthPyramid(cmd); });
+		sceneGraph.read(pass, depth, computeRead);
+		sceneGraph.read(pass, pyramid, pyramidRead);
+		sceneGraph.write(pass, pyramid, pyramidWrite);
+
+		pass = sceneGraph.addPass("meshlet culling late", [this](vk::CommandBuffer* cmd) { recordMeshletCulling(cmd, MESHLET_PHASE_LATE); });
+		sceneGraph.read(pass, pyramid, pyramidRead);
+		sceneGraph.read(pass, draws, computeRead);
+		sceneGraph.write(pass, draws, computeWrite);
+		sceneGraph.read(pass, visibility, computeRead);
+		sceneGraph.write(pass, visibility, computeWrite);
+
+		pass = sceneGraph.addPass("late scene", [this, contents](vk::CommandBuffer* cmd) {
+			beginRenderpass(cmd, device.getLateRenderpass(), contents);
+			recordScene(cmd, MESHLET_PHASE_LATE);
+			cmd->endRenderPass();
+		});
+		sceneUses(pass);
+	}
+	else {
+
+		pass = sceneGraph.addPass("scene", [this, contents](vk::CommandBuffer* cmd) {
+			beginRenderpass(cmd, device.getRenderpass(), contents);
+			recordScene(cmd, MESHLET_PHASE_SINGLE);
+			cmd->endRenderPass();
+		});
+		sceneUses(pass);
+	}
+
+	if (culled) {
+
+		pass = sceneGraph.addPass("host readback", nullptr);
+		sceneGraph.read(pass, draws, { Stage::eHost, Acc::eHostRead, Layout::eUndefined });
+		sceneGraph.write(pass, host, { Stage::eHost, {}, Layout::eUndefined });
+	}
+
+	sceneGraph.compile();
+	sceneGraph.execute(cmdBuffs, device.getPipelineBarrier2());
+	visibilityState = sceneGraph.getFinalState(visibility);
+
+	// the flag is cleared by the graph of post processing
+	if (graphDump)
+		cout << "\n" << sceneGraph.dump();
+}
+
+
+/**
+*	@brief Create pipeline and buffers of clustered lighting.
+*
+*	Every frame has its own light list, cluster grid uniform buffer and light indices
+*	of clusters, so the lights can move while the previous frame is rendered. The buffers
+*	are written into descriptor sets of scene objects by createDescriptorSets().
+*
+*/
+void HdaBuilder::createLightCulling() {
+
+	// uniform data + lights, light indices of clusters
+	lightCullDescriptSetLay = pipeline.createComputeDescriptorSetLayout({ vk::DescriptorType::eUniformBuffer, vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eStorageBuffer });
+	lightCullPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &lightCullDescriptSetLay, 0, nullptr);
+	lightCullPipeline = pipeline.createComputePipeline(pipeline.getLightCullShaderModule(), lightCullPipelineLayout);
+
+	vk::DeviceSize lightSize = sizeof(HdaLights::Light) * LIGHTS_MAX;
+	vk::DeviceSize clusterSize = sizeof(uint32_t) * CLUSTER_COUNT * CLUSTER_STRIDE;
+
+	lightBuffs.resize(PARALLEL_FRAMES);
+	lightBuffsMemory.resize(PARALLEL_FRAMES);
+	lightBuffsPointer.resize(PARALLEL_FRAMES);
+	clusterBuffs.resize(PARALLEL_FRAMES);
+	clusterBuffsMemory.resize(PARALLEL_FRAMES);
+	clusterUniformBuffs.resize(PARALLEL_FRAMES);
+	clusterUniformBuffsMemory.resize(PARALLEL_FRAMES);
+	clusterUniformBuffsPointer.resize(PARALLEL_FRAMES);
+
+	// light list and grid are written by host and read by both queues,
+	// light indices are released by the compute queue to the graphics queue every frame
+	vector<uint32_t> families;
+	if (device.getAsyncComputeSupport())
+		families = { device.getGraphicsQueueFamily(), device.getComputeQueueFamily() };
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		createBuffer(lightSize, vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, lightBuffs[i], lightBuffsMemory[i], families);
+		lightBuffsPointer[i] = device.getDevice().mapMemory(lightBuffsMemory[i], 0, lightSize, vk::MemoryMapFlags());
+		memset(lightBuffsPointer[i], 0, static_cast<size_t>(lightSize));
+
+		createBuffer(clusterSize, vk::BufferUsageFlagBits::eStorageBuffer,
+			vk::MemoryPropertyFlagBits::eDeviceLocal, clusterBuffs[i], clusterBuffsMemory[i]);
+
+		createBuffer(sizeof(HdaLights::ClusterUniformData), vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, clusterUniformBuffs[i], clusterUniformBuffsMemory[i], families);
+		clusterUniformBuffsPointer[i] = device.getDevice().mapMemory(clusterUniformBuffsMemory[i], 0, sizeof(HdaLights::ClusterUniformData), vk::MemoryMapFlags());
+		memcpy(clusterUniformBuffsPointer[i], &clusterData, sizeof(clusterData));
+	}
+
+	lightCullDescriptSets =
+		device.getDevice().allocateDescriptorSets(
+			vk::DescriptorSetAllocateInfo(
+				descriptorPool,
+				static_cast<uint32_t>(PARALLEL_FRAMES),
+				vector<vk::DescriptorSetLayout>(PARALLEL_FRAMES, lightCullDescriptSetLay).data()
+			)
+		);
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		array<vk::DescriptorBufferInfo, 3> buffInfos = {
+			vk::DescriptorBufferInfo(clusterUniformBuffs[i], 0, sizeof(HdaLights::ClusterUniformData)),
+			vk::DescriptorBufferInfo(lightBuffs[i], 0, lightSize),
+			vk::DescriptorBufferInfo(clusterBuffs[i], 0, clusterSize)
+		};
+
+		vector<vk::WriteDescriptorSet> writes;
+		for (uint32_t b = 0; b < buffInfos.size(); b++)
+			writes.push_back(
+				vk::WriteDescriptorSet(
+					lightCullDescriptSets[i],
+					b,
+					0,
+					1,
+					b == 0 ? vk::DescriptorType::eUniformBuffer : vk::DescriptorType::eStorageBuffer,
+					nullptr,
+					&buffInfos[b],
+					nullptr
+				)
+			);
+
+		device.getDevice().updateDescriptorSets(writes, nullptr);
+	}
+
+	cout << "createLightCulling(): Light culling pipeline and buffers are created.\n";
+}
+
+
+/**
+*	@brief Create light list of the scene.
+*
+*	The two spotlights of the scene are followed by point lights of the stress scene
+*	spread over the bounding box of the first object. Only the first lightCounts[lightCountIdx]
+*	lights are used.
+*
+*/
+void HdaBuilder::loadLights() {
+
+	glm::vec3 minP{ FLT_MAX };
+	glm::vec3 maxP{ -FLT_MAX };
+	for (const auto& v : sceneObjects[0].objectMesh.meshVertices) {
+		glm::vec3 p = glm::vec3(sceneObjects[0].modelMatrix * glm::vec4(v.position, 1.0f));
+		minP = glm::min(minP, p);
+		maxP = glm::max(maxP, p);
+	}
+	lightCenter = (minP + maxP) * 0.5f;
+
+	HdaModel::MaterialLightUniformData mlData{};
+	lights = HdaLights::sceneLights(mlData.cutOff, mlData.outerCutOff);
+
+	// spotlights of manifest replace the default ones
+	if (!sceneDesc.spotLights.empty()) {
+		lights.resize(min<size_t>(sceneDesc.spotLights.size(), LIGHTS_MAX), lights[0]);
+		for (size_t i = 0; i < lights.size(); i++) {
+			lights[i].position = glm::vec4(sceneDesc.spotLights[i].position, CAMERA_FAR);
+			lights[i].direction = glm::vec4(sceneDesc.spotLights[i].direction, LIGHT_TYPE_SPOT);
+		}
+	}
+	vector<HdaLights::Light> stressLights = HdaLights::createStressLights(LIGHTS_MAX - static_cast<uint32_t>(lights.size()), minP, maxP);
+	lights.insert(lights.end(), stressLights.begin(), stressLights.end());
+
+	lightStartT = chrono::high_resolution_clock::now();
+
+	cout << "loadLights(): " << lights.size() << " lights are created.\n";
+}
+
+
+/**
+*	@brief Record assignment of lights to clusters.
+*
+*	One invocation per cluster tests all lights of the frame, the light indices
+*	are read by fragment shaders of all render passes of the frame. On the graphics
+*	queue the scene graph derives the barrier before them. On the compute queue the
+*	indices are released to the graphics queue, acquireClusters() acquires them.
+*
+*/
+void HdaBuilder::recordLightCulling(vk::CommandBuffer* cmdBuffs, bool release) {
+
+	cmdBuffs->bindPipeline(vk::PipelineBindPoint::eCompute, lightCullPipeline);
+	cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eCompute, lightCullPipelineLayout, 0, 1, &lightCullDescriptSets[actual_frame], 0, nullptr);
+	cmdBuffs->dispatch((CLUSTER_COUNT + CLUSTER_GROUP_SIZE - 1) / CLUSTER_GROUP_SIZE, 1, 1);
+
+	// the graph has no ownership transfers between queue families
+	if (release)
+		cmdBuffs->pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe,
+			vk::DependencyFlags(),
+			nullptr,
+			vk::BufferMemoryBarrier(
+				vk::AccessFlagBits::eShaderWrite, vk::AccessFlags(),
+				device.getComputeQueueFamily(), device.getGraphicsQueueFamily(),	// srcQueueFamilyIndex + dstQueueFamilyIndex
+				clusterBuffs[actual_frame], 0, VK_WHOLE_SIZE
+			),
+			nullptr
+		);
+}
+
+
+/**
+*	@brief Create command buffers of async compute and timestamp queries of both queues.
+*
+*	Every frame has its own pool on the compute family. Timestamps mark the begin and end
+*	of the frame on the graphics queue and of the light culling on the compute queue.
+*
+*/
+void HdaBuilder::createAsyncCompute() {
+
+	if (device.getTimestampSupport())
+		timestampQueryPool =
+			device.getDevice().createQueryPool(
+				vk::QueryPoolCreateInfo(
+					vk::QueryPoolCreateFlags(),
+					vk::QueryType::eTimestamp,
+					static_cast<uint32_t>(PARALLEL_FRAMES * QUEUE_TIMESTAMPS),
+					vk::QueryPipelineStatisticFlags()
+				)
+			);
+
+	if (!device.getAsyncComputeSupport())
+		return;
+
+	computePools.resize(PARALLEL_FRAMES);
+	computeCommandBuffers.resize(PARALLEL_FRAMES);
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+		computePools[i] =
+			device.getDevice().createCommandPool(
+				vk::CommandPoolCreateInfo(
+					vk::CommandPoolCreateFlagBits::eTransient |
+					vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+					device.getComputeQueueFamily()
+				)
+			);
+
+		computeCommandBuffers[i] =
+			device.getDevice().allocateCommandBuffers(
+				vk::CommandBufferAllocateInfo(
+					computePools[i],
+					vk::CommandBufferLevel::ePrimary,
+					1
+				)
+			)[0];
+	}
+
+	cout << "createAsyncCompute(): Command buffers of compute queue are created.\n";
+}
+
+
+// the graphics queue waits for the compute timeline at fragment shader, the acquire is chained to the wait
+void HdaBuilder::acquireClusters(vk::CommandBuffer* cmdBuffs) {
+
+	cmdBuffs->pipelineBarrier(
+		vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eFragmentShader,
+		vk::DependencyFlags(),
+		nullptr,
+		vk::BufferMemoryBarrier(
+			vk::AccessFlags(), vk::AccessFlagBits::eShaderRead,
+			device.getComputeQueueFamily(), device.getGraphicsQueueFamily(),	// srcQueueFamilyIndex + dstQueueFamilyIndex
+			clusterBuffs[actual_frame], 0, VK_WHOLE_SIZE
+		),
+		nullptr
+	);
+}
+
+
+/**
+*	@brief Record and submit light culling of the frame to the compute queue.
+*
+*	Returns the value of compute timeline which the graphics queue waits for. The frame
+*	which read the light indices before was waited by render(), so the old contents are
+*	discarded without transfer back to the compute queue.
+*
+*/
+uint64_t HdaBuilder::submitAsyncCompute() {
+
+	vk::CommandBuffer cmdBuff = computeCommandBuffers[actual_frame];
+	uint32_t firstQuery = static_cast<uint32_t>(actual_frame * QUEUE_TIMESTAMPS);
+
+	cmdBuff.reset();
+	cmdBuff.begin(
+		vk::CommandBufferBeginInfo(
+			vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+			nullptr  // pInheritanceInfo
+		)
+	);
+
+	// the family may have no timestamps, then the frame keeps only the graphics ones
+	bool timestamps = device.getTimestampSupport() && device.getComputeTimestampBits() > 0;
+	if (timestamps) {
+		cmdBuff.resetQueryPool(timestampQueryPool, firstQuery + 2, 2);
+		cmdBuff.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool, firstQuery + 2);
+	}
+
+	recordLightCulling(&cmdBuff, true);
+
+	if (timestamps) {
+		cmdBuff.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, firstQuery + 3);
+		timestampsRecorded[actual_frame] = QUEUE_TIMESTAMPS;
+	}
+
+	cmdBuff.end();
+
+	uint64_t value = device.nextComputeTimelineValue();
+	vk::Semaphore timeline = device.getComputeTimeline();
+
+	device.getComputeQueue().submit(
+		vk::ArrayProxy<const vk::SubmitInfo>(
+			1,
+			&(const vk::SubmitInfo&)vk::SubmitInfo(
+				0, nullptr,
+				nullptr,
+				1, &cmdBuff,
+				1, &timeline,	// signalSemaphoreCount + pSignalSemaphores
+				&(const vk::TimelineSemaphoreSubmitInfo&)vk::TimelineSemaphoreSubmitInfo(	// pNext
+					0, nullptr,
+					1, &value	// signalSemaphoreValueCount + pSignalSemaphoreValues
+				)
+			)
+		),
+		nullptr
+	);
+
+	return value;
+}
+
+
+/**
+*	@brief Read timestamps of the finished frame.
+*
+*	Called after the timeline wait of actual frame. The times are in ms from the first
+*	timestamp of the frame, the overlap is the time when both queues worked on it.
+*	Only timestampValidBits of the queue family are defined, the rest is masked out.
+*
+*/
+void HdaBuilder::readQueueTimestamps() {
+
+	uint32_t cnt = timestampsRecorded[actual_frame];
+	gpuFrameMs = 0.0;
+	if (cnt == 0)
+		return;
+
+	array<uint64_t, QUEUE_TIMESTAMPS> ticks{};
+	vk::Result result = device.getDevice().getQueryPoolResults(timestampQueryPool, static_cast<uint32_t>(actual_frame * QUEUE_TIMESTAMPS), cnt, sizeof(uint64_t) * cnt, ticks.data(),
+															   sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+	if (result != vk::Result::eSuccess)
+		return;
+
+	auto validMask = [](uint32_t bits) { return bits >= 64 ? ~0ull : (1ull << bits) - 1; };
+	for (uint32_t i = 0; i < cnt; i++)
+		ticks[i] &= validMask(i < 2 ? device.getGraphicsTimestampBits() : device.getComputeTimestampBits());
+
+	double msPerTick = device.getPhysDevice().getProperties().limits.timestampPeriod / 1e6;
+	uint64_t first = cnt == QUEUE_TIMESTAMPS ? min(ticks[0], ticks[2]) : ticks[0];
+
+	queueTimeline.fill(0.0);
+	for (uint32_t i = 0; i < cnt; i++)
+		queueTimeline[i] = static_cast<double>(ticks[i] - first) * msPerTick;
+
+	queueOverlap = cnt == QUEUE_TIMESTAMPS ? max(0.0, min(queueTimeline[1], queueTimeline[3]) - max(queueTimeline[0], queueTimeline[2])) : 0.0;
+	gpuFrameMs = max(queueTimeline[1], queueTimeline[3]);
+}
+
+
+// light culling moves between the graphics queue and the compute queue
+void HdaBuilder::handleComputeKeys() {
+
+	if (window.getKeyPressed2Flag() == true) {
+
+		if (device.getAsyncComputeSupport()) {
+			asyncCompute = !asyncCompute;
+			cout << "\nLIGHT CULLING: " << (asyncCompute ? "async compute queue" : "graphics queue") << endl;
+		}
+		else
+			cout << "\nLIGHT CULLING: async compute queue is not available" << endl;
+
+		window.setKeyPressed2Flag();
+	}
+}
+
+
+// light list and cluster grid are written after recording, so they use the camera of the frame
+void HdaBuilder::updateLights() {
+
+	float t = chrono::duration<float>(chrono::high_resolution_clock::now() - lightStartT).count();
+	uint32_t lightCnt = lightCounts[lightCountIdx];
+
+	HdaLights::animateLights(lights, t, lightCenter, animatedLights);
+	memcpy(lightBuffsPointer[actual_frame], animatedLights.data(), sizeof(HdaLights::Light) * lightCnt);
+
+	clusterData = HdaLights::prepareClusterData(HdaModel::getCameraView(), renderExtent.width, renderExtent.height, lightCnt);
+	memcpy(clusterUniformBuffsPointer[actual_frame], &clusterData, sizeof(clusterData));
+}
+
+
+// the measured time of the current light count is printed with the times of other counts
+void HdaBuilder::handleLightKeys() {
+
+	if (window.getKeyPressedNFlag() == true) {
+
+		lightCountIdx = (lightCountIdx + 1) % static_cast<uint32_t>(lightCounts.size());
+		cout << "\nLIGHTS: " << lightCounts[lightCountIdx] << " | ms per frame:";
+		for (size_t i = 0; i < lightCounts.size(); i++)
+			if (lightFrameTimes[i] > 0.0)
+				cout << " " << lightCounts[i] << " lights: " << lightFrameTimes[i];
+		cout << endl;
+		window.setKeyPressedNFlag();
+	}
+}
+
+
+/**
+*	@brief Create pipeline of object for the geometry pass of deferred shading.
+*
+*	Objects write G-buffer with gbuffer.frag and the layout of the object pipeline.
+*	The skybox is not a part of G-buffer, it is drawn by its own shaders in the lighting
+*	subpass and tests depth of the geometry subpass, which is read only there.
+*
+*/
+void HdaBuilder::createDeferredPipeline(HdaModel::SceneObject* o, bool skybox) {
+
+	if (skybox) {
+
+		o->deferredPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX,
+			array{  // pStages
+				vk::PipelineShaderStageCreateInfo{
+					vk::PipelineShaderStageCreateFlags(),
+					vk::ShaderStageFlagBits::eVertex,  // stage
+					pipeline.getSkyboxVertexShaderModule(),  // module
+					"main",  // pName
+					nullptr  // pSpecializationInfo
+				},
+				vk::PipelineShaderStageCreateInfo{
+					vk::PipelineShaderStageCreateFlags(),
+					vk::ShaderStageFlagBits::eFragment,  // stage
+					pipeline.getSkyboxFragmentShaderModule(),  // module
+					"main",  // pName
+					nullptr  // pSpecializationInfo
+				},
+			}.data(), nullptr, nullptr, nullptr, nullptr,
+			&(const vk::PipelineRasterizationStateCreateInfo&)vk::PipelineRasterizationStateCreateInfo{  // pRasterizationState
+				vk::PipelineRasterizationStateCreateFlags(),
+				VK_FALSE,  // depthClampEnable
+				VK_FALSE,  // rasterizerDiscardEnable
+				vk::PolygonMode::eFill,  // polygonMode
+				vk::CullModeFlagBits::eFront,  // cullMode
+				vk::FrontFace::eCounterClockwise,  // frontFace
+				VK_FALSE,  // depthBiasEnable
+				0.f,  // depthBiasConstantFactor
+				0.f,  // depthBiasClamp
+				0.f,  // depthBiasSlopeFactor
+				1.f   // lineWidth
+			}, nullptr,
+			&(const vk::PipelineDepthStencilStateCreateInfo&)vk::PipelineDepthStencilStateCreateInfo{
+				vk::PipelineDepthStencilStateCreateFlags(),
+				VK_TRUE,  // depthTestEnable
+				VK_FALSE,  // depthWriteEnable
+				vk::CompareOp::eLessOrEqual,  // depthCompareOp
+				VK_FALSE,
+				VK_FALSE,
+				{},
+				{},
+				0.0f,
+				1.0f
+			}, nullptr, nullptr, o->objectPipelineLayout, device.getGbufferRenderpass(), 1, nullptr, UINT32_MAX);
+
+		return;
+	}
+
+	vk::PipelineColorBlendAttachmentState attachment{
+		VK_FALSE,  // blendEnable
+		vk::BlendFactor::eZero,  // srcColorBlendFactor
+		vk::BlendFactor::eZero,  // dstColorBlendFactor
+		vk::BlendOp::eAdd,       // colorBlendOp
+		vk::BlendFactor::eZero,  // srcAlphaBlendFactor
+		vk::BlendFactor::eZero,  // dstAlphaBlendFactor
+		vk::BlendOp::eAdd,       // alphaBlendOp
+		vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+			vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA  // colorWriteMask
+	};
+
+	// instanced objects read instance data as the second vertex buffer
+	bool instanced = !o->instances.empty();
+	auto bindings = HdaInstancing::getBindingDescriptions();
+	auto attributes = HdaInstancing::getAttributeDescriptions();
+	vk::PipelineVertexInputStateCreateInfo instanceInput{
+		vk::PipelineVertexInputStateCreateFlags(),
+		static_cast<uint32_t>(bindings.size()),  // vertexBindingDescriptionCount
+		bindings.data(),  // pVertexBindingDescriptions
+		static_cast<uint32_t>(attributes.size()),  // vertexAttributeDescriptionCount
+		attributes.data()  // pVertexAttributeDescriptions
+	};
+
+	o->deferredPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX,
+		array{  // pStages
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eVertex,  // stage
+				instanced ? pipeline.getInstancedVertexShaderModule() : pipeline.getVertexShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eFragment,  // stage
+				pipeline.getGbufferFragmentShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+		}.data(), instanced ? &instanceInput : nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+		&(const vk::PipelineColorBlendStateCreateInfo&)vk::PipelineColorBlendStateCreateInfo{  // pColorBlendState
+			vk::PipelineColorBlendStateCreateFlags(),
+			VK_FALSE,  // logicOpEnable
+			vk::LogicOp::eClear,  // logicOp
+			2,  // attachmentCount - albedo and normal
+			array{ attachment, attachment }.data(),  // pAttachments
+			array<float,4>{0.f,0.f,0.f,0.f}  // blendConstants
+		}, nullptr, o->objectPipelineLayout, device.getGbufferRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+}
+
+
+/**
+*	@brief Create descriptor sets and uniform buffers of the lighting pass.
+*
+*	The lighting pass reads G-buffer, depth and the light list and clusters of HdaLights,
+*	so every frame has its own set. Views of G-buffer are written by updateDeferredDescriptors().
+*
+*/
+void HdaBuilder::createDeferredLighting() {
+
+	// albedo, normal, depth as input attachments + uniform data + lights, light indices of clusters, cluster grid
+	lightingDescriptSetLay = pipeline.createDescriptorSetLayout({ vk::DescriptorType::eInputAttachment, vk::DescriptorType::eInputAttachment,
+		vk::DescriptorType::eInputAttachment, vk::DescriptorType::eUniformBuffer, vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eStorageBuffer,
+		vk::DescriptorType::eUniformBuffer }, vk::ShaderStageFlagBits::eFragment);
+	lightingPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &lightingDescriptSetLay, 0, nullptr);
+	createLightingPipeline();
+
+	deferredUniformBuffs.resize(PARALLEL_FRAMES);
+	deferredUniformBuffsMemory.resize(PARALLEL_FRAMES);
+	deferredUniformBuffsPointer.resize(PARALLEL_FRAMES);
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		createBuffer(sizeof(HdaDeferred::DeferredUniformData), vk::BufferUsageFlagBits::eUniformBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, deferredUniformBuffs[i], deferredUniformBuffsMemory[i]);
+		deferredUniformBuffsPointer[i] = device.getDevice().mapMemory(deferredUniformBuffsMemory[i], 0, sizeof(HdaDeferred::DeferredUniformData), vk::MemoryMapFlags());
+	}
+
+	lightingDescriptSets =
+		device.getDevice().allocateDescriptorSets(
+			vk::DescriptorSetAllocateInfo(
+				descriptorPool,
+				static_cast<uint32_t>(PARALLEL_FRAMES),
+				vector<vk::DescriptorSetLayout>(PARALLEL_FRAMES, lightingDescriptSetLay).data()
+			)
+		);
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		array<vk::DescriptorBufferInfo, 4> buffInfos = {
+			vk::DescriptorBufferInfo(deferredUniformBuffs[i], 0, sizeof(HdaDeferred::DeferredUniformData)),
+			vk::DescriptorBufferInfo(lightBuffs[i], 0, sizeof(HdaLights::Light) * LIGHTS_MAX),
+			vk::DescriptorBufferInfo(clusterBuffs[i], 0, sizeof(uint32_t) * CLUSTER_COUNT * CLUSTER_STRIDE),
+			vk::DescriptorBufferInfo(clusterUniformBuffs[i], 0, sizeof(HdaLights::ClusterUniformData))
+		};
+		array<vk::DescriptorType, 4> types = { vk::DescriptorType::eUniformBuffer, vk::DescriptorType::eStorageBuffer,
+			vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eUniformBuffer };
+
+		vector<vk::WriteDescriptorSet> writes;
+		for (uint32_t b = 0; b < buffInfos.size(); b++)
+			writes.push_back(vk::WriteDescriptorSet(lightingDescriptSets[i], b + 3, 0, 1, types[b], nullptr, &buffInfos[b], nullptr));
+
+		device.getDevice().updateDescriptorSets(writes, nullptr);
+	}
+
+	cout << "createDeferredLighting(): Lighting pass of deferred shading is created.\n";
+}
+
+
+// full screen triangle without vertex buffer, depth is sampled instead of tested
+void HdaBuilder::createLightingPipeline() {
+
+	lightingPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX,
+		array{  // pStages
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eVertex,  // stage
+				pipeline.getFullscreenVertexShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eFragment,  // stage
+				pipeline.getDeferredFragmentShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+		}.data(),
+		&(const vk::PipelineVertexInputStateCreateInfo&)vk::PipelineVertexInputStateCreateInfo{  // pVertexInputState
+			vk::PipelineVertexInputStateCreateFlags(),
+			0,  // vertexBindingDescriptionCount
+			nullptr,  // pVertexBindingDescriptions
+			0,  // vertexAttributeDescriptionCount
+			nullptr  // pVertexAttributeDescriptions
+		}, nullptr, nullptr, nullptr, nullptr, nullptr,
+		&(const vk::PipelineDepthStencilStateCreateInfo&)vk::PipelineDepthStencilStateCreateInfo{
+			vk::PipelineDepthStencilStateCreateFlags(),
+			VK_FALSE,  // depthTestEnable
+			VK_FALSE,  // depthWriteEnable
+			vk::CompareOp::eAlways,  // depthCompareOp
+			VK_FALSE,
+			VK_FALSE,
+			{},
+			{},
+			0.0f,
+			1.0f
+		}, nullptr, nullptr, lightingPipelineLayout, device.getGbufferRenderpass(), 1, nullptr, UINT32_MAX);
+}
+
+
+/**
+*	@brief Write views of G-buffer and depth into descriptor sets of the lighting pass.
+*
+*	The views are created together with swapchain, so the sets are updated again after
+*	the swapchain is recreated. They are input attachments of the lighting subpass,
+*	so no sampler is used and the layouts are the ones of the subpass.
+*
+*/
+void HdaBuilder::updateDeferredDescriptors() {
+
+	array<vk::DescriptorImageInfo, 3> imageInfos = {
+		vk::DescriptorImageInfo(nullptr, swapchain.getGbufferAlbedoView(), vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::DescriptorImageInfo(nullptr, swapchain.getGbufferNormalView(), vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::DescriptorImageInfo(nullptr, swapchain.getDepthImageView(), vk::ImageLayout::eDepthStencilReadOnlyOptimal)
+	};
+
+	for (size_t i = 0; i < lightingDescriptSets.size(); i++) {
+
+		vector<vk::WriteDescriptorSet> writes;
+		for (uint32_t b = 0; b < imageInfos.size(); b++)
+			writes.push_back(vk::WriteDescriptorSet(lightingDescriptSets[i], b, 0, 1, vk::DescriptorType::eInputAttachment, &imageInfos[b], nullptr, nullptr));
+
+		device.getDevice().updateDescriptorSets(writes, nullptr);
+	}
+}
+
+
+// uniform data are written after recording, so they use the camera of the frame as the light grid does
+void HdaBuilder::updateDeferredData() {
+
+	HdaModel::MaterialLightUniformData mlData{};
+	HdaDeferred::DeferredUniformData data = HdaDeferred::prepareDeferredData(HdaModel::getCameraView(), swapchain.getSurfaceExtent().width, swapchain.getSurfaceExtent().height);
+
+	data.lightAmbient = ambientColor;
+	data.lightDiffuse = diffuseColor;
+	data.lightSpecular = glm::vec4(1.0f);
+	data.attenuation = glm::vec4(mlData.kC, mlData.kL, mlData.kQ, 0.0f);
+	data.blinnPhongFlag = frameSceneData.blinnPhongFlag;
+	data.pointLightFlag = frameSceneData.pointLightFlag;
+	data.hdrOnFlag = hdrOnFlag;
+	data.exposure = exposure;
+	data.chooseMethodFlag = chooseMethodFlag;
+
+	memcpy(deferredUniformBuffsPointer[actual_frame], &data, sizeof(data));
+}
+
+
+/**
+*	@brief Record deferred shading of the frame.
+*
+*	The geometry subpass writes G-buffer of all objects, the lighting subpass shades every
+*	pixel once and the skybox is drawn behind the scene. Meshlets are culled by frustum and
+*	cones only, the depth pyramid of occlusion culling is built from the forward render passes.
+*	The culling is recorded and the render pass is ended by the scene graph.
+*
+*/
+void HdaBuilder::recordDeferred(vk::CommandBuffer* cmdBuffs, vk::SubpassContents contents) {
+
+	recordingRenderpass = device.getGbufferRenderpass();
+	recordingFramebuffer = swapchain.getGbufferFramebuffer();
+	recordingContents = contents;
+
+	cmdBuffs->beginRenderPass(
+		vk::RenderPassBeginInfo(
+			device.getGbufferRenderpass(),
+			swapchain.getGbufferFramebuffer(),
+			vk::Rect2D(vk::Offset2D(0, 0), renderExtent),  // renderArea
+			3,  // clearValueCount, scene color is not cleared
+			array{  // pClearValues
+				vk::ClearValue(array<float,4>{0.f, 0.f, 0.f, 0.f}),
+				vk::ClearValue(array<float,4>{0.5f, 0.5f, 0.f, 0.f}),
+				vk::ClearValue({1.0f, 0}),
+			}.data()
+		),
+		contents
+	);
+	drawScene(cmdBuffs, MESHLET_PHASE_SINGLE, DRAW_MODE_GBUFFER);
+
+	// the lighting subpass has one draw and the skybox, it is always recorded inline,
+	// the viewport is set again, because it is undefined after secondary command buffers
+	cmdBuffs->nextSubpass(vk::SubpassContents::eInline);
+	recordingContents = vk::SubpassContents::eInline;
+	setViewport(cmdBuffs, renderExtent);
+	cmdBuffs->bindPipeline(vk::PipelineBindPoint::eGraphics, lightingPipeline);
+	cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, lightingPipelineLayout, 0, 1, &lightingDescriptSets[actual_frame], 0, nullptr);
+	cmdBuffs->draw(3, 1, 0, 0);
+
+	drawScene(cmdBuffs, MESHLET_PHASE_SINGLE, DRAW_MODE_SKYBOX);
+}
+
+
+// occlusion culling and depth prepass belong to the forward path, they are ignored by deferred shading,
+// memory of frame targets per resolution is printed when it is switched on
+void HdaBuilder::handleDeferredKeys() {
+
+	if (window.getKeyPressedRFlag() == true) {
+
+		deferredShading = !deferredShading;
+		deferredShading ? cout << "\nDEFERRED SHADING: ON (occlusion culling and depth prepass are not used)" << endl : cout << "\nDEFERRED SHADING: OFF" << endl;
+		if (deferredShading)
+			HdaTransient::printMemoryReport(device.getFindFormatFunc(vk::ImageTiling::eOptimal));
+		window.setKeyPressedRFlag();
+	}
+}
+
+
+/**
+*	@brief Create pipelines of bloom and tone mapping.
+*
+*	Both bloom shaders share one layout with the source level and the destination level.
+*	Every level has its own downsample and upsample set, the views are written by
+*	updateBloomDescriptors(). Tone mapping reads the scene color, level 0 of the chain,
+*	the 3D LUT of tone mapping and the blurred grid of local tone mapping, it writes
+*	histograms of comparison tiles.
+*
+*/
+void HdaBuilder::createBloom() {
+
+	// source level or scene color + destination level
+	bloomDescriptSetLay = pipeline.createComputeDescriptorSetLayout({ vk::DescriptorType::eCombinedImageSampler, vk::DescriptorType::eStorageImage });
+
+	vk::PushConstantRange pushRange{ vk::ShaderStageFlagBits::eCompute, 0, sizeof(HdaBloom::BloomPushData) };
+	bloomPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &bloomDescriptSetLay, 1, &pushRange);
+	bloomDownPipeline = pipeline.createComputePipeline(pipeline.getBloomDownShaderModule(), bloomPipelineLayout);
+	bloomUpPipeline = pipeline.createComputePipeline(pipeline.getBloomUpShaderModule(), bloomPipelineLayout);
+
+	// taps between texels are filtered by hardware, so 13 taps cover 6x6 texels of the source
+	bloomSampler =
+		device.getDevice().createSampler(
+			vk::SamplerCreateInfo(
+				vk::SamplerCreateFlags(),
+				vk::Filter::eLinear,  // magFilter
+				vk::Filter::eLinear,  // minFilter
+				vk::SamplerMipmapMode::eNearest,  // mipmapMode
+				vk::SamplerAddressMode::eClampToEdge,  // addressModeU
+				vk::SamplerAddressMode::eClampToEdge,  // addressModeV
+				vk::SamplerAddressMode::eClampToEdge,  // addressModeW
+				0.0f,  // mipLodBias
+				VK_FALSE,  // anisotropyEnable
+				1.0f,  // maxAnisotropy
+				VK_FALSE,  // compareEnable
+				vk::CompareOp::eAlways,  // compareOp
+				0.0f,  // minLod
+				0.0f,  // maxLod
+				vk::BorderColor::eFloatTransparentBlack,  // borderColor
+				VK_FALSE  // unnormalizedCoordinates
+			)
+		);
+
+	vector<vk::DescriptorSet> sets =
+		device.getDevice().allocateDescriptorSets(
+			vk::DescriptorSetAllocateInfo(
+				descriptorPool,
+				static_cast<uint32_t>(2 * BLOOM_MAX_MIPS),
+				vector<vk::DescriptorSetLayout>(2 * BLOOM_MAX_MIPS, bloomDescriptSetLay).data()
+			)
+		);
+	bloomDownDescriptSets.assign(sets.begin(), sets.begin() + BLOOM_MAX_MIPS);
+	bloomUpDescriptSets.assign(sets.begin() + BLOOM_MAX_MIPS, sets.end());
+
+	// scene color + level 0 of bloom chain + LUT + local grid + tile histograms, parameters of TMO are push constants
+	tonemapDescriptSetLay = pipeline.createDescriptorSetLayout({ vk::DescriptorType::eCombinedImageSampler, vk::DescriptorType::eCombinedImageSampler,
+																 vk::DescriptorType::eCombinedImageSampler, vk::DescriptorType::eCombinedImageSampler,
+																 vk::DescriptorType::eStorageBuffer },
+															   vk::ShaderStageFlagBits::eFragment);
+	vk::PushConstantRange tonemapRange{ vk::ShaderStageFlagBits::eFragment, 0, sizeof(HdaBloom::TonemapPushData) };
+	tonemapPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &tonemapDescriptSetLay, 1, &tonemapRange);
+	createTonemapPipeline();
+
+	tonemapDescriptSet =
+		device.getDevice().allocateDescriptorSets(
+			vk::DescriptorSetAllocateInfo(
+				descriptorPool,
+				1,
+				&tonemapDescriptSetLay
+			)
+		)[0];
+
+	if (device.getTimestampSupport())
+		bloomQueryPool =
+			device.getDevice().createQueryPool(
+				vk::QueryPoolCreateInfo(
+					vk::QueryPoolCreateFlags(),
+					vk::QueryType::eTimestamp,
+					static_cast<uint32_t>(PARALLEL_FRAMES * BLOOM_TIMESTAMPS),
+					vk::QueryPipelineStatisticFlags()
+				)
+			);
+
+	createTonemapLut();
+	createTileStats();
+	updateBloomDescriptors();
+
+	cout << "createBloom(): Bloom and tone mapping pipelines are created.\n";
+}
+
+
+// full screen triangle into the swapchain image, the same as the lighting pass without depth
+void HdaBuilder::createTonemapPipeline() {
+
+	tonemapPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX,
+		array{  // pStages
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eVertex,  // stage
+				pipeline.getFullscreenVertexShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eFragment,  // stage
+				pipeline.getTonemapFragmentShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+		}.data(),
+		&(const vk::PipelineVertexInputStateCreateInfo&)vk::PipelineVertexInputStateCreateInfo{  // pVertexInputState
+			vk::PipelineVertexInputStateCreateFlags(),
+			0,  // vertexBindingDescriptionCount
+			nullptr,  // pVertexBindingDescriptions
+			0,  // vertexAttributeDescriptionCount
+			nullptr  // pVertexAttributeDescriptions
+		}, nullptr, nullptr, nullptr, nullptr, nullptr,
+		&(const vk::PipelineDepthStencilStateCreateInfo&)vk::PipelineDepthStencilStateCreateInfo{
+			vk::PipelineDepthStencilStateCreateFlags(),
+			VK_FALSE,  // depthTestEnable
+			VK_FALSE,  // depthWriteEnable
+			vk::CompareOp::eAlways,  // depthCompareOp
+			VK_FALSE,
+			VK_FALSE,
+			{},
+			{},
+			0.0f,
+			1.0f
+		}, nullptr, nullptr, tonemapPipelineLayout, device.getTonemapRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+}
+
+
+/**
+*	@brief Write views of scene color and bloom levels into descriptor sets.
+*
+*	The views are created together with swapchain, so the sets are updated again
+*	after the swapchain is recreated. Levels of the chain stay in general layout.
+*
+*/
+void HdaBuilder::updateBloomDescriptors() {
+
+	uint32_t levels = swapchain.getBloomLevels();
+
+	for (uint32_t l = 0; l < levels; l++) {
+
+		// level 0 reads the scene color left by the last render pass
+		vk::DescriptorImageInfo srcInfo(bloomSampler, l == 0 ? swapchain.getSceneColorView() : swapchain.getBloomLevelView(l - 1),
+										l == 0 ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eGeneral);
+		vk::DescriptorImageInfo dstInfo(nullptr, swapchain.getBloomLevelView(l), vk::ImageLayout::eGeneral);
+
+		device.getDevice().updateDescriptorSets(
+			array{
+				vk::WriteDescriptorSet(bloomDownDescriptSets[l], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &srcInfo, nullptr, nullptr),
+				vk::WriteDescriptorSet(bloomDownDescriptSets[l], 1, 0, 1, vk::DescriptorType::eStorageImage, &dstInfo, nullptr, nullptr)
+			},
+			nullptr
+		);
+
+		if (l == 0)
+			continue;
+
+		vk::DescriptorImageInfo upSrcInfo(bloomSampler, swapchain.getBloomLevelView(l), vk::ImageLayout::eGeneral);
+		vk::DescriptorImageInfo upDstInfo(nullptr, swapchain.getBloomLevelView(l - 1), vk::ImageLayout::eGeneral);
+
+		device.getDevice().updateDescriptorSets(
+			array{
+				vk::WriteDescriptorSet(bloomUpDescriptSets[l], 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &upSrcInfo, nullptr, nullptr),
+				vk::WriteDescriptorSet(bloomUpDescriptSets[l], 1, 0, 1, vk::DescriptorType::eStorageImage, &upDstInfo, nullptr, nullptr)
+			},
+			nullptr
+		);
+	}
+
+	// the LUT and the local grid are filtered by the same trilinear sampler with clamped coordinates
+	array<vk::DescriptorImageInfo, 4> imageInfos = {
+		vk::DescriptorImageInfo(bloomSampler, swapchain.getSceneColorView(), vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::DescriptorImageInfo(bloomSampler, swapchain.getBloomLevelView(0), vk::ImageLayout::eGeneral),
+		vk::DescriptorImageInfo(bloomSampler, lutImageView, vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::DescriptorImageInfo(bloomSampler, swapchain.getLocalGridView(1), vk::ImageLayout::eGeneral)
+	};
+	vk::DescriptorBufferInfo statsInfo(tileStatsBuff, 0, VK_WHOLE_SIZE);
+
+	device.getDevice().updateDescriptorSets(
+		array{
+			vk::WriteDescriptorSet(tonemapDescriptSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfos[0], nullptr, nullptr),
+			vk::WriteDescriptorSet(tonemapDescriptSet, 1, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfos[1], nullptr, nullptr),
+			vk::WriteDescriptorSet(tonemapDescriptSet, 2, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfos[2], nullptr, nullptr),
+			vk::WriteDescriptorSet(tonemapDescriptSet, 3, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfos[3], nullptr, nullptr),
+			vk::WriteDescriptorSet(tonemapDescriptSet, 4, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &statsInfo, nullptr)
+		},
+		nullptr
+	);
+}
+
+
+/**
+*	@brief Record bloom of HDR scene color.
+*
+*	Every level is downsampled from the previous one, then the levels are upsampled
+*	back and added to the larger level, so the result ends in level 0. No pass works
+*	in full resolution, the scene color is read once by the first downsample. Every pass
+*	is followed by a timestamp, so the time of every level is measured. The frame graph
+*	transitions the chain before the pass and makes level 0 visible to tone mapping.
+*
+*/
+void HdaBuilder::recordBloom(vk::CommandBuffer* cmdBuffs) {
+
+	vk::Extent2D extent = swapchain.getSurfaceExtent();
+	uint32_t levels = bloomFrameLevels[actual_frame];
+	uint32_t query = static_cast<uint32_t>(actual_frame * BLOOM_TIMESTAMPS);
+	bool timestamps = device.getTimestampSupport();
+
+	// one pass of chain, its level is read by the next pass
+	auto dispatchLevel = [&](vk::DescriptorSet set, const HdaBloom::BloomPushData& data) {
+
+		cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eCompute, bloomPipelineLayout, 0, 1, &set, 0, nullptr);
+		cmdBuffs->pushConstants(bloomPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(data), &data);
+		cmdBuffs->dispatch((data.dstSize.x + BLOOM_GROUP_SIZE - 1) / BLOOM_GROUP_SIZE, (data.dstSize.y + BLOOM_GROUP_SIZE - 1) / BLOOM_GROUP_SIZE, 1);
+
+		cmdBuffs->pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader,
+			vk::DependencyFlags(),
+			vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+			nullptr, nullptr
+		);
+
+		if (timestamps)
+			cmdBuffs->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, bloomQueryPool, query + bloomTimestampsRecorded[actual_frame]);
+		bloomTimestampsRecorded[actual_frame]++;
+	};
+
+	HdaBloom::BloomPushData data{};
+	data.threshold = bloomThresholds[bloomThresholdIdx];
+	data.knee = data.threshold * 0.5f;
+	data.srcSize = glm::ivec2(extent.width, extent.height);
+	data.srcScale = glm::vec2(renderExtent.width, renderExtent.height) / glm::vec2(extent.width, extent.height);
+
+	if (levels > 0)
+		cmdBuffs->bindPipeline(vk::PipelineBindPoint::eCompute, bloomDownPipeline);
+	for (uint32_t l = 0; l < levels; l++) {
+
+		data.dstSize = glm::ivec2(HdaBloom::levelExtent(extent.width, extent.height, l));
+		data.firstLevel = l == 0 ? 1 : 0;
+		dispatchLevel(bloomDownDescriptSets[l], data);
+		data.srcSize = data.dstSize;
+		data.srcScale = glm::vec2(1.0f);
+	}
+
+	if (levels > 1)
+		cmdBuffs->bindPipeline(vk::PipelineBindPoint::eCompute, bloomUpPipeline);
+	// from the smallest level, level l - 1 is added to level l - 2
+	for (uint32_t l = levels; l > 1; l--) {
+
+		data.srcSize = glm::ivec2(HdaBloom::levelExtent(extent.width, extent.height, l - 1));
+		data.dstSize = glm::ivec2(HdaBloom::levelExtent(extent.width, extent.height, l - 2));
+		dispatchLevel(bloomUpDescriptSets[l - 1], data);
+	}
+}
+
+
+/**
+*	@brief Record the tone mapping pass into the swapchain image.
+*
+*	TMO is applied to the scene color with bloom. In the comparison mode every tile has
+*	its own operator and the histograms of tiles of the frame are cleared before the pass
+*	and made visible to the host after it, readTileStats() reduces them.
+*
+*/
+void HdaBuilder::recordTonemap(vk::CommandBuffer* cmdBuffs, uint32_t imageIndex) {
+
+	updateCompareTitle();
+
+	const vk::DeviceSize frameBins = TONEMAP_COMPARE_MAX_TILES * TONEMAP_STATS_BINS;
+	statsFrameTiles[actual_frame] = compareTiles;
+	statsFrameMethods[actual_frame] = chooseMethodFlag;
+	if (compareTiles > 0) {
+
+		cmdBuffs->fillBuffer(tileStatsBuff, actual_frame * frameBins * sizeof(uint32_t), frameBins * sizeof(uint32_t), 0);
+		cmdBuffs->pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+			vk::DependencyFlags(),
+			vk::MemoryBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite),
+			nullptr, nullptr
+		);
+	}
+
+	HdaBloom::TonemapPushData data{};
+	data.exposure = exposure;
+	data.chooseMethodFlag = chooseMethodFlag;
+	data.hdrOnFlag = hdrOnFlag;
+	data.bloomIntensity = bloomFrameLevels[actual_frame] > 0 ? bloomIntensities[bloomIntensityIdx] / bloomFrameLevels[actual_frame] : 0.0f;
+	data.lutOnFlag = lutOn ? 1 : 0;
+	data.localOnFlag = localFrameOn[actual_frame] ? 1 : 0;
+	data.localCompression = localCompressions[localCompressionIdx];
+	data.localDetail = localDetail;
+	data.compareTiles = static_cast<int>(compareTiles);
+	data.compareGrid = compareGrid ? 1 : 0;
+	data.statsBase = static_cast<int>(actual_frame * frameBins);
+	data.upscaleFilter = upscaleFilter;
+	data.renderScale = glm::vec2(renderExtent.width, renderExtent.height) / glm::vec2(swapchain.getSurfaceExtent().width, swapchain.getSurfaceExtent().height);
+
+	cmdBuffs->beginRenderPass(
+		vk::RenderPassBeginInfo(
+			device.getTonemapRenderpass(),
+			swapchain.getFramebuffers()[imageIndex],  // framebuffer with right image index
+			vk::Rect2D(vk::Offset2D(0, 0), swapchain.getSurfaceExtent()),  // renderArea
+			0,  // clearValueCount
+			nullptr  // pClearValues
+		),
+		vk::SubpassContents::eInline
+	);
+	cmdBuffs->bindPipeline(vk::PipelineBindPoint::eGraphics, tonemapPipeline);
+	setViewport(cmdBuffs, swapchain.getSurfaceExtent());
+	cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, tonemapPipelineLayout, 0, 1, &tonemapDescriptSet, 0, nullptr);
+	cmdBuffs->pushConstants(tonemapPipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, sizeof(data), &data);
+	cmdBuffs->draw(3, 1, 0, 0);
+	cmdBuffs->endRenderPass();
+
+	if (compareTiles > 0)
+		cmdBuffs->pipelineBarrier(
+			vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eHost,
+			vk::DependencyFlags(),
+			vk::MemoryBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eHostRead),
+			nullptr, nullptr
+		);
+
+	if (device.getTimestampSupport())
+		cmdBuffs->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, bloomQueryPool,
+								 static_cast<uint32_t>(actual_frame * BLOOM_TIMESTAMPS) + bloomTimestampsRecorded[actual_frame]);
+	bloomTimestampsRecorded[actual_frame]++;
+}
+
+
+/**
+*	@brief Read times of bloom passes and tone mapping of the finished frame.
+*
+*	The first timestamp follows the scene passes, the downsamples of levels come next,
+*	the upsamples from the smallest level, the grid and blur of local tone mapping
+*	if it is on and tone mapping is the last one.
+*
+*/
+void HdaBuilder::readBloomTimestamps() {
+
+	uint32_t cnt = bloomTimestampsRecorded[actual_frame];
+	if (cnt == 0 || !device.getTimestampSupport())
+		return;
+
+	array<uint64_t, BLOOM_TIMESTAMPS> ticks{};
+	vk::Result result = device.getDevice().getQueryPoolResults(bloomQueryPool, static_cast<uint32_t>(actual_frame * BLOOM_TIMESTAMPS), cnt, sizeof(uint64_t) * cnt, ticks.data(),
+															   sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+	if (result != vk::Result::eSuccess)
+		return;
+
+	double msPerTick = device.getPhysDevice().getProperties().limits.timestampPeriod / 1e6;
+	auto passTime = [&](uint32_t i) { return static_cast<double>(ticks[i] - ticks[i - 1]) * msPerTick; };
+
+	uint32_t levels = bloomFrameLevels[actual_frame];
+	bloomTimedLevels = levels;
+	bloomDownTimes.fill(0.0);
+	bloomUpTimes.fill(0.0);
+	for (uint32_t l = 0; l < levels; l++)
+		bloomDownTimes[l] = passTime(l + 1);
+	uint32_t local = localFrameOn[actual_frame] ? LOCAL_TIMESTAMPS : 0;
+	for (uint32_t i = levels + 1; i < cnt - 1 - local; i++)
+		bloomUpTimes[2 * levels - i - 1] = passTime(i);
+	localGridTime = local > 0 ? passTime(cnt - 3) : 0.0;
+	localBlurTime = local > 0 ? passTime(cnt - 2) : 0.0;
+	tonemapTime = passTime(cnt - 1);
+}
+
+
+// threshold, intensity and levels take effect in the next recorded frame
+void HdaBuilder::handleBloomKeys() {
+
+	if (window.getKeyPressed3Flag() == true) {
+
+		bloomOn = !bloomOn;
+		bloomOn ? cout << "\nBLOOM: ON" << endl : cout << "\nBLOOM: OFF" << endl;
+		window.setKeyPressed3Flag();
+	}
+
+	if (window.getKeyPressed4Flag() == true) {
+
+		bloomThresholdIdx = (bloomThresholdIdx + 1) % bloomThresholds.size();
+		cout << "\nBLOOM THRESHOLD: " << bloomThresholds[bloomThresholdIdx] << endl;
+		window.setKeyPressed4Flag();
+	}
+
+	if (window.getKeyPressed5Flag() == true) {
+
+		bloomIntensityIdx = (bloomIntensityIdx + 1) % bloomIntensities.size();
+		cout << "\nBLOOM INTENSITY: " << bloomIntensities[bloomIntensityIdx] << endl;
+		window.setKeyPressed5Flag();
+	}
+
+	if (window.getKeyPressed6Flag() == true) {
+
+		bloomMips = bloomMips >= BLOOM_MAX_MIPS ? BLOOM_MIN_MIPS : bloomMips + 1;
+		cout << "\nBLOOM LEVELS: " << min(bloomMips, swapchain.getBloomLevels()) << endl;
+		window.setKeyPressed6Flag();
+	}
+}
+
+
+/**
+*	@brief Create 3D LUT of tone mapping and its staging buffers.
+*
+*	Texels are baked on CPU into the staging buffer of the frame and copied into the image
+*	by recordTonemapLut(). Every frame has its own staging buffer, so the host never writes
+*	texels which are read by a pending copy.
+*
+*/
+void HdaBuilder::createTonemapLut() {
+
+	lutImage =
+		device.getDevice().createImage(
+			vk::ImageCreateInfo(
+				vk::ImageCreateFlags(),
+				vk::ImageType::e3D,
+				TONEMAP_LUT_FORMAT,
+				vk::Extent3D(lutSize, lutSize, lutSize),
+				1,  // mipLevels
+				1,  // arrayLayers
+				vk::SampleCountFlagBits::e1,
+				vk::ImageTiling::eOptimal,
+				vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+				vk::SharingMode::eExclusive,
+				{},
+				{},
+				vk::ImageLayout::eUndefined
+			)
+		);
+
+	vk::MemoryRequirements memRequirements = device.getDevice().getImageMemoryRequirements(lutImage);
+	vk::PhysicalDeviceMemoryProperties memProperties = device.getPhysDevice().getMemoryProperties();
+	uint32_t memoryTypeIndex = UINT32_MAX;
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount && memoryTypeIndex == UINT32_MAX; i++)
+		if ((memRequirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eDeviceLocal))
+			memoryTypeIndex = i;
+
+	if (memoryTypeIndex == UINT32_MAX)
+		throw runtime_error("Corresponding memory type not found.\n");
+
+	lutImageMemory =
+		device.getDevice().allocateMemory(
+			vk::MemoryAllocateInfo(
+				memRequirements.size,
+				memoryTypeIndex
+			)
+		);
+	device.getDevice().bindImageMemory(lutImage, lutImageMemory, 0);
+	lutImageView = swapchain.createImageView(lutImage, TONEMAP_LUT_FORMAT, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(1), vk::ImageViewType::e3D);
+
+	vk::DeviceSize size = 4 * sizeof(uint16_t) * static_cast<vk::DeviceSize>(lutSize) * lutSize * lutSize;
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		createBuffer(size, vk::BufferUsageFlagBits::eTransferSrc, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+					 lutStagingBuffs[i], lutStagingMemory[i]);
+		lutStagingPointers[i] = static_cast<uint16_t*>(device.getDevice().mapMemory(lutStagingMemory[i], 0, size, vk::MemoryMapFlags()));
+	}
+
+	lutBaked = false;
+	lutState = HdaGraph::Access();
+	cout << "createTonemapLut(): LUT " << lutSize << "^3 is created | " << size / 1024.0 << " KB.\n";
+}
+
+
+void HdaBuilder::destroyTonemapLut() {
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		device.getDevice().unmapMemory(lutStagingMemory[i]);
+		device.getDevice().destroyBuffer(lutStagingBuffs[i]);
+		device.getDevice().freeMemory(lutStagingMemory[i]);
+		lutStagingPointers[i] = nullptr;
+	}
+
+	device.getDevice().destroyImageView(lutImageView);
+	device.getDevice().destroyImage(lutImage);
+	device.getDevice().freeMemory(lutImageMemory);
+}
+
+
+/**
+*	@brief Bake 3D LUT and copy it into the image.
+*
+*	The pass of the frame graph is declared when the LUT is not baked or its settings
+*	change and it is culled while tone mapping does not use the LUT. The graph orders
+*	the copy after tone mapping of the previous frames, which were submitted to the same
+*	queue before.
+*
+*/
+void HdaBuilder::recordTonemapLut(vk::CommandBuffer* cmdBuffs) {
+
+	lutSettings.chooseMethodFlag = chooseMethodFlag;
+	lutSettings.exposure = exposure;
+	lutSettings.gamma = 1.0f;		// the swapchain format encodes the output
+	lutGradeBaked = lutGradeIdx;
+
+	auto startT = chrono::high_resolution_clock::now();
+	HdaTonemap::bakeLut(jobs, lutSize, lutSettings, lutGrades[lutGradeIdx], lutStagingPointers[actual_frame]);
+	lutBakeTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startT).count();
+	lutBakes++;
+
+	cmdBuffs->copyBufferToImage(
+		lutStagingBuffs[actual_frame],
+		lutImage,
+		vk::ImageLayout::eTransferDstOptimal,
+		vk::BufferImageCopy(
+			0, 0, 0,		// buffer offset + buffer row length + buffer image height
+			vk::ImageSubresourceLayers(
+				vk::ImageAspectFlagBits::eColor,
+				0, 0, 1		// mip level + base array layer + layer count
+			),
+			vk::Offset3D(0, 0, 0),
+			vk::Extent3D(lutSize, lutSize, lutSize)
+		)
+	);
+
+	lutBaked = true;
+}
+
+
+// the grade is used only by the LUT, a new size waits for the GPU before the LUT is created again
+void HdaBuilder::handleLutKeys() {
+
+	if (window.getKeyPressed7Flag() == true) {
+
+		lutOn = !lutOn;
+		lutOn ? cout << "\nTONEMAP LUT: ON (" << lutSize << "^3)" << endl : cout << "\nTONEMAP LUT: OFF (analytic TMO)" << endl;
+		window.setKeyPressed7Flag();
+	}
+
+	if (window.getKeyPressed8Flag() == true) {
+
+		lutGradeIdx = (lutGradeIdx + 1) % lutGrades.size();
+		cout << "\nCOLOR GRADE: " << lutGradeNames[lutGradeIdx] << (lutOn ? "" : " (used only by the LUT)") << endl;
+		window.setKeyPressed8Flag();
+	}
+
+	if (window.getKeyPressed9Flag() == true) {
+
+		lutSize = lutSize >= TONEMAP_LUT_MAX_SIZE ? TONEMAP_LUT_MIN_SIZE : 2 * lutSize - 1;
+		device.getDevice().waitIdle();
+		destroyTonemapLut();
+		createTonemapLut();
+		updateBloomDescriptors();
+		cout << "\nTONEMAP LUT SIZE: " << lutSize << endl;
+		window.setKeyPressed9Flag();
+	}
+}
+
+
+/**
+*	@brief Create pipelines of local tone mapping.
+*
+*	The splat and the blur of bilateral grid have the same set layout as the bloom
+*	passes, a sampled source and a storage destination. Sets are written by
+*	updateLocalDescriptors(), the blurred grid is sliced by tonemap.frag.
+*
+*/
+void HdaBuilder::createLocalTonemap() {
+
+	vk::PushConstantRange pushRange{ vk::ShaderStageFlagBits::eCompute, 0, sizeof(HdaLocalTonemap::LocalPushData) };
+	localPipelineLayout = pipeline.createPipelineLayout(vk::PipelineLayoutCreateFlags(), UINT32_MAX, &bloomDescriptSetLay, 1, &pushRange);
+	localGridPipeline = pipeline.createComputePipeline(pipeline.getLocalGridShaderModule(), localPipelineLayout);
+	localBlurPipeline = pipeline.createComputePipeline(pipeline.getLocalBlurShaderModule(), localPipelineLayout);
+
+	vector<vk::DescriptorSet> sets =
+		device.getDevice().allocateDescriptorSets(
+			vk::DescriptorSetAllocateInfo(
+				descriptorPool,
+				static_cast<uint32_t>(2),
+				vector<vk::DescriptorSetLayout>(2, bloomDescriptSetLay).data()
+			)
+		);
+	localGridDescriptSet = sets[0];
+	localBlurDescriptSet = sets[1];
+
+	updateLocalDescriptors();
+
+	cout << "createLocalTonemap(): Bilateral grid pipelines are created.\n";
+}
+
+
+// grids are created together with swapchain, the tonemap set is written by updateBloomDescriptors()
+void HdaBuilder::updateLocalDescriptors() {
+
+	array<vk::DescriptorImageInfo, 4> imageInfos = {
+		vk::DescriptorImageInfo(bloomSampler, swapchain.getSceneColorView(), vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::DescriptorImageInfo(nullptr, swapchain.getLocalGridView(0), vk::ImageLayout::eGeneral),
+		vk::DescriptorImageInfo(bloomSampler, swapchain.getLocalGridView(0), vk::ImageLayout::eGeneral),
+		vk::DescriptorImageInfo(nullptr, swapchain.getLocalGridView(1), vk::ImageLayout::eGeneral)
+	};
+
+	device.getDevice().updateDescriptorSets(
+		array{
+			vk::WriteDescriptorSet(localGridDescriptSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfos[0], nullptr, nullptr),
+			vk::WriteDescriptorSet(localGridDescriptSet, 1, 0, 1, vk::DescriptorType::eStorageImage, &imageInfos[1], nullptr, nullptr),
+			vk::WriteDescriptorSet(localBlurDescriptSet, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &imageInfos[2], nullptr, nullptr),
+			vk::WriteDescriptorSet(localBlurDescriptSet, 1, 0, 1, vk::DescriptorType::eStorageImage, &imageInfos[3], nullptr, nullptr)
+		},
+		nullptr
+	);
+}
+
+
+/**
+*	@brief Record the splat of bilateral grid.
+*
+*	One workgroup of local_grid.comp splats one cell of the scene color, so the scene
+*	is read once and the rest of local tone mapping works on the grid of a few MB.
+*	The slice is done by tonemap.frag. The splat and the blur are passes of the frame
+*	graph, both are followed by a timestamp in the bloom query pool.
+*
+*/
+void HdaBuilder::recordLocalGrid(vk::CommandBuffer* cmdBuffs) {
+
+	// cells out of render extent stay empty, so the blur treats them as the border of frame
+	vk::Extent2D extent = renderExtent;
+	glm::uvec2 grid = swapchain.getLocalGridExtent();
+
+	HdaLocalTonemap::LocalPushData data{};
+	data.sceneSize = glm::ivec2(extent.width, extent.height);
+	data.exposure = exposure;
+
+	cmdBuffs->bindPipeline(vk::PipelineBindPoint::eCompute, localGridPipeline);
+	cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eCompute, localPipelineLayout, 0, 1, &localGridDescriptSet, 0, nullptr);
+	cmdBuffs->pushConstants(localPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(data), &data);
+	cmdBuffs->dispatch(grid.x, grid.y, 1);
+
+	if (device.getTimestampSupport())
+		cmdBuffs->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, bloomQueryPool,
+								 static_cast<uint32_t>(actual_frame * BLOOM_TIMESTAMPS) + bloomTimestampsRecorded[actual_frame]);
+	bloomTimestampsRecorded[actual_frame]++;
+}
+
+
+void HdaBuilder::recordLocalBlur(vk::CommandBuffer* cmdBuffs) {
+
+	glm::uvec2 grid = swapchain.getLocalGridExtent();
+
+	cmdBuffs->bindPipeline(vk::PipelineBindPoint::eCompute, localBlurPipeline);
+	cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eCompute, localPipelineLayout, 0, 1, &localBlurDescriptSet, 0, nullptr);
+	cmdBuffs->dispatch((grid.x + LOCAL_BLUR_GROUP_SIZE - 1) / LOCAL_BLUR_GROUP_SIZE, (grid.y + LOCAL_BLUR_GROUP_SIZE - 1) / LOCAL_BLUR_GROUP_SIZE, LOCAL_GRID_BINS);
+
+	if (device.getTimestampSupport())
+		cmdBuffs->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, bloomQueryPool,
+								 static_cast<uint32_t>(actual_frame * BLOOM_TIMESTAMPS) + bloomTimestampsRecorded[actual_frame]);
+	bloomTimestampsRecorded[actual_frame]++;
+}
+
+
+// the buffer has TONEMAP_STATS_BINS per tile for every frame, tonemap.frag adds to the region of its frame
+void HdaBuilder::createTileStats() {
+
+	vk::DeviceSize size = PARALLEL_FRAMES * TONEMAP_COMPARE_MAX_TILES * TONEMAP_STATS_BINS * sizeof(uint32_t);
+	createBuffer(size, vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+				 vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, tileStatsBuff, tileStatsMemory);
+	tileStatsPointer = static_cast<uint32_t*>(device.getDevice().mapMemory(tileStatsMemory, 0, size, vk::MemoryMapFlags()));
+}
+
+
+// histograms of the finished frame, the frame is waited for by the timeline semaphore
+void HdaBuilder::readTileStats() {
+
+	uint32_t tiles = statsFrameTiles[actual_frame];
+	statsTiles = tiles;
+	statsMethod = statsFrameMethods[actual_frame];
+
+	const uint32_t* histograms = tileStatsPointer + actual_frame * TONEMAP_COMPARE_MAX_TILES * TONEMAP_STATS_BINS;
+	for (uint32_t t = 0; t < tiles; t++)
+		tileStats[t] = HdaTonemap::tileStats(histograms + t * TONEMAP_STATS_BINS);
+}
+
+
+// operators of tiles are in the title, since the window has no text, squares in tiles count method + 1
+void HdaBuilder::updateCompareTitle() {
+
+	string title;
+	for (uint32_t t = 0; t < compareTiles; t++)
+		title += string(t == 0 ? "" : " | ") + to_string((chooseMethodFlag + t) % TONEMAP_METHODS + 1) + " " + HdaTonemap::methodName((chooseMethodFlag + t) % TONEMAP_METHODS);
+
+	if (title != compareTitle) {
+		window.setTitleLabel(title);
+		compareTitle = title;
+	}
+}
+
+
+// the comparison takes effect in the next recorded frame, the operators follow M
+void HdaBuilder::handleCompareKeys() {
+
+	if (window.getKeyPressedF1Flag() == true) {
+
+		compareTiles = compareTiles == 0 ? TONEMAP_COMPARE_MIN_TILES : compareTiles >= TONEMAP_COMPARE_MAX_TILES ? 0 : compareTiles + 1;
+		if (compareTiles == 0)
+			cout << "\nTMO COMPARISON: OFF" << endl;
+		else
+			cout << "\nTMO COMPARISON: " << compareTiles << (compareGrid ? " tiles" : " strips") << (lutOn ? " (analytic TMOs instead of the LUT)" : "") << endl;
+		window.setKeyPressedF1Flag();
+	}
+
+	if (window.getKeyPressedF2Flag() == true) {
+
+		compareGrid = !compareGrid;
+		cout << "\nTMO COMPARISON LAYOUT: " << (compareGrid ? "tiles with the whole frame" : "strips of one frame") << endl;
+		window.setKeyPressedF2Flag();
+	}
+}
+
+
+// the keys cycle the first values from settings and the presets
+void HdaBuilder::setResolutionSettings(const HdaResolution::Settings& settings) {
+
+	resolution.setSettings(settings);
+	resolutionTargets[0] = resolution.getSettings().targetMs;
+	resolutionMinScales[0] = resolution.getSettings().minScale;
+	dynamicResolution = true;
+}
+
+
+/**
+*	@brief Choose the viewport of scene passes of the recorded frame.
+*
+*	The controller is fed by GPU time of the frame which was waited for, so the scale
+*	reacts PARALLEL_FRAMES frames late. Without timestamps the scene has the full size.
+*
+*/
+void HdaBuilder::updateRenderExtent() {
+
+	float scale = dynamicResolution && device.getTimestampSupport() ? resolution.update(gpuFrameMs) : 1.0f;
+	renderExtent = HdaResolution::scaledExtent(swapchain.getSurfaceExtent(), scale);
+	frameRenderExtents[actual_frame] = renderExtent;
+}
+
+
+// pipelines have dynamic viewport and scissor, the scene is rendered into the corner of its attachments
+void HdaBuilder::setViewport(vk::CommandBuffer* cmdBuffs, vk::Extent2D extent) {
+
+	cmdBuffs->setViewport(0, vk::Viewport(0.f, 0.f, float(extent.width), float(extent.height), 0.f, 1.f));
+	cmdBuffs->setScissor(0, vk::Rect2D(vk::Offset2D(0, 0), extent));
+}
+
+
+// changes take effect in the next recorded frame, the controller starts from the largest scale
+void HdaBuilder::handleResolutionKeys() {
+
+	if (window.getKeyPressedF3Flag() == true) {
+
+		if (device.getTimestampSupport()) {
+			dynamicResolution = !dynamicResolution;
+			resolution.reset();
+			cout << "\nDYNAMIC RESOLUTION: " << (dynamicResolution ? "ON" : "OFF") << endl;
+		}
+		else
+			cout << "\nDYNAMIC RESOLUTION: timestamps are not supported" << endl;
+		window.setKeyPressedF3Flag();
+	}
+
+	if (window.getKeyPressedF4Flag() == true) {
+
+		resolutionTargetIdx = (resolutionTargetIdx + 1) % resolutionTargets.size();
+		HdaResolution::Settings settings = resolution.getSettings();
+		settings.targetMs = resolutionTargets[resolutionTargetIdx];
+		resolution.setSettings(settings);
+		cout << "\nDYNAMIC RESOLUTION TARGET: " << settings.targetMs << " ms (" << 1000.0f / settings.targetMs << " FPS)" << endl;
+		window.setKeyPressedF4Flag();
+	}
+
+	if (window.getKeyPressedF5Flag() == true) {
+
+		resolutionMinScaleIdx = (resolutionMinScaleIdx + 1) % resolutionMinScales.size();
+		HdaResolution::Settings settings = resolution.getSettings();
+		settings.minScale = resolutionMinScales[resolutionMinScaleIdx];
+		resolution.setSettings(settings);
+		cout << "\nDYNAMIC RESOLUTION SCALE: " << resolution.getSettings().minScale << " - " << resolution.getSettings().maxScale << endl;
+		window.setKeyPressedF5Flag();
+	}
+
+	if (window.getKeyPressedF6Flag() == true) {
+
+		upscaleFilter = (upscaleFilter + 1) % RESOLUTION_UPSCALE_FILTERS;
+		cout << "\nUPSCALE FILTER: " << (upscaleFilter == RESOLUTION_UPSCALE_EDGE ? "edge-adaptive" : "bilinear") << endl;
+		window.setKeyPressedF6Flag();
+	}
+}
+
+
+// pipelines are created again with the other variant, so the key is handled before the image is acquired
+void HdaBuilder::handlePrecisionKeys() {
+
+	if (window.getKeyPressedF7Flag() == true) {
+
+		if (device.getFloat16Support()) {
+			pipeline.setHalfPrecision(!pipeline.getHalfPrecision());
+			cout << "\nSHADING PRECISION: " << (pipeline.getHalfPrecision() ? "float16" : "float32") << endl;
+			recreateSwapchain();
+		}
+		else
+			cout << "\nSHADING PRECISION: float16 is not supported" << endl;
+		window.setKeyPressedF7Flag();
+	}
+}
+
+
+/**
+*	@brief Record post processing of HDR scene color by the frame graph.
+*
+*	Bloom, local tone mapping, the LUT and tone mapping declare what they read and write,
+*	the graph derives barriers between them and culls the passes whose results tone mapping
+*	does not use. tonemap.frag has all targets in its set also when an effect is off, so such
+*	reads keep only the layout. The bloom chain and local grids share memory with G-buffer,
+*	so their first use waits for the writes of the scene passes.
+*
+*/
+void HdaBuilder::recordPostProcessing(vk::CommandBuffer* cmdBuffs, uint32_t imageIndex) {
+
+	using Stage = vk::PipelineStageFlagBits2;
+	using Acc = vk::AccessFlagBits2;
+	using Layout = vk::ImageLayout;
+
+	const HdaGraph::Access aliased{ Stage::eColorAttachmentOutput | Stage::eFragmentShader | Stage::eComputeShader, Acc::eColorAttachmentWrite | Acc::eShaderWrite, Layout::eUndefined };
+	const HdaGraph::Access computeSample{ Stage::eComputeShader, Acc::eShaderRead, Layout::eShaderReadOnlyOptimal };
+	const HdaGraph::Access computeRead{ Stage::eComputeShader, Acc::eShaderRead, Layout::eGeneral };
+	const HdaGraph::Access computeWrite{ Stage::eComputeShader, Acc::eShaderWrite, Layout::eGeneral };
+	const HdaGraph::Access fragmentSample{ Stage::eFragmentShader, Acc::eShaderRead, Layout::eShaderReadOnlyOptimal };
+	const HdaGraph::Access fragmentRead{ Stage::eFragmentShader, Acc::eShaderRead, Layout::eGeneral };
+	const vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+	// the scene passes are finished before the first timestamp
+	uint32_t query = static_cast<uint32_t>(actual_frame * BLOOM_TIMESTAMPS);
+	if (device.getTimestampSupport()) {
+		cmdBuffs->resetQueryPool(bloomQueryPool, query, BLOOM_TIMESTAMPS);
+		cmdBuffs->writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, bloomQueryPool, query);
+	}
+	bloomTimestampsRecorded[actual_frame] = 1;
+
+	bloomFrameLevels[actual_frame] = bloomOn ? min(bloomMips, swapchain.getBloomLevels()) : 0;
+	localFrameOn[actual_frame] = hdrOnFlag == 1 && localCompressionIdx > 0;
+	bool lutUsed = lutOn && hdrOnFlag == 1;
+	bool lutChanged = lutSettings.chooseMethodFlag != chooseMethodFlag || lutSettings.exposure != exposure || lutGradeBaked != lutGradeIdx;
+
+	postGraph.clear();
+
+	// the dependency of the scene render pass made scene color visible to shaders
+	uint32_t scene = postGraph.addResource({ "scene color", swapchain.getSceneColorImage(), range, { Stage::eColorAttachmentOutput, {}, Layout::eShaderReadOnlyOptimal } });
+	uint32_t bloom = postGraph.addResource({ "bloom chain", swapchain.getBloomImage(), vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, swapchain.getBloomLevels(), 0, 1),
+											 aliased, true, false, swapchain.getTransientSize(swapchain.getBloomImage()) });
+	uint32_t grid = postGraph.addResource({ "local grid", swapchain.getLocalGridImage(0), range, aliased, true, false, swapchain.getTransientSize(swapchain.getLocalGridImage(0)) });
+	uint32_t blurred = postGraph.addResource({ "local grid blurred", swapchain.getLocalGridImage(1), range, aliased, true, false, swapchain.getTransientSize(swapchain.getLocalGridImage(1)) });
+	uint32_t lut = postGraph.addResource({ "tonemap LUT", lutImage, range, lutState });
+	// the render pass of tone mapping transitions the swapchain image
+	uint32_t output = postGraph.addResource({ "swapchain image", vk::Image(), range, {}, false, true });
+
+	uint32_t pass = postGraph.addPass("bloom", [this](vk::CommandBuffer* cmd) { recordBloom(cmd); });
+	postGraph.read(pass, scene, computeSample);
+	postGraph.read(pass, bloom, computeRead);
+	postGraph.write(pass, bloom, computeWrite);
+
+	pass = postGraph.addPass("local grid", [this](vk::CommandBuffer* cmd) { recordLocalGrid(cmd); });
+	postGraph.read(pass, scene, computeSample);
+	postGraph.write(pass, grid, computeWrite);
+
+	pass = postGraph.addPass("local blur", [this](vk::CommandBuffer* cmd) { recordLocalBlur(cmd); });
+	postGraph.read(pass, grid, computeRead);
+	postGraph.write(pass, blurred, computeWrite);
+
+	if (!lutBaked || lutChanged) {
+
+		pass = postGraph.addPass("tonemap LUT", [this](vk::CommandBuffer* cmd) { recordTonemapLut(cmd); });
+		postGraph.write(pass, lut, { Stage::eTransfer, Acc::eTransferWrite, Layout::eTransferDstOptimal });
+	}
+
+	pass = postGraph.addPass("tone mapping", [this, imageIndex](vk::CommandBuffer* cmd) { recordTonemap(cmd, imageIndex); });
+	postGraph.read(pass, scene, fragmentSample);
+	if (bloomFrameLevels[actual_frame] > 0)
+		postGraph.read(pass, bloom, fragmentRead);
+	else
+		postGraph.readLayout(pass, bloom, fragmentRead);
+	if (localFrameOn[actual_frame])
+		postGraph.read(pass, blurred, fragmentRead);
+	else
+		postGraph.readLayout(pass, blurred, fragmentRead);
+	if (lutUsed)
+		postGraph.read(pass, lut, fragmentSample);
+	else
+		postGraph.readLayout(pass, lut, fragmentSample);
+	postGraph.write(pass, output, { Stage::eColorAttachmentOutput, Acc::eColorAttachmentWrite, Layout::eUndefined });
+
+	postGraph.compile();
+	postGraph.execute(cmdBuffs, device.getPipelineBarrier2());
+	lutState = postGraph.getFinalState(lut);
+
+	if (graphDump) {
+		cout << "\n" << postGraph.dump();
+		graphDump = false;
+	}
+}
+
+
+// the scene graph and the graph of post processing are printed when the next frame is recorded
+void HdaBuilder::handleGraphKeys() {
+
+	if (window.getKeyPressedF8Flag() == true) {
+
+		graphDump = true;
+		window.setKeyPressedF8Flag();
+	}
+}
+
+
+// compression takes effect in the next recorded frame, the cost per resolution is printed when it is switched on
+void HdaBuilder::handleLocalKeys() {
+
+	if (window.getKeyPressed0Flag() == true) {
+
+		localCompressionIdx = (localCompressionIdx + 1) % localCompressions.size();
+		if (localCompressionIdx == 0)
+			cout << "\nLOCAL TMO: OFF" << endl;
+		else {
+			cout << "\nLOCAL TMO: ON (compression " << localCompressions[localCompressionIdx] << (hdrOnFlag == 1 ? ")" : ", used only with HDR)") << endl;
+			if (localCompressionIdx == 1)
+				HdaLocalTonemap::printLocalCost();
+		}
+		window.setKeyPressed0Flag();
+	}
+}
+
+
+/**
+*	@brief Create the object pipeline of instanced object.
+*
+*	The pipeline is the default object pipeline with instanced.vert and the instance
+*	buffer as the second vertex binding. Instances are not drawn by the depth prepass,
+*	so the object has no prepass pipelines.
+*
+*/
+void HdaBuilder::createInstancedPipelines(HdaModel::SceneObject* o) {
+
+	auto bindings = HdaInstancing::getBindingDescriptions();
+	auto attributes = HdaInstancing::getAttributeDescriptions();
+
+	o->objectPipeline = pipeline.createPipeline(vk::PipelineCreateFlags(), UINT32_MAX,
+		array{  // pStages
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eVertex,  // stage
+				pipeline.getInstancedVertexShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+			vk::PipelineShaderStageCreateInfo{
+				vk::PipelineShaderStageCreateFlags(),
+				vk::ShaderStageFlagBits::eFragment,  // stage
+				pipeline.getFragmentShaderModule(),  // module
+				"main",  // pName
+				nullptr  // pSpecializationInfo
+			},
+		}.data(),
+		&(const vk::PipelineVertexInputStateCreateInfo&)vk::PipelineVertexInputStateCreateInfo{  // pVertexInputState
+			vk::PipelineVertexInputStateCreateFlags(),
+			static_cast<uint32_t>(bindings.size()),  // vertexBindingDescriptionCount
+			bindings.data(),  // pVertexBindingDescriptions
+			static_cast<uint32_t>(attributes.size()),  // vertexAttributeDescriptionCount
+			attributes.data()  // pVertexAttributeDescriptions
+		}, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+		o->objectPipelineLayout, device.getRenderpass(), UINT32_MAX, nullptr, UINT32_MAX);
+}
+
+
+// every frame has its own buffer of visible instances, it is written while the frame is recorded
+void HdaBuilder::createInstanceBuffers(HdaModel::SceneObject* o) {
+
+	vk::DeviceSize instanceSize = sizeof(HdaModel::InstanceData) * INSTANCES_MAX;
+
+	o->instanceBuffs.resize(PARALLEL_FRAMES);
+	o->instanceBuffsMemory.resize(PARALLEL_FRAMES);
+	o->instanceBuffsPointer.resize(PARALLEL_FRAMES);
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+
+		createBuffer(instanceSize, vk::BufferUsageFlagBits::eVertexBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, o->instanceBuffs[i], o->instanceBuffsMemory[i]);
+		o->instanceBuffsPointer[i] = device.getDevice().mapMemory(o->instanceBuffsMemory[i], 0, instanceSize, vk::MemoryMapFlags());
+	}
+}
+
+
+/**
+*	@brief Cull instances of object by frustum.
+*
+*	The visible instances are written into the instance buffer of the frame sorted by
+*	level of detail, all drawings of the frame use it.
+*
+*/
+void HdaBuilder::cullObjectInstances(HdaModel::SceneObject* o) {
+
+	auto startT = chrono::high_resolution_clock::now();
+
+	float aspect = static_cast<float>(swapchain.getSurfaceExtent().width) / static_cast<float>(swapchain.getSurfaceExtent().height);
+	float pixelScale = renderExtent.height * 0.5f / tan(glm::radians(CAMERA_FOV) * 0.5f);
+	HdaMeshlet::CullUniformData cullData = HdaMeshlet::prepareCullData(HdaModel::getCameraView(), aspect, MESHLET_CULL_FRUSTUM, 0);
+
+	visibleInstances = HdaInstancing::cullInstances(o->instances, scene.getWorldTransform(sceneEntities[o - sceneObjects.data()]), o->instanceSphere, cullData, o->objectMesh.info[0], pixelScale,
+													static_cast<HdaModel::InstanceData*>(o->instanceBuffsPointer[actual_frame]), o->instanceLodFirst, &jobs);
+
+	for (uint32_t l = 0; l < MAX_LOD_LEVELS; l++)
+		lodHistogram[l] += o->instanceLodFirst[l + 1] - o->instanceLodFirst[l];
+
+	instanceCullTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startT).count();
+
+	// one draw call per submesh and non-empty level of detail
+	instanceDraws = 0;
+	for (uint32_t l = 0; l < MAX_LOD_LEVELS; l++)
+		if (o->instanceLodFirst[l + 1] > o->instanceLodFirst[l])
+			instanceDraws += static_cast<uint32_t>(o->objectMesh.info.size());
+}
 
-		hdrOnFlag == 0 ? hdrOnFlag = 1 : hdrOnFlag = 0;
-		hdrOnFlag == 1 ? cout << "\nHDR: ON" << endl : cout << "\nHDR: OFF" << endl;
-		cout << methodNames[chooseMethodFlag];
-		window.setKeyPressedXFlag();
-	}
-	sceneD->hdrOnFlag = hdrOnFlag;
 
-	if (window.getKeyPressedMFlag() == true) {
+// visible instances with one call per submesh and level of detail, the object pipeline and descriptor sets are already bound
+void HdaBuilder::drawInstances(HdaModel::SceneObject* o, vk::CommandBuffer* cmdBuffs) {
 
-		if (chooseMethodFlag == 4)
-			chooseMethodFlag = 0;
-		else
-			chooseMethodFlag += 1;
-		window.setKeyPressedMFlag();
+	vk::DeviceSize offset = 0;
+	cmdBuffs->bindVertexBuffers(1, 1, &o->instanceBuffs[actual_frame], &offset);
 
-		cout << methodNames[chooseMethodFlag];
+	for (uint32_t s = 0; s < o->objectMesh.info.size(); s++) {
+
+		const auto& inf = o->objectMesh.info[s];
+		for (uint32_t l = 0; l < MAX_LOD_LEVELS; l++) {
+
+			// prerecorded command buffers draw every level, the empty ones have zero instances in the draw arguments
+			if (recordingStatic) {
+				cmdBuffs->drawIndexedIndirect(
+					o->drawArgsBuffs[actual_frame],
+					(s * MAX_LOD_LEVELS + l) * sizeof(vk::DrawIndexedIndirectCommand),  // offset
+					1,  // drawCount
+					sizeof(vk::DrawIndexedIndirectCommand)  // stride
+				);
+				continue;
+			}
+
+			uint32_t count = o->instanceLodFirst[l + 1] - o->instanceLodFirst[l];
+			if (count == 0)
+				continue;
+
+			// the other submeshes may have less levels than the first one
+			uint32_t lod = min(l, inf.lodCnt - 1);
+			cmdBuffs->drawIndexed(
+				inf.lodIndexCnt[lod],  // indexCount
+				count,  // instanceCount
+				inf.lodFirstIndex[lod],  // firstIndex
+				0,  // vertexOffset
+				o->instanceLodFirst[l]   // firstInstance
+			);
+		}
 	}
-	sceneD->chooseMethodFlag = chooseMethodFlag;
+}
 
-	sceneD->nontextureFlag = 0;
 
-	// STATIC uniform buffer with model view projection data
-	glm::vec3 cameraPos{ 0.0f, 0.0f, 0.0f };
-	glm::mat4 skyboxView;
-	HdaModel::ProjectionUniformData modelviewProjection = HdaModel::projectionCalculation(o->modelMatrix, window.getGLFWwindow(), &skyboxView, cameraPos, sceneD, window.getKeyPressedXFlag(), &exposure);
-	memcpy(uniformBuffsMemoryPointer[actual_frame], &modelviewProjection, sizeof(modelviewProjection));
-	sceneD->exposure = exposure;
+// the measured time of the current instance count is printed with the times of other counts
+void HdaBuilder::handleInstanceKeys() {
 
-	// DYNAMIC uniform structure bind to dynamic uniform buffer with lighting and material data
-	HdaModel::loadLightData(matlightData, ambientColor, diffuseColor, glm::vec4(1.0f), array{ glm::vec4{ -15.0f, 25.0f, 0.0f, 1.0f } , glm::vec4{ -25.0f, 25.0f, 0.0f, 1.0f } }, array{ glm::vec4{ 15.0f, 0.0f, 0.0f, 0.0f } , glm::vec4{ -15.0f, 0.0f, 0.0f, 0.0f } });
+	if (window.getKeyPressedTFlag() == true) {
 
-	// selection of objects that should not rotate
-	if (o->nonRotateFlag == 0)
-		constants.modelMatrix = glm::rotate(o->modelMatrix, t * glm::radians(30.0f), glm::vec3(0, 1, 0)); //sceneObjects[i].modelMatrix;
-	else
-		constants.modelMatrix = o->modelMatrix;	//constants.modelMatrix = glm::translate(constants.modelMatrix, { 2 + (5 * cos(5)), 2 + (5 * sin(5)), 0 });
+		instanceCountIdx = (instanceCountIdx + 1) % static_cast<uint32_t>(instanceCounts.size());
+		for (auto& o : sceneObjects)
+			if (!o.instances.empty())
+				o.instances = HdaInstancing::createBenchmarkInstances(instanceCounts[instanceCountIdx], INSTANCE_SPACING);
 
-	// selection of objects that should not be textured
-	if (o->nonTextureFlag == 1) {
-		sceneD->nontextureFlag = 1;
+		cout << "\nINSTANCES: " << instanceCounts[instanceCountIdx] << " | ms per frame:";
+		for (size_t i = 0; i < instanceCounts.size(); i++)
+			if (instanceFrameTimes[i] > 0.0)
+				cout << " " << instanceCounts[i] << " instances: " << instanceFrameTimes[i];
+		cout << endl;
+		window.setKeyPressedTFlag();
 	}
+}
 
-	constants.cameraPosition = cameraPos;
 
-	// prepare matricies for calculation of normal matrix in vertex shader
-	sceneD->modelView = modelviewProjection.view * constants.modelMatrix;
-	sceneD->normalMatrix = glm::transpose(glm::inverse(sceneD->modelView));
-	sceneD->normalMatrixWorld = glm::transpose(glm::inverse(constants.modelMatrix));
+// every scene object has one root entity, the uniform data of all objects are uploaded by the first frame
+void HdaBuilder::createSceneEntities() {
 
-	cmdBuffs->pushConstants(o->objectPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(HdaModel::PushConstants), &constants);
+	sceneEntities.resize(sceneObjects.size());
 
-	mapMemoryToUniformBuffer(sceneUniformBuffMemory, sceneUniformSize, 2, *matlightData, 0, *sceneD, SELECT_SCENEDATA);
-	mapMemoryToUniformBuffer(materialLightUniformBuffMemory, materialUniformSize, 2, *matlightData, 0, *sceneD, SELECT_MATLIGHTDATA);
+	// negative exposure is never uploaded, so the first frames upload data of all objects
+	HdaModel::SceneUniformData neverUploaded{};
+	neverUploaded.exposure = -1.0f;
+	uploadedSceneData.assign(PARALLEL_FRAMES * sceneObjects.size(), neverUploaded);
 
-	// BIND descriptors with dynamic uniform buffer
-	uint32_t offsets[] = { dynamicUniformOffset, dynamicMaterialLightUniformOffset };
-	cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, o->objectPipelineLayout, 0, 1, &o->dsv[0][actual_frame], 2, offsets);
+	for (uint32_t i = 0; i < sceneObjects.size(); i++)
+		sceneEntities[i] = scene.createEntity(sceneObjects[i].modelMatrix, HdaScene::Handle{}, i);
 }
 
 
-void HdaBuilder::mapMemoryToUniformBuffer(vk::DeviceMemory devMem, size_t sizeofStructure, uint32_t numOfSizes, HdaModel::MaterialLightUniformData matlightData, uint32_t offsetN, HdaModel::SceneUniformData sceneData, uint32_t structSelect) {
+// rotating objects get a new local transform every frame, world transforms of the others stay clean
+void HdaBuilder::updateSceneTransforms(float t) {
 
-	char* data{};
-	if (device.getDevice().mapMemory(devMem, 0, calcRequiredAligment(sizeofStructure) * numOfSizes, vk::MemoryMapFlags(), (void**)&data) != vk::Result::eSuccess)
-		throw runtime_error("Function vk::Device::mapMemory() crash.\n");
-	data += calcRequiredAligment(sizeofStructure) * offsetN;
-	if (structSelect == 1)
-		memcpy(data, &sceneData, sizeofStructure);
-	else
-		memcpy(data, &matlightData, sizeofStructure);
-	device.getDevice().unmapMemory(devMem);
+	for (uint32_t i = 0; i + 1 < sceneEntities.size(); i++)
+		if (sceneObjects[i].nonRotateFlag == 0)
+			scene.setLocalTransform(sceneEntities[i], glm::rotate(sceneObjects[i].modelMatrix, t * glm::radians(30.0f), glm::vec3(0, 1, 0)));
+
+	scene.updateTransforms();
 }
 
 
-void HdaBuilder::drawMultiTexturedObjects(HdaModel::SceneObject* o, vk::CommandBuffer* cmdBuffs, float t) {
+/**
+*	@brief Decide whether the scene data of object have to be uploaded.
+*
+*	The data are uploaded when world transform of object changed or they differ from
+*	the last upload, e.g. the camera moved or a flag was switched. Skipped uploads save
+*	mapping of the dynamic uniform buffer. Every frame has its own scene data, so they
+*	are compared with the last upload into the part of the same frame.
+*
+*/
+bool HdaBuilder::uploadSceneData(uint32_t idx, const HdaModel::SceneUniformData& data) {
 
-	uint32_t currentTexIdx = UINT32_MAX;
+	HdaModel::SceneUniformData& last = uploadedSceneData[actual_frame * sceneEntities.size() + idx];
+	bool changed = scene.isDirty(sceneEntities[idx], SCENE_DIRTY_UNIFORM) || last.modelMatrix != data.modelMatrix || last.modelView != data.modelView || last.normalMatrixWorld != data.normalMatrixWorld ||
+				   last.nontextureFlag != data.nontextureFlag || last.blinnPhongFlag != data.blinnPhongFlag || last.pointLightFlag != data.pointLightFlag ||
+				   last.hdrOnFlag != data.hdrOnFlag || last.exposure != data.exposure || last.chooseMethodFlag != data.chooseMethodFlag;
 
-	uint32_t dynamicUniformOffset = 0;  // requiredAlignmentScene * 0;
-	uint32_t dynamicMaterialLightUniformOffset = 0; // requiredAlignmentMaterial * 0;
-	
-	HdaModel::MaterialLightUniformData matlightData{};
-	HdaModel::SceneUniformData sceneData{};
+	if (!changed) {
+		uniformSkips++;
+		return false;
+	}
 
-	uint32_t infoSize = static_cast<uint32_t>(o->objectMesh.info.size());
+	last = data;
+	scene.clearDirty(sceneEntities[idx], SCENE_DIRTY_UNIFORM);
+	uniformUploads++;
 
-	// TODO TODO
-	setUniformStructures(o, cmdBuffs, t, dynamicUniformOffset, dynamicMaterialLightUniformOffset, &matlightData, &sceneData);
+	return true;
+}
 
-	// loop through grouoped faces (triangles)
-	for (uint32_t i = 0, k = 0; i < infoSize; i++) {
 
-		auto thisTexIdx = o->objectMesh.info[i].textureIndex;
-		if (thisTexIdx != currentTexIdx && thisTexIdx <= o->objectMesh.numMat) {
+// the benchmark blocks rendering for a few seconds
+void HdaBuilder::handleSceneKeys() {
 
-			currentTexIdx = thisTexIdx;
+	if (window.getKeyPressedUFlag() == true) {
 
-			// set material properties
-			HdaModel::loadMaterialData(&matlightData, o->objectMesh.mats[currentTexIdx].ambient, o->objectMesh.mats[currentTexIdx].diffuse, o->objectMesh.mats[currentTexIdx].specular, o->objectMesh.mats[currentTexIdx].shi);
+		cout << "\nSCENE: " << scene.getEntityCount() << " entities";
+		HdaScene::benchmark({ 10000, 100000, 1000000 });
+		window.setKeyPressedUFlag();
+	}
+}
 
-			dynamicMaterialLightUniformOffset = static_cast<uint32_t>(requiredAlignmentMaterial * k);
 
-			mapMemoryToUniformBuffer(materialLightUniformBuffMemory, materialUniformSize, o->objectMesh.submeshCnt, matlightData, k, sceneData, SELECT_MATLIGHTDATA);		
-			
-			uint32_t offsets[] = { dynamicUniformOffset, dynamicMaterialLightUniformOffset };
-			cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, o->objectPipelineLayout, 0, 1, &o->dsv[currentTexIdx][actual_frame], 2, offsets);
-			
-			k++;
-		}
-	
-		cmdBuffs->draw(
-				static_cast<uint32_t>(o->objectMesh.info[i].vertexCnt),  // vertexCount
-				1,  // instanceCount
-				o->objectMesh.info[i].firstVertex,  // firstVertex
-				0   // firstInstance
-			);
+// utilization since the last press shows how much of the frame the workers were busy
+void HdaBuilder::handleJobKeys() {
+
+	if (window.getKeyPressedVFlag() == true) {
 
-		/*cmdBuffs->drawIndexed(static_cast<uint32_t>(o->objectMesh.info[i].vertexCnt),1,o->objectMesh.info[i].firstVertex,0,0);*/
+		cout << "\nJOBS:\n";
+		jobs.printUtilization();
+		HdaJobs::benchmark();
+		window.setKeyPressedVFlag();
 	}
 }
 
 
-// TODO TODO
-void HdaBuilder::drawSingleTexturedObjects(HdaModel::SceneObject* o, vk::CommandBuffer* cmdBuffs, float t, int i) {
+/**
+*	@brief Create command pools of secondary command buffers.
+*
+*	Every slot of job system has its own pool for every frame, so the threads never
+*	share a pool. Pools of frame are reset after its timeline wait and the command buffers
+*	are reused.
+*
+*/
+void HdaBuilder::createRecordPools(vector<vector<RecordPool>>& pools) {
 
-	// DYNAMIC uniform structure bind to dynamic uniform buffer with additional scene data
-	HdaModel::SceneUniformData sceneData;
-	array<string, 5> methodNames;
-	methodNames[0] = "\nALGORITHM: Reinhard TMO\n";
-	methodNames[1] = "\nALGORITHM: Hejl-Dawson TMO\n";
-	methodNames[2] = "\nALGORITHM: Hable - Uncharted 2 TMO\n";
-	methodNames[3] = "\nALGORITHM: ACES TMO\n";
-	methodNames[4] = "\nALGORITHM: Modified Reinhard TMO\n";
+	pools.resize(PARALLEL_FRAMES);
 
-	// TODO TODO hodi do vlastn funkce
-	if (window.getKeyPressedXFlag() == true) {
+	for (auto& framePools : pools) {
 
-		hdrOnFlag == 0 ? hdrOnFlag = 1 : hdrOnFlag = 0;
-		hdrOnFlag == 1 ? cout << "\nHDR: ON" << endl : cout << "\nHDR: OFF" << endl;
-		cout << methodNames[chooseMethodFlag];
-		window.setKeyPressedXFlag();
+		framePools = vector<RecordPool>(jobs.getSlotCount());
+		for (auto& p : framePools)
+			p.pool =
+				device.getDevice().createCommandPool(
+					vk::CommandPoolCreateInfo(
+						vk::CommandPoolCreateFlagBits::eTransient,
+						device.getGraphicsQueueFamily()
+					)
+				);
 	}
-	sceneData.hdrOnFlag = hdrOnFlag;
 
-	if (window.getKeyPressedMFlag() == true) {
+	cout << "createRecordPools(): " << jobs.getSlotCount() << " command pools per frame are created.\n";
+}
 
-		if (chooseMethodFlag == 4)
-			chooseMethodFlag = 0;
-		else
-			chooseMethodFlag += 1;
 
-		window.setKeyPressedMFlag();
-		
-		cout << methodNames[chooseMethodFlag];
+void HdaBuilder::resetRecordPools(vector<RecordPool>& pools) {
+
+	for (auto& p : pools) {
+		device.getDevice().resetCommandPool(p.pool, vk::CommandPoolResetFlags());
+		p.used = 0;
 	}
-	sceneData.chooseMethodFlag = chooseMethodFlag;
-	sceneData.nontextureFlag = 0;
-	
-	// STATIC uniform buffer with model view projection data
-	glm::vec3 cameraPos{ 0.0f, 0.0f, 0.0f };
-	glm::mat4 skyboxView;
-	HdaModel::ProjectionUniformData modelviewProjection = HdaModel::projectionCalculation(o->modelMatrix, window.getGLFWwindow(), &skyboxView, cameraPos, &sceneData, window.getKeyPressedXFlag(), &exposure);
-	memcpy(uniformBuffsMemoryPointer[actual_frame], &modelviewProjection, sizeof(modelviewProjection));
-	sceneData.exposure = exposure;
+}
 
-	// DYNAMIC uniform structure bind to dynamic uniform buffer with lighting and material data
-	HdaModel::MaterialLightUniformData matlightData;
-	HdaModel::loadLightData(&matlightData, ambientColor, diffuseColor, glm::vec4(1.0f), array{ glm::vec4{ -15.0f, 25.0f, 0.0f, 1.0f } , glm::vec4{ -25.0f, 25.0f, 0.0f, 1.0f } }, array{ glm::vec4{ 15.0f, 0.0f, 0.0f, 0.0f } , glm::vec4{ -15.0f, 0.0f, 0.0f, 0.0f } });
-	HdaModel::loadMaterialData(&matlightData, glm::vec4(0.6f, 0.6f, 0.6f, 0.0f), glm::vec4(0.6f, 0.6f, 0.6f, 0.0f), glm::vec4(0.5f, 0.5f, 0.5f, 0.0f), 16.0f);
 
+// called by jobs, the pool of the calling slot is used, persistent command buffers are executed in more frames
+vk::CommandBuffer HdaBuilder::beginSecondary(bool persistent) {
 
-	HdaModel::PushConstants constants{};
+	RecordPool& p = (persistent ? staticPools : recordPools)[actual_frame][jobs.getCurrentSlot()];
 
-	// the skybox requires its own view matrix, which lacks a translational component
-	// because the skybox must always be in the middle of the camera and we are not allowed to approach it
-	// 
-	// depending on the type of the object, we choose different structures for push constants
-	if (i == (sceneObjectsSize - 1)) {	// skybox is rendered as last object because depth testing 
+	if (p.used == p.buffs.size())
+		p.buffs.push_back(
+			device.getDevice().allocateCommandBuffers(
+				vk::CommandBufferAllocateInfo(
+					p.pool,
+					vk::CommandBufferLevel::eSecondary,
+					1
+				)
+			)[0]
+		);
+
+	vk::CommandBuffer cmdBuff = p.buffs[p.used++];
+
+	// the pipeline statistics query of frame is inherited only with inheritedQueries, otherwise the flags
+	// must be empty and render() does not begin the query, framebuffer of persistent command buffers
+	// is not known, the swapchain image changes
+	cmdBuff.begin(
+		vk::CommandBufferBeginInfo(
+			persistent ? vk::CommandBufferUsageFlags(vk::CommandBufferUsageFlagBits::eRenderPassContinue) : vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+			&(const vk::CommandBufferInheritanceInfo&)vk::CommandBufferInheritanceInfo(
+				recordingRenderpass,
+				0,  // subpass
+				persistent ? vk::Framebuffer(nullptr) : recordingFramebuffer,
+				VK_FALSE,  // occlusionQueryEnable
+				vk::QueryControlFlags(),
+				device.getInheritedQueriesSupport() ? vk::QueryPipelineStatisticFlags(vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations) : vk::QueryPipelineStatisticFlags()
+			)
+		)
+	);
+	setViewport(&cmdBuff, renderExtent);
+
+	return cmdBuff;
+}
+
+
+// chunks are split into groupCnt contiguous groups, one secondary command buffer per group
+vector<vk::CommandBuffer> HdaBuilder::recordSecondaries(const vector<DrawChunk>& chunks, uint32_t phase, uint32_t groupCnt, bool persistent) {
 
-		HdaModel::SkyboxPushConstants skyboxConstants{};
-		skyboxConstants.modelMatrix = o->modelMatrix;
-		skyboxConstants.viewMatrix = skyboxView;
+	vector<vk::CommandBuffer> secondaries(groupCnt);
+	HdaJobs::Counter counter;
 
-		cmdBuffs->pushConstants(o->objectPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(HdaModel::SkyboxPushConstants), &skyboxConstants);
+	for (uint32_t g = 0; g < groupCnt; g++) {
+
+		uint32_t first = static_cast<uint32_t>(g * chunks.size() / groupCnt);
+		uint32_t end = static_cast<uint32_t>((g + 1) * chunks.size() / groupCnt);
+
+		jobs.run("recordSecondaries", [this, &chunks, &secondaries, g, first, end, phase, persistent]() {
+			secondaries[g] = beginSecondary(persistent);
+			recordChunks(&secondaries[g], chunks, first, end, phase);
+			secondaries[g].end();
+		}, &counter);
 	}
-	else {
 
-		// selection of objects that should not rotate
-		if (o->nonRotateFlag == 0)
-			constants.modelMatrix = glm::rotate(o->modelMatrix, t * glm::radians(30.0f), glm::vec3(0, 1, 0)); //o->modelMatrix;
-		else
-			constants.modelMatrix = o->modelMatrix;	//constants.modelMatrix = glm::translate(constants.modelMatrix, { 2 + (5 * cos(5)), 2 + (5 * sin(5)), 0 });
+	jobs.wait(counter);
 
-		// selection of objects that should not be textured
-		if (o->nonTextureFlag == 1) {
-			sceneData.nontextureFlag = 1;
-		}
+	return secondaries;
+}
 
-		constants.cameraPosition = cameraPos;
 
-		// prepare matricies for calculation of normal matrix in vertex shader
-		sceneData.modelView = modelviewProjection.view * constants.modelMatrix;
-		sceneData.normalMatrix = glm::transpose(glm::inverse(sceneData.modelView));
-		sceneData.normalMatrixWorld = glm::transpose(glm::inverse(constants.modelMatrix));
+/**
+*	@brief Measure recording of a scene with thousands of draws against the number of threads.
+*
+*	Chunks of the shading pass are repeated until they have RECORD_BENCH_DRAWS draws
+*	and split into as many secondary command buffers as threads, so at most that many
+*	threads record at once. The command buffers are not submitted.
+*
+*/
+void HdaBuilder::benchmarkRecording() {
+
+	const int runs = 5;
+	vector<DrawChunk> sceneChunks = createDrawChunks(MESHLET_PHASE_SINGLE, DRAW_MODE_FULL, RECORD_CHUNK_DRAWS);
+	uint32_t sceneDraws = 0;
+	for (const auto& c : sceneChunks)
+		sceneDraws += c.end - c.first;
+
+	vector<DrawChunk> chunks;
+	uint32_t draws = 0;
+	while (draws < RECORD_BENCH_DRAWS && sceneDraws > 0) {
+		chunks.insert(chunks.end(), sceneChunks.begin(), sceneChunks.end());
+		draws += sceneDraws;
+	}
+
+	vector<uint32_t> threadCounts;
+	for (uint32_t n = 1; n < jobs.getSlotCount(); n *= 2)
+		threadCounts.push_back(n);
+	threadCounts.push_back(jobs.getSlotCount());
+
+	recordingRenderpass = device.getRenderpass();
+	recordingFramebuffer = nullptr;
+
+	cout << "\nbenchmarkRecording(): " << draws << " draws in " << chunks.size() << " chunks | threads | ms | speedup\n";
+
+	double singleT = 0.0;
+	for (uint32_t n : threadCounts) {
+
+		double recordT = 1e9;
+		for (int r = 0; r < runs; r++) {
+
+			resetRecordPools(recordPools[actual_frame]);
+			auto startT = chrono::high_resolution_clock::now();
+			recordSecondaries(chunks, MESHLET_PHASE_SINGLE, n, false);
+			recordT = min(recordT, chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startT).count());
+		}
+		if (n == 1)
+			singleT = recordT;
 
-		cmdBuffs->pushConstants(o->objectPipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(HdaModel::PushConstants), &constants);
+		cout << "  " << n << " | " << recordT << " | " << singleT / recordT << "\n";
 	}
 
-	mapMemoryToUniformBuffer(sceneUniformBuffMemory, sceneUniformSize, sceneObjectsSize, matlightData, i, sceneData, SELECT_SCENEDATA);
-	mapMemoryToUniformBuffer(materialLightUniformBuffMemory, materialUniformSize, sceneObjectsSize, matlightData, i, sceneData, SELECT_MATLIGHTDATA);
-	uint32_t dynamicUniformOffset = requiredAlignmentScene * i;
-	uint32_t dynamicMaterialLightUniformOffset = requiredAlignmentMaterial * i;
+	resetRecordPools(recordPools[actual_frame]);
+}
 
-	// BIND descriptors with dynamic uniform buffer
-	uint32_t offsets[] = { dynamicUniformOffset, dynamicMaterialLightUniformOffset };
-	cmdBuffs->bindDescriptorSets(vk::PipelineBindPoint::eGraphics, o->objectPipelineLayout, 0, 1, &o->objectDescriptSets[actual_frame], 2, offsets);
 
-	cmdBuffs->draw(
-		static_cast<uint32_t>(o->objectMesh.meshVertices.size()),  // vertexCount
-		1,  // instanceCount
-		0,  // firstVertex
-		0   // firstInstance
-	);
+// recording of scene switches between the primary command buffer and secondary command buffers of jobs
+void HdaBuilder::handleRecordKeys() {
+
+	if (window.getKeyPressedYFlag() == true) {
+
+		parallelRecording = !parallelRecording;
+		cout << "\nRECORDING: " << (parallelRecording ? "secondary command buffers of " + to_string(jobs.getSlotCount()) + " threads" : "single thread") << endl;
+		benchmarkRecording();
+		window.setKeyPressedYFlag();
+	}
 
-	// TODO TODO smazat
-	/*cmdBuffs->drawIndexed(static_cast<uint32_t>(sceneObjects[i].objectMesh.meshIndices.size()),1,0,0,0);*/
+	if (window.getKeyPressed1Flag() == true) {
+
+		staticCommands = !staticCommands;
+		for (auto& key : staticKeys)
+			key.clear();
+		staticRerecords = 0;
+
+		cout << "\nRECORDING: " << (staticCommands ? "prerecorded secondary command buffers" : parallelRecording ? "secondary command buffers of " + to_string(jobs.getSlotCount()) + " threads" : "single thread") << endl;
+		window.setKeyPressed1Flag();
+	}
 }
 
-void HdaBuilder::drawScene(vk::CommandBuffer* cmdBuffs) {
 
+// one host visible buffer per frame, non-instanced objects use the first entry of every submesh
+void HdaBuilder::createDrawArgsBuffers(HdaModel::SceneObject* o) {
 
-	vk::Pipeline currentPipe{};
-	vk::Buffer currentVertexBuff{};
+	vk::DeviceSize size = max<size_t>(o->objectMesh.info.size(), 1) * MAX_LOD_LEVELS * sizeof(vk::DrawIndexedIndirectCommand);
 
-	for (uint32_t i = 0; i < sceneObjectsSize; i++) {
+	o->drawArgsBuffs.resize(PARALLEL_FRAMES);
+	o->drawArgsBuffsMemory.resize(PARALLEL_FRAMES);
+	o->drawArgsBuffsPointer.resize(PARALLEL_FRAMES);
+
+	for (int i = 0; i < PARALLEL_FRAMES; i++) {
+		createBuffer(size, vk::BufferUsageFlagBits::eIndirectBuffer,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent, o->drawArgsBuffs[i], o->drawArgsBuffsMemory[i]);
+		o->drawArgsBuffsPointer[i] = device.getDevice().mapMemory(o->drawArgsBuffsMemory[i], 0, size, vk::MemoryMapFlags());
+	}
+}
 
-		// time counter
-		static auto startT = std::chrono::high_resolution_clock::now();
-		auto currentT = std::chrono::high_resolution_clock::now();
-		float t = std::chrono::duration<float, std::chrono::seconds::period>(currentT - startT).count();
 
-		// check if last pipe and vertex buffer is not same for higher performance
-		if (sceneObjects[i].objectPipeline != currentPipe) {
+/**
+*	@brief Write draws of the frame for prerecorded command buffers.
+*
+*	Submeshes draw their selected level of detail. Instanced objects have an entry for
+*	every submesh and level, the levels without visible instances draw zero instances.
+*
+*/
+void HdaBuilder::writeDrawArgs(HdaModel::SceneObject* o) {
+
+	auto* args = static_cast<vk::DrawIndexedIndirectCommand*>(o->drawArgsBuffsPointer[actual_frame]);
 
-			cmdBuffs->bindPipeline(vk::PipelineBindPoint::eGraphics, sceneObjects[i].objectPipeline);
+	for (uint32_t s = 0; s < o->objectMesh.info.size(); s++) {
 
-			currentPipe = sceneObjects[i].objectPipeline;
+		const auto& inf = o->objectMesh.info[s];
+		if (o->instances.empty()) {
+			uint32_t lod = o->selectedLods[s];
+			args[s] = vk::DrawIndexedIndirectCommand(inf.lodIndexCnt[lod], 1, inf.lodFirstIndex[lod], 0, 0);
+			continue;
 		}
 
-		if (sceneObjects[i].objectMesh.vertexBuff != currentVertexBuff) {
+		for (uint32_t l = 0; l < MAX_LOD_LEVELS; l++) {
+			uint32_t lod = min(l, inf.lodCnt - 1);
+			args[s * MAX_LOD_LEVELS + l] = vk::DrawIndexedIndirectCommand(inf.lodIndexCnt[lod], o->instanceLodFirst[l + 1] - o->instanceLodFirst[l], inf.lodFirstIndex[lod], 0, o->instanceLodFirst[l]);
+		}
+	}
+}
 
-			vk::Buffer vertexBuffers[] = { sceneObjects[i].objectMesh.vertexBuff };
-			vk::DeviceSize offsets[] = { 0 };
-			cmdBuffs->bindVertexBuffers(0, 1, vertexBuffers, offsets);
 
-			// if draw indexed
-			//cmdBuffs->bindIndexBuffer(sceneObjects[i].objectMesh.indexBuff, 0, vk::IndexType::eUint32);
+/**
+*	@brief State which the prerecorded command buffers depend on.
+*
+*	Pipelines are created again with the swapchain and the modes choose render passes,
+*	pipelines and buffers. Level 0 of meshlet culled submeshes is drawn by the draw
+*	commands of GPU culling, so only switching from or to level 0 changes the recording.
+*	The other levels and instance counts go through the draw arguments.
+*
+*/
+vector<uint32_t> HdaBuilder::staticRecordingKey() {
+
+	vector<uint32_t> key = { swapchainGeneration, static_cast<uint32_t>(meshletCullMode), occlusionCulling, depthPrepass, deferredShading, renderExtent.width, renderExtent.height };
 
-			currentVertexBuff = sceneObjects[i].objectMesh.vertexBuff;
-		}
+	if (meshletCullMode != MESHLET_CULL_OFF)
+		for (const auto& o : sceneObjects)
+			if (!o.cullDescriptSets.empty())
+				for (uint32_t lod : o.selectedLods)
+					key.push_back(lod == 0);
 
-		if (sceneObjects[i].multiTextureFlag == 1)
-			drawMultiTexturedObjects(&sceneObjects[i], cmdBuffs, t);
-		else
-			drawSingleTexturedObjects(&sceneObjects[i], cmdBuffs, t, i);
+	return key;
+}
+
+
+// called after the timeline wait of actual frame, so its command buffers can be recorded again
+void HdaBuilder::prepareStaticCommands() {
+
+	staticCallIdx = 0;
+	staticRecorded = false;
+
+	vector<uint32_t> key = staticRecordingKey();
+	if (key == staticKeys[actual_frame])
+		return;
+
+	resetRecordPools(staticPools[actual_frame]);
+	staticRecordings[actual_frame].clear();
+	staticKeys[actual_frame] = key;
+}
+
+
+/**
+*	@brief Execute prerecorded command buffers of the scene.
+*
+*	Every frame has its own recordings, as they bind descriptor sets and buffers of the
+*	frame. The drawScene() calls of frame are recorded in order the first time, the next
+*	frames only execute them. Data of the frame come through the uniform buffers and
+*	draw arguments of the frame.
+*
+*/
+void HdaBuilder::drawStaticScene(vk::CommandBuffer* cmdBuffs, uint32_t phase, uint32_t mode) {
+
+	vector<StaticRecording>& recordings = staticRecordings[actual_frame];
+	uint32_t idx = staticCallIdx++;
+
+	if (idx == recordings.size() || recordings[idx].phase != phase || recordings[idx].mode != mode || recordings[idx].renderpass != recordingRenderpass) {
+
+		// the later calls of frame are recorded again as well
+		recordings.resize(idx);
+
+		vector<DrawChunk> chunks = createDrawChunks(phase, mode, RECORD_CHUNK_DRAWS);
+		recordingStatic = true;
+		recordings.push_back(StaticRecording{ phase, mode, recordingRenderpass, recordSecondaries(chunks, phase, static_cast<uint32_t>(chunks.size()), true) });
+		recordingStatic = false;
+		staticRecorded = true;
 	}
+
+	if (!recordings[idx].buffs.empty())
+		cmdBuffs->executeCommands(recordings[idx].buffs);
 }
 
 
@@ -1402,23 +4372,19 @@ void HdaBuilder::render() {
 
 	vk::Result result;
 
-	// wait for rendering fence
-	result =
-		device.getDevice().waitForFences(
-			renderCompleteFences[actual_frame],
-			VK_TRUE,  // waitAll
-			uint64_t(4e9)  // timeout
-		);
-	if (result != vk::Result::eSuccess) {
-		if (result == vk::Result::eTimeout)
-			throw runtime_error("Task on GPU timeout.");
-		throw runtime_error("waitForFences() failed with error " + to_string(result) + ".");
-	}
+	// frame N waits for the value signaled by frame N - PARALLEL_FRAMES
+	device.waitTimeline(frameTimelineValues[actual_frame]);
 	if (window.getFramebufferResizedFlag()) {
 		window.setFramebufferResizedFlag();
 		recreateSwapchain();
 	}
-	device.getDevice().resetFences(renderCompleteFences[actual_frame]);
+	handlePrecisionKeys();
+
+	readMeshletStatistics();
+	readOverdrawStatistics();
+	readQueueTimestamps();
+	readBloomTimestamps();
+	readTileStats();
 
 	// get next image index for render and presentation
 	uint32_t imageIndex;
@@ -1429,13 +4395,15 @@ void HdaBuilder::render() {
 	if (result == vk::Result::eTimeout) {
 		throw runtime_error("Vulkan error: vk::Device::acquireNextImageKHR() timed out.");
 	}
-	else if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || result == vk::Result::eErrorIncompatibleDisplayKHR) { // || result == vk::Result::eErrorIncompatibleDisplayKHR
+	else if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eErrorIncompatibleDisplayKHR) {
+		// the semaphore is not signaled, suboptimal image is rendered and presentKHR() recreates swapchain
 		cout << "Recreate window" << std::endl;
 		recreateSwapchain(); // this will recreate size of window, surface and triangle
 		return;
 	}
 
 	commandBuffers[actual_frame].reset();
+	resetRecordPools(recordPools[actual_frame]);
 
 	// // // //
 	// recordording command buffer begin
@@ -1446,22 +4414,51 @@ void HdaBuilder::render() {
 		)
 	);
 
-	commandBuffers[actual_frame].beginRenderPass(
-		vk::RenderPassBeginInfo(
-			device.getRenderpass(),
-			swapchain.getFramebuffers()[imageIndex],  // framebuffer with right image index
-			vk::Rect2D(vk::Offset2D(0, 0), swapchain.getSurfaceExtent()),  // renderArea
-			2,  // clearValueCount
-			array{  // pClearValues
-				vk::ClearValue(array<float,4>{0.447f, 0.451f, 0.565f, 1.f}),	// {0.678f, 0.973f, 0.992f, 1.f})
-				vk::ClearValue({1.0f, 0}),	// The initial value at each point in the depth buffer should be the furthest possible depth, which is 1.0.
-			}.data()
-			),
-		vk::SubpassContents::eInline
-	);
+	handleCullingKeys();
+	handleLightKeys();
+	handleDeferredKeys();
+	handleInstanceKeys();
+	handleSceneKeys();
+	handleJobKeys();
+	handleRecordKeys();
+	handleComputeKeys();
+	handleBloomKeys();
+	handleLutKeys();
+	handleLocalKeys();
+	handleCompareKeys();
+	handleResolutionKeys();
+	handleGraphKeys();
+
+	// the viewport is the state of primary command buffer for all scene passes, tone mapping sets the full one
+	updateRenderExtent();
+	setViewport(&commandBuffers[actual_frame], renderExtent);
+
+	prepareScene();
+
+	auto recordStartT = chrono::high_resolution_clock::now();
+	vk::SubpassContents contents = parallelRecording || staticCommands ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline;
+	if (staticCommands)
+		prepareStaticCommands();
+
+	// secondary command buffers must not be executed in the query without inherited queries
+	bool statistics = device.getPipelineStatisticsSupport() && (contents == vk::SubpassContents::eInline || device.getInheritedQueriesSupport());
+	statisticsRecorded[actual_frame] = false;
+	if (statistics) {
+		commandBuffers[actual_frame].resetQueryPool(statisticsQueryPool, static_cast<uint32_t>(actual_frame), 1);
+		commandBuffers[actual_frame].beginQuery(statisticsQueryPool, static_cast<uint32_t>(actual_frame), vk::QueryControlFlags());
+	}
+
+	if (device.getTimestampSupport()) {
+		commandBuffers[actual_frame].resetQueryPool(timestampQueryPool, static_cast<uint32_t>(actual_frame * QUEUE_TIMESTAMPS), 2);
+		commandBuffers[actual_frame].writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, timestampQueryPool, static_cast<uint32_t>(actual_frame * QUEUE_TIMESTAMPS));
+	}
 
+	// light culling of async compute queue is submitted after recording, when the lights are updated
+	asyncFrame = asyncCompute;
+	if (asyncFrame)
+		acquireClusters(&commandBuffers[actual_frame]);
 
-	drawScene(&commandBuffers[actual_frame]);
+	recordScenePasses(&commandBuffers[actual_frame], contents);
 	
 
 	/*	TODO TODO delete
@@ -1499,26 +4496,67 @@ void HdaBuilder::render() {
 	);
 	*/
 
-	commandBuffers[actual_frame].endRenderPass();
+	if (statistics) {
+		commandBuffers[actual_frame].endQuery(statisticsQueryPool, static_cast<uint32_t>(actual_frame));
+		statisticsRecorded[actual_frame] = true;
+	}
+
+	// post processing of HDR scene color is not counted by the overdraw statistics
+	recordPostProcessing(&commandBuffers[actual_frame], imageIndex);
+
+	if (device.getTimestampSupport()) {
+		commandBuffers[actual_frame].writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, timestampQueryPool, static_cast<uint32_t>(actual_frame * QUEUE_TIMESTAMPS + 1));
+		timestampsRecorded[actual_frame] = 2;
+	}
+
+	updateLights();
+	updateDeferredData();
+
 	commandBuffers[actual_frame].end();
+	recordTime = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - recordStartT).count();
+	if (staticCommands && staticRecorded) {
+		rerecordTime = recordTime;
+		staticRerecords++;
+	}
+	else if (staticCommands)
+		reuseTime = recordTime;
 	// recordording command buffer end
 	// // // //
 
 
-	// submit frame for render
+	// submit frame for render, acquire and present need binary semaphores,
+	// uploads are waited on the GPU and the frame signals the next value of timeline
+	uint64_t frameValue = device.nextTimelineValue();
+	vector<vk::Semaphore> waitSemaphores = { presentCompleteSemaphores[actual_frame], device.getTimeline() };
+	vector<vk::PipelineStageFlags> waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eAllCommands };
+	vector<uint64_t> waitValues = { 0, upload.getSubmittedValue() };	// value of binary semaphore is ignored
+	array<vk::Semaphore, 2> signalSemaphores = { renderCompleteSemaphores[actual_frame], device.getTimeline() };
+	array<uint64_t, 2> signalValues = { 0, frameValue };
+
+	// vertex work and meshlet culling overlap with light culling, fragment shaders wait for it
+	if (asyncFrame) {
+		waitSemaphores.push_back(device.getComputeTimeline());
+		waitStages.push_back(vk::PipelineStageFlagBits::eFragmentShader);
+		waitValues.push_back(submitAsyncCompute());
+	}
+
 	device.getGraphicsQueue().submit(
 		vk::ArrayProxy<const vk::SubmitInfo>(
 			1,
 			&(const vk::SubmitInfo&)vk::SubmitInfo(
-				1, &presentCompleteSemaphores[actual_frame],  // waitSemaphoreCount + pWaitSemaphores +
-				&(const vk::PipelineStageFlags&)vk::PipelineStageFlags(  // pWaitDstStageMask
-					vk::PipelineStageFlagBits::eColorAttachmentOutput),
+				static_cast<uint32_t>(waitSemaphores.size()), waitSemaphores.data(),  // waitSemaphoreCount + pWaitSemaphores
+				waitStages.data(),  // pWaitDstStageMask
 				1, &commandBuffers[actual_frame],  // commandBufferCount + pCommandBuffers
-				1, &renderCompleteSemaphores[actual_frame]  // signalSemaphoreCount + pSignalSemaphores
+				2, signalSemaphores.data(),  // signalSemaphoreCount + pSignalSemaphores
+				&(const vk::TimelineSemaphoreSubmitInfo&)vk::TimelineSemaphoreSubmitInfo(	// pNext
+					static_cast<uint32_t>(waitValues.size()), waitValues.data(),
+					2, signalValues.data()
+				)
 			)
 			),
-		renderCompleteFences[actual_frame]
+		nullptr
 	);
+	frameTimelineValues[actual_frame] = frameValue;
 
 	// present
 	result =
@@ -1566,10 +4604,87 @@ void HdaBuilder::fps() {
 			auto fr = frames / chrono::duration<double>(d).count();
 			cout << "\r" << "FPS: " << fr;
 			cout << " | exposure: " << exposure;
+			cout << " | LOD histogram:";
+			for (uint32_t l = 0; l < MAX_LOD_LEVELS; l++)
+				cout << " " << lodHistogram[l];
+			if (meshletCullMode != MESHLET_CULL_OFF)
+				cout << " | meshlets GPU: " << gpuVisibleMeshlets << "/" << meshletTotal << " CPU: " << cpuVisibleMeshlets;
+			if (meshletCullMode != MESHLET_CULL_OFF && occlusionCulling)
+				cout << " | late: " << gpuLateMeshlets << " occluded: " << gpuOccludedMeshlets;
+			if (device.getPipelineStatisticsSupport() && !deferredShading && overdrawRatio > 0.0)
+				cout << " | overdraw" << (depthPrepass ? " (prepass): " : ": ") << overdrawRatio;
+
+			// G-buffer traffic with overdraw of the geometry pass, the lighting pass shades every pixel once
+			if (deferredShading) {
+				double gbufferOverdraw = device.getPipelineStatisticsSupport() ? overdrawRatio - 1.0 : 1.0;
+				HdaDeferred::GbufferCost cost = HdaDeferred::gbufferCost(renderExtent.width, renderExtent.height,
+																		 device.getFindFormatFunc(vk::ImageTiling::eOptimal), gbufferOverdraw);
+				double traffic = static_cast<double>(cost.geometryWrite + cost.lightingRead);
+				cout << " | G-buffer overdraw: " << max(gbufferOverdraw, 1.0) << " MB/frame: " << traffic / (1024.0 * 1024.0)
+					 << " GB/s: " << traffic * fr / (1024.0 * 1024.0 * 1024.0);
+			}
+
+			// lights per cluster of the last frame by CPU reference assignment
+			vector<uint32_t> clusterCounts;
+			uint32_t assigned = HdaLights::assignLights(animatedLights, clusterData, &clusterCounts);
+			lightFrameTimes[lightCountIdx] = 1000.0 / fr;
+			cout << " | lights: " << lightCounts[lightCountIdx] << " ms/frame: " << lightFrameTimes[lightCountIdx];
+			cout << " per cluster avg: " << static_cast<double>(assigned) / CLUSTER_COUNT << " max: " << *max_element(clusterCounts.begin(), clusterCounts.end());
+
+			instanceFrameTimes[instanceCountIdx] = 1000.0 / fr;
+			cout << " | uniform uploads: " << uniformUploads << " skipped: " << uniformSkips;
+			cout << " | instances: " << visibleInstances << "/" << instanceCounts[instanceCountIdx] << " cull ms: " << instanceCullTime << " draws: " << instanceDraws;
+			if (staticCommands)
+				cout << " | record ms: " << reuseTime << " (prerecorded, re-recorded " << staticRerecords << "x in " << rerecordTime << " ms, saved per frame: " << rerecordTime - reuseTime << " ms)";
+			else
+				cout << " | record ms: " << recordTime << (parallelRecording ? " (parallel)" : " (serial)");
+			if (device.getTimestampSupport()) {
+				cout << " | queues ms: graphics " << queueTimeline[0] << "-" << queueTimeline[1];
+				if (asyncCompute && device.getComputeTimestampBits() == 0)
+					cout << " compute n/a";
+				else if (asyncCompute)
+					cout << " compute " << queueTimeline[2] << "-" << queueTimeline[3] << " overlap " << queueOverlap;
+				if (dynamicResolution)
+					cout << " | resolution: " << renderExtent.width << "x" << renderExtent.height << " scale: " << resolution.getScale()
+						 << " GPU ms: " << resolution.getSmoothedMs() << "/" << resolution.getSettings().targetMs << " changes: " << resolution.getChanges();
+
+				// downsample and upsample of every level
+				if (bloomOn) {
+					double bloomTime = 0.0;
+					for (uint32_t l = 0; l < BLOOM_MAX_MIPS; l++)
+						bloomTime += bloomDownTimes[l] + bloomUpTimes[l];
+					cout << " | bloom ms: " << bloomTime << " levels:";
+					for (uint32_t l = 0; l < bloomTimedLevels; l++)
+						cout << " " << bloomDownTimes[l] + bloomUpTimes[l];
+				}
+				// the analytic TMO and the LUT are compared by cost per pixel
+				vk::Extent2D extent = swapchain.getSurfaceExtent();
+				cout << " | tonemap ms: " << tonemapTime << " ns/pixel: " << tonemapTime * 1e6 / (static_cast<double>(extent.width) * extent.height);
+				if (lutOn)
+					cout << " (LUT " << lutSize << ", bakes: " << lutBakes << " last ms: " << lutBakeTime << ")";
+				if (localCompressionIdx > 0)
+					cout << " | local TMO ms: grid " << localGridTime << " blur " << localBlurTime;
+
+				// the variants are compared by GPU time, the delta needs both measured
+				bool half = pipeline.getHalfPrecision();
+				precisionFrameTimes[half] = gpuTimeSum / frames;
+				cout << " | shading " << (half ? "float16" : "float32") << " GPU ms: " << precisionFrameTimes[half];
+				if (precisionFrameTimes[!half] > 0.0)
+					cout << " (" << (half ? "float32" : "float16") << ": " << precisionFrameTimes[!half] << ", delta: " << precisionFrameTimes[half] - precisionFrameTimes[!half] << ")";
+
+				// displayed luminance of every compared operator
+				for (uint32_t t = 0; t < statsTiles; t++) {
+					const HdaTonemap::TileStats& s = tileStats[t];
+					cout << " | " << HdaTonemap::methodName((statsMethod + t) % TONEMAP_METHODS) << " mean Y: " << s.mean << " median: " << s.median
+						 << " crushed %: " << 100.0f * s.crushed << " clipped %: " << 100.0f * s.clipped;
+				}
+			}
 			frames = 0.0;
+			gpuTimeSum = 0.0;
 			lT = cT;
 		}
 	}
 
 	frames++;
+	gpuTimeSum += gpuFrameMs;
 }
\ No newline at end of file
@@ -3,17 +3,42 @@
 #include "hda_window.hpp"
 #include "hda_swapchain.hpp"
 #include "hda_pipeline.hpp"
-#include "hda_sceneobject.hpp"
+#include "hda_scene.hpp"
+#include "hda_meshoptimizer.hpp"
+#include "hda_meshlod.hpp"
+#include "hda_meshlet.hpp"
+#include "hda_lights.hpp"
+#include "hda_deferred.hpp"
+#include "hda_instancing.hpp"
+#include "hda_manifest.hpp"
+#include "hda_jobs.hpp"
+#include "hda_upload.hpp"
+#include "hda_tonemap.hpp"
+#include "hda_localtonemap.hpp"
+#include "hda_resolution.hpp"
+#include "hda_graph.hpp"
 
 //#include "vk_mem_alloc.h"		TODO TODO DELETE
+#include <algorithm>
+#include <cfloat>
 #include <chrono>
 
-#define OBJECTS_NUMBER 3
 #define PARALLEL_FRAMES 2
 #define SELECT_SCENEDATA 1
 #define SELECT_MATLIGHTDATA 2
 #define NUM_OF_PARTS_WITH_SAME_TEX 103
 
+#define DRAW_MODE_FULL 0		// depth test and shading in one pass
+#define DRAW_MODE_DEPTH 1		// depth prepass
+#define DRAW_MODE_EQUAL 2		// shading of fragments which passed the prepass
+#define DRAW_MODE_GBUFFER 3		// geometry pass of deferred shading
+#define DRAW_MODE_SKYBOX 4		// skybox after the lighting pass of deferred shading
+
+#define RECORD_CHUNK_DRAWS 64		// the most submeshes of one chunk of secondary command buffer
+#define RECORD_BENCH_DRAWS 10000	// draws of the recording benchmark
+
+#define QUEUE_TIMESTAMPS 4			// begin and end of the frame on graphics queue and of the work of compute queue
+
 
 /*
 *
@@ -27,32 +52,36 @@ class HdaBuilder {
 
 public:
 
-	HdaBuilder(HdaInstanceGpu&, HdaWindow&, HdaSwapchain&, HdaPipeline&);
+	HdaBuilder(HdaInstanceGpu&, HdaWindow&, HdaSwapchain&, HdaPipeline&, HdaJobs&);
 	~HdaBuilder();
 
 	void initBuilder();
 	void render();
 
+	void setScenePath(string path) { scenePath = path; }
+	void setResolutionSettings(const HdaResolution::Settings&);
+
 private:
 
 	HdaInstanceGpu& device;
 	HdaWindow& window;
 	HdaSwapchain& swapchain;
 	HdaPipeline& pipeline;
+	HdaJobs& jobs;
+	HdaUpload upload;
 
 	//MT
 
 	void createCommandPool();
 	void createCommandBuffer();
 	void createSemaphores();
-	void createFences();
 
 	void recreateSwapchain();
 	void initSyncObjects();
 	void cleanupSyncObjects();
 
 	void createBuffer(vk::DeviceSize, vk::BufferUsageFlags, vk::MemoryPropertyFlags, vk::Buffer&, vk::DeviceMemory&);
-	void copyBuffers(vk::Buffer, vk::Buffer, vk::DeviceSize);
+	void createBuffer(vk::DeviceSize, vk::BufferUsageFlags, vk::MemoryPropertyFlags, vk::Buffer&, vk::DeviceMemory&, const vector<uint32_t>&);
 
 	inline size_t calcRequiredAligment(size_t);
 	void createVertexBuffer(HdaModel::Mesh&);
@@ -66,14 +95,10 @@ private:
 	vector<vk::DescriptorSet> createDescriptorSets(vk::DescriptorSetLayout, const vk::DescriptorImageInfo*, uint32_t, uint32_t, uint32_t);
 
 	void loadMesh(HdaModel::Mesh&, const char*, string);
-	void loadTexture(HdaModel::Texture& , const char*);
-
-	void layoutConversion(vk::Image, vk::Format, vk::ImageLayout, vk::ImageLayout, array<vk::AccessFlagBits, 2>, array<vk::PipelineStageFlagBits, 2>, uint32_t, uint32_t);
-
-	void copyBuffToImage(vk::Buffer, vk::Image, vk::ImageLayout, uint32_t, uint32_t, uint32_t, uint32_t);
-
-	void loadTextureCubemap(vector<const char*>, HdaModel::Texture&);
-	void loadCubemapSkybox(HdaModel::SceneObject*);
+	void uploadMesh(HdaModel::Mesh&, string);
+	void uploadTexture(HdaModel::Texture&, HdaManifest::ImageData&, string);
+	void uploadTextureCubemap(vector<HdaManifest::ImageData>&, HdaModel::Texture&);
+	void createSkybox(HdaModel::SceneObject*, vector<HdaManifest::ImageData>&);
 	void cleanupSceneObjects(vector<HdaModel::SceneObject>);
 
 	void mapMemoryToUniformBuffer(vk::DeviceMemory, size_t, uint32_t, HdaModel::MaterialLightUniformData, uint32_t, HdaModel::SceneUniformData, uint32_t);
@@ -82,10 +107,133 @@ private:
 	void calculateLightColor(glm::vec4 lightC, glm::vec4 diffuse, glm::vec4 ambient);
 
 	void loadScene();
-	void setUniformStructures(HdaModel::SceneObject*, vk::CommandBuffer*, float, uint32_t, uint32_t, HdaModel::MaterialLightUniformData*, HdaModel::SceneUniformData*);
-	void drawMultiTexturedObjects(HdaModel::SceneObject*, vk::CommandBuffer*, float);
-	void drawSingleTexturedObjects(HdaModel::SceneObject* o, vk::CommandBuffer* cmdBuffs, float t, int i);
-	void drawScene(vk::CommandBuffer*);
+	void createSceneObject(HdaModel::SceneObject*, const HdaManifest::ObjectDesc&, vector<HdaManifest::ImageData>&);
+	void setUniformStructures(HdaModel::SceneObject*, HdaModel::MaterialLightUniformData*, HdaModel::SceneUniformData*);
+	void prepareMultiTexturedObject(HdaModel::SceneObject*);
+	void prepareSingleTexturedObject(HdaModel::SceneObject* o, int i);
+	void prepareScene();
+	void drawScene(vk::CommandBuffer*, uint32_t, uint32_t);
+	void recordObject(HdaModel::SceneObject*, vk::CommandBuffer*, uint32_t, uint32_t, uint32_t, uint32_t);
+	void recordScene(vk::CommandBuffer*, uint32_t);
+	void createPrepassPipelines(HdaModel::SceneObject*);
+	void createStatisticsQuery();
+	void readOverdrawStatistics();
+	uint32_t selectLod(const HdaModel::IndexInfo&, const glm::mat4&);
+
+	void createMeshletCullPipeline();
+	void createMeshletCulling(HdaModel::SceneObject*);
+	void recordMeshletCulling(vk::CommandBuffer*, uint32_t);
+	void resetMeshletDraws(vk::CommandBuffer*);
+	void updateMeshletCullData(HdaModel::SceneObject*, const glm::mat4&);
+	void readMeshletStatistics();
+	void handleCullingKeys();
+
+	void createDepthPyramidPipeline();
+	void updateOcclusionDescriptors();
+	void recordDepthPyramid(vk::CommandBuffer*);
+	void beginRenderpass(vk::CommandBuffer*, vk::RenderPass, vk::SubpassContents);
+	void recordScenePasses(vk::CommandBuffer*, vk::SubpassContents);
+
+	void createLightCulling();
+	void loadLights();
+	void recordLightCulling(vk::CommandBuffer*, bool);
+	void updateLights();
+	void handleLightKeys();
+
+	void createAsyncCompute();
+	void acquireClusters(vk::CommandBuffer*);
+	uint64_t submitAsyncCompute();
+	void readQueueTimestamps();
+	void handleComputeKeys();
+
+	void createDeferredPipeline(HdaModel::SceneObject*, bool);
+	void createDeferredLighting();
+	void createLightingPipeline();
+	void updateDeferredDescriptors();
+	void updateDeferredData();
+	void recordDeferred(vk::CommandBuffer*, vk::SubpassContents);
+	void handleDeferredKeys();
+
+	void createBloom();
+	void createTonemapPipeline();
+	void updateBloomDescriptors();
+	void recordBloom(vk::CommandBuffer*);
+	void recordTonemap(vk::CommandBuffer*, uint32_t);
+	void readBloomTimestamps();
+	void handleBloomKeys();
+	void createTonemapLut();
+	void destroyTonemapLut();
+	void recordTonemapLut(vk::CommandBuffer*);
+	void handleLutKeys();
+	void createLocalTonemap();
+	void updateLocalDescriptors();
+	void recordLocalGrid(vk::CommandBuffer*);
+	void recordLocalBlur(vk::CommandBuffer*);
+	void handleLocalKeys();
+	void createTileStats();
+	void readTileStats();
+	void updateCompareTitle();
+	void handleCompareKeys();
+	void updateRenderExtent();
+	void setViewport(vk::CommandBuffer*, vk::Extent2D);
+	void handleResolutionKeys();
+	void handlePrecisionKeys();
+	void recordPostProcessing(vk::CommandBuffer*, uint32_t);
+	void handleGraphKeys();
+
+	void createInstancedPipelines(HdaModel::SceneObject*);
+	void createInstanceBuffers(HdaModel::SceneObject*);
+	void cullObjectInstances(HdaModel::SceneObject*);
+	void drawInstances(HdaModel::SceneObject*, vk::CommandBuffer*);
+	void handleInstanceKeys();
+
+	void createSceneEntities();
+	void updateSceneTransforms(float);
+	bool uploadSceneData(uint32_t, const HdaModel::SceneUniformData&);
+	void handleSceneKeys();
+	void handleJobKeys();
+
+	// range of submeshes of one object, the unit of work of recording jobs
+	struct DrawChunk {
+
+		uint32_t object;
+		uint32_t first;
+		uint32_t end;
+		vk::Pipeline pipeline;
+	};
+
+	// secondary command buffers of one slot of job system for one frame
+	struct RecordPool {
+
+		vk::CommandPool pool;
+		vector<vk::CommandBuffer> buffs;
+		uint32_t used = 0;
+	};
+
+	vector<DrawChunk> createDrawChunks(uint32_t, uint32_t, uint32_t);
+	void recordChunks(vk::CommandBuffer*, const vector<DrawChunk>&, uint32_t, uint32_t, uint32_t);
+	void createRecordPools(vector<vector<RecordPool>>&);
+	void resetRecordPools(vector<RecordPool>&);
+	vk::CommandBuffer beginSecondary(bool);
+	vector<vk::CommandBuffer> recordSecondaries(const vector<DrawChunk>&, uint32_t, uint32_t, bool);
+	void benchmarkRecording();
+	void handleRecordKeys();
+
+	// prerecorded secondary command buffers of one drawScene() call in the frame
+	struct StaticRecording {
+
+		uint32_t phase;
+		uint32_t mode;
+		vk::RenderPass renderpass;
+		vector<vk::CommandBuffer> buffs;
+	};
+
+	void createDrawArgsBuffers(HdaModel::SceneObject*);
+	void writeDrawArgs(HdaModel::SceneObject*);
+	vector<uint32_t> staticRecordingKey();
+	void prepareStaticCommands();
+	void drawStaticScene(vk::CommandBuffer*, uint32_t, uint32_t);
+	uint32_t sceneUniformSlot(uint32_t idx) { return actual_frame * sceneUniformSlots + idx; }
 
 
 	inline void fps();
@@ -98,7 +246,7 @@ private:
 	vector<vk::CommandBuffer> commandBuffers;
 	vector<vk::Semaphore> presentCompleteSemaphores;
 	vector<vk::Semaphore> renderCompleteSemaphores;
-	vector<vk::Fence> renderCompleteFences;
+	vector<uint64_t> frameTimelineValues;		// value of timeline signaled by the last submission of frame
 
 	std::vector<vk::Buffer> uniformBuffs;
 	std::vector<vk::DeviceMemory> uniformBuffsMemory;
@@ -126,12 +274,198 @@ private:
 	uint32_t requiredAlignmentScene{};
 	uint32_t requiredAlignmentMaterial{};
 	size_t sceneUniformSize{};
+	uint32_t sceneUniformSlots = 0;		// scene data of one frame, every frame has its own part of the buffer
+	uint32_t nextMaterialSlot = 0;		// material slots behind the objects are given to multitextured objects
 	size_t materialUniformSize{};
 	glm::vec4 lightColor{};
 	glm::vec4 diffuseColor{};
 	glm::vec4 ambientColor{};
 	uint32_t sceneObjectsSize = UINT32_MAX;
 
+	array<uint32_t, MAX_LOD_LEVELS> lodHistogram{};	// drawn submeshes per level of detail in the last frame
+
+	vk::DescriptorSetLayout cullDescriptSetLay;
+	vk::PipelineLayout cullPipelineLayout;
+	vk::Pipeline cullPipeline;
+	int meshletCullMode = MESHLET_CULL_FRUSTUM;
+	uint32_t meshletTotal = 0;
+	uint32_t gpuVisibleMeshlets = 0;	// read back from draw command buffer of finished frame
+	uint32_t cpuVisibleMeshlets = 0;	// CPU reference culling with the same data
+	HdaGraph::Access visibilityState{};	// the last use of visibility buffers, the scene graph starts from it
+
+	vk::DescriptorSetLayout pyramidDescriptSetLay;
+	vk::PipelineLayout pyramidPipelineLayout;
+	vk::Pipeline pyramidPipeline;
+	vector<vk::DescriptorSet> pyramidDescriptSets;	// one set per level
+	vk::Sampler depthPyramidSampler;
+	bool occlusionCulling = true;
+	uint32_t gpuLateMeshlets = 0;		// meshlets drawn by the late phase
+	uint32_t gpuOccludedMeshlets = 0;	// meshlets in frustum rejected by depth pyramid
+
+	bool depthPrepass = false;
+	vk::QueryPool statisticsQueryPool;	// fragment shader invocations, one query per frame
+	array<bool, PARALLEL_FRAMES> statisticsRecorded{};
+	double overdrawRatio = 0.0;			// fragment shader invocations per pixel in the finished frame
+
+	vk::DescriptorSetLayout lightCullDescriptSetLay;
+	vk::PipelineLayout lightCullPipelineLayout;
+	vk::Pipeline lightCullPipeline;
+	vector<vk::DescriptorSet> lightCullDescriptSets;
+	vector<vk::Buffer> lightBuffs;				// light list of frame, host visible
+	vector<vk::DeviceMemory> lightBuffsMemory;
+	vector<void*> lightBuffsPointer;
+	vector<vk::Buffer> clusterBuffs;			// light indices of clusters, written by light_cull.comp
+	vector<vk::DeviceMemory> clusterBuffsMemory;
+	vector<vk::Buffer> clusterUniformBuffs;
+	vector<vk::DeviceMemory> clusterUniformBuffsMemory;
+	vector<void*> clusterUniformBuffsPointer;
+	vector<HdaLights::Light> lights;			// spotlights of the scene followed by stress lights
+	vector<HdaLights::Light> animatedLights;	// lights of the last recorded frame
+	HdaLights::ClusterUniformData clusterData{};
+	glm::vec3 lightCenter{ 0.0f };
+	chrono::high_resolution_clock::time_point lightStartT;
+	array<uint32_t, 4> lightCounts = { 2, 64, 256, LIGHTS_MAX };	// light counts of stress scene
+	array<double, 4> lightFrameTimes{};			// the last measured ms per frame of light counts
+	uint32_t lightCountIdx = 0;
+
+	bool asyncCompute = false;					// light culling runs on the compute queue
+	bool asyncFrame = false;					// the recorded frame uses the compute queue
+	vector<vk::CommandPool> computePools;		// one pool per frame on the compute family
+	vector<vk::CommandBuffer> computeCommandBuffers;
+	vk::QueryPool timestampQueryPool;			// QUEUE_TIMESTAMPS queries per frame
+	array<uint32_t, PARALLEL_FRAMES> timestampsRecorded{};	// 2 without compute queue, 4 with it
+	array<double, QUEUE_TIMESTAMPS> queueTimeline{};		// ms of the finished frame from its first timestamp
+	double queueOverlap = 0.0;					// ms when both queues worked
+
+	bool deferredShading = false;
+	vk::DescriptorSetLayout lightingDescriptSetLay;
+	vk::PipelineLayout lightingPipelineLayout;
+	vk::Pipeline lightingPipeline;
+	vector<vk::DescriptorSet> lightingDescriptSets;
+	vector<vk::Buffer> deferredUniformBuffs;
+	vector<vk::DeviceMemory> deferredUniformBuffsMemory;
+	vector<void*> deferredUniformBuffsPointer;
+	HdaModel::SceneUniformData frameSceneData{};	// scene flags of the first drawn object in the frame
+
+	bool bloomOn = false;
+	vk::DescriptorSetLayout bloomDescriptSetLay;
+	vk::PipelineLayout bloomPipelineLayout;
+	vk::Pipeline bloomDownPipeline;
+	vk::Pipeline bloomUpPipeline;
+	vector<vk::DescriptorSet> bloomDownDescriptSets;	// set of level l reads level l - 1 or scene color
+	vector<vk::DescriptorSet> bloomUpDescriptSets;		// set of level l writes level l - 1
+	vk::Sampler bloomSampler;							// bilinear taps of bloom shaders
+	vk::DescriptorSetLayout tonemapDescriptSetLay;
+	vk::PipelineLayout tonemapPipelineLayout;
+	vk::Pipeline tonemapPipeline;
+	vk::DescriptorSet tonemapDescriptSet;
+	array<float, 4> bloomThresholds = { 0.8f, 1.0f, 1.5f, 2.5f };
+	array<float, 4> bloomIntensities = { 0.1f, 0.2f, 0.4f, 0.8f };	// divided by the number of levels
+	uint32_t bloomThresholdIdx = 1;
+	uint32_t bloomIntensityIdx = 1;
+	uint32_t bloomMips = 5;								// levels of the frame, at most the levels of the chain
+	vk::QueryPool bloomQueryPool;						// BLOOM_TIMESTAMPS queries per frame
+	array<uint32_t, PARALLEL_FRAMES> bloomTimestampsRecorded{};
+	array<uint32_t, PARALLEL_FRAMES> bloomFrameLevels{};
+	array<double, BLOOM_MAX_MIPS> bloomDownTimes{};		// ms of passes of the finished frame per level
+	array<double, BLOOM_MAX_MIPS> bloomUpTimes{};		// upsample into the level
+	uint32_t bloomTimedLevels = 0;
+	double tonemapTime = 0.0;
+	bool lutOn = false;
+	uint32_t lutSize = TONEMAP_LUT_SIZE;
+	vk::Image lutImage;
+	vk::DeviceMemory lutImageMemory;
+	vk::ImageView lutImageView;
+	array<vk::Buffer, PARALLEL_FRAMES> lutStagingBuffs;			// texels baked by the frame, persistently mapped
+	array<vk::DeviceMemory, PARALLEL_FRAMES> lutStagingMemory;
+	array<uint16_t*, PARALLEL_FRAMES> lutStagingPointers{};
+	bool lutBaked = false;										// the image has texels of lutSettings
+	HdaGraph::Access lutState{};								// the last use of the image, the frame graph starts from it
+	HdaTonemap::Settings lutSettings{};							// method and exposure of the baked texels
+	uint32_t lutGradeBaked = 0;
+	array<HdaTonemap::Grade, 4> lutGrades = {
+		HdaTonemap::Grade{ 1.0f, 1.0f, glm::vec3(1.0f) },
+		HdaTonemap::Grade{ 1.05f, 1.0f, glm::vec3(1.08f, 1.0f, 0.88f) },
+		HdaTonemap::Grade{ 0.95f, 1.0f, glm::vec3(0.9f, 0.98f, 1.1f) },
+		HdaTonemap::Grade{ 1.25f, 1.15f, glm::vec3(1.0f) }
+	};
+	array<const char*, 4> lutGradeNames = { "neutral", "warm", "cool", "punchy" };
+	uint32_t lutGradeIdx = 0;
+	uint32_t lutBakes = 0;
+	double lutBakeTime = 0.0;									// ms of the last bake on CPU
+	array<float, 4> localCompressions = { 1.0f, 0.7f, 0.5f, 0.3f };	// contrast of base layer, the first one is off
+	uint32_t localCompressionIdx = 0;
+	float localDetail = 1.0f;
+	vk::PipelineLayout localPipelineLayout;						// the same set layout as bloom passes
+	vk::Pipeline localGridPipeline;
+	vk::Pipeline localBlurPipeline;
+	vk::DescriptorSet localGridDescriptSet;						// scene color into the first grid
+	vk::DescriptorSet localBlurDescriptSet;						// the first grid into the second one
+	array<bool, PARALLEL_FRAMES> localFrameOn{};
+	HdaGraph sceneGraph;										// culling and render passes of the scene, compiled every frame
+	HdaGraph postGraph;											// passes of post processing, compiled every frame
+	bool graphDump = false;										// print the graph of the next frame
+	double localGridTime = 0.0;									// ms of passes of the finished frame
+	double localBlurTime = 0.0;
+	uint32_t compareTiles = 0;									// 0 is off, operators from chooseMethodFlag side by side
+	bool compareGrid = false;									// tiles show the whole frame instead of strips
+	vk::Buffer tileStatsBuff;									// histograms of tiles of every frame, persistently mapped
+	vk::DeviceMemory tileStatsMemory;
+	uint32_t* tileStatsPointer = nullptr;
+	array<uint32_t, PARALLEL_FRAMES> statsFrameTiles{};
+	array<int, PARALLEL_FRAMES> statsFrameMethods{};
+	array<HdaTonemap::TileStats, TONEMAP_COMPARE_MAX_TILES> tileStats{};	// of the last finished frame
+	uint32_t statsTiles = 0;
+	int statsMethod = 0;										// operator of the first tile of tileStats
+	string compareTitle;										// the last label of window title
+	HdaResolution resolution;
+	bool dynamicResolution = false;
+	vk::Extent2D renderExtent;									// viewport of scene passes in the recorded frame
+	array<vk::Extent2D, PARALLEL_FRAMES> frameRenderExtents{};
+	double gpuFrameMs = 0.0;									// GPU time of the finished frame over both queues
+	array<float, 4> resolutionTargets = { RESOLUTION_TARGET_MS, 1000.0f / 30.0f, 1000.0f / 90.0f, 1000.0f / 144.0f };	// the first one is from settings
+	uint32_t resolutionTargetIdx = 0;
+	array<float, 3> resolutionMinScales = { RESOLUTION_MIN_SCALE, 0.35f, 0.75f };	// the first one is from settings
+	uint32_t resolutionMinScaleIdx = 0;
+	int upscaleFilter = RESOLUTION_UPSCALE_BILINEAR;
+	array<double, 2> precisionFrameTimes{};						// GPU ms per frame of float32 and float16 variant, 0 until measured
+	double gpuTimeSum = 0.0;									// GPU ms of frames since the last print of fps()
+
+	array<uint32_t, 6> instanceCounts = { 1, 10, 100, 1000, 10000, INSTANCES_MAX };	// instance counts of benchmark scene
+	array<double, 6> instanceFrameTimes{};		// the last measured ms per frame of instance counts
+	uint32_t instanceCountIdx = 0;
+	double instanceCullTime = 0.0;				// ms of CPU culling of instances in the last frame
+	uint32_t visibleInstances = 0;
+	uint32_t instanceDraws = 0;					// draw calls of instanced object in the last drawing
+
+	string scenePath = SCENE_MANIFEST_PATH;
+	HdaManifest::SceneDesc sceneDesc;
+
+	HdaScene scene;
+	vector<HdaScene::Handle> sceneEntities;					// entity of every scene object
+	vector<HdaModel::SceneUniformData> uploadedSceneData;	// the last uploaded scene data of objects
+	uint32_t uniformUploads = 0;				// uploaded and skipped scene data of objects in the last frame
+	uint32_t uniformSkips = 0;
+
+	bool parallelRecording = false;
+	vector<vector<RecordPool>> recordPools;		// per frame and slot of job system
+	vk::RenderPass recordingRenderpass;			// render pass and framebuffer inherited by secondary command buffers
+	vk::Framebuffer recordingFramebuffer;
+	vk::SubpassContents recordingContents = vk::SubpassContents::eInline;
+	double recordTime = 0.0;					// ms of recording of the last frame
+
+	bool staticCommands = false;
+	bool recordingStatic = false;				// jobs draw from the draw arguments instead of the selected levels of detail
+	vector<vector<RecordPool>> staticPools;		// per frame and slot, reset only when the frame is recorded again
+	array<vector<StaticRecording>, PARALLEL_FRAMES> staticRecordings;
+	array<vector<uint32_t>, PARALLEL_FRAMES> staticKeys;	// state which the recordings of frame depend on
+	uint32_t staticCallIdx = 0;					// drawScene() calls in the frame
+	bool staticRecorded = false;				// the recordings of this frame were recorded again
+	uint32_t staticRerecords = 0;
+	double rerecordTime = 0.0;					// ms of recording of the last frame which recorded the scene again
+	double reuseTime = 0.0;						// ms of recording of the last frame which reused the recordings
+	uint32_t swapchainGeneration = 0;			// pipelines are created again with the swapchain
+
 	int hdrOnFlag = 0;
 	float exposure = 1.0f;
 	int chooseMethodFlag = 0;
@@ -0,0 +1,181 @@
+#version 450
+
+// lighting subpass of deferred shading, every pixel is shaded once from G-buffer
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+//
+// G-buffer, input attachments written by the geometry subpass at the same pixel
+//
+layout(input_attachment_index = 0, binding = 0) uniform subpassInput gbufferAlbedo;    // albedo + specular intensity
+layout(input_attachment_index = 1, binding = 1) uniform subpassInput gbufferNormal;    // octahedral world space normal + shininess
+layout(input_attachment_index = 2, binding = 2) uniform subpassInput gbufferDepth;
+
+layout(binding = 3) uniform DeferredUniformData {
+
+    mat4 invViewProj;
+    vec4 cameraPosition;
+    vec4 lightDirection;    // towards the directional light in world space
+    vec4 lightAmbient;
+    vec4 lightDiffuse;
+    vec4 lightSpecular;
+    vec4 attenuation;       // kC, kL, kQ
+    int blinnPhongFlag;
+    int pointLightFlag;
+    int hdrOnFlag;
+    float exposure;
+    int chooseMethodFlag;
+
+} deferredData;
+
+//
+// clustered lights, the same as in shader.frag
+//
+#define CLUSTER_STRIDE 129
+#define LIGHT_TYPE_SPOT 1.0
+
+struct Light {
+
+    vec4 position;      // world space position + range
+    vec4 direction;     // direction of spotlight + type
+    vec4 color;
+    vec4 params;        // cutOff, outerCutOff
+};
+
+layout(std430, binding = 4) readonly buffer Lights {
+
+    Light lights[];
+};
+
+layout(std430, binding = 5) readonly buffer ClusterLights {
+
+    uint clusterLights[];
+};
+
+layout(binding = 6) uniform ClusterUniformData {
+
+    mat4 view;
+    vec4 projection;    // p00, p11, zNear, zFar
+    uvec4 grid;         // size of grid + number of lights
+    vec4 screen;        // framebuffer size + scale and bias of depth slice
+
+} clusterData;
+
+// the same as GBUFFER_SHININESS_MAX in hda_deferred.hpp
+const float SHININESS_MAX = 1024.0;
+
+//
+// function prototypes
+//
+vec3 octDecode(vec2 e);
+float Specular(vec3 normal, vec3 viewDir, vec3 lightDir, float shininess);
+vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 fragP, vec3 albedo, vec2 material, Light light);
+uint ClusterIndex(float depth);
+
+void main() {
+
+    float depth = subpassLoad(gbufferDepth).r;
+
+    // background is drawn by the skybox after the lighting draw
+    if (depth == 1.0) {
+
+        outColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    vec4 albedoSpec = subpassLoad(gbufferAlbedo);
+    vec4 normalShi = subpassLoad(gbufferNormal);
+
+    // position is reconstructed from depth
+    vec4 world = deferredData.invViewProj * vec4(inUV * 2.0 - 1.0, depth, 1.0);
+    vec3 fragPos = world.xyz / world.w;
+
+    vec3 albedo = albedoSpec.rgb;
+    vec2 material = vec2(albedoSpec.a, max(normalShi.b * SHININESS_MAX, 1.0));     // specular intensity, shininess
+    vec3 normal = octDecode(normalShi.rg * 2.0 - 1.0);
+    vec3 viewDir = normalize(deferredData.cameraPosition.xyz - fragPos);
+
+    // directional lighting
+    vec3 lightDir = deferredData.lightDirection.xyz;
+    float diff = max(dot(normal, lightDir), 0.0);
+    float spec = diff > 0.0 ? Specular(normal, viewDir, lightDir, material.y) : 0.0;
+    vec3 result = deferredData.lightAmbient.rgb * albedo + diff * albedo * deferredData.lightDiffuse.rgb + spec * material.x * deferredData.lightSpecular.rgb;
+
+    // point lights and spotlights of the cluster of pixel
+    if (deferredData.pointLightFlag == 1) {
+
+        float viewDepth = -(clusterData.view * vec4(fragPos, 1.0)).z;
+        uint cluster = ClusterIndex(viewDepth) * CLUSTER_STRIDE;
+        uint lightCnt = clusterLights[cluster];
+        for (uint i = 1u; i <= lightCnt; i++)
+            result += CalcPointLight(normal, viewDir, fragPos, albedo, material, lights[clusterLights[cluster + i]]);
+    }
+
+    // linear HDR color, tone mapping is applied by tonemap.frag after bloom
+    outColor = vec4(result, 1.0);
+}
+
+
+// [-1, 1] square -> unit vector, the same as HdaDeferred::octDecode()
+vec3 octDecode(vec2 e) {
+
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+
+    return normalize(n);
+}
+
+// Phong or Blinn-Phong specular term, the same models as in shader.frag
+float Specular(vec3 normal, vec3 viewDir, vec3 lightDir, float shininess) {
+
+    float s;
+    if (deferredData.blinnPhongFlag == 1)
+        s = max(dot(normal, normalize(lightDir + viewDir)), 0.0);
+    else
+        s = max(dot(viewDir, reflect(-lightDir, normal)), 0.0);
+
+    return s > 0.0 ? pow(s, shininess) : 0.0;
+}
+
+vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 fragP, vec3 albedo, vec2 material, Light light) {
+
+    vec3 lightDirToFrag = normalize(light.position.xyz - fragP);
+
+    // spotlight soft edges, fragments outside the outer cone are not lit
+    float intensity = 1.0;
+    if (light.direction.w == LIGHT_TYPE_SPOT) {
+
+        float theta = dot(lightDirToFrag, normalize(-light.direction.xyz));
+        if (theta <= light.params.y)
+            return vec3(0.0);
+
+        float epsilon = light.params.x - light.params.y;
+        intensity = min((theta - light.params.y) / epsilon, 1.0);
+    }
+
+    // windowed attenuation, the same as in shader.frag
+    float distance = length(light.position.xyz - fragP);
+    float window = clamp(1.0 - pow(distance / light.position.w, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (deferredData.attenuation.x + deferredData.attenuation.y * distance + deferredData.attenuation.z * (distance * distance));
+    if (attenuation == 0.0)
+        return vec3(0.0);
+
+    float diff = max(dot(normal, lightDirToFrag), 0.0);
+    float spec = diff > 0.0 ? Specular(normal, viewDir, lightDirToFrag, material.y) : 0.0;
+
+    vec3 diffuse = diff * albedo * deferredData.lightDiffuse.rgb;
+    vec3 specular = spec * material.x * deferredData.lightSpecular.rgb;
+
+    return (diffuse + specular) * light.color.rgb * (intensity * attenuation);
+}
+
+// cluster of pixel, the same as in shader.frag but with depth reconstructed from G-buffer
+uint ClusterIndex(float depth) {
+
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterData.screen.xy * vec2(clusterData.grid.xy)), clusterData.grid.xy - 1u);
+    int slice = clamp(int(floor(log(max(depth, clusterData.projection.z)) * clusterData.screen.z + clusterData.screen.w)), 0, int(clusterData.grid.z) - 1);
+
+    return (uint(slice) * clusterData.grid.y + tile.y) * clusterData.grid.x + tile.x;
+}
@@ -0,0 +1,37 @@
+#version 450
+
+// position only variant of shader.vert for the depth prepass, the position must be
+// computed in the same way, so the main pass can test depth with eEqual
+layout(location = 0) in vec3 inPosition;
+
+layout(binding = 0) uniform ProjectionUniformData {
+
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+
+} uniformProjection;
+
+layout(binding = 1) uniform SceneUniformData {
+
+    mat4 normalMatrix;
+    mat4 normalMatrixWorld;
+    mat4 modelViewMatrix;
+    mat4 modelMatrix;
+
+} scenedata;
+
+layout( push_constant ) uniform constants {
+
+    vec3 cameraPosition;
+	int texId;
+
+} PushConstants;
+
+invariant gl_Position;
+
+void main() {
+
+    mat4 transformationMatrix = uniformProjection.proj * uniformProjection.view * scenedata.modelMatrix;
+    gl_Position = transformationMatrix * vec4(inPosition, 1.0);
+}
@@ -0,0 +1,80 @@
+#version 450
+
+// geometry pass of deferred shading, writes surface data instead of lit color
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexture;
+layout(location = 2) in vec3 fragPosWorld;
+layout(location = 3) in vec3 inNormalWorld;
+layout(location = 4) in flat int texId;
+
+layout(location = 0) out vec4 outAlbedo;    // albedo + specular intensity
+layout(location = 1) out vec4 outNormal;    // octahedral world space normal + shininess
+
+layout(binding = 1) uniform SceneUniformData {
+
+    mat4 normalMatrix;
+    mat4 normalMatrixWorld;
+    mat4 modelViewMatrix;
+    mat4 modelMatrix;       // world transform of the frame
+    int nontextureFlag;
+    int blinnPhongFlag;
+    int pointLightFlag;
+    int hdrOnFlag;
+    float exposure;
+    int chooseMethodFlag;
+
+} scenedata;
+
+layout(binding = 2) uniform MaterialLightUniformData {
+
+    // material data
+	vec4 materialAmbient;
+	vec4 materialDiffuse;
+	vec4 materialSpecular;
+	
+	// light data
+	vec4 lightAmbient;
+	vec4 lightDiffuse;
+	vec4 lightSpecular;
+
+    float materialShininess;
+
+    // attenuation coeficients
+    float kC;
+    float kL;
+    float kQ;
+
+    // spotlight
+    float cutOff;
+    float outerCutOff;
+
+} mlData;
+
+layout(binding = 3) uniform sampler2D texSampler;
+
+// the same as GBUFFER_SHININESS_MAX in hda_deferred.hpp
+const float SHININESS_MAX = 1024.0;
+
+// unit vector -> [-1, 1] square, the same as HdaDeferred::octEncode()
+vec2 octEncode(vec3 n) {
+
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0)
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+
+    return e;
+}
+
+void main() {
+
+    vec3 albedo = fragColor * mlData.materialDiffuse.rgb;
+    if (scenedata.nontextureFlag == 0)
+        albedo *= texture(texSampler, fragTexture).rgb;
+
+    float specular = max(max(mlData.materialSpecular.r, mlData.materialSpecular.g), mlData.materialSpecular.b);
+    float shininess = clamp(mlData.materialShininess / SHININESS_MAX, 0.0, 1.0);
+
+    outAlbedo = vec4(albedo, clamp(specular, 0.0, 1.0));
+    outNormal = vec4(octEncode(normalize(inNormalWorld)) * 0.5 + 0.5, shininess, 0.0);
+}
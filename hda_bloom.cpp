@@ -0,0 +1,73 @@
+#include "hda_bloom.hpp"
+
+#include <algorithm>
+
+
+// level 0 has half resolution of the scene color, every next level halves the previous one
+glm::uvec2 HdaBloom::levelExtent(uint32_t width, uint32_t height, uint32_t level) {
+
+	return glm::uvec2(std::max(width >> (level + 1), 1u), std::max(height >> (level + 1), 1u));
+}
+
+
+// levels of bloom chain which are larger than 1x1, at most BLOOM_MAX_MIPS
+uint32_t HdaBloom::levelCount(uint32_t width, uint32_t height) {
+
+	uint32_t levels = 1;
+	while (levels < BLOOM_MAX_MIPS && glm::all(glm::greaterThan(levelExtent(width, height, levels), glm::uvec2(1))))
+		levels++;
+
+	return levels;
+}
+
+
+/**
+*	@brief Estimate memory and traffic of bloom chain for one frame.
+*
+*	Every downsample reads its source level and writes its level, the source of level 0
+*	is the scene color. Every upsample reads the smaller level and reads and writes
+*	the larger one. The tone mapping pass reads level 0 once.
+*
+*/
+HdaBloom::BloomCost HdaBloom::bloomCost(uint32_t width, uint32_t height, uint32_t levels) {
+
+	const uint64_t texel = 8;	// rgba16f
+	BloomCost cost{};
+
+	uint64_t srcTexels = static_cast<uint64_t>(width) * height;
+	for (uint32_t l = 0; l < levels; l++) {
+
+		glm::uvec2 e = levelExtent(width, height, l);
+		uint64_t texels = static_cast<uint64_t>(e.x) * e.y;
+
+		cost.memory += texels * texel;
+		cost.traffic += (srcTexels + texels) * texel;
+		if (l > 0)
+			cost.traffic += (texels + 2 * srcTexels) * texel;
+
+		srcTexels = texels;
+	}
+
+	glm::uvec2 e = levelExtent(width, height, 0);
+	cost.traffic += static_cast<uint64_t>(e.x) * e.y * texel;
+
+	return cost;
+}
+
+
+// soft threshold of the first downsample, the same as in bloom_down.comp
+glm::vec3 HdaBloom::prefilter(glm::vec3 color, float threshold, float knee) {
+
+	float brightness = std::max(color.r, std::max(color.g, color.b));
+	float soft = std::clamp(brightness - threshold + knee, 0.0f, 2.0f * knee);
+	soft = soft * soft / (4.0f * knee + 1e-4f);
+
+	return color * (std::max(soft, brightness - threshold) / std::max(brightness, 1e-4f));
+}
+
+
+// weight of 2x2 box in Karis average, a single bright texel cannot dominate the level
+float HdaBloom::karisWeight(glm::vec3 color) {
+
+	return 1.0f / (1.0f + glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f)));
+}
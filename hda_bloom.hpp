@@ -0,0 +1,69 @@
+#pragma once
+#include "hda_model.hpp"
+
+#define SCENE_COLOR_FORMAT vk::Format::eR16G16B16A16Sfloat	// HDR color of scene passes, read by bloom and tonemap.frag
+#define BLOOM_FORMAT vk::Format::eR16G16B16A16Sfloat
+#define BLOOM_MAX_MIPS 6				// level 0 has half resolution of the scene
+#define BLOOM_MIN_MIPS 3
+#define BLOOM_GROUP_SIZE 8				// local_size_x and local_size_y in bloom_down.comp and bloom_up.comp
+#define BLOOM_TIMESTAMPS (2 * BLOOM_MAX_MIPS + 3)	// begin, every downsample and upsample, grid and blur of local TMO, tone mapping
+
+
+/*
+*
+* A class representing the CPU side of bloom. Bright parts of the HDR scene color are
+* downsampled into a chain of levels with 13 bilinear taps (Jimenez, "Next Generation
+* Post Processing in Call of Duty: Advanced Warfare"), the first level applies the soft
+* threshold and Karis average against fireflies. The levels are upsampled back by a tent
+* filter and added to the larger level, so no pass reads the full resolution more than
+* once. Level 0 is added to the scene color before tone mapping in tonemap.frag.
+*
+*/
+
+class HdaBloom {
+
+public:
+
+	// push constants of bloom_down.comp and bloom_up.comp
+	struct BloomPushData {
+
+		glm::ivec2 srcSize{ 0 };
+		glm::ivec2 dstSize{ 0 };
+		glm::vec2 srcScale{ 1.0f };	// part of the source read by the level, the scene has the scaled viewport
+		float threshold = 1.0f;
+		float knee = 0.5f;			// soft transition below the threshold
+		int firstLevel = 0;			// threshold and Karis average are applied
+		float pad = 0.0f;
+	};
+
+	// push constants of tonemap.frag
+	struct TonemapPushData {
+
+		float exposure = 1.0f;
+		int chooseMethodFlag = 0;
+		int hdrOnFlag = 0;
+		float bloomIntensity = 0.0f;	// 0 when bloom is off
+		int lutOnFlag = 0;				// 3D LUT of HdaTonemap replaces TMO and exposure
+		int localOnFlag = 0;			// slice of bilateral grid of HdaLocalTonemap before TMO or LUT
+		float localCompression = 1.0f;
+		float localDetail = 1.0f;
+		int compareTiles = 0;			// 0 is off, operators from chooseMethodFlag side by side
+		int compareGrid = 0;			// 1 every tile shows the whole frame, 0 tiles are strips of one frame
+		int statsBase = 0;				// first histogram bin of the frame
+		int upscaleFilter = 0;			// RESOLUTION_UPSCALE_BILINEAR or RESOLUTION_UPSCALE_EDGE
+		glm::vec2 renderScale{ 1.0f };	// viewport of the scene in scene color to the swapchain extent
+	};
+
+	// bytes of bloom chain for one resolution
+	struct BloomCost {
+
+		uint64_t memory = 0;
+		uint64_t traffic = 0;		// reads and writes of all passes of one frame
+	};
+
+	static glm::uvec2 levelExtent(uint32_t, uint32_t, uint32_t);
+	static uint32_t levelCount(uint32_t, uint32_t);
+	static BloomCost bloomCost(uint32_t, uint32_t, uint32_t);
+	static glm::vec3 prefilter(glm::vec3, float, float);
+	static float karisWeight(glm::vec3);
+};
@@ -0,0 +1,109 @@
+#include "hda_deferred.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+
+/*
+*
+* Octahedral normal encoding comes from Cigolle et al.
+* "A Survey of Efficient Representations for Independent Unit Vectors":
+* https://jcgt.org/published/0003/02/01/
+*
+*/
+
+
+// unit vector -> [-1, 1] square, the lower hemisphere is folded over the diagonals
+glm::vec2 HdaDeferred::octEncode(glm::vec3 n) {
+
+	n = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+	glm::vec2 e{ n.x, n.y };
+
+	if (n.z < 0.0f)
+		e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+
+	return e;
+}
+
+
+glm::vec3 HdaDeferred::octDecode(glm::vec2 e) {
+
+	glm::vec3 n{ e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y) };
+	float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+
+	return glm::normalize(n);
+}
+
+
+// size of texel of depth formats returned by HdaInstanceGpu::findFormat()
+uint32_t HdaDeferred::depthBytes(vk::Format format) {
+
+	if (format == vk::Format::eD32SfloatS8Uint)
+		return 8;
+	if (format == vk::Format::eD16Unorm)
+		return 2;
+
+	return 4;
+}
+
+
+/**
+*	@brief Estimate memory and traffic of G-buffer for one frame.
+*
+*	Every shaded fragment of the geometry pass tests and writes depth and writes both color
+*	targets, so the writes grow with overdraw. The lighting pass reads every texel of G-buffer
+*	once and writes one texel of HDR scene color, independently of the scene.
+*
+*/
+HdaDeferred::GbufferCost HdaDeferred::gbufferCost(uint32_t width, uint32_t height, vk::Format depthFormat, double overdraw) {
+
+	GbufferCost cost{};
+	uint64_t pixels = static_cast<uint64_t>(width) * height;
+	uint32_t texel = GBUFFER_COLOR_BYTES + depthBytes(depthFormat);
+
+	cost.memory = pixels * texel;
+	cost.geometryWrite = static_cast<uint64_t>(pixels * std::max(overdraw, 1.0) * (texel + depthBytes(depthFormat)));
+	cost.lightingRead = pixels * (texel + 8);
+
+	return cost;
+}
+
+
+// memory and traffic of G-buffer for common resolutions without overdraw
+void HdaDeferred::printGbufferCost(vk::Format depthFormat) {
+
+	const std::array<glm::uvec2, 4> resolutions = { glm::uvec2(1280, 720), glm::uvec2(1920, 1080), glm::uvec2(2560, 1440), glm::uvec2(3840, 2160) };
+
+	std::cout << "printGbufferCost(): " << GBUFFER_COLOR_BYTES + depthBytes(depthFormat) << " bytes per pixel\n";
+	for (const auto& r : resolutions) {
+
+		GbufferCost cost = gbufferCost(r.x, r.y, depthFormat, 1.0);
+		std::cout << "  " << r.x << "x" << r.y << " | memory: " << cost.memory / (1024.0 * 1024.0) << " MB"
+			<< " | traffic per frame: " << (cost.geometryWrite + cost.lightingRead) / (1024.0 * 1024.0) << " MB\n";
+	}
+}
+
+
+/**
+*	@brief Prepare data of the lighting pass for camera of the frame.
+*
+*	The projection is the same as in projectionCalculation(). The directional light
+*	is LIGHT_DIRECTION of shader.frag, both passes shade in world space.
+*
+*/
+HdaDeferred::DeferredUniformData HdaDeferred::prepareDeferredData(const glm::mat4& view, uint32_t width, uint32_t height) {
+
+	DeferredUniformData data{};
+
+	glm::mat4 projection = glm::perspective(glm::radians(CAMERA_FOV), static_cast<float>(width) / static_cast<float>(height), CAMERA_NEAR, CAMERA_FAR);
+	projection[1][1] *= -1;
+
+	data.invViewProj = glm::inverse(projection * view);
+	data.cameraPosition = glm::inverse(view) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	data.lightDirection = glm::vec4(glm::normalize(glm::vec3(8.0f, 2.0f, 11.0f)), 0.0f);
+
+	return data;
+}
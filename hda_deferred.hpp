@@ -0,0 +1,55 @@
+#pragma once
+#include "hda_model.hpp"
+
+#define GBUFFER_ALBEDO_FORMAT vk::Format::eR8G8B8A8Unorm			// albedo + specular intensity
+#define GBUFFER_NORMAL_FORMAT vk::Format::eA2B10G10R10UnormPack32	// octahedral normal + shininess
+#define GBUFFER_COLOR_BYTES 8										// bytes per pixel of both color targets
+#define GBUFFER_SHININESS_MAX 1024.0f								// shininess is stored as fraction of the maximum
+
+
+/*
+*
+* A class representing the CPU side of the deferred shading path. The geometry pass writes
+* a compact G-buffer - albedo with specular intensity and octahedral normal with shininess,
+* the position is reconstructed from depth. The lighting pass shades every pixel once with
+* the directional light and the clustered lights of HdaLights. The encoding functions
+* mirror gbuffer.frag and deferred.frag.
+*
+*/
+
+class HdaDeferred {
+
+public:
+
+	// uniform data of deferred.frag, std140 layout
+	struct DeferredUniformData {
+
+		alignas(16) glm::mat4 invViewProj{ 1.0f };			// depth buffer -> world space
+		alignas(16) glm::vec4 cameraPosition{ 0.0f };
+		alignas(16) glm::vec4 lightDirection{ 0.0f };		// direction towards the directional light in world space
+		alignas(16) glm::vec4 lightAmbient{ 1.0f };
+		alignas(16) glm::vec4 lightDiffuse{ 1.0f };
+		alignas(16) glm::vec4 lightSpecular{ 1.0f };
+		alignas(16) glm::vec4 attenuation{ 1.0f, 0.0f, 0.0f, 0.0f };	// kC, kL, kQ
+		int blinnPhongFlag = 0;
+		int pointLightFlag = 0;
+		int hdrOnFlag = 0;
+		alignas(4) float exposure = 1.0f;
+		int chooseMethodFlag = 0;
+	};
+
+	// bytes of G-buffer for one resolution
+	struct GbufferCost {
+
+		uint64_t memory = 0;			// color targets and depth
+		uint64_t geometryWrite = 0;		// color and depth writes of shaded fragments
+		uint64_t lightingRead = 0;		// G-buffer reads and color write of the lighting pass
+	};
+
+	static glm::vec2 octEncode(glm::vec3);
+	static glm::vec3 octDecode(glm::vec2);
+	static uint32_t depthBytes(vk::Format);
+	static GbufferCost gbufferCost(uint32_t, uint32_t, vk::Format, double);
+	static void printGbufferCost(vk::Format);
+	static DeferredUniformData prepareDeferredData(const glm::mat4&, uint32_t, uint32_t);
+};
@@ -0,0 +1,485 @@
+#include "hda_graph.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+
+void HdaGraph::clear() {
+
+	resources.clear();
+	passes.clear();
+	barriers.clear();
+	finalStates.clear();
+	transientTargets.clear();
+	transientSize = 0;
+	transientDedicated = 0;
+}
+
+
+uint32_t HdaGraph::addResource(const Resource& resource) {
+
+	resources.push_back(resource);
+	return static_cast<uint32_t>(resources.size() - 1);
+}
+
+
+uint32_t HdaGraph::addPass(const string& name, function<void(vk::CommandBuffer*)> record) {
+
+	Pass pass;
+	pass.name = name;
+	pass.record = record;
+	passes.push_back(pass);
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+
+void HdaGraph::read(uint32_t pass, uint32_t resource, const Access& access) {
+
+	passes[pass].uses.push_back({ resource, access, false, true });
+}
+
+
+// the pass needs the layout of resource, but not content, e.g. descriptor of disabled effect
+void HdaGraph::readLayout(uint32_t pass, uint32_t resource, const Access& access) {
+
+	passes[pass].uses.push_back({ resource, access, false, false });
+}
+
+
+void HdaGraph::write(uint32_t pass, uint32_t resource, const Access& access) {
+
+	passes[pass].uses.push_back({ resource, access, true, true });
+}
+
+
+// write bits of access, reads in srcAccessMask make nothing available
+vk::AccessFlags2 HdaGraph::writeAccess(vk::AccessFlags2 access) {
+
+	const vk::AccessFlags2 writes = vk::AccessFlagBits2::eShaderWrite | vk::AccessFlagBits2::eShaderStorageWrite
+		| vk::AccessFlagBits2::eColorAttachmentWrite | vk::AccessFlagBits2::eDepthStencilAttachmentWrite
+		| vk::AccessFlagBits2::eTransferWrite | vk::AccessFlagBits2::eHostWrite | vk::AccessFlagBits2::eMemoryWrite;
+
+	return access & writes;
+}
+
+
+/**
+*	@brief Cull passes, derive barriers and place transient resources.
+*
+*	Passes are walked from the last one, a pass is kept when it writes the frame output or
+*	content which a kept pass reads. Then every resource follows its last write and reads after
+*	it. Reads wait for the write unless a barrier already made it visible to their stages and
+*	accesses, writes and layout changes also wait for the reads (execution dependency only).
+*	Reads in the same layout do not need any barrier. Transient resources start in eUndefined,
+*	their previous content is discarded.
+*
+*/
+void HdaGraph::compile() {
+
+	barriers.clear();
+	transientTargets.clear();
+
+	// culling
+	vector<bool> needed(resources.size(), false);
+	for (size_t r = 0; r < resources.size(); r++)
+		needed[r] = resources[r].output;
+
+	for (size_t p = passes.size(); p-- > 0;) {
+
+		Pass& pass = passes[p];
+		pass.culled = true;
+		for (const Use& u : pass.uses)
+			if (u.write && needed[u.resource])
+				pass.culled = false;
+
+		if (pass.culled)
+			continue;
+
+		for (const Use& u : pass.uses)
+			if (!u.write && u.content)
+				needed[u.resource] = true;
+	}
+
+	// barriers
+	struct State {
+
+		Access write;			// the last write
+		Access reads;			// reads after the last write
+		Access visible;			// stages and accesses which see the last write
+		vk::ImageLayout layout;
+		bool discard;
+		uint32_t first;			// the first and the last kept pass using the resource
+		uint32_t last;
+	};
+
+	vector<State> states(resources.size());
+	for (size_t r = 0; r < resources.size(); r++) {
+
+		const Resource& res = resources[r];
+		State& s = states[r];
+		s = { {}, {}, {}, res.initial.layout, res.transient, GRAPH_NONE, GRAPH_NONE };
+		if (writeAccess(res.initial.access))
+			s.write = { res.initial.stages, writeAccess(res.initial.access), res.initial.layout };
+		else
+			s.reads = res.initial;
+	}
+
+	for (uint32_t p = 0; p < passes.size(); p++) {
+
+		if (passes[p].culled)
+			continue;
+
+		// all uses of one resource in the pass get one barrier
+		vector<Use> merged;
+		for (const Use& u : passes[p].uses) {
+
+			Use* m = nullptr;
+			for (Use& e : merged)
+				if (e.resource == u.resource)
+					m = &e;
+
+			if (!m) {
+
+				merged.push_back(u);
+				continue;
+			}
+
+			if (m->access.layout != u.access.layout)
+				throw runtime_error("HdaGraph: pass " + passes[p].name + " uses " + resources[u.resource].name + " in two layouts");
+
+			m->access.stages |= u.access.stages;
+			m->access.access |= u.access.access;
+			m->write = m->write || u.write;
+		}
+
+		for (const Use& u : merged) {
+
+			State& s = states[u.resource];
+			const Access& a = u.access;
+
+			bool layoutChange = a.layout != vk::ImageLayout::eUndefined && (a.layout != s.layout || s.discard);
+			bool pendingWrite = static_cast<bool>(s.write.access)
+				&& ((a.stages & ~s.visible.stages) || (a.access & ~s.visible.access));
+			bool waitReads = (u.write || layoutChange) && static_cast<bool>(s.reads.stages);
+
+			if (layoutChange || pendingWrite || waitReads) {
+
+				Barrier b;
+				b.pass = p;
+				b.resource = u.resource;
+				b.src.stages = s.write.stages | (waitReads ? s.reads.stages : vk::PipelineStageFlags2());
+				b.src.access = s.write.access;
+				b.src.layout = s.layout;
+				b.dst = a;
+				b.dst.layout = a.layout == vk::ImageLayout::eUndefined ? s.layout : a.layout;
+				b.oldLayout = s.discard ? vk::ImageLayout::eUndefined : s.layout;
+				barriers.push_back(b);
+
+				s.visible = a;
+				s.reads = {};
+			}
+
+			if (u.write) {
+
+				s.write.stages = a.stages;
+				s.write.access = writeAccess(a.access);
+				s.reads = {};
+				s.visible = {};
+			}
+			else {
+
+				s.reads.stages |= a.stages;
+				s.reads.access |= a.access;
+			}
+
+			if (a.layout != vk::ImageLayout::eUndefined)
+				s.layout = a.layout;
+			s.discard = false;
+
+			if (s.first == GRAPH_NONE)
+				s.first = p;
+			s.last = p;
+		}
+	}
+
+	finalStates.resize(resources.size());
+	for (size_t r = 0; r < resources.size(); r++) {
+
+		// reads after the write already see it, so the next frame reads without a barrier
+		const State& s = states[r];
+		finalStates[r] = s.reads.stages ? s.reads : s.write;
+		finalStates[r].layout = s.layout;
+	}
+
+	// transient resources of kept passes
+	transientDedicated = 0;
+	for (size_t r = 0; r < resources.size(); r++)
+		if (resources[r].transient && states[r].first != GRAPH_NONE) {
+
+			transientTargets.push_back({ resources[r].name, resources[r].size, resources[r].alignment, states[r].first, states[r].last });
+			transientDedicated += resources[r].size;
+		}
+	transientSize = HdaTransient::alias(transientTargets);
+}
+
+
+// legacy stages have the same bits, synchronization2 allows no stage
+static vk::PipelineStageFlags legacyStages(vk::PipelineStageFlags2 stages, vk::PipelineStageFlagBits none) {
+
+	VkPipelineStageFlags bits = static_cast<VkPipelineStageFlags>(static_cast<VkPipelineStageFlags2>(stages));
+	return bits ? vk::PipelineStageFlags(bits) : vk::PipelineStageFlags(none);
+}
+
+
+static vk::AccessFlags legacyAccess(vk::AccessFlags2 access) {
+
+	return vk::AccessFlags(static_cast<VkAccessFlags>(static_cast<VkAccessFlags2>(access)));
+}
+
+
+/**
+*	@brief Record barriers and kept passes.
+*
+*	Barriers of one pass are recorded by one command. Without synchronization2 they are
+*	recorded by vkCmdPipelineBarrier, the graph uses only stages and accesses which have
+*	the same bits there.
+*
+*/
+void HdaGraph::execute(vk::CommandBuffer* cmdBuffs, PFN_vkCmdPipelineBarrier2KHR pipelineBarrier2) {
+
+	size_t next = 0;
+	for (uint32_t p = 0; p < passes.size(); p++) {
+
+		if (passes[p].culled)
+			continue;
+
+		vector<vk::ImageMemoryBarrier2> imageBarriers;
+		vector<vk::MemoryBarrier2> memoryBarriers;
+		for (; next < barriers.size() && barriers[next].pass == p; next++) {
+
+			const Barrier& b = barriers[next];
+			const Resource& res = resources[b.resource];
+			if (res.image)
+				imageBarriers.push_back(vk::ImageMemoryBarrier2(
+					b.src.stages,				// srcStageMask
+					b.src.access,				// srcAccessMask
+					b.dst.stages,				// dstStageMask
+					b.dst.access,				// dstAccessMask
+					b.oldLayout,				// oldLayout
+					b.dst.layout,				// newLayout
+					VK_QUEUE_FAMILY_IGNORED,	// srcQueueFamilyIndex
+					VK_QUEUE_FAMILY_IGNORED,	// dstQueueFamilyIndex
+					res.image,					// image
+					res.range					// subresourceRange
+				));
+			else
+				memoryBarriers.push_back(vk::MemoryBarrier2(b.src.stages, b.src.access, b.dst.stages, b.dst.access));
+		}
+
+		if (pipelineBarrier2 && (imageBarriers.size() || memoryBarriers.size())) {
+
+			vk::DependencyInfo dependency(
+				vk::DependencyFlags(),		// dependencyFlags
+				memoryBarriers,				// memoryBarriers
+				{},							// bufferMemoryBarriers
+				imageBarriers				// imageMemoryBarriers
+			);
+			pipelineBarrier2(static_cast<VkCommandBuffer>(*cmdBuffs), reinterpret_cast<const VkDependencyInfo*>(&dependency));
+		}
+		else if (imageBarriers.size() || memoryBarriers.size()) {
+
+			vk::PipelineStageFlags2 src{}, dst{};
+			vector<vk::ImageMemoryBarrier> legacyImage;
+			vector<vk::MemoryBarrier> legacyMemory;
+			for (const vk::ImageMemoryBarrier2& b : imageBarriers) {
+
+				src |= b.srcStageMask;
+				dst |= b.dstStageMask;
+				legacyImage.push_back(vk::ImageMemoryBarrier(legacyAccess(b.srcAccessMask), legacyAccess(b.dstAccessMask),
+					b.oldLayout, b.newLayout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, b.image, b.subresourceRange));
+			}
+			for (const vk::MemoryBarrier2& b : memoryBarriers) {
+
+				src |= b.srcStageMask;
+				dst |= b.dstStageMask;
+				legacyMemory.push_back(vk::MemoryBarrier(legacyAccess(b.srcAccessMask), legacyAccess(b.dstAccessMask)));
+			}
+
+			cmdBuffs->pipelineBarrier(
+				legacyStages(src, vk::PipelineStageFlagBits::eTopOfPipe),		// srcStageMask
+				legacyStages(dst, vk::PipelineStageFlagBits::eBottomOfPipe),	// dstStageMask
+				vk::DependencyFlags(),		// dependencyFlags
+				legacyMemory,				// memoryBarriers
+				nullptr,					// bufferMemoryBarriers
+				legacyImage					// imageMemoryBarriers
+			);
+		}
+
+		if (passes[p].record)
+			passes[p].record(cmdBuffs);
+	}
+}
+
+
+string HdaGraph::accessName(const Access& a) {
+
+	string name = vk::to_string(a.stages) + " " + vk::to_string(a.access);
+	if (a.layout != vk::ImageLayout::eUndefined)
+		name += " " + vk::to_string(a.layout);
+	return name;
+}
+
+
+// compiled graph as text, passes in order with their uses, barriers and placement of transient resources
+string HdaGraph::dump() {
+
+	uint32_t culled = 0;
+	for (const Pass& pass : passes)
+		culled += pass.culled ? 1 : 0;
+
+	ostringstream out;
+	const double mb = 1024.0 * 1024.0;
+	out << "frame graph: " << passes.size() << " passes (" << culled << " culled), " << barriers.size() << " barriers, transient memory "
+		<< transientSize / mb << " MB (" << transientDedicated / mb << " MB without aliasing)\n";
+
+	for (uint32_t p = 0; p < passes.size(); p++) {
+
+		out << "  pass " << p << " " << passes[p].name << (passes[p].culled ? " (culled)" : "") << "\n";
+		for (const Use& u : passes[p].uses)
+			out << "    " << (u.write ? "write " : (u.content ? "read " : "layout ")) << resources[u.resource].name << ": " << accessName(u.access) << "\n";
+
+		for (const Barrier& b : barriers)
+			if (b.pass == p)
+				out << "    barrier " << resources[b.resource].name << ": " << vk::to_string(b.src.stages) << " " << vk::to_string(b.src.access)
+					<< " -> " << vk::to_string(b.dst.stages) << " " << vk::to_string(b.dst.access)
+					<< (resources[b.resource].image || b.oldLayout != b.dst.layout ? ", " + vk::to_string(b.oldLayout) + " -> " + vk::to_string(b.dst.layout) : "") << "\n";
+	}
+
+	for (const HdaTransient::Target& t : transientTargets)
+		out << "  transient " << t.name << ": passes " << t.first << "-" << t.last << ", offset " << t.offset << ", size " << t.size << "\n";
+
+	return out.str();
+}
+
+
+/**
+*	@brief Check barriers, culling and aliasing of a small graph, no device is needed.
+*
+*	Scene color is blurred by compute into a transient target, tone mapping reads it
+*	twice (the second read needs no barrier) and the scene is overwritten after the reads.
+*	A pass which nobody reads is culled, a disabled effect keeps only the layout of its
+*	target and two transient targets with disjoint lifetimes share memory.
+*
+*/
+bool HdaGraph::selfTest() {
+
+	using Stage = vk::PipelineStageFlagBits2;
+	using Acc = vk::AccessFlagBits2;
+	using Layout = vk::ImageLayout;
+
+	const Access colorWrite{ Stage::eColorAttachmentOutput, Acc::eColorAttachmentWrite, Layout::eUndefined };
+	const Access computeSample{ Stage::eComputeShader, Acc::eShaderRead, Layout::eShaderReadOnlyOptimal };
+	const Access computeWrite{ Stage::eComputeShader, Acc::eShaderWrite, Layout::eGeneral };
+	const Access computeRead{ Stage::eComputeShader, Acc::eShaderRead, Layout::eGeneral };
+	const Access fragmentRead{ Stage::eFragmentShader, Acc::eShaderRead, Layout::eShaderReadOnlyOptimal };
+
+	HdaGraph g;
+	Resource scene{ "scene", vk::Image(), {}, { Stage::eColorAttachmentOutput, Acc::eColorAttachmentWrite, Layout::eShaderReadOnlyOptimal } };
+	Resource blur{ "blur", vk::Image(), {}, {}, true, false, 1000 };
+	Resource unused{ "unused", vk::Image(), {}, {}, true, false, 4000 };
+	Resource disabled{ "disabled", vk::Image(), {}, {}, true, false, 2000 };
+	Resource late{ "late", vk::Image(), {}, {}, true, false, 500 };
+	Resource output{ "output", vk::Image(), {}, {}, false, true };
+
+	uint32_t rScene = g.addResource(scene);
+	uint32_t rBlur = g.addResource(blur);
+	uint32_t rUnused = g.addResource(unused);
+	uint32_t rDisabled = g.addResource(disabled);
+	uint32_t rLate = g.addResource(late);
+	uint32_t rOutput = g.addResource(output);
+
+	uint32_t pBlur = g.addPass("blur", nullptr);
+	g.read(pBlur, rScene, computeSample);
+	g.write(pBlur, rBlur, computeWrite);
+
+	uint32_t pUnused = g.addPass("unused", nullptr);
+	g.write(pUnused, rUnused, computeWrite);
+
+	uint32_t pDisabled = g.addPass("disabled effect", nullptr);
+	g.read(pDisabled, rScene, computeSample);
+	g.write(pDisabled, rDisabled, computeWrite);
+
+	uint32_t pTonemap = g.addPass("tonemap", nullptr);
+	g.read(pTonemap, rBlur, fragmentRead);
+	g.readLayout(pTonemap, rDisabled, fragmentRead);
+	g.write(pTonemap, rOutput, colorWrite);
+
+	uint32_t pStats = g.addPass("stats", nullptr);
+	g.read(pStats, rBlur, fragmentRead);
+	g.write(pStats, rOutput, colorWrite);
+
+	uint32_t pOverwrite = g.addPass("overwrite", nullptr);
+	g.write(pOverwrite, rLate, computeWrite);
+	g.read(pOverwrite, rScene, computeRead);
+	g.write(pOverwrite, rOutput, colorWrite);
+
+	g.compile();
+
+	bool ok = true;
+	auto check = [&](bool condition, const char* what) {
+
+		cout << "selfTest(): " << (condition ? "ok     " : "FAILED ") << what << endl;
+		ok = ok && condition;
+	};
+
+	auto find = [&](uint32_t pass, uint32_t resource) -> const Barrier* {
+
+		for (const Barrier& b : g.getBarriers())
+			if (b.pass == pass && b.resource == resource)
+				return &b;
+		return nullptr;
+	};
+
+	const Barrier* b;
+
+	check(g.getPass(pUnused).culled, "pass without readers is culled");
+	check(g.getPass(pDisabled).culled, "pass read only for layout is culled");
+	check(!g.getPass(pBlur).culled && !g.getPass(pTonemap).culled && !g.getPass(pStats).culled && !g.getPass(pOverwrite).culled, "passes writing output are kept");
+
+	b = find(pBlur, rScene);
+	check(b && b->src.stages == Stage::eColorAttachmentOutput && b->src.access == Acc::eColorAttachmentWrite
+		&& b->dst.stages == Stage::eComputeShader && b->oldLayout == b->dst.layout, "read after write waits for color writes without layout change");
+
+	b = find(pBlur, rBlur);
+	check(b && b->oldLayout == Layout::eUndefined && b->dst.layout == Layout::eGeneral && !b->src.stages, "first use of transient discards content");
+
+	b = find(pTonemap, rBlur);
+	check(b && b->src.stages == Stage::eComputeShader && b->src.access == Acc::eShaderWrite && b->dst.stages == Stage::eFragmentShader
+		&& b->oldLayout == Layout::eGeneral && b->dst.layout == Layout::eShaderReadOnlyOptimal, "compute write is made visible to fragment shader");
+
+	b = find(pTonemap, rDisabled);
+	check(b && b->oldLayout == Layout::eUndefined && b->dst.layout == Layout::eShaderReadOnlyOptimal, "layout only read of culled writer transitions from undefined");
+
+	check(!find(pStats, rBlur), "read after read in the same layout has no barrier");
+
+	b = find(pOverwrite, rScene);
+	check(b && b->src.stages == (Stage::eColorAttachmentOutput | Stage::eComputeShader) && b->dst.layout == Layout::eGeneral,
+		"layout change waits for previous reads");
+
+	b = find(pStats, rOutput);
+	check(b && b->src.stages == Stage::eColorAttachmentOutput && b->src.access == Acc::eColorAttachmentWrite, "write after write waits for previous write");
+
+	check(!find(pTonemap, rOutput), "first write of resource without previous use has no barrier");
+	check(g.getFinalState(rScene).layout == Layout::eGeneral, "final state has the last layout");
+	check(g.getFinalState(rBlur).access == Acc::eShaderRead && g.getFinalState(rBlur).stages == Stage::eFragmentShader, "final state of read resource has only reads");
+
+	const vector<HdaTransient::Target>& targets = g.getTransientTargets();
+	check(targets.size() == 3, "culled transient resource is not placed");
+	check(g.getTransientSize() == 3000 && targets.size() == 3 && targets[2].offset == 0, "disjoint transient resources share memory");
+
+	cout << g.dump();
+	return ok;
+}
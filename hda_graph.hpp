@@ -0,0 +1,102 @@
+#pragma once
+#include "hda_transient.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#define GRAPH_NONE UINT32_MAX		// no pass or no resource
+
+
+/*
+*
+* A class representing a small frame graph. Passes declare resources which they read and write
+* with stages, accesses and layouts of synchronization2 and they run in the order of declaration.
+* compile() culls passes whose writes are not read by a kept pass or by the frame output, derives
+* one barrier for every hazard and layout change between passes and places transient resources
+* by lifetimes with HdaTransient::alias(). Render passes keep transitions of their attachments,
+* so their accesses have layout eUndefined and only the hazards are synchronized.
+*
+*/
+
+class HdaGraph {
+
+public:
+
+	// use of resource by a pass or the last use before the frame
+	struct Access {
+
+		vk::PipelineStageFlags2 stages{};
+		vk::AccessFlags2 access{};
+		vk::ImageLayout layout = vk::ImageLayout::eUndefined;	// eUndefined - no layout is managed (buffers, attachments of render passes)
+	};
+
+	struct Resource {
+
+		std::string name;
+		vk::Image image;					// null for buffers, they get memory barriers
+		vk::ImageSubresourceRange range;
+		Access initial;
+		bool transient = false;				// content is not kept between frames, memory can be shared
+		bool output = false;				// read after the frame (presented, by host or by the next frame)
+		uint64_t size = 0;					// memory of transient resource
+		uint64_t alignment = 1;
+	};
+
+	struct Use {
+
+		uint32_t resource = GRAPH_NONE;
+		Access access;
+		bool write = false;
+		bool content = true;				// false - only layout is needed, so writers are not kept
+	};
+
+	struct Pass {
+
+		std::string name;
+		std::vector<Use> uses;
+		std::function<void(vk::CommandBuffer*)> record;
+		bool culled = false;
+	};
+
+	// barrier before pass, src is the state after the previous uses of resource
+	struct Barrier {
+
+		uint32_t pass = GRAPH_NONE;
+		uint32_t resource = GRAPH_NONE;
+		Access src;
+		Access dst;
+		vk::ImageLayout oldLayout = vk::ImageLayout::eUndefined;
+	};
+
+	void clear();
+	uint32_t addResource(const Resource&);
+	uint32_t addPass(const std::string&, std::function<void(vk::CommandBuffer*)>);
+	void read(uint32_t, uint32_t, const Access&);
+	void readLayout(uint32_t, uint32_t, const Access&);
+	void write(uint32_t, uint32_t, const Access&);
+	void compile();
+	void execute(vk::CommandBuffer*, PFN_vkCmdPipelineBarrier2KHR);
+	std::string dump();
+
+	inline const std::vector<Barrier>& getBarriers() { return barriers; }
+	inline const Pass& getPass(uint32_t p) { return passes[p]; }
+	inline Access getFinalState(uint32_t r) { return finalStates[r]; }
+	inline uint64_t getTransientSize() { return transientSize; }
+	inline const std::vector<HdaTransient::Target>& getTransientTargets() { return transientTargets; }
+
+	static bool selfTest();
+
+private:
+
+	static vk::AccessFlags2 writeAccess(vk::AccessFlags2);
+	static std::string accessName(const Access&);
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<Barrier> barriers;		// in order of passes
+	std::vector<Access> finalStates;	// the last write or reads after it, the initial state of the next frame
+	std::vector<HdaTransient::Target> transientTargets;
+	uint64_t transientSize = 0;
+	uint64_t transientDedicated = 0;
+};
@@ -16,6 +16,7 @@ void HdrDemoApp::runApp() {
 	while (!hdaAppWindow.glfwShouldClose()) {
 
 		glfwPollEvents();
+		jobs.processMainThreadJobs();
 
 		if (hdaAppWindow.getKeyPressedIFlag() == true) {
 			showUsage();
@@ -55,9 +56,37 @@ void HdrDemoApp::showUsage() {
 	cout << "Q	move backwards\n";
 	cout << "\n";
 	cout << "O	turn on the pointlights\n";
+	cout << "N	switch the number of lights of the stress scene (2, 64, 256, 1024)\n";
+	cout << "T	switch the number of instances of the second object (1 - 100000)\n";
+	cout << "U	run the CPU benchmark of scene storage (10k - 1M entities)\n";
+	cout << "V	print utilization of job system and run its CPU benchmark\n";
+	cout << "Y	switch recording of scene into secondary command buffers of more threads and measure it\n";
+	cout << "1	switch prerecorded command buffers of scene, they are recorded again only when the scene or pipelines change\n";
+	cout << "2	switch light culling to the async compute queue and print timeline of both queues\n";
+	cout << "3	turn ON/OFF the bloom, times of its levels are printed with the queue timeline\n";
+	cout << "4	switch the bloom threshold (0.8, 1.0, 1.5, 2.5)\n";
+	cout << "5	switch the bloom intensity (0.1, 0.2, 0.4, 0.8)\n";
+	cout << "6	switch the number of bloom levels (3 - 6)\n";
+	cout << "7	switch the TMO between analytic and baked 3D LUT, cost per pixel is printed with tone mapping time\n";
+	cout << "8	switch the color grade of the LUT (neutral, warm, cool, punchy)\n";
+	cout << "9	switch the size of the LUT (17, 33, 65)\n";
+	cout << "0	switch the local TMO with bilateral grid (off, 0.7, 0.5, 0.3 compression of base contrast), cost per resolution is printed\n";
+	cout << "F1	switch the comparison of 2 to 5 TMOs side by side from M, labels are in the title and squares of tiles\n";
+	cout << "F2	switch the comparison between strips of one frame and tiles with the whole frame\n";
+	cout << "F3	switch the dynamic resolution driven by GPU frame time, the scale is printed with queue times\n";
+	cout << "F4	switch the target frame time of dynamic resolution (60 or --resolution, 30, 90, 144 FPS)\n";
+	cout << "F5	switch the minimal scale of dynamic resolution (0.5 or --resolution, 0.35, 0.75)\n";
+	cout << "F6	switch the upscale filter of tone mapping (bilinear, edge-adaptive)\n";
+	cout << "F7	switch the shading and tone mapping between float32 and float16 variant, GPU ms of both are printed\n";
+	cout << "F8	print the compiled frame graph of post processing (passes, culled passes, barriers, transient memory)\n";
 	cout << "\n";
 	cout << "M	switch the TMO\n";
 	cout << "\n";
+	cout << "K	switch the meshlet culling (off, frustum, frustum + backface cones)\n";
+	cout << "L	switch the occlusion culling with depth pyramid (needs meshlet culling)\n";
+	cout << "J	turn ON/OFF the depth prepass\n";
+	cout << "R	switch between forward and deferred shading\n";
+	cout << "\n";
 	cout << "C	higher exposure\n";
 	cout << "Y	lower exposure\n\n";
 }
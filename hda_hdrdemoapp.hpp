@@ -4,6 +4,7 @@
 #include "hda_swapchain.hpp"
 #include "hda_pipeline.hpp"
 #include "builder.hpp"
+#include "hda_jobs.hpp"
 
 
 #include <iostream>
@@ -27,6 +28,8 @@ public:
 	~HdrDemoApp() { cout << "HdrDemoApp: Destructor\n"; };
 
 	void runApp();
+	void setScenePath(string path) { builder.setScenePath(path); }
+	void setResolutionSettings(const HdaResolution::Settings& settings) { builder.setResolutionSettings(settings); }
 
 	void showUsage();
 
@@ -40,6 +43,8 @@ private:
 
 	HdaPipeline pipeline{ device, swapchain };
 
-	HdaBuilder builder{ device, hdaAppWindow, swapchain, pipeline };
+	HdaJobs jobs{ HdaJobs::defaultWorkerCount() };
+
+	HdaBuilder builder{ device, hdaAppWindow, swapchain, pipeline, jobs };
 
 };
\ No newline at end of file
@@ -18,8 +18,15 @@ HdaInstanceGpu::~HdaInstanceGpu() {
 
 	cout << "HdaInstaceGpu: Destructor\n";
 
-	if (eCh == 1)
+	if (eCh == 1) {
+		device.destroy(timeline);
+		device.destroy(computeTimeline);
 		device.destroy(renderpass);
+		device.destroy(earlyRenderpass);
+		device.destroy(lateRenderpass);
+		device.destroy(gbufferRenderpass);
+		device.destroy(tonemapRenderpass);
+	}
 	device.destroy();
 	instance.destroy(winSurface);
 	instance.destroy();
@@ -32,7 +39,11 @@ void HdaInstanceGpu::initGpu() {
 	createWinSurface();
 	findPhysDevice();
 	deviceInit();
+	timelineInit();
 	renderpassInit();
+	occlusionRenderpassInit();
+	deferredRenderpassInit();
+	tonemapRenderpassInit();
 }
 
 
@@ -75,7 +86,7 @@ void HdaInstanceGpu::instanceInit() {
 					VK_MAKE_VERSION(1,0,0),			// application version
 					nullptr,						// engine name
 					VK_MAKE_VERSION(1,0,0),			// engine version
-					VK_API_VERSION_1_0,				// api version
+					VK_API_VERSION_1_2,				// api version, timeline semaphores are core since 1.2
 				},
 				0,        // enabled layer count
 				nullptr,  // enabled layer names
@@ -168,6 +179,8 @@ void HdaInstanceGpu::findPhysDevice() {
 	//surfaceFormat.format = vk::Format::eB8G8R8A8Srgb;
 	//surfaceFormat.colorSpace = vk::ColorSpaceKHR::eSrgbNonlinear;
 
+	findComputeFamily();
+
 	cout << "Selected physical device: " << physDevice.getProperties().deviceName << std::endl;
 	cout << "Selected surfaceFormat:" << vk::to_string(surfaceFormat.format) << " / " << vk::to_string(surfaceFormat.colorSpace) << endl;
 
@@ -240,6 +253,16 @@ bool HdaInstanceGpu::isSuitable(vk::PhysicalDevice physdev) {
 	if (!physdev.getFeatures().samplerAnisotropy)
 		return false;
 
+	// tonemap.frag counts histograms of comparison tiles
+	if (!physdev.getFeatures().fragmentStoresAndAtomics)
+		return false;
+
+	// frames and uploads are synchronized by timeline semaphore
+	if (physdev.getProperties().apiVersion < VK_API_VERSION_1_2)
+		return false;
+	if (!physdev.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>().get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore)
+		return false;
+
 	vk::SurfaceFormatKHR surformat;
 	uint32_t graphicsFamily = UINT32_MAX;
 	uint32_t presentationFamily = UINT32_MAX;
@@ -278,6 +301,45 @@ bool HdaInstanceGpu::isSuitable(vk::PhysicalDevice physdev) {
 	return false;
 }
 
+/**
+*	@brief Find queue family for async compute.
+*
+*	A family with compute and without graphics is preferred, it is usually served by
+*	separate hardware queues. Otherwise any other compute family is used, compute work
+*	stays on the graphics queue if the graphics family is the only one.
+*
+*/
+void HdaInstanceGpu::findComputeFamily() {
+
+	vector<vk::QueueFamilyProperties> queueFamilyList = physDevice.getQueueFamilyProperties();
+
+	for (uint32_t index = 0; index < queueFamilyList.size(); index++) {
+
+		if (!(queueFamilyList[index].queueFlags & vk::QueueFlagBits::eCompute) || index == graphicsQueueFamily)
+			continue;
+
+		if (!(queueFamilyList[index].queueFlags & vk::QueueFlagBits::eGraphics)) {
+			computeQueueFamily = index;
+			break;
+		}
+		if (computeQueueFamily == UINT32_MAX)
+			computeQueueFamily = index;
+	}
+
+	// timestamps of both queues are compared in one timeline
+	timestampSupport = physDevice.getProperties().limits.timestampComputeAndGraphics == VK_TRUE;
+	graphicsTimestampBits = queueFamilyList[graphicsQueueFamily].timestampValidBits;
+
+	if (computeQueueFamily == UINT32_MAX)
+		cout << "findComputeFamily(): Async compute queue is not available.\n";
+	else {
+		computeTimestampBits = queueFamilyList[computeQueueFamily].timestampValidBits;
+		cout << "findComputeFamily(): Async compute queue family " << computeQueueFamily
+			 << ((queueFamilyList[computeQueueFamily].queueFlags & vk::QueueFlagBits::eGraphics) ? " (shares graphics)" : " (dedicated)")
+			 << ", timestamp bits " << computeTimestampBits << ".\n";
+	}
+}
+
 /*
 *
 * Tda reprezentujc celek okennho systmu.
@@ -287,42 +349,123 @@ void HdaInstanceGpu::deviceInit() {
 
 	cout << "deviceInit(): Logical device initialization started.\n";
 
-	array<const char*, 1> devExt = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	vector<const char*> devExt = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+
+	// meshlets are culled in compute shader on every device, mesh shaders are only reported
+	for (vk::ExtensionProperties& extProp : physDevice.enumerateDeviceExtensionProperties()) {
+		if (strcmp(extProp.extensionName, "VK_EXT_mesh_shader") == 0)
+			meshShaderSupport = true;
+		if (strcmp(extProp.extensionName, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) == 0)
+			synchronization2Support = true;
+	}
+	cout << "deviceInit(): VK_EXT_mesh_shader " << (meshShaderSupport ? "is" : "is not") << " supported.\n";
 
 	vk::PhysicalDeviceFeatures devFeatures{};
 	devFeatures.samplerAnisotropy = VK_TRUE;
+	devFeatures.fragmentStoresAndAtomics = VK_TRUE;
+
+	// fragment shader invocations are counted for the overdraw ratio
+	pipelineStatisticsSupport = physDevice.getFeatures().pipelineStatisticsQuery == VK_TRUE;
+	devFeatures.pipelineStatisticsQuery = pipelineStatisticsSupport ? VK_TRUE : VK_FALSE;
+	cout << "deviceInit(): Pipeline statistics query " << (pipelineStatisticsSupport ? "is" : "is not") << " supported.\n";
+
+	// secondary command buffers may be executed in an active query only with inherited queries
+	inheritedQueriesSupport = pipelineStatisticsSupport && physDevice.getFeatures().inheritedQueries == VK_TRUE;
+	devFeatures.inheritedQueries = inheritedQueriesSupport ? VK_TRUE : VK_FALSE;
+	cout << "deviceInit(): Inherited queries " << (inheritedQueriesSupport ? "are" : "are not") << " supported.\n";
+
+	vk::PhysicalDeviceVulkan12Features devFeatures12{};
+	devFeatures12.timelineSemaphore = VK_TRUE;
+
+	// float16 arithmetic of VK_KHR_shader_float16_int8 is core in Vulkan 1.2, the variants of shaders use it
+	float16Support = physDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>().get<vk::PhysicalDeviceVulkan12Features>().shaderFloat16 == VK_TRUE;
+	devFeatures12.shaderFloat16 = float16Support ? VK_TRUE : VK_FALSE;
+	cout << "deviceInit(): Shader float16 " << (float16Support ? "is" : "is not") << " supported.\n";
+
+	// barriers of the frame graph, without the extension they are recorded by vkCmdPipelineBarrier
+	vk::PhysicalDeviceSynchronization2FeaturesKHR devFeaturesSync2(VK_TRUE);
+	if (synchronization2Support)
+		synchronization2Support = physDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceSynchronization2FeaturesKHR>().get<vk::PhysicalDeviceSynchronization2FeaturesKHR>().synchronization2 == VK_TRUE;
+	if (synchronization2Support) {
+
+		devExt.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+		devFeatures12.pNext = &devFeaturesSync2;
+	}
+	cout << "deviceInit(): VK_KHR_synchronization2 " << (synchronization2Support ? "is" : "is not") << " supported.\n";
+
+	// one queue of every distinct family
+	set<uint32_t> families = { graphicsQueueFamily, presentationQueueFamily };
+	if (computeQueueFamily != UINT32_MAX)
+		families.insert(computeQueueFamily);
+
+	const float priority = 1.f;
+	vector<vk::DeviceQueueCreateInfo> queueInfos;
+	for (uint32_t family : families)
+		queueInfos.push_back(
+			vk::DeviceQueueCreateInfo{
+				vk::DeviceQueueCreateFlags(),  // flags
+				family,				  // queueFamilyIndex
+				1,                    // queueCount
+				&priority,			  // pQueuePriorities
+			}
+		);
 
 	// create device
 	device =
 		physDevice.createDevice(
 			vk::DeviceCreateInfo{
 			   vk::DeviceCreateFlags(),  // flags
-			   graphicsQueueFamily == presentationQueueFamily ? uint32_t(1) : uint32_t(2), // queueCreateInfoCount
-			   array{                    // pQueueCreateInfos
-				  vk::DeviceQueueCreateInfo{
-					 vk::DeviceQueueCreateFlags(),  // flags
-					 graphicsQueueFamily,  // queueFamilyIndex
-					 1,                    // queueCount
-					 &(const float&)1.f,   // pQueuePriorities
-				  },
-				  vk::DeviceQueueCreateInfo{
-					 vk::DeviceQueueCreateFlags(),
-					 presentationQueueFamily,
-					 1,
-					 &(const float&)1.f,
-				  },
-			   }.data(),
+			   static_cast<uint32_t>(queueInfos.size()), // queueCreateInfoCount
+			   queueInfos.data(),		// pQueueCreateInfos
 			   0, nullptr,  // no layers
-			   1, devExt.data(),  // number of enabled extensions, enabled extension names
-			   &devFeatures    // enabled features
+			   static_cast<uint32_t>(devExt.size()), devExt.data(),  // number of enabled extensions, enabled extension names
+			   &devFeatures,    // enabled features
+			   &devFeatures12   // pNext
 			}
 	);
 
 	cout << "deviceInit(): Logical device initialization end.\n";
 
+	if (synchronization2Support)
+		pipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(device.getProcAddr("vkCmdPipelineBarrier2KHR"));
+
 	// get queues - graphicsQueueFamily is index into choosen family
 	graphicsQueue = device.getQueue(graphicsQueueFamily, 0);
 	presentationQueue = device.getQueue(presentationQueueFamily, 0);
+	if (computeQueueFamily != UINT32_MAX)
+		computeQueue = device.getQueue(computeQueueFamily, 0);
+}
+
+
+void HdaInstanceGpu::timelineInit() {
+
+	vk::SemaphoreTypeCreateInfo typeInfo(
+		vk::SemaphoreType::eTimeline,
+		0	// initialValue
+	);
+
+	timeline = device.createSemaphore(vk::SemaphoreCreateInfo(vk::SemaphoreCreateFlags(), &typeInfo));
+	computeTimeline = device.createSemaphore(vk::SemaphoreCreateInfo(vk::SemaphoreCreateFlags(), &typeInfo));
+}
+
+
+// host waits until the GPU reaches the value, values which were not submitted yet are not allowed
+void HdaInstanceGpu::waitTimeline(uint64_t value) {
+
+	vk::Result result =
+		device.waitSemaphores(
+			vk::SemaphoreWaitInfo(
+				vk::SemaphoreWaitFlags(),
+				1, &timeline,	// semaphoreCount + pSemaphores
+				&value			// pValues
+			),
+			uint64_t(4e9)  // timeout
+		);
+	if (result != vk::Result::eSuccess) {
+		if (result == vk::Result::eTimeout)
+			throw runtime_error("Task on GPU timeout.");
+		throw runtime_error("waitSemaphores() failed with error " + to_string(result) + ".");
+	}
 }
 
 /*
@@ -350,7 +493,8 @@ vk::Format HdaInstanceGpu::findFormat(vk::ImageTiling tiling) {
 
 /*
 *
-* Method for initializing render pass - Vulkan object.
+* Method for initializing render pass - Vulkan object. The scene is drawn into HDR
+* color, which is read by the bloom chain and tone mapped into the swapchain image.
 *
 */
 void HdaInstanceGpu::renderpassInit() {
@@ -365,14 +509,14 @@ void HdaInstanceGpu::renderpassInit() {
 				array{  // pAttachments
 					vk::AttachmentDescription(
 						vk::AttachmentDescriptionFlags(),  // flags
-						surfaceFormat.format,              // format
+						SCENE_COLOR_FORMAT,                // format
 						vk::SampleCountFlagBits::e1,       // samples
 						vk::AttachmentLoadOp::eClear,      // loadOp
 						vk::AttachmentStoreOp::eStore,     // storeOp
 						vk::AttachmentLoadOp::eDontCare,   // stencilLoadOp
 						vk::AttachmentStoreOp::eDontCare,  // stencilStoreOp
 						vk::ImageLayout::eUndefined,       // initialLayout
-						vk::ImageLayout::ePresentSrcKHR    // finalLayout
+						vk::ImageLayout::eShaderReadOnlyOptimal  // finalLayout
 					),
 					vk::AttachmentDescription(
 						vk::AttachmentDescriptionFlags(),  // flags
@@ -411,21 +555,389 @@ void HdaInstanceGpu::renderpassInit() {
 						nullptr   // pPreserveAttachments
 					),
 				}.data(),
-				1,      // dependencyCount
+				2,      // dependencyCount
 				array{  // pDependencies
+					// scene color was read by bloom and tone mapping of the previous frame
 					vk::SubpassDependency(
 						VK_SUBPASS_EXTERNAL,   // srcSubpass
 						0,                     // dstSubpass
-						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests |
+											   vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader),  // srcStageMask
 						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests),  // dstStageMask
 						vk::AccessFlags(),     // srcAccessMask
 						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite | // vk::AccessFlagBits::eColorAttachmentRead | 
 										vk::AccessFlagBits::eDepthStencilAttachmentWrite),  // dstAccessMask
 						vk::DependencyFlags()  // dependencyFlags
 					),
+					// scene color is sampled by bloom_down.comp and tonemap.frag
+					vk::SubpassDependency(
+						0,                     // srcSubpass
+						VK_SUBPASS_EXTERNAL,   // dstSubpass
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader),  // dstStageMask
+						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite),  // srcAccessMask
+						vk::AccessFlags(vk::AccessFlagBits::eShaderRead),  // dstAccessMask
+						vk::DependencyFlags()  // dependencyFlags
+					),
 				}.data()
 			)
 		);
 
 	cout << "renderpassInit(): Renderpass is created.\n";
+}
+
+
+/*
+*
+* Method for initializing render passes of two phase occlusion culling. The early pass keeps
+* color and depth, so depth pyramid can be built from depth before the late pass continues
+* drawing into the same attachments. Both passes are compatible with the main render pass,
+* so the same pipelines and the scene framebuffer are used.
+*
+*/
+void HdaInstanceGpu::occlusionRenderpassInit() {
+
+	earlyRenderpass = createRenderpass(vk::AttachmentLoadOp::eClear, vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal,
+									   vk::AttachmentStoreOp::eStore, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal);
+	lateRenderpass = createRenderpass(vk::AttachmentLoadOp::eLoad, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+									  vk::AttachmentStoreOp::eDontCare, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eDepthStencilAttachmentOptimal);
+
+	cout << "occlusionRenderpassInit(): Renderpasses are created.\n";
+}
+
+
+/*
+*
+* Method for initializing the render pass of deferred shading. The geometry subpass writes
+* G-buffer and depth, the lighting subpass reads them as input attachments at the same pixel
+* and draws into the HDR scene color with depth read only, so the skybox is depth tested
+* against the scene. G-buffer and depth are not stored, tile-based GPUs keep them in tile
+* memory and the G-buffer attachments are transient.
+*
+*/
+void HdaInstanceGpu::deferredRenderpassInit() {
+
+	vk::Format depthFormat = findFormat(vk::ImageTiling::eOptimal);
+
+	gbufferRenderpass =
+		device.createRenderPass(
+			vk::RenderPassCreateInfo(
+				vk::RenderPassCreateFlags(),  // flags
+				4,      // attachmentCount
+				array{  // pAttachments
+					vk::AttachmentDescription(
+						vk::AttachmentDescriptionFlags(),  // flags
+						GBUFFER_ALBEDO_FORMAT,             // format
+						vk::SampleCountFlagBits::e1,       // samples
+						vk::AttachmentLoadOp::eClear,      // loadOp
+						vk::AttachmentStoreOp::eDontCare,  // storeOp, read only by the lighting subpass
+						vk::AttachmentLoadOp::eDontCare,   // stencilLoadOp
+						vk::AttachmentStoreOp::eDontCare,  // stencilStoreOp
+						vk::ImageLayout::eUndefined,       // initialLayout
+						vk::ImageLayout::eShaderReadOnlyOptimal  // finalLayout
+					),
+					vk::AttachmentDescription(
+						vk::AttachmentDescriptionFlags(),  // flags
+						GBUFFER_NORMAL_FORMAT,             // format
+						vk::SampleCountFlagBits::e1,       // samples
+						vk::AttachmentLoadOp::eClear,      // loadOp
+						vk::AttachmentStoreOp::eDontCare,  // storeOp
+						vk::AttachmentLoadOp::eDontCare,   // stencilLoadOp
+						vk::AttachmentStoreOp::eDontCare,  // stencilStoreOp
+						vk::ImageLayout::eUndefined,       // initialLayout
+						vk::ImageLayout::eShaderReadOnlyOptimal  // finalLayout
+					),
+					vk::AttachmentDescription(
+						vk::AttachmentDescriptionFlags(),  // flags
+						depthFormat,                       // format
+						vk::SampleCountFlagBits::e1,       // samples
+						vk::AttachmentLoadOp::eClear,      // loadOp
+						vk::AttachmentStoreOp::eDontCare,  // storeOp, the depth pyramid is built only by the forward path
+						vk::AttachmentLoadOp::eDontCare,   // stencilLoadOp
+						vk::AttachmentStoreOp::eDontCare,  // stencilStoreOp
+						vk::ImageLayout::eUndefined,       // initialLayout
+						vk::ImageLayout::eDepthStencilReadOnlyOptimal  // finalLayout
+					),
+					vk::AttachmentDescription(
+						vk::AttachmentDescriptionFlags(),  // flags
+						SCENE_COLOR_FORMAT,                // format
+						vk::SampleCountFlagBits::e1,       // samples
+						vk::AttachmentLoadOp::eDontCare,   // loadOp, every pixel is written by the lighting subpass
+						vk::AttachmentStoreOp::eStore,     // storeOp
+						vk::AttachmentLoadOp::eDontCare,   // stencilLoadOp
+						vk::AttachmentStoreOp::eDontCare,  // stencilStoreOp
+						vk::ImageLayout::eUndefined,       // initialLayout
+						vk::ImageLayout::eShaderReadOnlyOptimal  // finalLayout
+					),
+				}.data(),
+				2,      // subpassCount
+				array{  // pSubpasses
+					vk::SubpassDescription(
+						vk::SubpassDescriptionFlags(),     // flags
+						vk::PipelineBindPoint::eGraphics,  // pipelineBindPoint
+						0,        // inputAttachmentCount
+						nullptr,  // pInputAttachments
+						2,        // colorAttachmentCount
+						array{    // pColorAttachments
+							vk::AttachmentReference(
+								0,  // attachment
+								vk::ImageLayout::eColorAttachmentOptimal  // layout
+							),
+							vk::AttachmentReference(
+								1,  // attachment
+								vk::ImageLayout::eColorAttachmentOptimal  // layout
+							),
+						}.data(),
+						nullptr,  // pResolveAttachments
+						array{
+							vk::AttachmentReference(
+								2,  // attachment
+								vk::ImageLayout::eDepthStencilAttachmentOptimal  // layout
+							),
+						}.data(),  // pDepthStencilAttachment
+						0,        // preserveAttachmentCount
+						nullptr   // pPreserveAttachments
+					),
+					vk::SubpassDescription(
+						vk::SubpassDescriptionFlags(),     // flags
+						vk::PipelineBindPoint::eGraphics,  // pipelineBindPoint
+						3,        // inputAttachmentCount
+						array{    // pInputAttachments
+							vk::AttachmentReference(
+								0,  // attachment
+								vk::ImageLayout::eShaderReadOnlyOptimal  // layout
+							),
+							vk::AttachmentReference(
+								1,  // attachment
+								vk::ImageLayout::eShaderReadOnlyOptimal  // layout
+							),
+							vk::AttachmentReference(
+								2,  // attachment
+								vk::ImageLayout::eDepthStencilReadOnlyOptimal  // layout
+							),
+						}.data(),
+						1,        // colorAttachmentCount
+						array{    // pColorAttachments
+							vk::AttachmentReference(
+								3,  // attachment
+								vk::ImageLayout::eColorAttachmentOptimal  // layout
+							),
+						}.data(),
+						nullptr,  // pResolveAttachments
+						array{
+							vk::AttachmentReference(
+								2,  // attachment
+								vk::ImageLayout::eDepthStencilReadOnlyOptimal  // layout
+							),
+						}.data(),  // pDepthStencilAttachment
+						0,        // preserveAttachmentCount
+						nullptr   // pPreserveAttachments
+					),
+				}.data(),
+				4,      // dependencyCount
+				array{  // pDependencies
+					// depth was read by the previous frame, G-buffer shares memory with bloom and local grids written by compute shaders
+					vk::SubpassDependency(
+						VK_SUBPASS_EXTERNAL,   // srcSubpass
+						0,                     // dstSubpass
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eColorAttachmentOutput |
+											   vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eComputeShader),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests),  // dstStageMask
+						vk::AccessFlags(vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eShaderWrite),  // srcAccessMask
+						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentRead |
+										vk::AccessFlagBits::eDepthStencilAttachmentWrite),  // dstAccessMask
+						vk::DependencyFlags()  // dependencyFlags
+					),
+					// scene color was read by bloom and tone mapping of the previous frame
+					vk::SubpassDependency(
+						VK_SUBPASS_EXTERNAL,   // srcSubpass
+						1,                     // dstSubpass
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eFragmentShader |
+											   vk::PipelineStageFlagBits::eComputeShader),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput),  // dstStageMask
+						vk::AccessFlags(),     // srcAccessMask
+						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite),  // dstAccessMask
+						vk::DependencyFlags()  // dependencyFlags
+					),
+					// G-buffer and depth are read by deferred.frag at the pixel which wrote them
+					vk::SubpassDependency(
+						0,                     // srcSubpass
+						1,                     // dstSubpass
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eEarlyFragmentTests),  // dstStageMask
+						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite),  // srcAccessMask
+						vk::AccessFlags(vk::AccessFlagBits::eInputAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentRead),  // dstAccessMask
+						vk::DependencyFlags(vk::DependencyFlagBits::eByRegion)  // dependencyFlags
+					),
+					// scene color is sampled by bloom_down.comp and tonemap.frag
+					vk::SubpassDependency(
+						1,                     // srcSubpass
+						VK_SUBPASS_EXTERNAL,   // dstSubpass
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader),  // dstStageMask
+						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite),  // srcAccessMask
+						vk::AccessFlags(vk::AccessFlagBits::eShaderRead),  // dstAccessMask
+						vk::DependencyFlags()  // dependencyFlags
+					),
+				}.data()
+			)
+		);
+
+	cout << "deferredRenderpassInit(): Renderpass is created.\n";
+}
+
+
+/*
+*
+* Method for initializing render pass of tone mapping. The full screen pass reads
+* the HDR scene color and bloom and writes every pixel of the swapchain image,
+* so the previous content is not loaded and no depth is needed.
+*
+*/
+void HdaInstanceGpu::tonemapRenderpassInit() {
+
+	tonemapRenderpass =
+		device.createRenderPass(
+			vk::RenderPassCreateInfo(
+				vk::RenderPassCreateFlags(),  // flags
+				1,      // attachmentCount
+				array{  // pAttachments
+					vk::AttachmentDescription(
+						vk::AttachmentDescriptionFlags(),  // flags
+						surfaceFormat.format,              // format
+						vk::SampleCountFlagBits::e1,       // samples
+						vk::AttachmentLoadOp::eDontCare,   // loadOp
+						vk::AttachmentStoreOp::eStore,     // storeOp
+						vk::AttachmentLoadOp::eDontCare,   // stencilLoadOp
+						vk::AttachmentStoreOp::eDontCare,  // stencilStoreOp
+						vk::ImageLayout::eUndefined,       // initialLayout
+						vk::ImageLayout::ePresentSrcKHR    // finalLayout
+					),
+				}.data(),
+				1,      // subpassCount
+				array{  // pSubpasses
+					vk::SubpassDescription(
+						vk::SubpassDescriptionFlags(),     // flags
+						vk::PipelineBindPoint::eGraphics,  // pipelineBindPoint
+						0,        // inputAttachmentCount
+						nullptr,  // pInputAttachments
+						1,        // colorAttachmentCount
+						array{    // pColorAttachments
+							vk::AttachmentReference(
+								0,  // attachment
+								vk::ImageLayout::eColorAttachmentOptimal  // layout
+							),
+						}.data(),
+						nullptr,  // pResolveAttachments
+						nullptr,  // pDepthStencilAttachment
+						0,        // preserveAttachmentCount
+						nullptr   // pPreserveAttachments
+					),
+				}.data(),
+				1,      // dependencyCount
+				array{  // pDependencies
+					// the swapchain image is acquired at color attachment output
+					vk::SubpassDependency(
+						VK_SUBPASS_EXTERNAL,   // srcSubpass
+						0,                     // dstSubpass
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput),  // dstStageMask
+						vk::AccessFlags(),     // srcAccessMask
+						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite),  // dstAccessMask
+						vk::DependencyFlags()  // dependencyFlags
+					),
+				}.data()
+			)
+		);
+
+	cout << "tonemapRenderpassInit(): Renderpass is created.\n";
+}
+
+
+vk::RenderPass HdaInstanceGpu::createRenderpass(vk::AttachmentLoadOp loadOp, vk::ImageLayout colorInitial, vk::ImageLayout colorFinal,
+												vk::AttachmentStoreOp depthStoreOp, vk::ImageLayout depthInitial, vk::ImageLayout depthFinal) {
+
+	vk::RenderPass rp =
+		device.createRenderPass(
+			vk::RenderPassCreateInfo(
+				vk::RenderPassCreateFlags(),  // flags
+				2,      // attachmentCount
+				array{  // pAttachments
+					vk::AttachmentDescription(
+						vk::AttachmentDescriptionFlags(),  // flags
+						SCENE_COLOR_FORMAT,                // format
+						vk::SampleCountFlagBits::e1,       // samples
+						loadOp,                            // loadOp
+						vk::AttachmentStoreOp::eStore,     // storeOp
+						vk::AttachmentLoadOp::eDontCare,   // stencilLoadOp
+						vk::AttachmentStoreOp::eDontCare,  // stencilStoreOp
+						colorInitial,                      // initialLayout
+						colorFinal                         // finalLayout
+					),
+					vk::AttachmentDescription(
+						vk::AttachmentDescriptionFlags(),  // flags
+						findFormat(vk::ImageTiling::eOptimal),              // format
+						vk::SampleCountFlagBits::e1,       // samples
+						loadOp,                            // loadOp
+						depthStoreOp,                      // storeOp
+						vk::AttachmentLoadOp::eDontCare,   // stencilLoadOp
+						vk::AttachmentStoreOp::eDontCare,  // stencilStoreOp
+						depthInitial,                      // initialLayout
+						depthFinal                         // finalLayout
+					),
+				}.data(),
+				1,      // subpassCount
+				array{  // pSubpasses
+					vk::SubpassDescription(
+						vk::SubpassDescriptionFlags(),     // flags
+						vk::PipelineBindPoint::eGraphics,  // pipelineBindPoint
+						0,        // inputAttachmentCount
+						nullptr,  // pInputAttachments
+						1,        // colorAttachmentCount
+						array{    // pColorAttachments
+							vk::AttachmentReference(
+								0,  // attachment
+								vk::ImageLayout::eColorAttachmentOptimal  // layout
+							),
+						}.data(),
+						nullptr,  // pResolveAttachments
+						array{
+							vk::AttachmentReference(
+								1,  // attachment
+								vk::ImageLayout::eDepthStencilAttachmentOptimal  // layout
+							),
+						}.data(),  // pDepthStencilAttachment
+						0,        // preserveAttachmentCount
+						nullptr   // pPreserveAttachments
+					),
+				}.data(),
+				2,      // dependencyCount
+				array{  // pDependencies
+					// attachments of the previous pass, depth reads of depth_pyramid.comp and scene color reads of the previous frame
+					vk::SubpassDependency(
+						VK_SUBPASS_EXTERNAL,   // srcSubpass
+						0,                     // dstSubpass
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests |
+											   vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests),  // dstStageMask
+						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite),  // srcAccessMask
+						vk::AccessFlags(vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite |
+										vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite),  // dstAccessMask
+						vk::DependencyFlags()  // dependencyFlags
+					),
+					// depth is sampled by depth_pyramid.comp after the early pass, scene color by bloom and tone mapping after the late pass
+					vk::SubpassDependency(
+						0,                     // srcSubpass
+						VK_SUBPASS_EXTERNAL,   // dstSubpass
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eLateFragmentTests | vk::PipelineStageFlagBits::eColorAttachmentOutput),  // srcStageMask
+						vk::PipelineStageFlags(vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eFragmentShader),  // dstStageMask
+						vk::AccessFlags(vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eColorAttachmentWrite),  // srcAccessMask
+						vk::AccessFlags(vk::AccessFlagBits::eShaderRead),  // dstAccessMask
+						vk::DependencyFlags()  // dependencyFlags
+					),
+				}.data()
+			)
+		);
+
+	return rp;
 }
\ No newline at end of file
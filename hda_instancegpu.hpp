@@ -1,6 +1,8 @@
 #pragma once
 #include "hda_window.hpp"
 #include "hda_model.hpp"
+#include "hda_deferred.hpp"
+#include "hda_bloom.hpp"
 
 
 /*
@@ -29,12 +31,36 @@ public:
 
 	inline uint32_t getGraphicsQueueFamily() { return graphicsQueueFamily; }
 	inline uint32_t getPresentQueueFamily() { return presentationQueueFamily; }
+	inline uint32_t getComputeQueueFamily() { return computeQueueFamily; }
 
 	inline vk::Format getFindFormatFunc(vk::ImageTiling t) { return findFormat(t); }
 	inline vk::RenderPass getRenderpass() { return renderpass;  }
+	inline vk::RenderPass getEarlyRenderpass() { return earlyRenderpass; }
+	inline vk::RenderPass getLateRenderpass() { return lateRenderpass; }
+	inline vk::RenderPass getGbufferRenderpass() { return gbufferRenderpass; }
+	inline vk::RenderPass getTonemapRenderpass() { return tonemapRenderpass; }
 
 	inline vk::Queue getGraphicsQueue() { return graphicsQueue; }
 	inline vk::Queue getPresentationQueue() { return presentationQueue; }
+	inline vk::Queue getComputeQueue() { return computeQueue; }
+
+	inline bool getMeshShaderSupport() { return meshShaderSupport; }
+	inline bool getPipelineStatisticsSupport() { return pipelineStatisticsSupport; }
+	inline bool getInheritedQueriesSupport() { return inheritedQueriesSupport; }
+	inline bool getAsyncComputeSupport() { return computeQueueFamily != UINT32_MAX; }
+	inline bool getTimestampSupport() { return timestampSupport; }
+	inline uint32_t getGraphicsTimestampBits() { return graphicsTimestampBits; }
+	inline uint32_t getComputeTimestampBits() { return computeTimestampBits; }	// 0 - the compute family writes no timestamps
+	inline bool getFloat16Support() { return float16Support; }
+	inline PFN_vkCmdPipelineBarrier2KHR getPipelineBarrier2() { return pipelineBarrier2; }	// nullptr without synchronization2
+
+	// every submission to the graphics queue signals the next value of one timeline semaphore,
+	// the compute queue has its own timeline, so the values of both stay increasing in order of execution
+	inline vk::Semaphore getTimeline() { return timeline; }
+	inline uint64_t nextTimelineValue() { return ++timelineValue; }
+	inline vk::Semaphore getComputeTimeline() { return computeTimeline; }
+	inline uint64_t nextComputeTimelineValue() { return ++computeTimelineValue; }
+	void waitTimeline(uint64_t);
 
 
 private:
@@ -43,11 +69,17 @@ private:
 	void instanceInit();
 	void findPhysDevice();
 	bool isSuitable(vk::PhysicalDevice physdev);
+	void findComputeFamily();
 	void deviceInit();
+	void timelineInit();
 	void createWinSurface();
 	void checkExtensionSupport(const char **, uint32_t);
 	vk::Format findFormat(vk::ImageTiling);
 	void renderpassInit();
+	void occlusionRenderpassInit();
+	void deferredRenderpassInit();
+	void tonemapRenderpassInit();
+	vk::RenderPass createRenderpass(vk::AttachmentLoadOp, vk::ImageLayout, vk::ImageLayout, vk::AttachmentStoreOp, vk::ImageLayout, vk::ImageLayout);
 
 	int eCh = 0;
 	
@@ -55,6 +87,10 @@ private:
 	vk::SurfaceKHR winSurface;
 
 	vk::RenderPass renderpass;
+	vk::RenderPass earlyRenderpass;		// two phase occlusion culling
+	vk::RenderPass lateRenderpass;
+	vk::RenderPass gbufferRenderpass;	// deferred shading, geometry and lighting subpasses
+	vk::RenderPass tonemapRenderpass;	// the only pass which writes the swapchain image
 
 	vk::Instance instance;
 	vk::Device device;
@@ -62,9 +98,26 @@ private:
 	vk::PhysicalDevice physDevice;
 	uint32_t graphicsQueueFamily = UINT32_MAX;
 	uint32_t presentationQueueFamily = UINT32_MAX;
+	uint32_t computeQueueFamily = UINT32_MAX;		// family without graphics, UINT32_MAX if there is none
 	vk::Queue graphicsQueue;
 	vk::Queue presentationQueue;
+	vk::Queue computeQueue;
+
+	vk::Semaphore timeline;
+	uint64_t timelineValue = 0;		// the last value given to a submission
+	vk::Semaphore computeTimeline;
+	uint64_t computeTimelineValue = 0;
 
 	vk::SurfaceFormatKHR surfaceFormat;
+
+	bool meshShaderSupport = false;
+	bool pipelineStatisticsSupport = false;
+	bool inheritedQueriesSupport = false;
+	bool timestampSupport = false;
+	uint32_t graphicsTimestampBits = 0;		// timestampValidBits of the queue families
+	uint32_t computeTimestampBits = 0;
+	bool float16Support = false;
+	bool synchronization2Support = false;
+	PFN_vkCmdPipelineBarrier2KHR pipelineBarrier2 = nullptr;
 };
 
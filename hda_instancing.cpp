@@ -0,0 +1,150 @@
+#include "hda_instancing.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+
+// mesh vertices per vertex, instance data per instance
+std::array<vk::VertexInputBindingDescription, 2> HdaInstancing::getBindingDescriptions() {
+
+	return {
+		HdaModel::Vertex::getBindingDescription(),
+		vk::VertexInputBindingDescription{ 1,	// second buffer with instance data
+			sizeof(HdaModel::InstanceData),		// the step to move to the next instance
+			vk::VertexInputRate::eInstance		// per instance
+		}
+	};
+}
+
+
+// attributes of Vertex followed by columns of model matrix and tint
+std::array<vk::VertexInputAttributeDescription, 9> HdaInstancing::getAttributeDescriptions() {
+
+	std::array<vk::VertexInputAttributeDescription, 9> attributeDescription;
+	std::array<vk::VertexInputAttributeDescription, 4> vertexAttributes = HdaModel::Vertex::getAttributeDescription();
+	std::copy(vertexAttributes.begin(), vertexAttributes.end(), attributeDescription.begin());
+
+	for (uint32_t i = 0; i < 5; i++) {
+
+		attributeDescription[4 + i].binding = 1;
+		attributeDescription[4 + i].location = INSTANCE_ATTRIBUTE_LOCATION + i;
+		attributeDescription[4 + i].format = vk::Format::eR32G32B32A32Sfloat;
+		attributeDescription[4 + i].offset = static_cast<uint32_t>(i < 4 ? offsetof(HdaModel::InstanceData, model) + sizeof(glm::vec4) * i : offsetof(HdaModel::InstanceData, tint));
+	}
+
+	return attributeDescription;
+}
+
+
+/**
+*	@brief Create instances of the benchmark scene.
+*
+*	The first instance has no transform and no tint, so one instance looks the same
+*	as the object without instancing. The others fill a cube grid around it with
+*	random rotation around vertical axis and random tint, the generator has fixed seed.
+*
+*/
+std::vector<HdaModel::InstanceData> HdaInstancing::createBenchmarkInstances(uint32_t count, float spacing) {
+
+	std::vector<HdaModel::InstanceData> instances(count);
+	std::mt19937 generator(4321);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+	float half = static_cast<float>(side / 2);
+
+	for (uint32_t i = 1; i < count; i++) {
+
+		glm::vec3 cell{ static_cast<float>(i % side), static_cast<float>((i / side) % side), static_cast<float>(i / (side * side)) };
+		glm::mat4 model = glm::translate(glm::mat4{ 1.0f }, (cell - half) * spacing);
+		instances[i].model = glm::rotate(model, unit(generator) * glm::radians(360.0f), glm::vec3(0, 1, 0));
+		instances[i].tint = glm::vec4(0.4f + 0.6f * unit(generator), 0.4f + 0.6f * unit(generator), 0.4f + 0.6f * unit(generator), 1.0f);
+	}
+
+	return instances;
+}
+
+
+// center of bounding box and the furthest vertex from it
+glm::vec4 HdaInstancing::meshBoundingSphere(const HdaModel::Mesh& mesh) {
+
+	glm::vec3 minP{ FLT_MAX };
+	glm::vec3 maxP{ -FLT_MAX };
+	for (const auto& v : mesh.meshVertices) {
+		minP = glm::min(minP, v.position);
+		maxP = glm::max(maxP, v.position);
+	}
+
+	glm::vec3 center = (minP + maxP) * 0.5f;
+	float radius = 0.0f;
+	for (const auto& v : mesh.meshVertices)
+		radius = std::max(radius, glm::length(v.position - center));
+
+	return glm::vec4(center, radius);
+}
+
+
+/**
+*	@brief Cull instances by frustum and sort the visible ones by level of detail.
+*
+*	The cull data are prepared for the view matrix, so the camera position is in world
+*	space. Bounding sphere of instance is tested against the frustum in the same way
+*	as meshlets are. Level of detail is selected by submesh lodInfo for the whole
+*	instance. Visible instances are written into visible by counting sort, lodFirst
+*	receives the first instance of every level. Returns the number of visible instances.
+*	The tests run on jobs when they are not nullptr, the order of instances is kept.
+*
+*/
+uint32_t HdaInstancing::cullInstances(const std::vector<HdaModel::InstanceData>& instances, const glm::mat4& objectModel, const glm::vec4& sphere,
+									  const HdaMeshlet::CullUniformData& data, const HdaModel::IndexInfo& lodInfo, float pixelScale,
+									  HdaModel::InstanceData* visible, std::array<uint32_t, MAX_LOD_LEVELS + 1>& lodFirst, HdaJobs* jobs) {
+
+	std::vector<uint8_t> instanceLod(instances.size());
+
+	auto cullRange = [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t i = begin; i < end; i++) {
+
+			glm::mat4 model = instances[i].model * objectModel;
+			float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+			// camera looks in the direction of -z
+			glm::vec3 center = glm::vec3(data.modelView * model * glm::vec4(glm::vec3(sphere), 1.0f));
+			float radius = sphere.w * scale;
+
+			bool inside = std::abs(center.x) * data.frustum.x + center.z * data.frustum.y < radius;
+			inside = inside && std::abs(center.y) * data.frustum.z + center.z * data.frustum.w < radius;
+			inside = inside && center.z - radius < -data.zNear;
+			inside = inside && center.z + radius > -data.zFar;
+
+			instanceLod[i] = inside ? static_cast<uint8_t>(HdaMeshLod::selectLod(lodInfo, model, glm::vec3(data.cameraPosition), pixelScale, LOD_PIXEL_ERROR)) : INSTANCE_CULLED;
+		}
+	};
+
+	if (jobs != nullptr)
+		jobs->parallelFor("cullInstances", static_cast<uint32_t>(instances.size()), INSTANCE_CULL_GRAIN, cullRange);
+	else
+		cullRange(0, static_cast<uint32_t>(instances.size()));
+
+	std::array<uint32_t, MAX_LOD_LEVELS> lodCnt{};
+	uint32_t visibleCnt = 0;
+	for (uint8_t lod : instanceLod)
+		if (lod != INSTANCE_CULLED) {
+			lodCnt[lod]++;
+			visibleCnt++;
+		}
+
+	lodFirst[0] = 0;
+	for (uint32_t l = 0; l < MAX_LOD_LEVELS; l++)
+		lodFirst[l + 1] = lodFirst[l] + lodCnt[l];
+
+	std::array<uint32_t, MAX_LOD_LEVELS> next{};
+	std::copy(lodFirst.begin(), lodFirst.begin() + MAX_LOD_LEVELS, next.begin());
+	for (size_t i = 0; i < instances.size(); i++)
+		if (instanceLod[i] != INSTANCE_CULLED)
+			visible[next[instanceLod[i]]++] = instances[i];
+
+	return visibleCnt;
+}
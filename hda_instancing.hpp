@@ -0,0 +1,34 @@
+#pragma once
+#include "hda_model.hpp"
+#include "hda_meshlet.hpp"
+#include "hda_meshlod.hpp"
+#include "hda_jobs.hpp"
+
+#define INSTANCES_MAX 100000
+#define INSTANCE_SPACING 12.0f			// distance of neighbouring instances of the benchmark grid
+#define INSTANCE_ATTRIBUTE_LOCATION 4	// model matrix takes locations 4 - 7, tint location 8
+#define INSTANCE_CULL_GRAIN 2048		// instances of one culling job
+#define INSTANCE_CULLED 0xFF			// level of detail of instance outside of frustum
+
+
+/*
+*
+* A class representing instancing of scene objects. An instanced object keeps one mesh
+* and a list of instances with their own transform and tint. Instances are culled by
+* frustum on CPU, sorted by level of detail and written into instance rate vertex buffer,
+* so every submesh is drawn with one call per used level of detail.
+*
+*/
+
+class HdaInstancing {
+
+public:
+
+	static std::array<vk::VertexInputBindingDescription, 2> getBindingDescriptions();
+	static std::array<vk::VertexInputAttributeDescription, 9> getAttributeDescriptions();
+
+	static std::vector<HdaModel::InstanceData> createBenchmarkInstances(uint32_t, float);
+	static glm::vec4 meshBoundingSphere(const HdaModel::Mesh&);
+	static uint32_t cullInstances(const std::vector<HdaModel::InstanceData>&, const glm::mat4&, const glm::vec4&, const HdaMeshlet::CullUniformData&,
+								  const HdaModel::IndexInfo&, float, HdaModel::InstanceData*, std::array<uint32_t, MAX_LOD_LEVELS + 1>&, HdaJobs*);
+};
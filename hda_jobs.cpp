@@ -0,0 +1,358 @@
+#include "hda_jobs.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+/*
+*
+* The scheduling follows the work-stealing of Blumofe and Leiserson
+* "Scheduling Multithreaded Computations by Work Stealing", the deques are locked
+* instead of lock-free, which is cheap enough for jobs of tens of microseconds.
+* Waiting by running other jobs is the counter model of Christian Gyrling
+* "Parallelizing the Naughty Dog Engine Using Fibers" without fibers.
+*
+*/
+
+
+// slot of the calling thread, workers of other job systems use the external deque
+static thread_local const HdaJobs* workerOwner = nullptr;
+static thread_local uint32_t workerSlot = JOB_SLOT_EXTERNAL;
+
+
+// the thread which creates the job system is its main thread
+HdaJobs::HdaJobs(uint32_t workerCnt) {
+
+	mainThread = std::this_thread::get_id();
+	startT = statsT = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t i = 0; i <= workerCnt; i++)
+		slots.push_back(std::make_unique<Slot>());
+	for (uint32_t i = 1; i <= workerCnt; i++)
+		workers.emplace_back(&HdaJobs::workerLoop, this, i);
+}
+
+
+// all counters have to be waited for before, queued jobs are not run
+HdaJobs::~HdaJobs() {
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stop = true;
+	}
+	sleepCondition.notify_all();
+
+	for (auto& w : workers)
+		w.join();
+}
+
+
+// the main thread takes part in waiting, so one worker less than hardware threads
+uint32_t HdaJobs::defaultWorkerCount() {
+
+	return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+}
+
+
+uint32_t HdaJobs::currentSlot() const {
+
+	return workerOwner == this ? workerSlot : JOB_SLOT_EXTERNAL;
+}
+
+
+/**
+*	@brief Queue job into the deque of calling thread.
+*
+*	The counter is incremented now and decremented when the job ends, also when it
+*	throws. The exception is kept in the counter and wait() rethrows it, exceptions
+*	of jobs without counter can only be reported.
+*
+*/
+void HdaJobs::run(const char* name, std::function<void()> func, Counter* counter) {
+
+	if (counter != nullptr)
+		counter->pending++;
+
+	// incremented before the job can be taken, so the decrement of a worker never comes first
+	queued++;
+	Slot& slot = *slots[currentSlot()];
+	{
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		slot.jobs.push_back(Job{ name, std::move(func), counter });
+	}
+
+	// the lock orders the notification after the check of sleeping worker
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_one();
+}
+
+
+// the waiting thread runs jobs of its deque or steals them, so it never blocks a worker,
+// the first exception of the jobs is rethrown after all of them ended
+void HdaJobs::wait(Counter& counter) {
+
+	uint32_t slot = currentSlot();
+
+	while (counter.pending.load() > 0)
+		if (!runOneJob(slot))
+			std::this_thread::yield();
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(counter.errorMutex);
+		error.swap(counter.error);
+	}
+	if (error)
+		std::rethrow_exception(error);
+}
+
+
+/**
+*	@brief Run func over ranges of [0, count) in parallel and wait for them.
+*
+*	Ranges have grain items, the grain is chosen from the number of slots when it is 0.
+*	The calling thread runs ranges too.
+*
+*/
+void HdaJobs::parallelFor(const char* name, uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& func) {
+
+	if (grain == 0)
+		grain = std::max(count / (static_cast<uint32_t>(slots.size()) * JOB_GRAIN_PER_SLOT), 1u);
+
+	// a single range does not need the deques
+	if (count <= grain) {
+		func(0, count);
+		return;
+	}
+
+	Counter counter;
+	for (uint32_t begin = 0; begin < count; begin += grain) {
+
+		uint32_t end = std::min(count, begin + grain);
+		run(name, [&func, begin, end]() { func(begin, end); }, &counter);
+	}
+
+	wait(counter);
+}
+
+
+// GLFW and other main thread work, run immediately when called from the main thread
+void HdaJobs::runOnMainThread(std::function<void()> func) {
+
+	if (isMainThread()) {
+		func();
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mainMutex);
+	mainJobs.push_back(std::move(func));
+}
+
+
+// called by the main loop once per frame
+void HdaJobs::processMainThreadJobs() {
+
+	std::vector<std::function<void()>> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mainMutex);
+		jobs.swap(mainJobs);
+	}
+
+	for (auto& j : jobs)
+		j();
+}
+
+
+// the own deque is LIFO for cache locality, stealing takes the oldest job of the next slots
+bool HdaJobs::runOneJob(uint32_t slot) {
+
+	Job job;
+	bool found = false;
+
+	{
+		Slot& own = *slots[slot];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty()) {
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			found = true;
+		}
+	}
+
+	for (uint32_t i = 1; !found && i < slots.size(); i++) {
+
+		Slot& victim = *slots[(slot + i) % slots.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			slots[slot]->stealCnt++;
+			found = true;
+		}
+	}
+
+	if (!found)
+		return false;
+
+	queued--;
+	execute(job, slot);
+
+	return true;
+}
+
+
+void HdaJobs::execute(Job& job, uint32_t slot) {
+
+	auto jobStartT = std::chrono::high_resolution_clock::now();
+
+	try {
+		job.func();
+	}
+	catch (...) {
+
+		if (job.counter != nullptr) {
+			std::lock_guard<std::mutex> lock(job.counter->errorMutex);
+			if (!job.counter->error)
+				job.counter->error = std::current_exception();
+		}
+		else
+			std::cout << "execute(): Job " << job.name << " without counter failed.\n";
+	}
+
+	auto jobEndT = std::chrono::high_resolution_clock::now();
+	slots[slot]->busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(jobEndT - jobStartT).count();
+	slots[slot]->jobCnt++;
+
+	if (traceHook)
+		traceHook(slot, job.name, std::chrono::duration<double, std::milli>(jobStartT - startT).count(), std::chrono::duration<double, std::milli>(jobEndT - startT).count());
+
+	if (job.counter != nullptr)
+		job.counter->pending--;
+}
+
+
+void HdaJobs::workerLoop(uint32_t slot) {
+
+	workerOwner = this;
+	workerSlot = slot;
+
+	while (!stop) {
+
+		if (runOneJob(slot))
+			continue;
+
+		// sleep until a job is queued, spinning workers would slow down the main thread
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait(lock, [this] { return queued > 0 || stop; });
+	}
+}
+
+
+/**
+*	@brief Print jobs, steals and busy time of every slot.
+*
+*	The utilization is the busy time of slot divided by the time since the last call,
+*	the statistics are reset afterwards.
+*
+*/
+void HdaJobs::printUtilization() {
+
+	auto nowT = std::chrono::high_resolution_clock::now();
+	double wallMs = std::chrono::duration<double, std::milli>(nowT - statsT).count();
+	statsT = nowT;
+
+	std::cout << "printUtilization(): " << workers.size() << " workers, " << wallMs << " ms\n";
+	for (uint32_t i = 0; i < slots.size(); i++) {
+
+		double busyMs = slots[i]->busyNs.exchange(0) / 1e6;
+		std::cout << "  " << (i == JOB_SLOT_EXTERNAL ? std::string("main") : "worker " + std::to_string(i)) << " | jobs: " << slots[i]->jobCnt.exchange(0)
+			<< " | steals: " << slots[i]->stealCnt.exchange(0) << " | busy: " << busyMs << " ms (" << 100.0 * busyMs / std::max(wallMs, 1e-6) << " %)\n";
+	}
+}
+
+
+/**
+*	@brief CPU benchmark of job system.
+*
+*	Spawn overhead is measured with empty jobs, fan-out/fan-in with a root job spawning
+*	and waiting for 64 children, and scaling of parallelFor() with 0 to all workers.
+*	Every measurement takes the best of 5 runs.
+*
+*/
+void HdaJobs::benchmark() {
+
+	const int runs = 5;
+	const uint32_t spawnCnt = 100000, fanCnt = 1000, fanWidth = 64, itemCnt = 1 << 18;
+	auto ms = [](std::chrono::high_resolution_clock::time_point startT) {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startT).count();
+	};
+
+	{
+		HdaJobs jobs(defaultWorkerCount());
+		double spawnT = 1e9, fanT = 1e9;
+
+		for (int r = 0; r < runs; r++) {
+
+			Counter counter;
+			auto startT = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < spawnCnt; i++)
+				jobs.run("empty", []() {}, &counter);
+			jobs.wait(counter);
+			spawnT = std::min(spawnT, ms(startT));
+
+			startT = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < fanCnt; i++) {
+
+				Counter root;
+				jobs.run("root", [&jobs]() {
+					Counter children;
+					for (uint32_t c = 0; c < fanWidth; c++)
+						jobs.run("child", []() {}, &children);
+					jobs.wait(children);
+				}, &root);
+				jobs.wait(root);
+			}
+			fanT = std::min(fanT, ms(startT));
+		}
+
+		std::cout << "\nbenchmark(): " << jobs.getWorkerCount() << " workers | spawn and run: " << spawnT * 1e6 / spawnCnt << " ns per job"
+			<< " | fan-out/fan-in of " << fanWidth << " jobs: " << fanT * 1e3 / fanCnt << " us\n";
+	}
+
+	// every item does a few hundred flops, so the scaling is not limited by memory
+	std::vector<float> items(itemCnt);
+	auto work = [&items](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			float x = static_cast<float>(i) * 1e-6f;
+			for (int k = 0; k < 16; k++)
+				x = std::sin(x) * 0.5f + std::sqrt(x + 1.0f);
+			items[i] = x;
+		}
+	};
+
+	std::cout << "benchmark(): workers | parallelFor of " << itemCnt << " items ms | speedup\n";
+
+	std::vector<uint32_t> workerCounts = { 0 };
+	for (uint32_t w = 1; w < defaultWorkerCount(); w *= 2)
+		workerCounts.push_back(w);
+	workerCounts.push_back(defaultWorkerCount());
+
+	double serialT = 0.0;
+	for (uint32_t w : workerCounts) {
+
+		HdaJobs jobs(w);
+		double forT = 1e9;
+		for (int r = 0; r < runs; r++) {
+
+			auto startT = std::chrono::high_resolution_clock::now();
+			jobs.parallelFor("benchmark", itemCnt, 0, work);
+			forT = std::min(forT, ms(startT));
+		}
+		if (w == 0)
+			serialT = forT;
+
+		std::cout << "  " << w << " | " << forT << " | " << serialT / forT << "\n";
+	}
+}
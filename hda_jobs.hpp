@@ -0,0 +1,101 @@
+#pragma once
+#include "hda_model.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#define JOB_SLOT_EXTERNAL 0			// deque of the main thread and other threads which are not workers
+#define JOB_GRAIN_PER_SLOT 4		// parallelFor() makes this many jobs per slot when grain is 0
+
+
+/*
+*
+* A class representing the work-stealing job system. Every worker has its own deque,
+* it pushes and pops its jobs at the back and steals the oldest jobs from the front
+* of other deques when its own is empty. Threads which are not workers share one deque.
+* Jobs signal counters, a thread waiting for a counter runs other jobs meanwhile, so
+* jobs can wait for jobs they spawned. GLFW can be called only from the main thread,
+* such work is queued by runOnMainThread() and run by the main loop.
+*
+*/
+
+class HdaJobs {
+
+public:
+
+	// number of jobs which did not finish yet, one counter can be signaled by many jobs
+	struct Counter {
+
+		std::atomic<uint32_t> pending{ 0 };
+		std::mutex errorMutex;
+		std::exception_ptr error;		// the first exception of the jobs, rethrown by wait()
+	};
+
+	// called after every job with slot, job name and start and end in ms since creation of job system
+	using TraceHook = std::function<void(uint32_t, const char*, double, double)>;
+
+	HdaJobs(uint32_t);
+	~HdaJobs();
+
+	void run(const char*, std::function<void()>, Counter*);
+	void wait(Counter&);
+	void parallelFor(const char*, uint32_t, uint32_t, const std::function<void(uint32_t, uint32_t)>&);
+
+	void runOnMainThread(std::function<void()>);
+	void processMainThreadJobs();
+	bool isMainThread() const { return std::this_thread::get_id() == mainThread; }
+
+	uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+	uint32_t getSlotCount() const { return static_cast<uint32_t>(slots.size()); }
+	uint32_t getCurrentSlot() const { return currentSlot(); }		// per-thread resources are indexed by slot
+	void setTraceHook(TraceHook hook) { traceHook = hook; }		// only while no job runs
+	void printUtilization();
+
+	static uint32_t defaultWorkerCount();
+	static void benchmark();
+
+private:
+
+	struct Job {
+
+		const char* name = "";
+		std::function<void()> func;
+		Counter* counter = nullptr;
+	};
+
+	// deque of one thread with its statistics since the last printUtilization()
+	struct Slot {
+
+		std::mutex mutex;
+		std::deque<Job> jobs;
+		std::atomic<uint64_t> jobCnt{ 0 };
+		std::atomic<uint64_t> stealCnt{ 0 };
+		std::atomic<uint64_t> busyNs{ 0 };
+	};
+
+	std::vector<std::unique_ptr<Slot>> slots;	// JOB_SLOT_EXTERNAL followed by workers
+	std::vector<std::thread> workers;
+	std::atomic<uint32_t> queued{ 0 };			// jobs in all deques
+	std::atomic<bool> stop{ false };
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+
+	std::thread::id mainThread;
+	std::mutex mainMutex;
+	std::vector<std::function<void()>> mainJobs;
+
+	TraceHook traceHook;
+	std::chrono::high_resolution_clock::time_point startT;
+	std::chrono::high_resolution_clock::time_point statsT;
+
+	uint32_t currentSlot() const;
+	bool runOneJob(uint32_t);
+	void execute(Job&, uint32_t);
+	void workerLoop(uint32_t);
+};
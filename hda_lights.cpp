@@ -0,0 +1,202 @@
+#include "hda_lights.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+
+/*
+*
+* Clustered shading follows Olsson, Billeter and Assarsson
+* "Clustered Deferred and Forward Shading":
+* https://www.cse.chalmers.se/~uffe/clustered_shading_preprint.pdf
+*
+* and the exponential depth slices are the ones from Doom 2016 talk by Tiago Sousa
+* and Jean Geffroy "The devil is in the details: idTech 666".
+*
+*/
+
+
+/**
+*	@brief The two spotlights of the demo scene.
+*
+*	The range is the far plane of camera, so the windowed falloff does not change
+*	their lighting and they are assigned to every cluster.
+*
+*/
+std::vector<HdaLights::Light> HdaLights::sceneLights(float cutOff, float outerCutOff) {
+
+	std::vector<Light> lights(2);
+
+	lights[0].position = glm::vec4(-15.0f, 25.0f, 0.0f, CAMERA_FAR);
+	lights[0].direction = glm::vec4(15.0f, 0.0f, 0.0f, LIGHT_TYPE_SPOT);
+	lights[1].position = glm::vec4(-25.0f, 25.0f, 0.0f, CAMERA_FAR);
+	lights[1].direction = glm::vec4(-15.0f, 0.0f, 0.0f, LIGHT_TYPE_SPOT);
+
+	for (auto& l : lights)
+		l.params = glm::vec4(cutOff, outerCutOff, 0.0f, 0.0f);
+
+	return lights;
+}
+
+
+/**
+*	@brief Create point lights spread over the box.
+*
+*	The generator has fixed seed, so every run measures the same scene. The range
+*	of light is a tenth of the box diagonal.
+*
+*/
+std::vector<HdaLights::Light> HdaLights::createStressLights(uint32_t count, glm::vec3 minP, glm::vec3 maxP) {
+
+	std::vector<Light> lights(count);
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	float range = glm::length(maxP - minP) * 0.1f;
+
+	for (auto& l : lights) {
+
+		glm::vec3 p{ unit(generator), unit(generator), unit(generator) };
+		l.position = glm::vec4(minP + p * (maxP - minP), range);
+		l.direction = glm::vec4(0.0f, -1.0f, 0.0f, LIGHT_TYPE_POINT);
+
+		// saturated colors with low intensity, hundreds of lights overlap
+		glm::vec3 c{ unit(generator), unit(generator), unit(generator) };
+		c = c / std::max(std::max(c.x, c.y), std::max(c.z, 0.001f));
+		l.color = glm::vec4(c * 0.1f, 1.0f);
+	}
+
+	return lights;
+}
+
+
+// point lights rotate around vertical axis going through center, spotlights do not move
+void HdaLights::animateLights(const std::vector<Light>& lights, float t, glm::vec3 center, std::vector<Light>& animated) {
+
+	animated.resize(lights.size());
+
+	for (size_t i = 0; i < lights.size(); i++) {
+
+		animated[i] = lights[i];
+		if (lights[i].direction.w != LIGHT_TYPE_POINT)
+			continue;
+
+		// every light has one of five speeds, odd lights go in the opposite direction
+		float angle = t * (0.1f + 0.05f * (i % 5)) * (i % 2 == 0 ? 1.0f : -1.0f);
+		float c = std::cos(angle), s = std::sin(angle);
+		glm::vec3 d = glm::vec3(lights[i].position) - center;
+		animated[i].position = glm::vec4(center.x + c * d.x + s * d.z, lights[i].position.y, center.z - s * d.x + c * d.z, lights[i].position.w);
+	}
+}
+
+
+/**
+*	@brief Prepare data for assignment of lights to clusters.
+*
+*	Depth slice of view space depth d is floor(log(d) * scale + bias), so the slices
+*	grow exponentially from CAMERA_NEAR to CAMERA_FAR.
+*
+*/
+HdaLights::ClusterUniformData HdaLights::prepareClusterData(const glm::mat4& view, uint32_t width, uint32_t height, uint32_t lightCnt) {
+
+	ClusterUniformData data{};
+
+	float f = 1.0f / std::tan(glm::radians(CAMERA_FOV) * 0.5f);
+	float aspect = static_cast<float>(width) / static_cast<float>(height);
+	float logRatio = std::log(CAMERA_FAR / CAMERA_NEAR);
+
+	data.view = view;
+	data.projection = glm::vec4(f / aspect, f, CAMERA_NEAR, CAMERA_FAR);
+	data.grid = glm::uvec4(CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, lightCnt);
+	data.screen = glm::vec4(static_cast<float>(width), static_cast<float>(height), CLUSTER_GRID_Z / logRatio, -CLUSTER_GRID_Z * std::log(CAMERA_NEAR) / logRatio);
+
+	return data;
+}
+
+
+// index of cluster of fragment, the same as in shader.frag
+uint32_t HdaLights::clusterIndex(glm::vec2 fragCoord, float depth, const ClusterUniformData& data) {
+
+	uint32_t x = std::min(static_cast<uint32_t>(fragCoord.x / data.screen.x * data.grid.x), data.grid.x - 1);
+	uint32_t y = std::min(static_cast<uint32_t>(fragCoord.y / data.screen.y * data.grid.y), data.grid.y - 1);
+	int z = static_cast<int>(std::floor(std::log(std::max(depth, CAMERA_NEAR)) * data.screen.z + data.screen.w));
+	z = std::clamp(z, 0, static_cast<int>(data.grid.z) - 1);
+
+	return (static_cast<uint32_t>(z) * data.grid.y + y) * data.grid.x + x;
+}
+
+
+/**
+*	@brief Axis aligned bounding box of cluster in view space.
+*
+*	The camera looks in the direction of -z, tiles go from the top left corner
+*	of framebuffer as gl_FragCoord does.
+*
+*/
+void HdaLights::clusterBounds(uint32_t cluster, const ClusterUniformData& data, glm::vec3& minP, glm::vec3& maxP) {
+
+	uint32_t x = cluster % data.grid.x;
+	uint32_t y = (cluster / data.grid.x) % data.grid.y;
+	uint32_t z = cluster / (data.grid.x * data.grid.y);
+
+	float zNear = data.projection.z * std::pow(data.projection.w / data.projection.z, static_cast<float>(z) / data.grid.z);
+	float zFar = data.projection.z * std::pow(data.projection.w / data.projection.z, static_cast<float>(z + 1) / data.grid.z);
+
+	// tile in normalized device coordinates, y axis is flipped
+	glm::vec2 ndcMin{ -1.0f + 2.0f * x / data.grid.x, -1.0f + 2.0f * y / data.grid.y };
+	glm::vec2 ndcMax{ -1.0f + 2.0f * (x + 1) / data.grid.x, -1.0f + 2.0f * (y + 1) / data.grid.y };
+
+	glm::vec2 nearMin{ ndcMin.x * zNear / data.projection.x, -ndcMax.y * zNear / data.projection.y };
+	glm::vec2 nearMax{ ndcMax.x * zNear / data.projection.x, -ndcMin.y * zNear / data.projection.y };
+	glm::vec2 farMin{ ndcMin.x * zFar / data.projection.x, -ndcMax.y * zFar / data.projection.y };
+	glm::vec2 farMax{ ndcMax.x * zFar / data.projection.x, -ndcMin.y * zFar / data.projection.y };
+
+	minP = glm::vec3(std::min(nearMin.x, farMin.x), std::min(nearMin.y, farMin.y), -zFar);
+	maxP = glm::vec3(std::max(nearMax.x, farMax.x), std::max(nearMax.y, farMax.y), -zNear);
+}
+
+
+// sphere of light range against bounding box of cluster, conservative for spotlights
+bool HdaLights::isLightInCluster(const Light& light, const glm::vec3& minP, const glm::vec3& maxP, const ClusterUniformData& data) {
+
+	glm::vec3 center = glm::vec3(data.view * glm::vec4(glm::vec3(light.position), 1.0f));
+	glm::vec3 closest = glm::clamp(center, minP, maxP);
+
+	return glm::dot(closest - center, closest - center) <= light.position.w * light.position.w;
+}
+
+
+/**
+*	@brief Assign lights to clusters on CPU.
+*
+*	Returns the number of stored light indices of all clusters, light counts
+*	of clusters are stored into counts if it is not nullptr.
+*
+*/
+uint32_t HdaLights::assignLights(const std::vector<Light>& lights, const ClusterUniformData& data, std::vector<uint32_t>* counts) {
+
+	uint32_t total = 0;
+	uint32_t lightCnt = std::min<uint32_t>(data.grid.w, static_cast<uint32_t>(lights.size()));
+	uint32_t clusterCnt = data.grid.x * data.grid.y * data.grid.z;
+
+	if (counts != nullptr)
+		counts->assign(clusterCnt, 0);
+
+	for (uint32_t c = 0; c < clusterCnt; c++) {
+
+		glm::vec3 minP, maxP;
+		clusterBounds(c, data, minP, maxP);
+
+		uint32_t cnt = 0;
+		for (uint32_t l = 0; l < lightCnt && cnt < CLUSTER_MAX_LIGHTS; l++)
+			if (isLightInCluster(lights[l], minP, maxP, data))
+				cnt++;
+
+		total += cnt;
+		if (counts != nullptr)
+			(*counts)[c] = cnt;
+	}
+
+	return total;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "hda_model.hpp"
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24				// exponential depth slices between CAMERA_NEAR and CAMERA_FAR
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+#define CLUSTER_MAX_LIGHTS 128			// lights over the limit are dropped from the cluster
+#define CLUSTER_STRIDE (CLUSTER_MAX_LIGHTS + 1)	// light count followed by light indices
+#define CLUSTER_GROUP_SIZE 64			// local_size_x in light_cull.comp
+
+#define LIGHTS_MAX 1024
+#define LIGHT_TYPE_POINT 0.0f
+#define LIGHT_TYPE_SPOT 1.0f
+
+
+/*
+*
+* A class representing clustered forward lighting. The view frustum is split into
+* a grid of clusters (froxels) - screen tiles with exponential depth slices. Lights
+* are assigned to clusters by light_cull.comp once per frame and the fragment shader
+* loops only over the lights of its cluster. The functions mirror the compute shader,
+* so the GPU results can be checked on CPU.
+*
+*/
+
+class HdaLights {
+
+public:
+
+	// one light of the light list, std430 layout
+	struct Light {
+
+		alignas(16) glm::vec4 position{ 0.0f };		// world space position + range of light
+		alignas(16) glm::vec4 direction{ 0.0f };	// direction of spotlight + LIGHT_TYPE_POINT or LIGHT_TYPE_SPOT
+		alignas(16) glm::vec4 color{ 1.0f };		// multiplies diffuse and specular color of light
+		alignas(16) glm::vec4 params{ 0.0f };		// cutOff, outerCutOff of spotlight
+	};
+
+	// uniform data of light_cull.comp and shader.frag, std140 layout
+	struct ClusterUniformData {
+
+		alignas(16) glm::mat4 view{ 1.0f };
+		alignas(16) glm::vec4 projection{ 0.0f };	// p00, p11 before the flip of y axis, zNear, zFar
+		alignas(16) glm::uvec4 grid{ 0 };			// size of grid + number of lights
+		alignas(16) glm::vec4 screen{ 0.0f };		// framebuffer size + scale and bias of depth slice
+	};
+
+	static std::vector<Light> sceneLights(float, float);
+	static std::vector<Light> createStressLights(uint32_t, glm::vec3, glm::vec3);
+	static void animateLights(const std::vector<Light>&, float, glm::vec3, std::vector<Light>&);
+
+	static ClusterUniformData prepareClusterData(const glm::mat4&, uint32_t, uint32_t, uint32_t);
+	static uint32_t clusterIndex(glm::vec2, float, const ClusterUniformData&);
+	static void clusterBounds(uint32_t, const ClusterUniformData&, glm::vec3&, glm::vec3&);
+	static bool isLightInCluster(const Light&, const glm::vec3&, const glm::vec3&, const ClusterUniformData&);
+	static uint32_t assignLights(const std::vector<Light>&, const ClusterUniformData&, std::vector<uint32_t>*);
+};
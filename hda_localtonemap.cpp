@@ -0,0 +1,366 @@
+#include "hda_localtonemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+static size_t cellIndex(const HdaLocalTonemap::Grid& grid, uint32_t x, uint32_t y, uint32_t bin) {
+
+	return (static_cast<size_t>(bin) * grid.height + y) * grid.width + x;
+}
+
+
+static uint32_t binOf(float logLum) {
+
+	return std::min(static_cast<uint32_t>((logLum - LOCAL_LOG_MIN) / (LOCAL_LOG_MAX - LOCAL_LOG_MIN) * LOCAL_GRID_BINS), static_cast<uint32_t>(LOCAL_GRID_BINS - 1));
+}
+
+
+// cells which cover the scene, the last ones may be partial
+glm::uvec2 HdaLocalTonemap::gridExtent(uint32_t width, uint32_t height) {
+
+	return glm::uvec2((width + LOCAL_GRID_CELL - 1) / LOCAL_GRID_CELL, (height + LOCAL_GRID_CELL - 1) / LOCAL_GRID_CELL);
+}
+
+
+// clamped to the range of bins, black is the first bin
+float HdaLocalTonemap::logLuminance(glm::vec3 color, float exposure) {
+
+	float lum = glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f)) * exposure;
+	return std::clamp(std::log2(std::max(lum, 1e-30f)), LOCAL_LOG_MIN, LOCAL_LOG_MAX);
+}
+
+
+/**
+*	@brief Splat log luminance of interleaved RGB image into bilateral grid.
+*
+*	Every pixel adds its log luminance and 1 into the nearest bin of its cell, both
+*	are divided by pixels of cell as in local_grid.comp. Rows of cells are split
+*	among workers, so no two jobs write one cell.
+*
+*/
+HdaLocalTonemap::Grid HdaLocalTonemap::buildGrid(HdaJobs& jobs, const float* rgb, uint32_t width, uint32_t height, float exposure) {
+
+	glm::uvec2 extent = gridExtent(width, height);
+	Grid grid{ extent.x, extent.y, std::vector<glm::vec2>(static_cast<size_t>(extent.x) * extent.y * LOCAL_GRID_BINS, glm::vec2(0.0f)) };
+	const float norm = 1.0f / (LOCAL_GRID_CELL * LOCAL_GRID_CELL);
+
+	jobs.parallelFor("buildGrid", extent.y, 1, [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t y = begin * LOCAL_GRID_CELL; y < std::min(end * LOCAL_GRID_CELL, height); y++)
+			for (uint32_t x = 0; x < width; x++) {
+
+				const float* c = rgb + 3 * (static_cast<size_t>(y) * width + x);
+				float l = logLuminance(glm::vec3(c[0], c[1], c[2]), exposure);
+
+				glm::vec2& cell = grid.cells[cellIndex(grid, x / LOCAL_GRID_CELL, y / LOCAL_GRID_CELL, binOf(l))];
+				cell += glm::vec2((l - LOCAL_LOG_MIN) * norm, norm);
+			}
+	});
+
+	return grid;
+}
+
+
+// 3x3x3 binomial filter, taps outside the grid are empty cells as in local_blur.comp
+HdaLocalTonemap::Grid HdaLocalTonemap::blurGrid(HdaJobs& jobs, const Grid& src) {
+
+	Grid dst{ src.width, src.height, std::vector<glm::vec2>(src.cells.size(), glm::vec2(0.0f)) };
+
+	jobs.parallelFor("blurGrid", src.height * LOCAL_GRID_BINS, 0, [&](uint32_t begin, uint32_t end) {
+
+		for (uint32_t row = begin; row < end; row++) {
+
+			uint32_t y = row % src.height, bin = row / src.height;
+			for (uint32_t x = 0; x < src.width; x++) {
+
+				glm::vec2 sum(0.0f);
+				for (int dz = -1; dz <= 1; dz++)
+					for (int dy = -1; dy <= 1; dy++)
+						for (int dx = -1; dx <= 1; dx++) {
+
+							int tx = static_cast<int>(x) + dx, ty = static_cast<int>(y) + dy, tz = static_cast<int>(bin) + dz;
+							if (tx < 0 || ty < 0 || tz < 0 || tx >= static_cast<int>(src.width) || ty >= static_cast<int>(src.height) || tz >= LOCAL_GRID_BINS)
+								continue;
+
+							float weight = static_cast<float>((2 - std::abs(dx)) * (2 - std::abs(dy)) * (2 - std::abs(dz)));
+							sum += src.cells[cellIndex(src, tx, ty, tz)] * weight;
+						}
+
+				dst.cells[cellIndex(dst, x, y, bin)] = sum / 64.0f;
+			}
+		}
+	});
+
+	return dst;
+}
+
+
+/**
+*	@brief Slice the grid at pixel center and log luminance.
+*
+*	Trilinear filtering with clamped coordinates is the same as texture() of the grid
+*	in tonemap.frag. The cell center of bin is the middle of its luminance range.
+*	Returns log luminance of the base layer.
+*
+*/
+float HdaLocalTonemap::sliceBase(const Grid& grid, float px, float py, float logLum) {
+
+	float t[3] = {
+		px / LOCAL_GRID_CELL - 0.5f,
+		py / LOCAL_GRID_CELL - 0.5f,
+		(logLum - LOCAL_LOG_MIN) / (LOCAL_LOG_MAX - LOCAL_LOG_MIN) * LOCAL_GRID_BINS - 0.5f
+	};
+	int size[3] = { static_cast<int>(grid.width), static_cast<int>(grid.height), LOCAL_GRID_BINS };
+
+	int base[3];
+	float frac[3];
+	for (int i = 0; i < 3; i++) {
+
+		float f = std::floor(t[i]);
+		base[i] = static_cast<int>(f);
+		frac[i] = t[i] - f;
+	}
+
+	glm::vec2 cell(0.0f);
+	for (uint32_t corner = 0; corner < 8; corner++) {
+
+		float weight = 1.0f;
+		int index[3];
+		for (int i = 0; i < 3; i++) {
+
+			int step = (corner >> i) & 1;
+			index[i] = std::clamp(base[i] + step, 0, size[i] - 1);
+			weight *= step ? frac[i] : 1.0f - frac[i];
+		}
+		cell += weight * grid.cells[cellIndex(grid, index[0], index[1], index[2])];
+	}
+
+	return cell.y > 1e-6f ? cell.x / cell.y + LOCAL_LOG_MIN : logLum;
+}
+
+
+// factor of color, contrast of base is compressed around middle gray and the detail is scaled
+float HdaLocalTonemap::localScale(float logLum, float base, float compression, float detail) {
+
+	float anchor = std::log2(LOCAL_MIDDLE_GRAY);
+	float result = anchor + (base - anchor) * compression + (logLum - base) * detail;
+
+	return std::exp2(result - logLum);
+}
+
+
+/**
+*	@brief Tone map interleaved RGB image by the local operator and the global TMO.
+*
+*	The grid is built and blurred once for the image, every row is scaled by the slice
+*	and passed to HdaTonemap::tonemapRow() with the TMO, exposure and gamma of settings.
+*
+*/
+void HdaLocalTonemap::localTonemap(HdaJobs& jobs, const float* src, float* dst, uint32_t width, uint32_t height, const HdaTonemap::Settings& settings) {
+
+	Grid grid = blurGrid(jobs, buildGrid(jobs, src, width, height, settings.exposure));
+	int isa = HdaTonemap::bestIsa();
+
+	jobs.parallelFor("localTonemap", height, 0, [&](uint32_t begin, uint32_t end) {
+
+		std::vector<float> row(3 * static_cast<size_t>(width));
+		for (uint32_t y = begin; y < end; y++) {
+
+			const float* in = src + 3 * static_cast<size_t>(y) * width;
+			for (uint32_t x = 0; x < width; x++) {
+
+				glm::vec3 c(in[3 * x], in[3 * x + 1], in[3 * x + 2]);
+				float l = logLuminance(c, settings.exposure);
+				c *= localScale(l, sliceBase(grid, x + 0.5f, y + 0.5f, l), settings.localCompression, settings.localDetail);
+
+				row[3 * x] = c.r;
+				row[3 * x + 1] = c.g;
+				row[3 * x + 2] = c.b;
+			}
+			HdaTonemap::tonemapRow(row.data(), dst + 3 * static_cast<size_t>(y) * width, width, settings, isa);
+		}
+	});
+}
+
+
+// brute force bilateral filter of log luminance with the spatial and range extent of one cell and one bin
+float HdaLocalTonemap::bilateralBase(const float* rgb, uint32_t width, uint32_t height, uint32_t x, uint32_t y, float exposure) {
+
+	const float sigmaS = LOCAL_GRID_CELL, sigmaR = (LOCAL_LOG_MAX - LOCAL_LOG_MIN) / LOCAL_GRID_BINS;
+	const int radius = 2 * LOCAL_GRID_CELL;
+
+	auto lum = [&](int qx, int qy) {
+		const float* c = rgb + 3 * (static_cast<size_t>(qy) * width + qx);
+		return logLuminance(glm::vec3(c[0], c[1], c[2]), exposure);
+	};
+
+	float center = lum(x, y);
+	double sum = 0.0, weights = 0.0;
+	for (int qy = std::max(static_cast<int>(y) - radius, 0); qy <= std::min(static_cast<int>(y) + radius, static_cast<int>(height) - 1); qy++)
+		for (int qx = std::max(static_cast<int>(x) - radius, 0); qx <= std::min(static_cast<int>(x) + radius, static_cast<int>(width) - 1); qx++) {
+
+			float l = lum(qx, qy);
+			float ds = static_cast<float>((qx - static_cast<int>(x)) * (qx - static_cast<int>(x)) + (qy - static_cast<int>(y)) * (qy - static_cast<int>(y)));
+			double w = std::exp(-ds / (2.0f * sigmaS * sigmaS) - (l - center) * (l - center) / (2.0f * sigmaR * sigmaR));
+			sum += w * l;
+			weights += w;
+		}
+
+	return static_cast<float>(sum / weights);
+}
+
+
+/**
+*	@brief Estimate memory and traffic of local tone mapping for one frame.
+*
+*	The splat reads the scene color once and writes the grid, the blur reads and writes
+*	it. Taps of the slice in tonemap.frag hit the small grid in cache, so they are
+*	not counted.
+*
+*/
+HdaLocalTonemap::LocalCost HdaLocalTonemap::localCost(uint32_t width, uint32_t height) {
+
+	const uint64_t texel = 8;	// rgba16f
+	glm::uvec2 extent = gridExtent(width, height);
+	uint64_t gridBytes = static_cast<uint64_t>(extent.x) * extent.y * LOCAL_GRID_BINS * texel;
+
+	LocalCost cost{};
+	cost.memory = 2 * gridBytes;
+	cost.traffic = static_cast<uint64_t>(width) * height * texel + 3 * gridBytes;
+
+	return cost;
+}
+
+
+void HdaLocalTonemap::printLocalCost() {
+
+	const glm::uvec2 resolutions[] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+
+	std::cout << "printLocalCost(): resolution | grid | KB | MB of traffic per frame\n";
+	for (glm::uvec2 r : resolutions) {
+
+		glm::uvec2 extent = gridExtent(r.x, r.y);
+		LocalCost cost = localCost(r.x, r.y);
+		std::cout << "  " << r.x << "x" << r.y << " | " << extent.x << "x" << extent.y << "x" << LOCAL_GRID_BINS << " | "
+			<< cost.memory / 1024.0 << " | " << cost.traffic / (1024.0 * 1024.0) << "\n";
+	}
+}
+
+
+// dark room with detail and three spotlights with hard edges, the case which global TMOs crush
+static std::vector<float> testScene(uint32_t width, uint32_t height) {
+
+	std::vector<float> image(3 * static_cast<size_t>(width) * height);
+	const float lights[3][4] = { { 0.25f, 0.4f, 0.12f, 40.0f }, { 0.55f, 0.6f, 0.15f, 120.0f }, { 0.8f, 0.35f, 0.08f, 400.0f } };
+
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++) {
+
+			float u = static_cast<float>(x) / width, v = static_cast<float>(y) / height;
+			float detail = 1.0f + 0.3f * std::sin(x * 0.35f) * std::sin(y * 0.35f);
+			float radiance = 0.02f + 0.08f * v;
+
+			for (const float* l : lights) {
+				float d = std::hypot((u - l[0]) * width / height, v - l[1]);
+				if (d < l[2])
+					radiance += l[3] * (1.0f - 0.5f * d / l[2]);
+			}
+
+			float* c = &image[3 * (static_cast<size_t>(y) * width + x)];
+			c[0] = radiance * detail;
+			c[1] = radiance * detail * 0.9f;
+			c[2] = radiance * detail * 0.75f;
+		}
+
+	return image;
+}
+
+
+/**
+*	@brief Validate the CPU reference and measure it for more resolutions.
+*
+*	The base of the blurred grid is compared with the brute force bilateral filter
+*	in a sparse set of pixels, compression 1 and detail 1 have to give the global TMO.
+*	Every resolution prints the grid, its cost and times of grid, whole local and
+*	global tone mapping on all workers. Returns false if a check fails.
+*
+*/
+bool HdaLocalTonemap::benchmark() {
+
+	const int runs = 3;
+	const glm::uvec2 resolutions[] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+	auto ms = [](std::chrono::high_resolution_clock::time_point startT) {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startT).count();
+	};
+
+	HdaJobs jobs(HdaJobs::defaultWorkerCount());
+	HdaTonemap::Settings settings{};
+	bool ok = true;
+
+	// validation at 1080p
+	{
+		const uint32_t width = 1920, height = 1080, stride = 997;
+		std::vector<float> image = testScene(width, height);
+		Grid grid = blurGrid(jobs, buildGrid(jobs, image.data(), width, height, settings.exposure));
+
+		float maxError = 0.0f;
+		double sum = 0.0;
+		uint32_t cnt = 0;
+		for (size_t p = 0; p < static_cast<size_t>(width) * height; p += stride, cnt++) {
+
+			uint32_t x = static_cast<uint32_t>(p % width), y = static_cast<uint32_t>(p / width);
+			const float* c = &image[3 * p];
+			float l = logLuminance(glm::vec3(c[0], c[1], c[2]), settings.exposure);
+			float d = std::abs(sliceBase(grid, x + 0.5f, y + 0.5f, l) - bilateralBase(image.data(), width, height, x, y, settings.exposure));
+			maxError = std::max(maxError, d);
+			sum += d;
+		}
+		float meanError = static_cast<float>(sum / cnt);
+		if (!(meanError <= LOCAL_BASE_TOLERANCE))
+			ok = false;
+
+		// without compression the local operator only multiplies by 1
+		std::vector<float> local(image.size()), global(image.size());
+		HdaTonemap::tonemapImage(jobs, image.data(), global.data(), width, height, settings, HdaTonemap::bestIsa());
+		localTonemap(jobs, image.data(), local.data(), width, height, settings);
+		float identityError = 0.0f;
+		for (size_t i = 0; i < image.size(); i++)
+			identityError = std::max(identityError, std::abs(local[i] - global[i]));
+		if (!(identityError <= TONEMAP_TOLERANCE))
+			ok = false;
+
+		std::cout << "\nbenchmark(): grid base vs bilateral filter in " << cnt << " pixels, stops: max " << maxError << " mean " << meanError
+			<< (meanError <= LOCAL_BASE_TOLERANCE ? "" : " MISMATCH") << " | compression 1 vs global TMO: " << identityError
+			<< (identityError <= TONEMAP_TOLERANCE ? "" : " MISMATCH") << "\n";
+	}
+
+	std::cout << "benchmark(): " << jobs.getWorkerCount() << " workers | resolution | grid | KB | MB of traffic | grid ms | local TMO ms | global TMO ms\n";
+	settings.localCompression = 0.5f;
+	for (glm::uvec2 r : resolutions) {
+
+		std::vector<float> image = testScene(r.x, r.y), result(image.size());
+		double gridT = 1e9, localT = 1e9, globalT = 1e9;
+		for (int i = 0; i < runs; i++) {
+
+			auto startT = std::chrono::high_resolution_clock::now();
+			Grid grid = blurGrid(jobs, buildGrid(jobs, image.data(), r.x, r.y, settings.exposure));
+			gridT = std::min(gridT, ms(startT));
+
+			startT = std::chrono::high_resolution_clock::now();
+			localTonemap(jobs, image.data(), result.data(), r.x, r.y, settings);
+			localT = std::min(localT, ms(startT));
+
+			startT = std::chrono::high_resolution_clock::now();
+			HdaTonemap::tonemapImage(jobs, image.data(), result.data(), r.x, r.y, settings, HdaTonemap::bestIsa());
+			globalT = std::min(globalT, ms(startT));
+		}
+
+		glm::uvec2 extent = gridExtent(r.x, r.y);
+		LocalCost cost = localCost(r.x, r.y);
+		std::cout << "  " << r.x << "x" << r.y << " | " << extent.x << "x" << extent.y << "x" << LOCAL_GRID_BINS << " | " << cost.memory / 1024.0
+			<< " | " << cost.traffic / (1024.0 * 1024.0) << " | " << gridT << " | " << localT << " | " << globalT << "\n";
+	}
+
+	return ok;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "hda_tonemap.hpp"
+
+#define LOCAL_GRID_FORMAT vk::Format::eR16G16B16A16Sfloat	// sum of log luminance and count, both normalized by pixels of cell
+#define LOCAL_GRID_CELL 16				// pixels of cell in both directions, local_size of local_grid.comp
+#define LOCAL_GRID_BINS 16				// bins of log luminance
+#define LOCAL_LOG_MIN -12.0f			// log2 of exposed luminance covered by bins
+#define LOCAL_LOG_MAX 12.0f
+#define LOCAL_MIDDLE_GRAY 0.18f			// base luminance which is kept by compression
+#define LOCAL_BLUR_GROUP_SIZE 8			// local_size_x and local_size_y of local_blur.comp
+#define LOCAL_TIMESTAMPS 2				// grid and blur
+#define LOCAL_BASE_TOLERANCE 0.25f		// mean difference of grid base from bilateral filter in stops
+
+
+/*
+*
+* A class representing the CPU side of local tone mapping by the bilateral grid (Chen, Paris
+* and Durand, "Real-time Edge-Aware Image Processing with the Bilateral Grid"). Every cell
+* of 16x16 pixels splats log luminance of its pixels into bins, the grid is blurred in space
+* and luminance, so the grid sliced at luminance of a pixel is an edge-aware base layer.
+* The contrast of base is compressed around middle gray and the detail is kept (Durand
+* and Dorsey, "Fast Bilateral Filtering for the Display of High-Dynamic-Range Images"),
+* the global TMO follows. The functions mirror local_grid.comp, local_blur.comp and the
+* slice in tonemap.frag.
+*
+*/
+
+class HdaLocalTonemap {
+
+public:
+
+	// push constants of local_grid.comp
+	struct LocalPushData {
+
+		glm::ivec2 sceneSize{ 0 };
+		float exposure = 1.0f;
+		float pad = 0.0f;
+	};
+
+	// cells of bins follow each other as slices of 3D image
+	struct Grid {
+
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<glm::vec2> cells;
+	};
+
+	// bytes of both grids for one resolution
+	struct LocalCost {
+
+		uint64_t memory = 0;
+		uint64_t traffic = 0;		// scene color read by the splat, grid writes and reads of the blur
+	};
+
+	static glm::uvec2 gridExtent(uint32_t, uint32_t);
+	static float logLuminance(glm::vec3, float);
+	static Grid buildGrid(HdaJobs&, const float*, uint32_t, uint32_t, float);
+	static Grid blurGrid(HdaJobs&, const Grid&);
+	static float sliceBase(const Grid&, float, float, float);
+	static float localScale(float, float, float, float);
+	static void localTonemap(HdaJobs&, const float*, float*, uint32_t, uint32_t, const HdaTonemap::Settings&);
+	static float bilateralBase(const float*, uint32_t, uint32_t, uint32_t, uint32_t, float);
+
+	static LocalCost localCost(uint32_t, uint32_t);
+	static void printLocalCost();
+	static bool benchmark();
+};
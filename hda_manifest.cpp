@@ -0,0 +1,340 @@
+#include "hda_manifest.hpp"
+#include "external/include/stb_image.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+
+/**
+*	@brief Parse scene manifest.
+*
+*	Empty lines and lines starting with # are skipped. Keys in front of the first object
+*	describe the whole scene, keys behind "object <name>" describe the object. Errors
+*	are reported with the line of manifest.
+*
+*/
+HdaManifest::SceneDesc HdaManifest::parseManifest(const std::filesystem::path& file) {
+
+	std::ifstream in(file);
+	if (!in)
+		throw std::runtime_error("Failed to open scene manifest " + file.string() + ".");
+
+	SceneDesc scene;
+	std::filesystem::path base = file.parent_path();
+	ObjectDesc* object = nullptr;
+	std::string line;
+	uint32_t lineNum = 0;
+
+	while (std::getline(in, line)) {
+
+		lineNum++;
+		std::istringstream words(line);
+		std::string key;
+		if (!(words >> key) || key[0] == '#')
+			continue;
+
+		auto fail = [&](const std::string& what) {
+			throw std::runtime_error("Scene manifest " + file.string() + ", line " + std::to_string(lineNum) + ": " + what + ".");
+		};
+		auto readPath = [&]() {
+			std::string p;
+			if (!(words >> p))
+				fail("missing path of " + key);
+			return portablePath(base, p);
+		};
+		auto readVec3 = [&]() {
+			glm::vec3 v;
+			if (!(words >> v.x >> v.y >> v.z))
+				fail("missing vector of " + key);
+			return v;
+		};
+
+		if (key == "object") {
+			scene.objects.emplace_back();
+			object = &scene.objects.back();
+			words >> object->name;
+		}
+		else if (key == "default_texture")
+			scene.defaultTexture = readPath();
+		else if (key == "skybox_mesh")
+			scene.skybox.mesh = readPath();
+		else if (key == "skybox_faces") {
+			for (auto& f : scene.skybox.faces)
+				f = readPath();
+		}
+		else if (key == "skybox_scale") {
+			if (!(words >> scene.skybox.scale))
+				fail("missing scale of skybox");
+		}
+		else if (key == "spotlight") {
+			LightDesc l;
+			l.position = readVec3();
+			l.direction = readVec3();
+			scene.spotLights.push_back(l);
+		}
+		else if (object == nullptr)
+			fail("key " + key + " is not in object");
+		else if (key == "mesh")
+			object->mesh = readPath();
+		else if (key == "material_dir")
+			object->materialDir = readPath();
+		else if (key == "texture_dir")
+			object->textureDir = readPath();
+		else if (key == "texture")
+			object->texture = readPath();
+		else if (key == "translate")
+			object->translate = readVec3();
+		else if (key == "rotate") {
+			glm::vec3 axis = readVec3();
+			float angle = 0.0f;
+			if (!(words >> angle))
+				fail("missing angle of rotation");
+			object->rotate = glm::vec4(axis, angle);
+		}
+		else if (key == "scale") {
+			float s = 1.0f;
+			if (!(words >> s))
+				fail("missing scale");
+			float y, z;
+			object->scale = (words >> y >> z) ? glm::vec3(s, y, z) : glm::vec3(s);
+		}
+		else if (key == "material") {
+			object->materialOverride = true;
+			object->material.ambient = glm::vec4(readVec3(), 0.0f);
+			object->material.diffuse = glm::vec4(readVec3(), 0.0f);
+			object->material.specular = glm::vec4(readVec3(), 0.0f);
+			if (!(words >> object->material.shi))
+				fail("missing shininess of material");
+		}
+		else if (key == "flags") {
+			std::string flag;
+			while (words >> flag) {
+				if (flag == "multitexture")
+					object->multiTexture = true;
+				else if (flag == "notexture")
+					object->textured = false;
+				else if (flag == "rotating")
+					object->rotating = true;
+				else if (flag == "instanced")
+					object->instanced = true;
+				else if (flag == "meshlets")
+					object->meshlets = true;
+				else
+					fail("unknown flag " + flag);
+			}
+		}
+		else
+			fail("unknown key " + key);
+	}
+
+	if (scene.objects.empty())
+		throw std::runtime_error("Scene manifest " + file.string() + " has no objects.");
+	if (scene.skybox.mesh.empty() || scene.skybox.faces[5].empty() || scene.defaultTexture.empty())
+		throw std::runtime_error("Scene manifest " + file.string() + " has no skybox or default texture.");
+	for (auto& o : scene.objects) {
+		if (o.mesh.empty())
+			throw std::runtime_error("Object " + o.name + " of scene manifest " + file.string() + " has no mesh.");
+		if (o.materialDir.empty())
+			o.materialDir = o.mesh.parent_path();
+	}
+
+	std::cout << "parseManifest(): " << scene.objects.size() << " objects are described in " << file.string() << "\n";
+
+	return scene;
+}
+
+
+// path of manifest relative to its directory, backslashes are accepted as well
+std::filesystem::path HdaManifest::portablePath(const std::filesystem::path& base, const std::string& p) {
+
+	std::string generic = p;
+	std::replace(generic.begin(), generic.end(), '\\', '/');
+
+	return (base / std::filesystem::path(generic)).lexically_normal().make_preferred();
+}
+
+
+// the same order as the transforms of the original scene - rotation, translation, scale
+glm::mat4 HdaManifest::modelMatrix(const ObjectDesc& o) {
+
+	glm::mat4 model = glm::rotate(glm::mat4{ 1.0f }, glm::radians(o.rotate.w), glm::vec3(o.rotate));
+	model = glm::translate(model, o.translate);
+
+	return glm::scale(model, o.scale);
+}
+
+
+// stb_image can decode on more threads at once
+HdaManifest::ImageData HdaManifest::loadImage(const std::filesystem::path& file, bool hdr) {
+
+	ImageData image{};
+	int channels = 0;
+
+	if (hdr)
+		image.hdrPixels = stbi_loadf(file.string().c_str(), &image.width, &image.height, &channels, STBI_rgb_alpha);
+	else
+		image.pixels = stbi_load(file.string().c_str(), &image.width, &image.height, &channels, STBI_rgb_alpha);
+
+	if (image.pixels == nullptr && image.hdrPixels == nullptr)
+		throw std::runtime_error("Failed to load texture file " + file.string() + ".");
+
+	return image;
+}
+
+
+void HdaManifest::freeImage(ImageData& image) {
+
+	stbi_image_free(image.pixels);
+	stbi_image_free(image.hdrPixels);
+	image.pixels = nullptr;
+	image.hdrPixels = nullptr;
+}
+
+
+/**
+*	@brief Add asset to the graph.
+*
+*	The asset is ready when all dependencies are loaded. Dependencies have to be added
+*	before, so the indices of graph are in topological order. Loading of asset can
+*	add assets which depend on it, e.g. textures named by .mtl file of mesh.
+*
+*/
+uint32_t HdaManifest::AssetGraph::add(const std::string& name, std::function<void()> load, const std::vector<uint32_t>& dependencies) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t idx = static_cast<uint32_t>(assets.size());
+	assets.emplace_back();
+	Asset& asset = assets.back();
+	asset.name = name;
+	asset.load = std::move(load);
+	asset.dependencies = dependencies;
+
+	for (uint32_t d : dependencies) {
+		if (d >= idx)
+			throw std::runtime_error("AssetGraph: dependency of " + name + " is not added.");
+		if (!assets[d].loaded) {
+			assets[d].dependents.push_back(idx);
+			asset.waiting++;
+		}
+	}
+
+	if (asset.waiting == 0) {
+		if (jobs != nullptr)
+			submit(idx);
+		else
+			ready.push_back(idx);
+	}
+
+	return idx;
+}
+
+
+// the first error of loading is thrown again when all started assets ended
+void HdaManifest::AssetGraph::run(HdaJobs& jobSystem) {
+
+	startT = std::chrono::high_resolution_clock::now();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs = &jobSystem;
+		for (uint32_t a : ready)
+			submit(a);
+		ready.clear();
+	}
+
+	// the calling thread loads assets too while it waits
+	jobSystem.wait(counter);
+	jobs = nullptr;
+
+	wallMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startT).count();
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+
+// called with locked mutex, dependents are queued before the job ends, so the counter stays above zero
+void HdaManifest::AssetGraph::submit(uint32_t idx) {
+
+	jobs->run(assets[idx].name.c_str(), [this, idx]() { load(idx); }, &counter);
+}
+
+
+void HdaManifest::AssetGraph::load(uint32_t idx) {
+
+	Asset* asset;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		asset = &assets[idx];
+		asset->startMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startT).count();
+		if (error)
+			return;
+	}
+
+	try {
+		asset->load();
+	}
+	catch (...) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!error)
+			error = std::current_exception();
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	asset->endMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startT).count();
+	asset->loaded = true;
+	for (uint32_t d : asset->dependents)
+		if (--assets[d].waiting == 0)
+			submit(d);
+}
+
+
+/**
+*	@brief Print load time of every asset and the critical path.
+*
+*	The critical path is the chain of dependencies with the longest sum of load times,
+*	the loading cannot be faster than it with any number of threads.
+*
+*/
+void HdaManifest::AssetGraph::printLoadTimes() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<double> pathMs(assets.size(), 0.0);
+	std::vector<uint32_t> previous(assets.size(), UINT32_MAX);
+	double sumMs = 0.0;
+	uint32_t last = 0;
+
+	std::cout << "printLoadTimes(): asset | start ms | load ms\n";
+	for (uint32_t i = 0; i < assets.size(); i++) {
+
+		double ms = assets[i].endMs - assets[i].startMs;
+		std::cout << "  " << assets[i].name << " | " << assets[i].startMs << " | " << ms << "\n";
+		sumMs += ms;
+
+		for (uint32_t d : assets[i].dependencies)
+			if (pathMs[d] > pathMs[i]) {
+				pathMs[i] = pathMs[d];
+				previous[i] = d;
+			}
+		pathMs[i] += ms;
+		if (pathMs[i] > pathMs[last])
+			last = i;
+	}
+
+	std::cout << "  " << assets.size() << " assets | sum of load times: " << sumMs << " ms | wall time: " << wallMs << " ms\n";
+	if (assets.empty())
+		return;
+
+	std::vector<uint32_t> path;
+	for (uint32_t i = last; i != UINT32_MAX; i = previous[i])
+		path.push_back(i);
+
+	std::cout << "  critical path: " << pathMs[last] << " ms |";
+	for (auto i = path.rbegin(); i != path.rend(); i++)
+		std::cout << (i == path.rbegin() ? " " : " -> ") << assets[*i].name;
+	std::cout << "\n";
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "hda_model.hpp"
+#include "hda_jobs.hpp"
+
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+
+#define SCENE_MANIFEST_PATH "../scenes/default.scene"	// relative to the working directory, as the models are
+
+
+/*
+*
+* A class representing the scene manifest. The manifest is a text file with one key
+* and its values per line, "object" starts a new object and the following keys belong
+* to it. Paths are relative to the manifest and use '/' on every platform. Assets are
+* decoded by jobs of AssetGraph, which queues an asset when all its dependencies are
+* loaded and reports load times and the critical path.
+*
+*/
+
+class HdaManifest {
+
+public:
+
+	struct ObjectDesc {
+
+		std::string name;
+		std::filesystem::path mesh;
+		std::filesystem::path materialDir;		// directory of .mtl file
+		std::filesystem::path textureDir;		// base of texture names in .mtl file
+		std::filesystem::path texture;			// texture of the whole object
+		glm::vec3 translate{ 0.0f };
+		glm::vec4 rotate{ 0.0f, 1.0f, 0.0f, 0.0f };	// axis + angle in degrees
+		glm::vec3 scale{ 1.0f };
+		bool multiTexture = false;				// textures of .mtl file instead of one texture
+		bool textured = true;
+		bool rotating = false;
+		bool instanced = false;
+		bool meshlets = false;
+		bool materialOverride = false;
+		HdaModel::Material material{};			// replaces materials of .mtl file when materialOverride is set
+	};
+
+	struct SkyboxDesc {
+
+		std::filesystem::path mesh;
+		std::array<std::filesystem::path, 6> faces;	// +x, -x, +y, -y, +z, -z
+		float scale = 300.0f;
+	};
+
+	struct LightDesc {
+
+		glm::vec3 position{ 0.0f };
+		glm::vec3 direction{ 0.0f, -1.0f, 0.0f };
+	};
+
+	struct SceneDesc {
+
+		std::vector<ObjectDesc> objects;
+		SkyboxDesc skybox;
+		std::vector<LightDesc> spotLights;		// the spotlights of HdaLights::sceneLights() when empty
+		std::filesystem::path defaultTexture;	// used for empty texture names of .mtl file
+	};
+
+	// decoded image, pixels are freed by freeImage()
+	struct ImageData {
+
+		int width = 0;
+		int height = 0;
+		unsigned char* pixels = nullptr;	// RGBA 8 bits per channel
+		float* hdrPixels = nullptr;			// RGBA float
+	};
+
+	// dependency graph of assets, assets can be added by loading of their dependencies
+	class AssetGraph {
+
+	public:
+
+		uint32_t add(const std::string&, std::function<void()>, const std::vector<uint32_t>&);
+		void run(HdaJobs&);
+		void printLoadTimes();
+
+	private:
+
+		struct Asset {
+
+			std::string name;
+			std::function<void()> load;
+			std::vector<uint32_t> dependencies;
+			std::vector<uint32_t> dependents;
+			uint32_t waiting = 0;				// dependencies which are not loaded yet
+			double startMs = 0.0;
+			double endMs = 0.0;
+			bool loaded = false;
+		};
+
+		std::deque<Asset> assets;				// references stay valid while assets are added
+		std::vector<uint32_t> ready;			// assets without dependencies added before run()
+		std::mutex mutex;
+		HdaJobs* jobs = nullptr;				// job system of running graph
+		HdaJobs::Counter counter;
+		std::exception_ptr error;
+		std::chrono::high_resolution_clock::time_point startT;
+		double wallMs = 0.0;
+
+		void submit(uint32_t);
+		void load(uint32_t);
+	};
+
+	static SceneDesc parseManifest(const std::filesystem::path&);
+	static std::filesystem::path portablePath(const std::filesystem::path&, const std::string&);
+	static glm::mat4 modelMatrix(const ObjectDesc&);
+
+	static ImageData loadImage(const std::filesystem::path&, bool);
+	static void freeImage(ImageData&);
+};
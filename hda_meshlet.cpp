@@ -0,0 +1,430 @@
+#include "hda_meshlet.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+
+/*
+*
+* Meshlet bounds and the normal cone test are modified from meshoptimizer:
+* https://github.com/zeux/meshoptimizer
+*
+* and the sphere frustum test from Arseny Kapoulkine's niagara renderer:
+* https://github.com/zeux/niagara
+*
+*/
+
+
+/**
+*	@brief Split level 0 of all submeshes into meshlets.
+*
+*	Must be called after HdaMeshOptimizer::optimizeMesh(). Triangles are taken in the
+*	order of the index buffer, which is already optimized for the vertex cache, and
+*	a new meshlet is started when the vertex or triangle limit would be exceeded.
+*	The index buffer is not changed.
+*
+*/
+void HdaMeshlet::buildMeshlets(HdaModel::Mesh& mesh, const char* filename) {
+
+	auto startT = std::chrono::high_resolution_clock::now();
+
+	mesh.meshlets.clear();
+
+	// last meshlet which the vertex was added to
+	std::vector<uint32_t> vertexMeshlet(mesh.meshVertices.size(), UINT32_MAX);
+	uint64_t vertexSum = 0;
+
+	for (uint32_t s = 0; s < mesh.info.size(); s++) {
+
+		auto& inf = mesh.info[s];
+		inf.firstMeshlet = static_cast<uint32_t>(mesh.meshlets.size());
+		inf.meshletCnt = 0;
+
+		if (inf.vertexCnt < 3)
+			continue;
+
+		uint32_t id = static_cast<uint32_t>(mesh.meshlets.size());
+		HdaModel::Meshlet meshlet{};
+		meshlet.firstIndex = inf.firstVertex;
+		meshlet.submesh = s;
+
+		for (uint32_t i = inf.firstVertex; i + 2 < inf.firstVertex + inf.vertexCnt; i += 3) {
+
+			const uint32_t* tri = &mesh.meshIndices[i];
+
+			uint32_t newVertices = 0;
+			for (uint32_t k = 0; k < 3; k++)
+				if (vertexMeshlet[tri[k]] != id)
+					newVertices++;
+
+			// meshlet is full, start the next one with this triangle
+			if (meshlet.vertexCnt + newVertices > MESHLET_MAX_VERTICES || meshlet.indexCnt / 3 + 1 > MESHLET_MAX_TRIANGLES) {
+
+				computeBounds(meshlet, mesh);
+				mesh.meshlets.push_back(meshlet);
+				vertexSum += meshlet.vertexCnt;
+
+				id++;
+				meshlet = HdaModel::Meshlet{};
+				meshlet.firstIndex = i;
+				meshlet.submesh = s;
+			}
+
+			for (uint32_t k = 0; k < 3; k++) {
+				if (vertexMeshlet[tri[k]] != id) {
+					vertexMeshlet[tri[k]] = id;
+					meshlet.vertexCnt++;
+				}
+			}
+			meshlet.indexCnt += 3;
+		}
+
+		if (meshlet.indexCnt > 0) {
+			computeBounds(meshlet, mesh);
+			mesh.meshlets.push_back(meshlet);
+			vertexSum += meshlet.vertexCnt;
+		}
+
+		inf.meshletCnt = static_cast<uint32_t>(mesh.meshlets.size()) - inf.firstMeshlet;
+	}
+
+	auto endT = std::chrono::high_resolution_clock::now();
+
+	size_t coneCnt = std::count_if(mesh.meshlets.begin(), mesh.meshlets.end(), [](const HdaModel::Meshlet& m) { return m.coneAxis.w < 1.0f; });
+	uint64_t indexSum = 0;
+	for (const auto& m : mesh.meshlets)
+		indexSum += m.indexCnt;
+	double meshletCnt = std::max<double>(1.0, static_cast<double>(mesh.meshlets.size()));
+
+	std::cout << "buildMeshlets(): " << filename << " | meshlets: " << mesh.meshlets.size()
+		<< " | avg triangles: " << (indexSum / 3) / meshletCnt
+		<< " | avg vertices: " << vertexSum / meshletCnt
+		<< " | cullable cones: " << coneCnt
+		<< " | time: " << std::chrono::duration<double, std::milli>(endT - startT).count() << " ms\n";
+}
+
+
+/**
+*	@brief Compute bounding sphere and normal cone of meshlet.
+*
+*	The cone axis is the average of triangle normals. If the normals are spread
+*	too much, the cutoff is set to 1 and the meshlet is never culled by the cone.
+*	The apex is moved back along the axis, so all triangle planes are in front of it.
+*
+*/
+void HdaMeshlet::computeBounds(HdaModel::Meshlet& meshlet, const HdaModel::Mesh& mesh) {
+
+	const uint32_t* indices = &mesh.meshIndices[meshlet.firstIndex];
+
+	// bounding sphere - center of bounding box and the farthest vertex
+	glm::vec3 minP{ FLT_MAX };
+	glm::vec3 maxP{ -FLT_MAX };
+	for (uint32_t i = 0; i < meshlet.indexCnt; i++) {
+		minP = glm::min(minP, mesh.meshVertices[indices[i]].position);
+		maxP = glm::max(maxP, mesh.meshVertices[indices[i]].position);
+	}
+	glm::vec3 center = (minP + maxP) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t i = 0; i < meshlet.indexCnt; i++)
+		radius = std::max(radius, glm::length(mesh.meshVertices[indices[i]].position - center));
+	meshlet.boundingSphere = glm::vec4(center, radius);
+
+	// triangle normals
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec3> points;
+	glm::vec3 axis{ 0.0f };
+	for (uint32_t i = 0; i + 2 < meshlet.indexCnt; i += 3) {
+
+		glm::vec3 p0 = mesh.meshVertices[indices[i]].position;
+		glm::vec3 n = glm::cross(mesh.meshVertices[indices[i + 1]].position - p0, mesh.meshVertices[indices[i + 2]].position - p0);
+		float len = glm::length(n);
+		if (len == 0.0f)
+			continue;
+
+		normals.push_back(n / len);
+		points.push_back(p0);
+		axis += n / len;
+	}
+
+	meshlet.coneApex = glm::vec4(center, 0.0f);
+	meshlet.coneAxis = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	if (normals.empty() || glm::length(axis) == 0.0f)
+		return;
+	axis = glm::normalize(axis);
+
+	float minDot = 1.0f;
+	for (const auto& n : normals)
+		minDot = std::min(minDot, glm::dot(axis, n));
+	if (minDot <= MESHLET_CONE_MIN_DOT) {
+		meshlet.coneAxis = glm::vec4(axis, 1.0f);
+		return;
+	}
+
+	// the largest distance to move the apex back so it is behind all triangle planes
+	float maxT = 0.0f;
+	for (size_t t = 0; t < normals.size(); t++)
+		maxT = std::max(maxT, glm::dot(center - points[t], normals[t]) / glm::dot(axis, normals[t]));
+
+	meshlet.coneApex = glm::vec4(center - axis * maxT, 0.0f);
+	meshlet.coneAxis = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+}
+
+
+/**
+*	@brief Prepare data for culling of meshlets of one object.
+*
+*	The side planes of the symmetric frustum are derived from CAMERA_FOV and the aspect
+*	ratio, so the test is done in view space. The camera position is transformed into
+*	model space for the cone test.
+*
+*/
+HdaMeshlet::CullUniformData HdaMeshlet::prepareCullData(const glm::mat4& modelView, float aspect, int cullMode, uint32_t meshletCnt) {
+
+	CullUniformData data{};
+
+	float f = 1.0f / std::tan(glm::radians(CAMERA_FOV) * 0.5f);
+	glm::vec2 frustumX = glm::normalize(glm::vec2(f / aspect, 1.0f));
+	glm::vec2 frustumY = glm::normalize(glm::vec2(f, 1.0f));
+
+	data.modelView = modelView;
+	data.frustum = glm::vec4(frustumX.x, frustumX.y, frustumY.x, frustumY.y);
+	data.cameraPosition = glm::inverse(modelView) * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	data.scale = std::max(glm::length(glm::vec3(modelView[0])), std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+	data.cullMode = cullMode;
+	data.meshletCnt = meshletCnt;
+
+	HdaOcclusion::Projection proj = HdaOcclusion::cameraProjection(aspect);
+	data.projection = glm::vec4(proj.p00, proj.p11, proj.depthA, proj.depthB);
+
+	return data;
+}
+
+
+/**
+*	@brief CPU version of the test done in meshlet_cull.comp.
+*/
+bool HdaMeshlet::isMeshletVisible(const HdaModel::Meshlet& meshlet, const CullUniformData& data) {
+
+	if (data.cullMode == MESHLET_CULL_OFF)
+		return true;
+
+	// camera looks in the direction of -z
+	glm::vec3 center = glm::vec3(data.modelView * glm::vec4(glm::vec3(meshlet.boundingSphere), 1.0f));
+	float radius = meshlet.boundingSphere.w * data.scale;
+
+	bool visible = std::abs(center.x) * data.frustum.x + center.z * data.frustum.y < radius;
+	visible = visible && std::abs(center.y) * data.frustum.z + center.z * data.frustum.w < radius;
+	visible = visible && center.z - radius < -data.zNear;
+	visible = visible && center.z + radius > -data.zFar;
+
+	if (visible && data.cullMode == MESHLET_CULL_FRUSTUM_CONE && meshlet.coneAxis.w < 1.0f) {
+
+		glm::vec3 dir = glm::vec3(meshlet.coneApex) - glm::vec3(data.cameraPosition);
+		float len = glm::length(dir);
+		if (len > 0.0f)
+			visible = glm::dot(dir / len, glm::vec3(meshlet.coneAxis)) < meshlet.coneAxis.w;
+	}
+
+	return visible;
+}
+
+
+/**
+*	@brief Cull all meshlets of mesh on CPU.
+*
+*	Returns the number of visible meshlets, their indices are stored
+*	into visibleMeshlets if it is not nullptr.
+*
+*/
+uint32_t HdaMeshlet::cullMeshlets(const HdaModel::Mesh& mesh, const CullUniformData& data, std::vector<uint32_t>* visibleMeshlets) {
+
+	uint32_t visibleCnt = 0;
+
+	if (visibleMeshlets != nullptr)
+		visibleMeshlets->clear();
+
+	for (uint32_t m = 0; m < mesh.meshlets.size(); m++) {
+		if (isMeshletVisible(mesh.meshlets[m], data)) {
+			visibleCnt++;
+			if (visibleMeshlets != nullptr)
+				visibleMeshlets->push_back(m);
+		}
+	}
+
+	return visibleCnt;
+}
+
+
+/**
+*	@brief Check meshlets of a sphere and a wavy grid against their triangles.
+*
+*	Every meshlet keeps the vertex and triangle limits and every triangle is in exactly
+*	one meshlet of its submesh. The sphere and cone tests are compared with per-triangle
+*	tests from random cameras: a culled meshlet must not have a triangle which faces the
+*	camera and is not outside one frustum plane with all its vertices.
+*
+*/
+bool HdaMeshlet::selfTest() {
+
+	HdaModel::Mesh mesh;
+	const uint32_t rings = 48, segments = 96;
+	const float pi = glm::radians(180.0f);
+
+	// unit sphere, counter clockwise from outside
+	for (uint32_t r = 0; r <= rings; r++)
+		for (uint32_t s = 0; s <= segments; s++) {
+
+			float theta = pi * r / rings, phi = 2.0f * pi * s / segments;
+			glm::vec3 p{ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+			mesh.meshVertices.push_back({ p, p, glm::vec3(1.0f), glm::vec2(0.0f) });
+		}
+	for (uint32_t r = 0; r < rings; r++)
+		for (uint32_t s = 0; s < segments; s++) {
+
+			uint32_t a = r * (segments + 1) + s, b = a + segments + 1;
+			if (r > 0)
+				mesh.meshIndices.insert(mesh.meshIndices.end(), { a, a + 1, b });
+			if (r + 1 < rings)
+				mesh.meshIndices.insert(mesh.meshIndices.end(), { a + 1, b + 1, b });
+		}
+
+	HdaModel::IndexInfo sphere{};
+	sphere.vertexCnt = static_cast<uint32_t>(mesh.meshIndices.size());
+	mesh.info.push_back(sphere);
+
+	// grid under the sphere facing +y
+	const uint32_t cells = 40;
+	uint32_t base = static_cast<uint32_t>(mesh.meshVertices.size());
+	for (uint32_t z = 0; z <= cells; z++)
+		for (uint32_t x = 0; x <= cells; x++) {
+
+			glm::vec3 p{ -3.0f + 6.0f * x / cells, -1.5f + 0.1f * std::sin(x * 0.7f) * std::cos(z * 0.5f), -3.0f + 6.0f * z / cells };
+			mesh.meshVertices.push_back({ p, glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f), glm::vec2(0.0f) });
+		}
+	HdaModel::IndexInfo grid{};
+	grid.firstVertex = static_cast<uint32_t>(mesh.meshIndices.size());
+	for (uint32_t z = 0; z < cells; z++)
+		for (uint32_t x = 0; x < cells; x++) {
+
+			uint32_t a = base + z * (cells + 1) + x, b = a + cells + 1;
+			mesh.meshIndices.insert(mesh.meshIndices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	grid.vertexCnt = static_cast<uint32_t>(mesh.meshIndices.size()) - grid.firstVertex;
+	mesh.info.push_back(grid);
+
+	buildMeshlets(mesh, "selfTest");
+
+	bool ok = true;
+	auto check = [&](bool condition, const char* what) {
+
+		std::cout << "selfTest(): " << (condition ? "ok     " : "FAILED ") << what << std::endl;
+		ok = ok && condition;
+	};
+
+	// limits and coverage
+	bool limits = true, submeshes = true;
+	std::vector<uint32_t> covered(mesh.meshIndices.size() / 3, 0);
+	for (uint32_t m = 0; m < mesh.meshlets.size(); m++) {
+
+		const HdaModel::Meshlet& meshlet = mesh.meshlets[m];
+		std::vector<uint32_t> vertices(mesh.meshIndices.begin() + meshlet.firstIndex, mesh.meshIndices.begin() + meshlet.firstIndex + meshlet.indexCnt);
+		std::sort(vertices.begin(), vertices.end());
+		size_t unique = std::unique(vertices.begin(), vertices.end()) - vertices.begin();
+
+		limits = limits && meshlet.indexCnt > 0 && meshlet.indexCnt % 3 == 0 && meshlet.indexCnt / 3 <= MESHLET_MAX_TRIANGLES
+			&& meshlet.vertexCnt <= MESHLET_MAX_VERTICES && unique == meshlet.vertexCnt;
+
+		const HdaModel::IndexInfo& inf = mesh.info[meshlet.submesh];
+		submeshes = submeshes && meshlet.firstIndex >= inf.firstVertex && meshlet.firstIndex + meshlet.indexCnt <= inf.firstVertex + inf.vertexCnt
+			&& m >= inf.firstMeshlet && m < inf.firstMeshlet + inf.meshletCnt;
+
+		for (uint32_t t = meshlet.firstIndex / 3; t < (meshlet.firstIndex + meshlet.indexCnt) / 3; t++)
+			covered[t]++;
+	}
+
+	check(limits, "meshlets keep vertex and triangle limits, vertex counts are exact");
+	check(submeshes, "meshlets are inside ranges of their submeshes");
+	check(std::all_of(covered.begin(), covered.end(), [](uint32_t c) { return c == 1; }), "every triangle is in exactly one meshlet");
+
+	// culling from random cameras, the model is rotated and moved
+	std::mt19937 random(28);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f, 0.0f, -0.3f)), 0.7f, glm::normalize(glm::vec3(1.0f, 2.0f, 0.5f)));
+
+	uint32_t views = 64, unsafe[2] = { 0, 0 }, culled[2] = { 0, 0 }, hidden[2] = { 0, 0 };
+	bool lists = true;
+	for (uint32_t v = 0; v < views; v++) {
+
+		glm::vec3 dir = glm::normalize(glm::vec3(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f));
+		glm::vec3 eye = dir * (1.5f + 6.5f * unit(random));
+		glm::vec3 target{ 2.0f * unit(random) - 1.0f, 2.0f * unit(random) - 1.0f, 2.0f * unit(random) - 1.0f };
+		glm::mat4 modelView = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)) * model;
+
+		for (int mode = 0; mode < 2; mode++) {
+
+			CullUniformData data = prepareCullData(modelView, 16.0f / 9.0f, mode == 0 ? MESHLET_CULL_FRUSTUM : MESHLET_CULL_FRUSTUM_CONE,
+												   static_cast<uint32_t>(mesh.meshlets.size()));
+			glm::vec3 camera{ data.cameraPosition };
+
+			std::vector<uint32_t> visibleList;
+			cullMeshlets(mesh, data, &visibleList);
+			size_t next = 0;
+
+			for (uint32_t m = 0; m < mesh.meshlets.size(); m++) {
+
+				const HdaModel::Meshlet& meshlet = mesh.meshlets[m];
+				bool visible = isMeshletVisible(meshlet, data);
+				lists = lists && (visible == (next < visibleList.size() && visibleList[next] == m));
+				if (visible)
+					next++;
+
+				// per triangle, vertices on a plane count as outside, so rounding does not report false errors
+				bool anyVisible = false;
+				for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCnt && !anyVisible; i += 3) {
+
+					glm::vec3 p[3];
+					glm::vec3 view[3];
+					for (int k = 0; k < 3; k++) {
+						p[k] = mesh.meshVertices[mesh.meshIndices[i + k]].position;
+						view[k] = glm::vec3(modelView * glm::vec4(p[k], 1.0f));
+					}
+
+					glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+					if (glm::length(n) == 0.0f)
+						continue;
+					bool front = glm::dot(glm::normalize(n), camera - p[0]) > 1e-4f;
+
+					auto outside = [&](auto distance) { return distance(view[0]) > -1e-4f && distance(view[1]) > -1e-4f && distance(view[2]) > -1e-4f; };
+					bool out = outside([&](glm::vec3 q) { return q.x * data.frustum.x + q.z * data.frustum.y; })
+						|| outside([&](glm::vec3 q) { return -q.x * data.frustum.x + q.z * data.frustum.y; })
+						|| outside([&](glm::vec3 q) { return q.y * data.frustum.z + q.z * data.frustum.w; })
+						|| outside([&](glm::vec3 q) { return -q.y * data.frustum.z + q.z * data.frustum.w; })
+						|| outside([&](glm::vec3 q) { return q.z + data.zNear; })
+						|| outside([&](glm::vec3 q) { return -data.zFar - q.z; });
+
+					anyVisible = !out && (mode == 0 || front);
+				}
+
+				if (!visible && anyVisible)
+					unsafe[mode]++;
+				if (!visible)
+					culled[mode]++;
+				if (!anyVisible)
+					hidden[mode]++;
+			}
+		}
+	}
+
+	std::cout << "selfTest(): " << mesh.meshlets.size() << " meshlets, " << views << " views | frustum: " << culled[0] << " culled of " << hidden[0]
+		<< " hidden | frustum + cone: " << culled[1] << " culled of " << hidden[1] << " hidden\n";
+
+	check(lists, "cullMeshlets() returns meshlets which pass isMeshletVisible()");
+	check(unsafe[0] == 0, "sphere test never culls a meshlet with a triangle in frustum");
+	check(unsafe[1] == 0, "cone test never culls a meshlet with a front facing triangle in frustum");
+	check(culled[1] > culled[0], "cone test culls backfacing meshlets");
+
+	return ok;
+}
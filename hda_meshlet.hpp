@@ -0,0 +1,59 @@
+#pragma once
+#include "hda_model.hpp"
+#include "hda_occlusion.hpp"
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+#define MESHLET_CONE_MIN_DOT 0.1f		// cluster with wider normal cone is never backface culled
+#define MESHLET_DISPATCH_ROW 65535		// minimal guaranteed maxComputeWorkGroupCount[0]
+#define MESHLET_DRAW_OFFSET 16			// draw commands follow the visible meshlet counter and padding
+
+#define MESHLET_CULL_OFF 0
+#define MESHLET_CULL_FRUSTUM 1
+#define MESHLET_CULL_FRUSTUM_CONE 2		// backface cone culling is correct only for one sided geometry
+
+#define MESHLET_PHASE_SINGLE 0			// frustum and cone culling without occlusion
+#define MESHLET_PHASE_EARLY 1			// meshlets visible in the last frame
+#define MESHLET_PHASE_LATE 2			// meshlets not occluded by depth pyramid of early phase
+
+
+/*
+*
+* A class representing splitting of submeshes into meshlets - small clusters of triangles
+* with bounding sphere and normal cone - and their culling. Meshlets are built over level 0
+* of every IndexInfo submesh. The triangles of one meshlet are continuous in the index buffer,
+* so the compute shader can copy visible meshlets into a compacted index buffer.
+*
+*/
+
+class HdaMeshlet {
+
+public:
+
+	// uniform data of meshlet_cull.comp, std140 layout
+	struct CullUniformData {
+
+		alignas(16) glm::mat4 modelView{ 1.0f };
+		alignas(16) glm::vec4 frustum{ 0.0f };			// x, z of normalized left/right plane + y, z of top/bottom plane
+		alignas(16) glm::vec4 cameraPosition{ 0.0f };	// camera position in model space
+		alignas(4) float zNear = CAMERA_NEAR;
+		alignas(4) float zFar = CAMERA_FAR;
+		alignas(4) float scale = 1.0f;					// max scale of model view matrix for sphere radius
+		int cullMode = MESHLET_CULL_OFF;
+		uint32_t meshletCnt = 0;
+		uint32_t submeshCnt = 0;						// late phase draw commands follow the early ones
+		alignas(16) glm::vec4 projection{ 0.0f };		// p00, p11, depthA, depthB of HdaOcclusion::Projection
+		alignas(8) glm::vec2 pyramidSize{ 0.0f };		// size of depth pyramid level 0
+	};
+
+	static void buildMeshlets(HdaModel::Mesh&, const char*);
+	static CullUniformData prepareCullData(const glm::mat4&, float, int, uint32_t);
+	static bool isMeshletVisible(const HdaModel::Meshlet&, const CullUniformData&);
+	static uint32_t cullMeshlets(const HdaModel::Mesh&, const CullUniformData&, std::vector<uint32_t>*);
+
+	static bool selfTest();
+
+private:
+
+	static void computeBounds(HdaModel::Meshlet&, const HdaModel::Mesh&);
+};
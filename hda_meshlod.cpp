@@ -0,0 +1,389 @@
+#include "hda_meshlod.hpp"
+#include "hda_meshoptimizer.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+
+/*
+*
+* Simplification is based on the quadric error metrics by Garland and Heckbert
+* "Surface Simplification Using Quadric Error Metrics":
+* https://www.cs.cmu.edu/~garland/Papers/quadrics.pdf
+*
+* and the way of greedy edge collapse passes with locked seams modified from meshoptimizer:
+* https://github.com/zeux/meshoptimizer
+*
+*/
+
+
+void HdaMeshLod::Quadric::addPlane(glm::vec3 n, float d, float weight) {
+
+	a00 += weight * n.x * n.x; a01 += weight * n.x * n.y; a02 += weight * n.x * n.z; a03 += weight * n.x * d;
+	a11 += weight * n.y * n.y; a12 += weight * n.y * n.z; a13 += weight * n.y * d;
+	a22 += weight * n.z * n.z; a23 += weight * n.z * d;
+	a33 += weight * d * d;
+	w += weight;
+}
+
+void HdaMeshLod::Quadric::add(const Quadric& q) {
+
+	a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+	a11 += q.a11; a12 += q.a12; a13 += q.a13;
+	a22 += q.a22; a23 += q.a23;
+	a33 += q.a33;
+	w += q.w;
+}
+
+// returns weighted average distance of point p from all planes of quadric
+float HdaMeshLod::Quadric::error(glm::vec3 p) const {
+
+	if (w <= 0.0)
+		return 0.0f;
+
+	double x = p.x, y = p.y, z = p.z;
+	double e = a00 * x * x + a11 * y * y + a22 * z * z + a33
+		+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z + a03 * x + a13 * y + a23 * z);
+
+	return static_cast<float>(std::sqrt(std::max(e, 0.0) / w));
+}
+
+
+/**
+*	@brief Generate levels of detail for all submeshes of mesh.
+*
+*	Must be called after HdaMeshOptimizer::optimizeMesh(), because it works with indexed
+*	submeshes. Every level is simplified from the full detail submesh, so the error
+*	of the level is measured against the original surface.
+*
+*/
+void HdaMeshLod::generateLods(HdaModel::Mesh& mesh, const char* filename) {
+
+	auto startT = std::chrono::high_resolution_clock::now();
+
+	std::array<size_t, MAX_LOD_LEVELS> levelTriangles{};
+
+	for (auto& inf : mesh.info) {
+
+		inf.lodCnt = 1;
+		inf.lodFirstIndex[0] = inf.firstVertex;
+		inf.lodIndexCnt[0] = inf.vertexCnt;
+		inf.lodError[0] = 0.0f;
+		levelTriangles[0] += inf.vertexCnt / 3;
+
+		if (inf.vertexCnt < 3)
+			continue;
+
+		// vertex span of submesh
+		auto first = mesh.meshIndices.begin() + inf.firstVertex;
+		auto last = first + inf.vertexCnt;
+		uint32_t vertexBase = *std::min_element(first, last);
+		uint32_t vertexCnt = *std::max_element(first, last) - vertexBase + 1;
+
+		std::vector<glm::vec3> positions(vertexCnt);
+		for (uint32_t v = 0; v < vertexCnt; v++)
+			positions[v] = mesh.meshVertices[vertexBase + v].position;
+
+		// bounding sphere - center of bounding box and the farthest vertex
+		glm::vec3 minP{ FLT_MAX };
+		glm::vec3 maxP{ -FLT_MAX };
+		for (auto it = first; it != last; ++it) {
+			minP = glm::min(minP, positions[*it - vertexBase]);
+			maxP = glm::max(maxP, positions[*it - vertexBase]);
+		}
+		glm::vec3 center = (minP + maxP) * 0.5f;
+		float radius = 0.0f;
+		for (auto it = first; it != last; ++it)
+			radius = std::max(radius, glm::length(positions[*it - vertexBase] - center));
+		inf.boundingSphere = glm::vec4(center, radius);
+
+		std::vector<uint32_t> full(first, last);
+		for (auto& idx : full)
+			idx -= vertexBase;
+
+		size_t previousCnt = full.size();
+		for (uint32_t level = 1; level < MAX_LOD_LEVELS; level++) {
+
+			size_t target = static_cast<size_t>(full.size() * std::pow(LOD_REDUCTION, static_cast<float>(level))) / 3 * 3;
+			if (target < 3)
+				break;
+
+			std::vector<uint32_t> lod = full;
+			float error = simplify(lod, positions.data(), vertexCnt, target, LOD_MAX_RELATIVE_ERROR * radius);
+
+			if (lod.empty() || lod.size() > previousCnt * LOD_MIN_REDUCTION)
+				break;
+			previousCnt = lod.size();
+
+			for (auto& idx : lod)
+				idx += vertexBase;
+			HdaMeshOptimizer::optimizeVertexCache(lod.data(), lod.size(), vertexBase, vertexCnt);
+
+			inf.lodFirstIndex[level] = static_cast<uint32_t>(mesh.meshIndices.size());
+			inf.lodIndexCnt[level] = static_cast<uint32_t>(lod.size());
+			inf.lodError[level] = error;
+			inf.lodCnt = level + 1;
+			levelTriangles[level] += lod.size() / 3;
+
+			mesh.meshIndices.insert(mesh.meshIndices.end(), lod.begin(), lod.end());
+		}
+	}
+
+	auto endT = std::chrono::high_resolution_clock::now();
+
+	std::cout << "generateLods(): " << filename << " | time: " << std::chrono::duration<double, std::milli>(endT - startT).count() << " ms\n\ttriangles:";
+	for (uint32_t level = 0; level < MAX_LOD_LEVELS; level++)
+		std::cout << " LOD" << level << ": " << levelTriangles[level];
+	std::cout << std::endl;
+}
+
+
+/**
+*	@brief Find vertices which must not move.
+*
+*	Vertices on UV/normal seams (more vertices with the same position) and on borders
+*	(edges with one triangle - holes and material boundaries) are locked, so the
+*	simplification does not tear the surface apart.
+*
+*/
+std::vector<bool> HdaMeshLod::findLockedVertices(const std::vector<uint32_t>& indices, const glm::vec3* positions, uint32_t vertexCnt) {
+
+	std::vector<bool> locked(vertexCnt, false);
+
+	// weld vertices by position
+	std::vector<uint32_t> weld(vertexCnt);
+	std::unordered_map<glm::vec3, uint32_t> firstByPosition{};
+	firstByPosition.reserve(vertexCnt);
+	for (uint32_t v = 0; v < vertexCnt; v++) {
+
+		auto it = firstByPosition.find(positions[v]);
+		if (it == firstByPosition.end()) {
+			firstByPosition.emplace(positions[v], v);
+			weld[v] = v;
+		}
+		else {
+			weld[v] = it->second;
+			locked[v] = true;
+			locked[it->second] = true;
+		}
+	}
+
+	// count triangles of every welded edge
+	std::unordered_map<uint64_t, uint32_t> edgeTriangles{};
+	edgeTriangles.reserve(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (uint32_t k = 0; k < 3; k++) {
+
+			uint64_t a = weld[indices[i + k]];
+			uint64_t b = weld[indices[i + (k + 1) % 3]];
+			edgeTriangles[a < b ? (a << 32) | b : (b << 32) | a]++;
+		}
+	}
+
+	for (const auto& edge : edgeTriangles) {
+		if (edge.second != 2) {
+			locked[edge.first >> 32] = true;
+			locked[edge.first & 0xffffffff] = true;
+		}
+	}
+
+	// lock the whole welded group
+	for (uint32_t v = 0; v < vertexCnt; v++)
+		if (locked[weld[v]])
+			locked[v] = true;
+
+	return locked;
+}
+
+
+bool HdaMeshLod::collapseFlipsTriangle(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& adjacencyOffset, const std::vector<uint32_t>& adjacency,
+	const glm::vec3* positions, uint32_t from, uint32_t to) {
+
+	for (uint32_t a = adjacencyOffset[from]; a < adjacencyOffset[from + 1]; a++) {
+
+		const uint32_t* tri = &indices[adjacency[a] * 3];
+
+		// triangles with the collapsed edge disappear
+		if (tri[0] == to || tri[1] == to || tri[2] == to)
+			continue;
+
+		glm::vec3 p[3];
+		glm::vec3 q[3];
+		for (uint32_t k = 0; k < 3; k++) {
+			p[k] = positions[tri[k]];
+			q[k] = tri[k] == from ? positions[to] : p[k];
+		}
+
+		glm::vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+		glm::vec3 n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+		if (glm::dot(n0, n1) <= 0.0f)
+			return true;
+	}
+
+	return false;
+}
+
+
+/**
+*	@brief Simplify triangles in place by collapsing edges to one of their vertices.
+*
+*	Indices are local in range [0, vertexCnt). Collapses are done in greedy passes
+*	ordered by quadric error until the target index count or the error limit
+*	is reached. Returns the max error of done collapses in model units.
+*
+*/
+float HdaMeshLod::simplify(std::vector<uint32_t>& indices, const glm::vec3* positions, uint32_t vertexCnt, size_t targetIndexCnt, float maxError) {
+
+	std::vector<bool> locked = findLockedVertices(indices, positions, vertexCnt);
+
+	// vertex quadrics from the planes of adjacent triangles weighted by area
+	std::vector<Quadric> quadrics(vertexCnt);
+	for (size_t i = 0; i < indices.size(); i += 3) {
+
+		glm::vec3 p0 = positions[indices[i]];
+		glm::vec3 p1 = positions[indices[i + 1]];
+		glm::vec3 p2 = positions[indices[i + 2]];
+
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float area = glm::length(n) * 0.5f;
+		if (area <= 0.0f)
+			continue;
+		n = glm::normalize(n);
+
+		for (uint32_t k = 0; k < 3; k++)
+			quadrics[indices[i + k]].addPlane(n, -glm::dot(n, p0), area);
+	}
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		float error;
+	};
+
+	float resultError = 0.0f;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> remap(vertexCnt);
+	std::vector<bool> touched(vertexCnt);
+
+	while (indices.size() > targetIndexCnt) {
+
+		// vertex -> triangles adjacency
+		std::vector<uint32_t> adjacencyOffset(vertexCnt + 1, 0);
+		for (auto idx : indices)
+			adjacencyOffset[idx + 1]++;
+		for (uint32_t v = 0; v < vertexCnt; v++)
+			adjacencyOffset[v + 1] += adjacencyOffset[v];
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+		// every edge can be collapsed in both directions if the moving vertex is not locked
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			for (uint32_t k = 0; k < 3; k++) {
+
+				uint32_t a = indices[i + k];
+				uint32_t b = indices[i + (k + 1) % 3];
+
+				for (uint32_t dir = 0; dir < 2; dir++) {
+
+					uint32_t from = dir == 0 ? a : b;
+					uint32_t to = dir == 0 ? b : a;
+					if (locked[from])
+						continue;
+
+					Quadric q = quadrics[from];
+					q.add(quadrics[to]);
+					collapses.push_back({ from, to, q.error(positions[to]) });
+				}
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		// each collapse removes about two triangles, one pass does at most the half of remaining work
+		size_t triangleGoal = (indices.size() - targetIndexCnt) / 3;
+		size_t collapseLimit = std::max<size_t>(1, triangleGoal / 2 + 1);
+		size_t collapseCnt = 0;
+
+		for (uint32_t v = 0; v < vertexCnt; v++)
+			remap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const auto& c : collapses) {
+
+			if (collapseCnt >= collapseLimit || c.error > maxError)
+				break;
+			if (touched[c.from] || touched[c.to])
+				continue;
+			if (collapseFlipsTriangle(indices, adjacencyOffset, adjacency, positions, c.from, c.to))
+				continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to].add(quadrics[c.from]);
+			resultError = std::max(resultError, c.error);
+			collapseCnt++;
+
+			// neighbourhood of collapse is frozen until the next pass, so the flip test stays valid
+			for (uint32_t a = adjacencyOffset[c.from]; a < adjacencyOffset[c.from + 1]; a++)
+				for (uint32_t k = 0; k < 3; k++)
+					touched[indices[adjacency[a] * 3 + k]] = true;
+			for (uint32_t a = adjacencyOffset[c.to]; a < adjacencyOffset[c.to + 1]; a++)
+				for (uint32_t k = 0; k < 3; k++)
+					touched[indices[adjacency[a] * 3 + k]] = true;
+		}
+
+		if (collapseCnt == 0)
+			break;
+
+		// rewrite indices and drop degenerate triangles
+		size_t out = 0;
+		for (size_t i = 0; i < indices.size(); i += 3) {
+
+			uint32_t a = remap[indices[i]];
+			uint32_t b = remap[indices[i + 1]];
+			uint32_t c = remap[indices[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			indices[out++] = a;
+			indices[out++] = b;
+			indices[out++] = c;
+		}
+		indices.resize(out);
+	}
+
+	return resultError;
+}
+
+
+/**
+*	@brief Select level of detail of submesh.
+*
+*	The error of every level is projected to the screen at the distance of the nearest
+*	point of the bounding sphere. The coarsest level with error under threshold is used.
+*	pixelScale is the viewport height / (2 * tan(fov / 2)).
+*
+*/
+uint32_t HdaMeshLod::selectLod(const HdaModel::IndexInfo& inf, const glm::mat4& model, glm::vec3 cameraPos, float pixelScale, float threshold) {
+
+	if (inf.lodCnt <= 1)
+		return 0;
+
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(inf.boundingSphere), 1.0f));
+	float distance = std::max(glm::length(center - cameraPos) - inf.boundingSphere.w * scale, 0.1f);
+
+	uint32_t lod = 0;
+	for (uint32_t level = 1; level < inf.lodCnt; level++)
+		if (inf.lodError[level] * scale / distance * pixelScale <= threshold)
+			lod = level;
+
+	return lod;
+}
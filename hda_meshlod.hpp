@@ -0,0 +1,45 @@
+#pragma once
+#include "hda_model.hpp"
+
+#define LOD_REDUCTION 0.5f			// triangle count ratio between two following levels
+#define LOD_MIN_REDUCTION 0.9f		// level which is not at least 10 % smaller than the previous one is dropped
+#define LOD_MAX_RELATIVE_ERROR 0.1f	// max simplification error relative to the submesh bounding sphere radius
+#define LOD_PIXEL_ERROR 1.0f		// max allowed projected error in pixels when selecting level
+
+
+/*
+*
+* A class representing automatic generation and selection of levels of detail.
+* Every IndexInfo submesh is simplified by quadric error metrics edge collapses.
+* Levels are stored behind the original indices in the same index buffer and use
+* the same vertices, so no other buffer is needed.
+*
+*/
+
+class HdaMeshLod {
+
+public:
+
+	static void generateLods(HdaModel::Mesh&, const char*);
+	static float simplify(std::vector<uint32_t>&, const glm::vec3*, uint32_t, size_t, float);
+	static uint32_t selectLod(const HdaModel::IndexInfo&, const glm::mat4&, glm::vec3, float, float);
+
+private:
+
+	// symmetric 4x4 matrix of plane equations with the sum of their weights
+	struct Quadric {
+
+		double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		double a11 = 0, a12 = 0, a13 = 0;
+		double a22 = 0, a23 = 0;
+		double a33 = 0;
+		double w = 0;
+
+		void addPlane(glm::vec3, float, float);
+		void add(const Quadric&);
+		float error(glm::vec3) const;
+	};
+
+	static std::vector<bool> findLockedVertices(const std::vector<uint32_t>&, const glm::vec3*, uint32_t);
+	static bool collapseFlipsTriangle(const std::vector<uint32_t>&, const std::vector<uint32_t>&, const std::vector<uint32_t>&, const glm::vec3*, uint32_t, uint32_t);
+};
@@ -0,0 +1,560 @@
+#include "hda_meshoptimizer.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+
+
+/*
+*
+* Vertex cache optimization follows Tom Forsyth's article "Linear-Speed Vertex Cache Optimisation":
+* https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+*
+* Overdraw optimization and statistics are modified from the ideas of Sander et al.
+* "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" and meshoptimizer:
+* https://github.com/zeux/meshoptimizer
+*
+*/
+
+
+/**
+*	@brief Run the whole optimization stage on loaded mesh.
+*
+*	Indexes every submesh, then reorders its triangles for vertex cache and overdraw
+*	and its vertices for vertex fetch. The IndexInfo ranges stay valid, they are only
+*	interpreted as ranges of the index buffer from now on.
+*
+*/
+void HdaMeshOptimizer::optimizeMesh(HdaModel::Mesh& mesh, const char* filename) {
+
+	auto startT = std::chrono::high_resolution_clock::now();
+	size_t rawVertexCnt = mesh.meshVertices.size();
+
+	// (first vertex, vertex count) of every submesh in the new vertex buffer
+	std::vector<std::pair<uint32_t, uint32_t>> spans;
+	indexSubmeshes(mesh, spans);
+
+	VertexCacheStats cacheBefore = analyzeVertexCache(mesh.meshIndices.data(), mesh.meshIndices.size(), VERTEX_CACHE_SIZE);
+	OverdrawStats overdrawBefore = analyzeOverdraw(mesh.meshIndices.data(), mesh.meshIndices.size(), mesh.meshVertices.data());
+
+	for (size_t i = 0; i < mesh.info.size(); i++) {
+
+		if (mesh.info[i].vertexCnt < 3)
+			continue;
+
+		uint32_t* submeshIndices = mesh.meshIndices.data() + mesh.info[i].firstVertex;
+		size_t submeshIndexCnt = mesh.info[i].vertexCnt;
+
+		optimizeVertexCache(submeshIndices, submeshIndexCnt, spans[i].first, spans[i].second);
+		optimizeOverdraw(submeshIndices, submeshIndexCnt, mesh.meshVertices.data(), VERTEX_CACHE_SIZE, OVERDRAW_THRESHOLD);
+		optimizeVertexFetch(submeshIndices, submeshIndexCnt, mesh.meshVertices.data(), spans[i].first, spans[i].second);
+	}
+
+	VertexCacheStats cacheAfter = analyzeVertexCache(mesh.meshIndices.data(), mesh.meshIndices.size(), VERTEX_CACHE_SIZE);
+	OverdrawStats overdrawAfter = analyzeOverdraw(mesh.meshIndices.data(), mesh.meshIndices.size(), mesh.meshVertices.data());
+
+	auto endT = std::chrono::high_resolution_clock::now();
+
+	std::cout << "optimizeMesh(): " << filename << " | submeshes: " << mesh.info.size() << " | vertices: " << rawVertexCnt << " -> " << mesh.meshVertices.size()
+		<< " | triangles: " << cacheAfter.triangleCnt << " | time: " << std::chrono::duration<double, std::milli>(endT - startT).count() << " ms\n";
+	std::cout << std::fixed << std::setprecision(3)
+		<< "\tACMR: " << cacheBefore.acmr << " -> " << cacheAfter.acmr
+		<< " | ATVR: " << cacheBefore.atvr << " -> " << cacheAfter.atvr
+		<< " | overdraw: " << overdrawBefore.overdraw << " -> " << overdrawAfter.overdraw << std::endl;
+	std::cout << std::defaultfloat;
+}
+
+
+/**
+*	@brief Build index buffer of the mesh.
+*
+*	Loader produces one vertex per face corner. Identical vertices are merged inside
+*	each submesh only, so every submesh owns a contiguous span of the vertex buffer,
+*	which is stored in spans. Position k in the index buffer still belongs to the
+*	same face corner as vertex k before, so the IndexInfo ranges need no update.
+*
+*/
+void HdaMeshOptimizer::indexSubmeshes(HdaModel::Mesh& mesh, std::vector<std::pair<uint32_t, uint32_t>>& spans) {
+
+	std::vector<HdaModel::Vertex> vertices;
+	vertices.reserve(mesh.meshVertices.size());
+
+	mesh.meshIndices.assign(mesh.meshVertices.size(), 0);
+	spans.clear();
+	spans.reserve(mesh.info.size());
+
+	for (const auto& inf : mesh.info) {
+
+		auto vertexBase = static_cast<uint32_t>(vertices.size());
+		std::unordered_map<HdaModel::Vertex, uint32_t> uniqueVertices{};
+		uniqueVertices.reserve(inf.vertexCnt);
+
+		for (uint32_t k = inf.firstVertex; k < inf.firstVertex + inf.vertexCnt; k++) {
+
+			auto it = uniqueVertices.find(mesh.meshVertices[k]);
+			if (it == uniqueVertices.end()) {
+				it = uniqueVertices.emplace(mesh.meshVertices[k], static_cast<uint32_t>(vertices.size())).first;
+				vertices.push_back(mesh.meshVertices[k]);
+			}
+			mesh.meshIndices[k] = it->second;
+		}
+
+		spans.emplace_back(vertexBase, static_cast<uint32_t>(vertices.size()) - vertexBase);
+	}
+
+	mesh.meshVertices.swap(vertices);
+}
+
+
+float HdaMeshOptimizer::forsythVertexScore(int cachePosition, uint32_t liveTriangles) {
+
+	// no triangle needs this vertex anymore
+	if (liveTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+
+		// the last triangle was just drawn, its vertices get fixed score so they are not reused immediately
+		if (cachePosition < 3)
+			score = 0.75f;
+		else {
+			float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, 1.5f);
+		}
+	}
+
+	// bonus for vertices with few triangles left, so lonely triangles are not left behind
+	score += 2.0f * std::pow(static_cast<float>(liveTriangles), -0.5f);
+
+	return score;
+}
+
+
+/**
+*	@brief Reorder triangles of one submesh for post-transform vertex cache.
+*
+*	Greedy Forsyth algorithm, the triangle with the highest sum of vertex scores
+*	is emitted next. Indices are expected in range [vertexBase, vertexBase + vertexCnt).
+*
+*/
+void HdaMeshOptimizer::optimizeVertexCache(uint32_t* indices, size_t indexCnt, uint32_t vertexBase, uint32_t vertexCnt) {
+
+	size_t triangleCnt = indexCnt / 3;
+	if (triangleCnt < 2 || vertexCnt == 0)
+		return;
+
+	std::vector<uint32_t> local(indices, indices + triangleCnt * 3);
+	for (auto& idx : local)
+		idx -= vertexBase;
+
+	// vertex -> triangles adjacency in one flat array
+	std::vector<uint32_t> liveTriangles(vertexCnt, 0);
+	for (auto idx : local)
+		liveTriangles[idx]++;
+
+	std::vector<uint32_t> adjacencyOffset(vertexCnt + 1, 0);
+	for (uint32_t v = 0; v < vertexCnt; v++)
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+
+	std::vector<uint32_t> adjacency(local.size());
+	std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+	for (uint32_t t = 0; t < triangleCnt; t++)
+		for (uint32_t k = 0; k < 3; k++)
+			adjacency[fill[local[t * 3 + k]]++] = t;
+
+	std::vector<int> cachePosition(vertexCnt, -1);
+	std::vector<float> vertexScore(vertexCnt);
+	for (uint32_t v = 0; v < vertexCnt; v++)
+		vertexScore[v] = forsythVertexScore(-1, liveTriangles[v]);
+
+	std::vector<float> triangleScore(triangleCnt);
+	std::vector<bool> emitted(triangleCnt, false);
+	for (uint32_t t = 0; t < triangleCnt; t++)
+		triangleScore[t] = vertexScore[local[t * 3]] + vertexScore[local[t * 3 + 1]] + vertexScore[local[t * 3 + 2]];
+
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	size_t bestTriangle = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+	size_t nextUnemitted = 0;
+	size_t out = 0;
+
+	for (size_t e = 0; e < triangleCnt; e++) {
+
+		// no candidate in cache, continue with the first triangle not drawn yet
+		if (bestTriangle == SIZE_MAX) {
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = nextUnemitted;
+		}
+
+		const uint32_t* tri = &local[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+
+		for (uint32_t k = 0; k < 3; k++) {
+
+			uint32_t v = tri[k];
+			indices[out++] = v + vertexBase;
+
+			// remove drawn triangle from the live part of vertex adjacency
+			uint32_t* begin = &adjacency[adjacencyOffset[v]];
+			uint32_t* end = begin + liveTriangles[v];
+			uint32_t* it = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+			std::swap(*it, *(end - 1));
+			liveTriangles[v]--;
+		}
+
+		// vertices of drawn triangle go to the front of the cache
+		newCache.assign(tri, tri + 3);
+		for (uint32_t v : cache)
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache.push_back(v);
+
+		for (size_t i = 0; i < newCache.size(); i++) {
+
+			uint32_t v = newCache[i];
+			cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+			vertexScore[v] = forsythVertexScore(cachePosition[v], liveTriangles[v]);
+		}
+
+		// rescore triangles touched by the cache and pick the best one
+		float bestScore = -1.0f;
+		bestTriangle = SIZE_MAX;
+		for (size_t i = 0; i < newCache.size(); i++) {
+
+			uint32_t v = newCache[i];
+			for (uint32_t a = adjacencyOffset[v]; a < adjacencyOffset[v] + liveTriangles[v]; a++) {
+
+				uint32_t t = adjacency[a];
+				triangleScore[t] = vertexScore[local[t * 3]] + vertexScore[local[t * 3 + 1]] + vertexScore[local[t * 3 + 2]];
+
+				if (i < FORSYTH_CACHE_SIZE && triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (newCache.size() > FORSYTH_CACHE_SIZE)
+			newCache.resize(FORSYTH_CACHE_SIZE);
+		cache.swap(newCache);
+	}
+}
+
+
+/**
+*	@brief Reorder clusters of one submesh to reduce overdraw.
+*
+*	Triangles are split into clusters on vertex cache boundaries, so the order inside
+*	a cluster keeps the cache efficiency. Clusters facing out of the mesh are drawn
+*	first, because they are more likely to occlude the rest. Threshold allows
+*	smaller clusters at the cost of ACMR (1.05 = at most 5 % worse).
+*
+*/
+void HdaMeshOptimizer::optimizeOverdraw(uint32_t* indices, size_t indexCnt, const HdaModel::Vertex* vertices, uint32_t cacheSize, float threshold) {
+
+	size_t triangleCnt = indexCnt / 3;
+	if (triangleCnt < 2)
+		return;
+
+	uint32_t maxIndex = *std::max_element(indices, indices + triangleCnt * 3);
+
+	// FIFO cache simulation with timestamps, vertex is in cache if it was added less than cacheSize misses ago
+	std::vector<uint32_t> timestamps(maxIndex + 1, 0);
+	uint32_t timestamp = cacheSize + 1;
+	auto simulate = [&](size_t t) {
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t v = indices[t * 3 + k];
+			if (timestamp - timestamps[v] > cacheSize) {
+				timestamps[v] = timestamp++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+
+	// hard boundaries - triangle which misses all three vertices starts a new cluster
+	std::vector<size_t> hardClusters;
+	for (size_t t = 0; t < triangleCnt; t++)
+		if (simulate(t) == 3 || t == 0)
+			hardClusters.push_back(t);
+
+	// soft boundaries - split hard clusters where the ACMR of the part with cold cache
+	// is not worse than the ACMR of the whole hard cluster multiplied by threshold
+	std::vector<size_t> clusters;
+	for (size_t c = 0; c < hardClusters.size(); c++) {
+
+		size_t start = hardClusters[c];
+		size_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : triangleCnt;
+
+		timestamp += cacheSize + 1;	// flush cache
+		uint32_t hardMisses = 0;
+		for (size_t t = start; t < end; t++)
+			hardMisses += simulate(t);
+		float hardAcmr = static_cast<float>(hardMisses) / (end - start);
+
+		timestamp += cacheSize + 1;
+		clusters.push_back(start);
+
+		uint32_t clusterMisses = 0;
+		size_t clusterStart = start;
+		for (size_t t = start; t < end; t++) {
+
+			clusterMisses += simulate(t);
+			float clusterAcmr = static_cast<float>(clusterMisses) / (t - clusterStart + 1);
+
+			if (t + 1 < end && clusterAcmr <= hardAcmr * threshold) {
+				clusters.push_back(t + 1);
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				timestamp += cacheSize + 1;
+			}
+		}
+	}
+
+	// mesh centroid
+	glm::vec3 meshCentroid{ 0.0f };
+	for (size_t i = 0; i < triangleCnt * 3; i++)
+		meshCentroid += vertices[indices[i]].position;
+	meshCentroid /= static_cast<float>(triangleCnt * 3);
+
+	auto sortClusters = [&](const std::vector<size_t>& clusterStarts) {
+
+		// sort key - how much the cluster is facing out of the mesh
+		std::vector<float> sortKey(clusterStarts.size());
+		for (size_t c = 0; c < clusterStarts.size(); c++) {
+
+			size_t start = clusterStarts[c];
+			size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCnt;
+
+			glm::vec3 centroid{ 0.0f };
+			glm::vec3 normal{ 0.0f };
+			float area = 0.0f;
+
+			for (size_t t = start; t < end; t++) {
+
+				glm::vec3 p0 = vertices[indices[t * 3 + 0]].position;
+				glm::vec3 p1 = vertices[indices[t * 3 + 1]].position;
+				glm::vec3 p2 = vertices[indices[t * 3 + 2]].position;
+
+				glm::vec3 n = glm::cross(p1 - p0, p2 - p0);	// length = 2 * area
+				float a = glm::length(n);
+
+				centroid += (p0 + p1 + p2) * (a / 3.0f);
+				normal += n;
+				area += a;
+			}
+
+			float normalLength = glm::length(normal);
+			if (area > 0.0f && normalLength > 0.0f)
+				sortKey[c] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+			else
+				sortKey[c] = -FLT_MAX;
+		}
+
+		std::vector<size_t> order(clusterStarts.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+		std::vector<uint32_t> sorted;
+		sorted.reserve(triangleCnt * 3);
+		for (size_t c : order) {
+
+			size_t start = clusterStarts[c];
+			size_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCnt;
+			sorted.insert(sorted.end(), indices + start * 3, indices + end * 3);
+		}
+		return sorted;
+	};
+
+	// the fine clusters are tried first, coarse hard clusters next and if the
+	// ACMR would still get worse than the threshold allows, the order is kept
+	float cacheAcmr = analyzeVertexCache(indices, triangleCnt * 3, cacheSize).acmr;
+	for (const auto* candidate : { &clusters, &hardClusters }) {
+
+		if (candidate->size() < 2)
+			continue;
+
+		std::vector<uint32_t> sorted = sortClusters(*candidate);
+		if (analyzeVertexCache(sorted.data(), sorted.size(), cacheSize).acmr <= cacheAcmr * threshold) {
+			std::copy(sorted.begin(), sorted.end(), indices);
+			return;
+		}
+	}
+}
+
+
+/**
+*	@brief Reorder vertices of one submesh in order of first use.
+*
+*	Vertices in span [vertexBase, vertexBase + vertexCnt) are moved in place
+*	and indices are remapped accordingly.
+*
+*/
+void HdaMeshOptimizer::optimizeVertexFetch(uint32_t* indices, size_t indexCnt, HdaModel::Vertex* vertices, uint32_t vertexBase, uint32_t vertexCnt) {
+
+	std::vector<uint32_t> remap(vertexCnt, UINT32_MAX);
+	uint32_t next = 0;
+
+	for (size_t i = 0; i < indexCnt; i++) {
+
+		uint32_t v = indices[i] - vertexBase;
+		if (remap[v] == UINT32_MAX)
+			remap[v] = next++;
+		indices[i] = vertexBase + remap[v];
+	}
+
+	// unreferenced vertices go to the end of the span
+	for (uint32_t v = 0; v < vertexCnt; v++)
+		if (remap[v] == UINT32_MAX)
+			remap[v] = next++;
+
+	std::vector<HdaModel::Vertex> original(vertices + vertexBase, vertices + vertexBase + vertexCnt);
+	for (uint32_t v = 0; v < vertexCnt; v++)
+		vertices[vertexBase + remap[v]] = original[v];
+}
+
+
+/**
+*	@brief Simulate FIFO post-transform vertex cache.
+*
+*	ACMR is the number of vertex shader invocations per triangle (0.5 - 3.0),
+*	ATVR per unique vertex (1.0 is the optimum).
+*
+*/
+HdaMeshOptimizer::VertexCacheStats HdaMeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCnt, uint32_t cacheSize) {
+
+	VertexCacheStats stats{};
+	stats.triangleCnt = static_cast<uint32_t>(indexCnt / 3);
+	if (stats.triangleCnt == 0)
+		return stats;
+
+	uint32_t maxIndex = *std::max_element(indices, indices + indexCnt);
+	std::vector<uint32_t> timestamps(maxIndex + 1, 0);
+	std::vector<bool> used(maxIndex + 1, false);
+	uint32_t timestamp = cacheSize + 1;
+
+	for (size_t i = 0; i < stats.triangleCnt * 3; i++) {
+
+		uint32_t v = indices[i];
+		if (timestamp - timestamps[v] > cacheSize) {
+			timestamps[v] = timestamp++;
+			stats.vertexTransforms++;
+		}
+		if (!used[v]) {
+			used[v] = true;
+			stats.vertexCnt++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(stats.vertexTransforms) / stats.triangleCnt;
+	stats.atvr = static_cast<float>(stats.vertexTransforms) / stats.vertexCnt;
+
+	return stats;
+}
+
+
+/**
+*	@brief Estimate overdraw by software rasterization.
+*
+*	The mesh is rendered in the index buffer order from six axis aligned directions
+*	into a small depth buffer with early depth test. Overdraw is the number
+*	of shaded fragments divided by the number of covered pixels (1.0 is the optimum).
+*
+*/
+HdaMeshOptimizer::OverdrawStats HdaMeshOptimizer::analyzeOverdraw(const uint32_t* indices, size_t indexCnt, const HdaModel::Vertex* vertices) {
+
+	OverdrawStats stats{};
+	size_t triangleCnt = indexCnt / 3;
+	if (triangleCnt == 0)
+		return stats;
+
+	glm::vec3 minP{ FLT_MAX };
+	glm::vec3 maxP{ -FLT_MAX };
+	for (size_t i = 0; i < triangleCnt * 3; i++) {
+		minP = glm::min(minP, vertices[indices[i]].position);
+		maxP = glm::max(maxP, vertices[indices[i]].position);
+	}
+	glm::vec3 extent = maxP - minP;
+	float scale = std::max(extent.x, std::max(extent.y, extent.z));
+	if (scale <= 0.0f)
+		return stats;
+
+	std::vector<float> depthBuffer(OVERDRAW_VIEWPORT * OVERDRAW_VIEWPORT);
+
+	for (int axis = 0; axis < 3; axis++) {
+		for (int direction = 0; direction < 2; direction++) {
+
+			std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+			for (size_t t = 0; t < triangleCnt; t++) {
+
+				glm::vec3 screen[3];
+				for (int k = 0; k < 3; k++) {
+
+					glm::vec3 p = (vertices[indices[t * 3 + k]].position - minP) / scale;
+					float depth = p[axis];
+					screen[k] = glm::vec3(p[(axis + 1) % 3] * (OVERDRAW_VIEWPORT - 1), p[(axis + 2) % 3] * (OVERDRAW_VIEWPORT - 1), direction == 0 ? depth : 1.0f - depth);
+				}
+
+				rasterizeTriangle(screen[0], screen[1], screen[2], depthBuffer, stats);
+			}
+
+			for (float d : depthBuffer)
+				if (d != FLT_MAX)
+					stats.pixelsCovered++;
+		}
+	}
+
+	stats.overdraw = stats.pixelsCovered == 0 ? 0.0f : static_cast<float>(stats.pixelsShaded) / stats.pixelsCovered;
+
+	return stats;
+}
+
+
+void HdaMeshOptimizer::rasterizeTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, std::vector<float>& depthBuffer, OverdrawStats& stats) {
+
+	auto edge = [](const glm::vec3& p0, const glm::vec3& p1, float x, float y) {
+		return (p1.x - p0.x) * (y - p0.y) - (p1.y - p0.y) * (x - p0.x);
+	};
+
+	float area = edge(a, b, c.x, c.y);
+	if (area == 0.0f)
+		return;
+
+	// pipelines do not cull, so both windings are rasterized
+	if (area < 0.0f) {
+		std::swap(b, c);
+		area = -area;
+	}
+
+	int minX = std::max(0, static_cast<int>(std::floor(std::min(a.x, std::min(b.x, c.x)))));
+	int minY = std::max(0, static_cast<int>(std::floor(std::min(a.y, std::min(b.y, c.y)))));
+	int maxX = std::min(OVERDRAW_VIEWPORT - 1, static_cast<int>(std::ceil(std::max(a.x, std::max(b.x, c.x)))));
+	int maxY = std::min(OVERDRAW_VIEWPORT - 1, static_cast<int>(std::ceil(std::max(a.y, std::max(b.y, c.y)))));
+
+	for (int y = minY; y <= maxY; y++) {
+		for (int x = minX; x <= maxX; x++) {
+
+			float px = x + 0.5f, py = y + 0.5f;
+			float w0 = edge(b, c, px, py);
+			float w1 = edge(c, a, px, py);
+			float w2 = edge(a, b, px, py);
+			if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+				continue;
+
+			float z = (w0 * a.z + w1 * b.z + w2 * c.z) / area;
+			float& d = depthBuffer[y * OVERDRAW_VIEWPORT + x];
+			if (z < d) {
+				d = z;
+				stats.pixelsShaded++;
+			}
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "hda_model.hpp"
+
+#define VERTEX_CACHE_SIZE 16
+#define FORSYTH_CACHE_SIZE 32
+#define OVERDRAW_THRESHOLD 1.05f
+#define OVERDRAW_VIEWPORT 256
+
+
+/*
+*
+* A class representing the mesh optimization stage. After loading, the geometry
+* of every submesh (IndexInfo range) is indexed and reordered for the post-transform
+* vertex cache, overdraw and vertex fetch. All statistics are computed on the CPU.
+*
+*/
+
+class HdaMeshOptimizer {
+
+public:
+
+	struct VertexCacheStats {
+
+		uint32_t vertexTransforms = 0;	// number of cache misses
+		uint32_t triangleCnt = 0;
+		uint32_t vertexCnt = 0;			// number of unique vertices
+		float acmr = 0.0f;				// average cache miss ratio - transforms per triangle
+		float atvr = 0.0f;				// average transform to vertex ratio - transforms per vertex
+	};
+
+	struct OverdrawStats {
+
+		uint64_t pixelsCovered = 0;
+		uint64_t pixelsShaded = 0;
+		float overdraw = 0.0f;			// shaded / covered
+	};
+
+	static void optimizeMesh(HdaModel::Mesh&, const char*);
+
+	static void indexSubmeshes(HdaModel::Mesh&, std::vector<std::pair<uint32_t, uint32_t>>&);
+	static void optimizeVertexCache(uint32_t*, size_t, uint32_t, uint32_t);
+	static void optimizeOverdraw(uint32_t*, size_t, const HdaModel::Vertex*, uint32_t, float);
+	static void optimizeVertexFetch(uint32_t*, size_t, HdaModel::Vertex*, uint32_t, uint32_t);
+
+	static VertexCacheStats analyzeVertexCache(const uint32_t*, size_t, uint32_t);
+	static OverdrawStats analyzeOverdraw(const uint32_t*, size_t, const HdaModel::Vertex*);
+
+private:
+
+	static float forsythVertexScore(int, uint32_t);
+	static void rasterizeTriangle(glm::vec3, glm::vec3, glm::vec3, std::vector<float>&, OverdrawStats&);
+};
@@ -197,12 +197,29 @@ void HdaModel::Mesh::loadObjFormat(const char* filename, std::string mtlBasedir)
 		inf.vertexCnt = vertexCount;
 		inf.firstVertex = fstVertex;
 		info.push_back(inf);
+
+		// next shape starts a new sub-group, otherwise the ranges of shapes would overlap
+		fstVertex = static_cast<uint32_t>(meshVertices.size());
+		vertexCount = 0;
 	}
 
 	submeshCnt = submeshCount;
 }
 
 
+glm::vec3 HdaModel::getCameraPosition() {
+
+	return camera;
+}
+
+
+// view matrix of the last projectionCalculation() call
+glm::mat4 HdaModel::getCameraView() {
+
+	return glm::lookAt(camera, camera + zCameraSpace, yCameraSpace);
+}
+
+
 /*
 *  Code of camera movement modified from tutorial article obtained from LearnOpenGL:
 *  https://learnopengl.com/Getting-started/Camera
@@ -230,7 +247,7 @@ HdaModel::ProjectionUniformData HdaModel::projectionCalculation(glm::mat4 model,
 
 	//camera projection
 	glfwGetFramebufferSize(window, &width, &height);
-	glm::mat4 projection = glm::perspective(glm::radians(55.f), float(width)/float(height), 0.1f, 400.0f);
+	glm::mat4 projection = glm::perspective(glm::radians(CAMERA_FOV), float(width)/float(height), CAMERA_NEAR, CAMERA_FAR);
 	projection[1][1] *= -1;
 	modelviewProjection.proj = projection;
 
@@ -303,12 +320,9 @@ void HdaModel::loadMaterialData(HdaModel::MaterialLightUniformData* mlData, glm:
 }
 
 
-void HdaModel::loadLightData(HdaModel::MaterialLightUniformData* mlData, glm::vec4 lightAmbient, glm::vec4 lightDiffuse, glm::vec4 lightSpecular, std::array<glm::vec4, 2> positions, std::array<glm::vec4, 2> directions) {
+void HdaModel::loadLightData(HdaModel::MaterialLightUniformData* mlData, glm::vec4 lightAmbient, glm::vec4 lightDiffuse, glm::vec4 lightSpecular) {
 
 	mlData->lightAmbient = lightAmbient;
 	mlData->lightDiffuse = lightDiffuse;
 	mlData->lightSpecular = lightSpecular;
-
-	mlData->lightDirections = directions;
-	mlData->lightPositions = positions;
 }
\ No newline at end of file
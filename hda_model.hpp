@@ -17,6 +17,11 @@
 
 #define P (std::cout << "print debug" << endl)
 
+#define MAX_LOD_LEVELS 4
+#define CAMERA_FOV 55.f
+#define CAMERA_NEAR 0.1f
+#define CAMERA_FAR 400.0f
+
 
 /*
 *
@@ -44,15 +49,45 @@ public:
 		static std::array<vk::VertexInputAttributeDescription, 4> getAttributeDescription();
 
 		bool operator==(const Vertex& other) const {
-			return position == other.position && color == other.color && uv == other.uv;
+			return position == other.position && normal == other.normal && color == other.color && uv == other.uv;
 		}
 	};
 
+	// per instance data of instanced objects, read as instance rate vertex attributes
+	struct InstanceData {
+
+		glm::mat4 model{ 1.0f };	// applied after the model matrix of object
+		glm::vec4 tint{ 1.0f };		// multiplies vertex color
+	};
+
 	struct IndexInfo {
 
-		uint32_t vertexCnt = 0;		// vertex count;
-		uint32_t firstVertex = 0;	// offset for drawing - where to start drawing
+		uint32_t vertexCnt = 0;		// vertex count; index count after HdaMeshOptimizer::optimizeMesh()
+		uint32_t firstVertex = 0;	// offset for drawing - where to start drawing (into index buffer after optimization)
 		uint32_t textureIndex = UINT32_MAX;	// index for texture
+
+		// levels of detail, level 0 is the range above
+		uint32_t lodCnt = 1;
+		std::array<uint32_t, MAX_LOD_LEVELS> lodFirstIndex{};
+		std::array<uint32_t, MAX_LOD_LEVELS> lodIndexCnt{};
+		std::array<float, MAX_LOD_LEVELS> lodError{};	// simplification error in model units
+		glm::vec4 boundingSphere{ 0.0f };	// center + radius in model space
+
+		// meshlets of level 0, range into Mesh::meshlets
+		uint32_t firstMeshlet = 0;
+		uint32_t meshletCnt = 0;
+	};
+
+	// small cluster of triangles, layout matches the storage buffer in meshlet_cull.comp
+	struct Meshlet {
+
+		glm::vec4 boundingSphere{ 0.0f };	// center + radius in model space
+		glm::vec4 coneApex{ 0.0f };			// apex of the normal cone
+		glm::vec4 coneAxis{ 0.0f };			// axis + cutoff, cutoff 1 means the cone can not be culled
+		uint32_t firstIndex = 0;			// triangles of meshlet are continuous in index buffer
+		uint32_t indexCnt = 0;
+		uint32_t submesh = 0;				// index into Mesh::info
+		uint32_t vertexCnt = 0;
 	};
 
 	struct Material {
@@ -82,19 +117,20 @@ public:
 		std::vector<Material> mats;
 		uint32_t submeshCnt = 0;
 
+		std::vector<Meshlet> meshlets;
+
 		void loadObjFormat(const char*, std::string);
 	};
 
+	// push constants do not change between frames, the model matrix is in SceneUniformData
 	struct PushConstants {
 
 		glm::vec3 cameraPosition;
 		int texId;
-		glm::mat4 modelMatrix;
 	};
 
 	struct SkyboxPushConstants {
 
-		glm::mat4 viewMatrix;
 		glm::mat4 modelMatrix;
 	};
 
@@ -110,6 +146,7 @@ public:
 		alignas(16) glm::mat4 normalMatrix{ 1.0f };
 		alignas(16) glm::mat4 normalMatrixWorld{ 1.0f };
 		alignas(16) glm::mat4 modelView{ 1.0f };
+		alignas(16) glm::mat4 modelMatrix{ 1.0f };
 		int nontextureFlag = 0;
 		int blinnPhongFlag = 0;
 		int pointLightFlag = 0;
@@ -125,9 +162,7 @@ public:
 		alignas(16) glm::vec4 materialDiffuse{ 1.0f };
 		alignas(16) glm::vec4 materialSpecular{ 1.0f };
 
-		// light data
-		alignas(16) std::array<glm::vec4, 2> lightPositions;
-		alignas(16) std::array<glm::vec4, 2> lightDirections;
+		// light data, positions and directions of lights are in the light list of HdaLights
 		alignas(16) glm::vec4 lightAmbient{ 1.0f };
 		alignas(16) glm::vec4 lightDiffuse{ 1.0f };
 		alignas(16) glm::vec4 lightSpecular{ 1.0f };
@@ -158,19 +193,67 @@ public:
 		int nonRotateFlag = 0;
 		int texObjIndex = 0;
 		int multiTextureFlag = 0;
+		int materialOverrideFlag = 0;	// overrideMaterial replaces materials of the mesh
+		Material overrideMaterial{};
 		glm::mat4 modelMatrix = glm::mat4{ 1.0f };
 		vk::Pipeline objectPipeline;
 		vk::PipelineLayout objectPipelineLayout;
 		std::vector<vk::DescriptorSet> objectDescriptSets;
 		std::vector<std::vector<vk::DescriptorSet>> dsv;
 		vk::DescriptorSetLayout objectDescriptSetLay;
+
+		// meshlet culling, buffers are created only for objects with meshlets
+		vk::Buffer meshletBuff;
+		vk::DeviceMemory meshletBuffMemory;
+		vk::Buffer drawTemplateBuff;	// draw commands with zero index count, copied before culling
+		vk::DeviceMemory drawTemplateBuffMemory;
+		std::vector<vk::Buffer> culledIndexBuffs;
+		std::vector<vk::DeviceMemory> culledIndexBuffsMemory;
+		std::vector<vk::Buffer> drawCmdBuffs;
+		std::vector<vk::DeviceMemory> drawCmdBuffsMemory;
+		std::vector<void*> drawCmdBuffsPointer;
+		std::vector<vk::Buffer> cullUniformBuffs;
+		std::vector<vk::DeviceMemory> cullUniformBuffsMemory;
+		std::vector<void*> cullUniformBuffsPointer;
+		std::vector<vk::DescriptorSet> cullDescriptSets;
+
+		// state of the frame prepared by prepareScene(), used by all drawings of the frame
+		vk::Buffer visibilityBuff;		// meshlets visible in the last frame
+		vk::DeviceMemory visibilityBuffMemory;
+		PushConstants pushConstants{};
+		SkyboxPushConstants skyboxConstants{};
+		std::vector<uint32_t> selectedLods;
+		std::vector<uint32_t> submeshMaterialSlots;	// slot of material in dynamic uniform buffer, multitextured objects only
+		uint32_t materialSlotBase = 0;				// first of these slots, every multitextured object has its own range
+
+		// draws of the selected levels of detail written every frame, prerecorded command buffers draw from them
+		std::vector<vk::Buffer> drawArgsBuffs;
+		std::vector<vk::DeviceMemory> drawArgsBuffsMemory;
+		std::vector<void*> drawArgsBuffsPointer;
+
+		// depth prepass, the skybox uses only objectPipeline
+		vk::Pipeline depthPrepassPipeline;	// position only, no color writes
+		vk::Pipeline depthEqualPipeline;	// shading with eEqual depth test and no depth writes
+
+		// geometry pass of deferred shading, the skybox variant is drawn after the lighting pass without depth writes
+		vk::Pipeline deferredPipeline;
+
+		// instancing, the object is drawn once for every visible instance when instances are not empty
+		std::vector<InstanceData> instances;
+		glm::vec4 instanceSphere{ 0.0f };	// bounding sphere of mesh in model space
+		std::vector<vk::Buffer> instanceBuffs;		// visible instances sorted by level of detail, one buffer per frame
+		std::vector<vk::DeviceMemory> instanceBuffsMemory;
+		std::vector<void*> instanceBuffsPointer;
+		std::array<uint32_t, MAX_LOD_LEVELS + 1> instanceLodFirst{};	// visible instances of level l are [first[l], first[l + 1])
 	};
 
 	//////// functions
 
+	static glm::vec3 getCameraPosition();
+	static glm::mat4 getCameraView();
 	static ProjectionUniformData projectionCalculation(glm::mat4, GLFWwindow*, glm::mat4*, glm::vec3, HdaModel::SceneUniformData*, bool, float*);
 	static void HdaModel::loadMaterialData(HdaModel::MaterialLightUniformData*, glm::vec4, glm::vec4, glm::vec4, float);
-	static void HdaModel::loadLightData(HdaModel::MaterialLightUniformData*, glm::vec4, glm::vec4, glm::vec4, std::array<glm::vec4, 2>, std::array<glm::vec4, 2>);
+	static void HdaModel::loadLightData(HdaModel::MaterialLightUniformData*, glm::vec4, glm::vec4, glm::vec4);
 };
 
 namespace std {
@@ -0,0 +1,284 @@
+#include "hda_occlusion.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+
+/*
+*
+* Two phase occlusion culling and the sphere projection are modified from
+* Arseny Kapoulkine's niagara renderer:
+* https://github.com/zeux/niagara
+*
+* and the projection of sphere comes from Mara and McGuire
+* "2D Polyhedral Bounds of a Clipped, Perspective-Projected 3D Sphere":
+* https://jcgt.org/published/0002/02/05/
+*
+*/
+
+
+// the largest power of two which is not larger than the depth attachment
+glm::uvec2 HdaOcclusion::pyramidSize(uint32_t width, uint32_t height) {
+
+	glm::uvec2 size{ 1, 1 };
+	while (size.x * 2 <= width)
+		size.x *= 2;
+	while (size.y * 2 <= height)
+		size.y *= 2;
+
+	return size;
+}
+
+
+uint32_t HdaOcclusion::pyramidLevels(uint32_t width, uint32_t height) {
+
+	glm::uvec2 size = pyramidSize(width, height);
+	uint32_t levels = 1;
+	while ((std::max(size.x, size.y) >> levels) > 0)
+		levels++;
+
+	return std::min<uint32_t>(levels, DEPTH_PYRAMID_MAX_LEVELS);
+}
+
+
+HdaOcclusion::Projection HdaOcclusion::cameraProjection(float aspect) {
+
+	Projection proj{};
+
+	proj.p11 = 1.0f / std::tan(glm::radians(CAMERA_FOV) * 0.5f);
+	proj.p00 = proj.p11 / aspect;
+	proj.depthA = CAMERA_FAR / (CAMERA_FAR - CAMERA_NEAR);
+	proj.depthB = -CAMERA_FAR * CAMERA_NEAR / (CAMERA_FAR - CAMERA_NEAR);
+	proj.zNear = CAMERA_NEAR;
+
+	return proj;
+}
+
+
+/**
+*	@brief Build depth pyramid from depth buffer.
+*
+*	Level 0 is resampled to power of two size, so one texel covers up to 3x3 texels
+*	of depth buffer. Every level keeps the maximum of the covered texels, so the test
+*	against it is conservative.
+*
+*/
+HdaOcclusion::DepthPyramid HdaOcclusion::buildPyramid(const std::vector<float>& depth, uint32_t width, uint32_t height) {
+
+	DepthPyramid pyramid;
+	glm::uvec2 size = pyramidSize(width, height);
+	uint32_t levels = pyramidLevels(width, height);
+
+	const float* src = depth.data();
+	glm::uvec2 srcSize{ width, height };
+
+	for (uint32_t l = 0; l < levels; l++) {
+
+		glm::uvec2 dstSize{ std::max(size.x >> l, 1u), std::max(size.y >> l, 1u) };
+		std::vector<float> dst(static_cast<size_t>(dstSize.x) * dstSize.y);
+
+		for (uint32_t y = 0; y < dstSize.y; y++) {
+			for (uint32_t x = 0; x < dstSize.x; x++) {
+
+				uint32_t x0 = x * srcSize.x / dstSize.x;
+				uint32_t y0 = y * srcSize.y / dstSize.y;
+				uint32_t x1 = std::min(((x + 1) * srcSize.x + dstSize.x - 1) / dstSize.x, srcSize.x);
+				uint32_t y1 = std::min(((y + 1) * srcSize.y + dstSize.y - 1) / dstSize.y, srcSize.y);
+
+				float d = 0.0f;
+				for (uint32_t sy = y0; sy < y1; sy++)
+					for (uint32_t sx = x0; sx < x1; sx++)
+						d = std::max(d, src[static_cast<size_t>(sy) * srcSize.x + sx]);
+
+				dst[static_cast<size_t>(y) * dstSize.x + x] = d;
+			}
+		}
+
+		pyramid.sizes.push_back(dstSize);
+		pyramid.levels.push_back(std::move(dst));
+		src = pyramid.levels.back().data();
+		srcSize = dstSize;
+	}
+
+	return pyramid;
+}
+
+
+/**
+*	@brief Project sphere in view space to screen rectangle.
+*
+*	The camera looks in the direction of -z. The rectangle is in uv coordinates
+*	(minU, minV, maxU, maxV) with v going down as in the framebuffer. Returns false
+*	if the sphere intersects the near plane and can not be projected.
+*
+*/
+bool HdaOcclusion::projectSphere(glm::vec3 center, float radius, const Projection& proj, glm::vec4& rect) {
+
+	// distance in front of the camera
+	glm::vec3 c{ center.x, center.y, -center.z };
+	if (c.z < radius + proj.zNear)
+		return false;
+
+	glm::vec2 cx{ -c.x, -c.z };
+	glm::vec2 vx{ std::sqrt(glm::dot(cx, cx) - radius * radius), radius };
+	glm::vec2 minX{ vx.x * cx.x - vx.y * cx.y, vx.y * cx.x + vx.x * cx.y };
+	glm::vec2 maxX{ vx.x * cx.x + vx.y * cx.y, -vx.y * cx.x + vx.x * cx.y };
+
+	glm::vec2 cy{ -c.y, -c.z };
+	glm::vec2 vy{ std::sqrt(glm::dot(cy, cy) - radius * radius), radius };
+	glm::vec2 minY{ vy.x * cy.x - vy.y * cy.y, vy.y * cy.x + vy.x * cy.y };
+	glm::vec2 maxY{ vy.x * cy.x + vy.y * cy.y, -vy.y * cy.x + vy.x * cy.y };
+
+	glm::vec4 clip{ minX.x / minX.y * proj.p00, minY.x / minY.y * proj.p11, maxX.x / maxX.y * proj.p00, maxY.x / maxY.y * proj.p11 };
+
+	// clip space -> uv space, y axis is flipped
+	rect = glm::vec4(clip.x * 0.5f + 0.5f, clip.w * -0.5f + 0.5f, clip.z * 0.5f + 0.5f, clip.y * -0.5f + 0.5f);
+
+	return true;
+}
+
+
+/**
+*	@brief Test sphere in view space against depth pyramid.
+*
+*	The level is chosen so the rectangle covers at most 2x2 texels, the farthest
+*	of them is compared with the nearest point of the sphere.
+*
+*/
+bool HdaOcclusion::isSphereOccluded(const DepthPyramid& pyramid, glm::vec3 center, float radius, const Projection& proj) {
+
+	glm::vec4 rect;
+	if (pyramid.levels.empty() || !projectSphere(center, radius, proj, rect))
+		return false;
+
+	float width = (rect.z - rect.x) * pyramid.sizes[0].x;
+	float height = (rect.w - rect.y) * pyramid.sizes[0].y;
+	float level = std::ceil(std::log2(std::max(std::max(width, height), 1.0f)));
+	uint32_t l = std::min(static_cast<uint32_t>(level), static_cast<uint32_t>(pyramid.levels.size()) - 1);
+
+	glm::uvec2 size = pyramid.sizes[l];
+	auto texel = [](float uv, uint32_t s) { return static_cast<uint32_t>(std::clamp(static_cast<int>(std::floor(uv * s)), 0, static_cast<int>(s) - 1)); };
+	uint32_t x0 = texel(rect.x, size.x), x1 = texel(rect.z, size.x);
+	uint32_t y0 = texel(rect.y, size.y), y1 = texel(rect.w, size.y);
+
+	float depth = 0.0f;
+	for (uint32_t y = y0; y <= y1; y++)
+		for (uint32_t x = x0; x <= x1; x++)
+			depth = std::max(depth, pyramid.levels[l][static_cast<size_t>(y) * size.x + x]);
+
+	float sphereDepth = proj.depthA + proj.depthB / (-center.z - radius);
+
+	return sphereDepth > depth;
+}
+
+
+/**
+*	@brief Compare the pyramid and the sphere test with scans of the depth buffer.
+*
+*	The depth buffer has no power of two size, random far depth and a few near walls.
+*	Every texel of every level must be the maximum of the depth texels under its area.
+*	The sphere test reads a coarser level than the scan of its rectangle, so it may keep
+*	an occluded sphere, but it must never cull a sphere which the scan sees.
+*
+*/
+bool HdaOcclusion::selfTest() {
+
+	const uint32_t width = 1000;
+	const uint32_t height = 600;
+	Projection proj = cameraProjection(static_cast<float>(width) / height);
+	auto depthAt = [&](float distance) { return proj.depthA + proj.depthB / distance; };
+
+	std::mt19937 random(29);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<float> depth(static_cast<size_t>(width) * height);
+	for (float& d : depth)
+		d = depthAt(100.0f + 200.0f * unit(random));
+
+	// walls at 5 - 20 units cover about a half of the screen
+	for (uint32_t w = 0; w < 6; w++) {
+
+		uint32_t x0 = static_cast<uint32_t>(unit(random) * width * 0.8f), y0 = static_cast<uint32_t>(unit(random) * height * 0.8f);
+		uint32_t x1 = std::min(x0 + 100 + static_cast<uint32_t>(unit(random) * 300), width);
+		uint32_t y1 = std::min(y0 + 60 + static_cast<uint32_t>(unit(random) * 200), height);
+		float d = depthAt(5.0f + 15.0f * unit(random));
+		for (uint32_t y = y0; y < y1; y++)
+			for (uint32_t x = x0; x < x1; x++)
+				depth[static_cast<size_t>(y) * width + x] = std::min(depth[static_cast<size_t>(y) * width + x], d);
+	}
+
+	DepthPyramid pyramid = buildPyramid(depth, width, height);
+
+	// maximum of the depth texels which intersect [x0, x1) x [y0, y1) of level size
+	auto scan = [&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1, glm::uvec2 size) {
+
+		uint32_t sx0 = x0 * width / size.x, sy0 = y0 * height / size.y;
+		uint32_t sx1 = std::min((x1 * width + size.x - 1) / size.x, width);
+		uint32_t sy1 = std::min((y1 * height + size.y - 1) / size.y, height);
+
+		float d = 0.0f;
+		for (uint32_t y = sy0; y < sy1; y++)
+			for (uint32_t x = sx0; x < sx1; x++)
+				d = std::max(d, depth[static_cast<size_t>(y) * width + x]);
+		return d;
+	};
+
+	uint64_t texels = 0, texelErrors = 0;
+	for (uint32_t l = 0; l < pyramid.levels.size(); l++) {
+
+		glm::uvec2 size = pyramid.sizes[l];
+		for (uint32_t y = 0; y < size.y; y++)
+			for (uint32_t x = 0; x < size.x; x++) {
+
+				texels++;
+				if (pyramid.levels[l][static_cast<size_t>(y) * size.x + x] != scan(x, y, x + 1, y + 1, size))
+					texelErrors++;
+			}
+	}
+
+	// spheres over the whole screen from the near plane to behind the far depth
+	uint32_t spheres = 4000, culledVisible = 0, occluded = 0, kept = 0;
+	for (uint32_t i = 0; i < spheres; i++) {
+
+		float distance = 1.0f + 300.0f * unit(random) * unit(random);
+		float radius = 0.05f + distance * 0.1f * unit(random);
+		glm::vec2 ndc{ unit(random) * 2.0f - 1.0f, unit(random) * 2.0f - 1.0f };
+		glm::vec3 center{ ndc.x * distance / proj.p00, -ndc.y * distance / proj.p11, -distance };
+
+		glm::vec4 rect;
+		if (!projectSphere(center, radius, proj, rect))
+			continue;
+
+		auto pixel = [](float uv, uint32_t s) { return static_cast<uint32_t>(std::clamp(static_cast<int>(std::floor(uv * s)), 0, static_cast<int>(s) - 1)); };
+		float sceneDepth = scan(pixel(rect.x, width), pixel(rect.y, height), pixel(rect.z, width) + 1, pixel(rect.w, height) + 1, glm::uvec2(width, height));
+		bool scanOccluded = depthAt(distance - radius) > sceneDepth;
+
+		bool pyramidOccluded = isSphereOccluded(pyramid, center, radius, proj);
+		if (pyramidOccluded && !scanOccluded)
+			culledVisible++;
+		if (pyramidOccluded)
+			occluded++;
+		if (scanOccluded && !pyramidOccluded)
+			kept++;
+	}
+
+	bool ok = true;
+	auto check = [&](bool condition, const char* what) {
+
+		std::cout << "selfTest(): " << (condition ? "ok     " : "FAILED ") << what << std::endl;
+		ok = ok && condition;
+	};
+
+	std::cout << "selfTest(): " << pyramid.levels.size() << " levels, " << texels << " texels, " << texelErrors << " differ from the scan\n";
+	std::cout << "selfTest(): " << spheres << " spheres, " << occluded << " culled by pyramid, " << culledVisible << " of them visible in the scan, "
+		<< kept << " occluded in the scan but kept\n";
+
+	check(pyramid.sizes[0].x == 512 && pyramid.sizes[0].y == 512 && pyramid.sizes.back().x == 1 && pyramid.sizes.back().y == 1, "pyramid has power of two levels down to 1x1");
+	check(texelErrors == 0, "every texel is the maximum depth under its area");
+	check(culledVisible == 0, "no visible sphere is culled");
+	check(occluded > 0, "spheres behind walls are culled");
+
+	return ok;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "hda_model.hpp"
+
+#define DEPTH_PYRAMID_MAX_LEVELS 16
+#define DEPTH_PYRAMID_GROUP_SIZE 8		// local_size_x and local_size_y in depth_pyramid.comp
+
+
+/*
+*
+* A class representing the CPU side of the hierarchical depth (Hi-Z) occlusion test.
+* The depth pyramid has power of two size smaller or equal to the depth attachment,
+* every texel keeps the farthest depth of the area it covers. The functions mirror
+* depth_pyramid.comp and the occlusion test in meshlet_cull.comp, so they can be used
+* to check the GPU results.
+*
+*/
+
+class HdaOcclusion {
+
+public:
+
+	struct DepthPyramid {
+
+		std::vector<glm::uvec2> sizes;
+		std::vector<std::vector<float>> levels;
+	};
+
+	// projection data needed by the test, perspective of projectionCalculation()
+	struct Projection {
+
+		float p00 = 1.0f;		// projection[0][0]
+		float p11 = 1.0f;		// projection[1][1] before the flip of y axis
+		float depthA = 1.0f;	// depth = depthA + depthB / distance
+		float depthB = 0.0f;
+		float zNear = CAMERA_NEAR;
+	};
+
+	static glm::uvec2 pyramidSize(uint32_t, uint32_t);
+	static uint32_t pyramidLevels(uint32_t, uint32_t);
+	static Projection cameraProjection(float);
+
+	static DepthPyramid buildPyramid(const std::vector<float>&, uint32_t, uint32_t);
+	static bool projectSphere(glm::vec3, float, const Projection&, glm::vec4&);
+	static bool isSphereOccluded(const DepthPyramid&, glm::vec3, float, const Projection&);
+
+	static bool selfTest();
+};
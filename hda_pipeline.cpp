@@ -1,5 +1,7 @@
 #include "hda_pipeline.hpp"
 
+#include <set>
+#include <unordered_map>
 
 
 const uint32_t vertexShaderSpirv[] = {
@@ -16,6 +18,58 @@ const uint32_t skyboxFragmentShaderSpirv[] = {
 	#include "skybox.frag.spv"
 };
 
+const uint32_t meshletCullShaderSpirv[] = {
+	#include "meshlet_cull.comp.spv"
+};
+const uint32_t depthPyramidShaderSpirv[] = {
+	#include "depth_pyramid.comp.spv"
+};
+
+const uint32_t depthPrepassVertexShaderSpirv[] = {
+	#include "depth_prepass.vert.spv"
+};
+const uint32_t lightCullShaderSpirv[] = {
+	#include "light_cull.comp.spv"
+};
+
+const uint32_t fullscreenVertexShaderSpirv[] = {
+	#include "fullscreen.vert.spv"
+};
+const uint32_t gbufferFragmentShaderSpirv[] = {
+	#include "gbuffer.frag.spv"
+};
+const uint32_t deferredFragmentShaderSpirv[] = {
+	#include "deferred.frag.spv"
+};
+
+const uint32_t instancedVertexShaderSpirv[] = {
+	#include "instanced.vert.spv"
+};
+
+const uint32_t bloomDownShaderSpirv[] = {
+	#include "bloom_down.comp.spv"
+};
+const uint32_t bloomUpShaderSpirv[] = {
+	#include "bloom_up.comp.spv"
+};
+const uint32_t localGridShaderSpirv[] = {
+	#include "local_grid.comp.spv"
+};
+const uint32_t localBlurShaderSpirv[] = {
+	#include "local_blur.comp.spv"
+};
+const uint32_t tonemapFragmentShaderSpirv[] = {
+	#include "tonemap.frag.spv"
+};
+
+// HALF_PRECISION variants
+const uint32_t fragmentHalfShaderSpirv[] = {
+	#include "shader_fp16.frag.spv"
+};
+const uint32_t tonemapFragmentHalfShaderSpirv[] = {
+	#include "tonemap_fp16.frag.spv"
+};
+
 
 
 /*
@@ -63,6 +117,28 @@ void HdaPipeline::cleanupPipeline() {
 	device.getDevice().destroyShaderModule(skyboxVertexShaderModule);
 	device.getDevice().destroyShaderModule(hdrFragmentShaderModule);
 	device.getDevice().destroyShaderModule(hdrVertexShaderModule);
+	device.getDevice().destroyShaderModule(meshletCullShaderModule);
+	device.getDevice().destroyShaderModule(depthPyramidShaderModule);
+	device.getDevice().destroyShaderModule(depthPrepassVertexShaderModule);
+	device.getDevice().destroyShaderModule(lightCullShaderModule);
+	device.getDevice().destroyShaderModule(fullscreenVertexShaderModule);
+	device.getDevice().destroyShaderModule(gbufferFragmentShaderModule);
+	device.getDevice().destroyShaderModule(deferredFragmentShaderModule);
+	device.getDevice().destroyShaderModule(instancedVertexShaderModule);
+	device.getDevice().destroyShaderModule(bloomDownShaderModule);
+	device.getDevice().destroyShaderModule(bloomUpShaderModule);
+	device.getDevice().destroyShaderModule(localGridShaderModule);
+	device.getDevice().destroyShaderModule(localBlurShaderModule);
+	device.getDevice().destroyShaderModule(tonemapFragmentShaderModule);
+	device.getDevice().destroyShaderModule(fragmentHalfShaderModule);
+	device.getDevice().destroyShaderModule(tonemapFragmentHalfShaderModule);
+}
+
+
+// the variant takes effect in pipelines created after the call
+void HdaPipeline::setHalfPrecision(bool on) {
+
+	halfPrecision = on && device.getFloat16Support();
 }
 
 
@@ -74,7 +150,7 @@ vk::DescriptorSetLayout HdaPipeline::createDescriptorSetLayout(int descriptType,
 		device.getDevice().createDescriptorSetLayout(
 			vk::DescriptorSetLayoutCreateInfo(
 				vk::DescriptorSetLayoutCreateFlags(),		
-				descriptType == 0 ? 4 : 1,//binding count	// CHANGED
+				descriptType == 0 ? 7 : 1,//binding count	// CHANGED
 				descriptType == 0 ? array{
 					vk::DescriptorSetLayoutBinding{
 						0,
@@ -103,6 +179,27 @@ vk::DescriptorSetLayout HdaPipeline::createDescriptorSetLayout(int descriptType,
 						descrBind,	//1
 						vk::ShaderStageFlagBits::eFragment,
 						nullptr
+					},
+					vk::DescriptorSetLayoutBinding{		// light list
+						4,
+						vk::DescriptorType::eStorageBuffer,
+						1,
+						vk::ShaderStageFlagBits::eFragment,
+						nullptr
+					},
+					vk::DescriptorSetLayoutBinding{		// light indices of clusters
+						5,
+						vk::DescriptorType::eStorageBuffer,
+						1,
+						vk::ShaderStageFlagBits::eFragment,
+						nullptr
+					},
+					vk::DescriptorSetLayoutBinding{		// cluster grid
+						6,
+						vk::DescriptorType::eUniformBuffer,
+						1,
+						vk::ShaderStageFlagBits::eFragment,
+						nullptr
 					}
 				}.data() : array{
 					vk::DescriptorSetLayoutBinding{
@@ -121,6 +218,71 @@ vk::DescriptorSetLayout HdaPipeline::createDescriptorSetLayout(int descriptType,
 }
 
 
+/*
+*
+* Layout for compute shaders - uniform buffers are bound first, storage buffers follow
+* them, so the binding numbers go 0 .. uniformCnt + storageCnt - 1.
+*
+*/
+vk::DescriptorSetLayout HdaPipeline::createComputeDescriptorSetLayout(const vector<vk::DescriptorType>& types) {
+
+	return createDescriptorSetLayout(types, vk::ShaderStageFlagBits::eCompute);
+}
+
+
+vk::DescriptorSetLayout HdaPipeline::createDescriptorSetLayout(const vector<vk::DescriptorType>& types, vk::ShaderStageFlags stages) {
+
+	vector<vk::DescriptorSetLayoutBinding> bindings;
+
+	// binding i has descriptor type types[i]
+	for (uint32_t i = 0; i < types.size(); i++)
+		bindings.push_back(
+			vk::DescriptorSetLayoutBinding{
+				i,
+				types[i],
+				1,
+				stages,
+				nullptr
+			}
+		);
+
+	vk::DescriptorSetLayout descriptorSetLay =
+		device.getDevice().createDescriptorSetLayout(
+			vk::DescriptorSetLayoutCreateInfo(
+				vk::DescriptorSetLayoutCreateFlags(),
+				static_cast<uint32_t>(bindings.size()),
+				bindings.data()
+			)
+		);
+	cout << "createDescriptorSetLayout(): Layout is created.\n";
+
+	return descriptorSetLay;
+}
+
+
+vk::Pipeline HdaPipeline::createComputePipeline(vk::ShaderModule shader, vk::PipelineLayout pipLay) {
+
+	vk::Pipeline pipe =
+		device.getDevice().createComputePipeline(
+			nullptr,
+			vk::ComputePipelineCreateInfo(
+				vk::PipelineCreateFlags(),
+				vk::PipelineShaderStageCreateInfo{
+					vk::PipelineShaderStageCreateFlags(),
+					vk::ShaderStageFlagBits::eCompute,  // stage
+					shader,  // module
+					"main",  // pName
+					nullptr  // pSpecializationInfo
+				},
+				pipLay  // layout
+			)
+		).value;
+	cout << "createComputePipeline(): Pipeline is created.\n";
+
+	return pipe;
+}
+
+
 vk::Pipeline HdaPipeline::createPipeline(vk::PipelineCreateFlags flags, uint32_t stgCnt, const vk::PipelineShaderStageCreateInfo* shaders, const vk::PipelineVertexInputStateCreateInfo* vrtxIn, 
 										 const vk::PipelineInputAssemblyStateCreateInfo* assemIn, const vk::PipelineTessellationStateCreateInfo* tess, const vk::PipelineViewportStateCreateInfo* viewPort, 
 										 const vk::PipelineRasterizationStateCreateInfo* raster, const vk::PipelineMultisampleStateCreateInfo* ms, const vk::PipelineDepthStencilStateCreateInfo* depth, 
@@ -149,7 +311,7 @@ vk::Pipeline HdaPipeline::createPipeline(vk::PipelineCreateFlags flags, uint32_t
 					vk::PipelineShaderStageCreateInfo{
 						vk::PipelineShaderStageCreateFlags(),
 						vk::ShaderStageFlagBits::eFragment,  // stage
-						fragmentShaderModule,  // module
+						getFragmentShaderModule(),  // module
 						"main",  // pName
 						nullptr// pSpecializationInfo
 					},
@@ -256,7 +418,16 @@ vk::Pipeline HdaPipeline::createPipeline(vk::PipelineCreateFlags flags, uint32_t
 					array<float,4>{0.f,0.f,0.f,0.f}  // blendConstants
 				} : blend,
 
-				dynamic == nullptr ? nullptr : dynamic,  // pDynamicState
+				// viewport and scissor are set by command buffers, the scene is rendered into a scaled viewport
+				dynamic == nullptr ?
+				&(const vk::PipelineDynamicStateCreateInfo&)vk::PipelineDynamicStateCreateInfo{  // pDynamicState
+					vk::PipelineDynamicStateCreateFlags(),
+					2,  // dynamicStateCount
+					array{  // pDynamicStates
+						vk::DynamicState::eViewport,
+						vk::DynamicState::eScissor,
+					}.data()
+				} : dynamic,
 				pipLay,  // layout
 				rp,  // renderPass
 				subp == UINT32_MAX ? 0 : subp,  // subpass
@@ -329,4 +500,255 @@ void HdaPipeline::createShaderModules() {
 			)
 		);
 
+	meshletCullShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(meshletCullShaderSpirv),  // codeSize
+				meshletCullShaderSpirv  // pCode
+			)
+		);
+
+	depthPyramidShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(depthPyramidShaderSpirv),  // codeSize
+				depthPyramidShaderSpirv  // pCode
+			)
+		);
+
+	depthPrepassVertexShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(depthPrepassVertexShaderSpirv),  // codeSize
+				depthPrepassVertexShaderSpirv  // pCode
+			)
+		);
+
+	lightCullShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(lightCullShaderSpirv),  // codeSize
+				lightCullShaderSpirv  // pCode
+			)
+		);
+
+	fullscreenVertexShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(fullscreenVertexShaderSpirv),  // codeSize
+				fullscreenVertexShaderSpirv  // pCode
+			)
+		);
+
+	gbufferFragmentShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(gbufferFragmentShaderSpirv),  // codeSize
+				gbufferFragmentShaderSpirv  // pCode
+			)
+		);
+
+	deferredFragmentShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(deferredFragmentShaderSpirv),  // codeSize
+				deferredFragmentShaderSpirv  // pCode
+			)
+		);
+
+	instancedVertexShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(instancedVertexShaderSpirv),  // codeSize
+				instancedVertexShaderSpirv  // pCode
+			)
+		);
+
+	bloomDownShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(bloomDownShaderSpirv),  // codeSize
+				bloomDownShaderSpirv  // pCode
+			)
+		);
+
+	bloomUpShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(bloomUpShaderSpirv),  // codeSize
+				bloomUpShaderSpirv  // pCode
+			)
+		);
+
+	localGridShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(localGridShaderSpirv),  // codeSize
+				localGridShaderSpirv  // pCode
+			)
+		);
+
+	localBlurShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(localBlurShaderSpirv),  // codeSize
+				localBlurShaderSpirv  // pCode
+			)
+		);
+
+	tonemapFragmentShaderModule =
+		device.getDevice().createShaderModule(
+			vk::ShaderModuleCreateInfo(
+				vk::ShaderModuleCreateFlags(),
+				sizeof(tonemapFragmentShaderSpirv),  // codeSize
+				tonemapFragmentShaderSpirv  // pCode
+			)
+		);
+
+	// float16 variants are chosen by device capability
+	if (device.getFloat16Support()) {
+
+		fragmentHalfShaderModule =
+			device.getDevice().createShaderModule(
+				vk::ShaderModuleCreateInfo(
+					vk::ShaderModuleCreateFlags(),
+					sizeof(fragmentHalfShaderSpirv),  // codeSize
+					fragmentHalfShaderSpirv  // pCode
+				)
+			);
+
+		tonemapFragmentHalfShaderModule =
+			device.getDevice().createShaderModule(
+				vk::ShaderModuleCreateInfo(
+					vk::ShaderModuleCreateFlags(),
+					sizeof(tonemapFragmentHalfShaderSpirv),  // codeSize
+					tonemapFragmentHalfShaderSpirv  // pCode
+				)
+			);
+	}
+	setHalfPrecision(true);
+	cout << "createShaderModules(): Shading and tone mapping use " << (halfPrecision ? "float16" : "float32") << " variant.\n";
+}
+
+
+/**
+*	@brief Count instructions of SPIR-V module.
+*
+*	Float ops are the instructions with float scalar or vector result, half ops are the part
+*	of them with float16 result. Interface components are counted for user variables with
+*	location, builtins are skipped, so the inputs of fragment shader are its varyings.
+*
+*/
+HdaPipeline::ShaderStats HdaPipeline::shaderStatistics(const uint32_t* code, size_t words) {
+
+	// opcodes and decorations of SPIR-V specification
+	enum : uint32_t {
+		OpExtInst = 12, OpTypeInt = 21, OpTypeFloat = 22, OpTypeVector = 23, OpTypeMatrix = 24, OpTypePointer = 32,
+		OpVariable = 59, OpDecorate = 71, OpFConvert = 115, OpFNegate = 127, OpFAdd = 129, OpFSub = 131, OpFMul = 133,
+		OpFDiv = 136, OpFRem = 140, OpFMod = 141, OpVectorTimesScalar = 142, OpMatrixTimesMatrix = 146, OpDot = 148,
+		StorageInput = 1, StorageOutput = 3, DecorationBuiltIn = 11, DecorationLocation = 30
+	};
+
+	ShaderStats stats{};
+	stats.words = static_cast<uint32_t>(words);
+
+	unordered_map<uint32_t, uint32_t> floatWidth;		// float scalar and vector types
+	unordered_map<uint32_t, uint32_t> components;		// numeric types
+	unordered_map<uint32_t, uint32_t> pointee;			// pointer types
+	set<uint32_t> located, builtins;
+	vector<array<uint32_t, 3>> variables;				// type, id, storage class of interface variables
+
+	// the first 5 words are the header
+	for (size_t i = 5; i < words; ) {
+
+		uint32_t count = code[i] >> 16;
+		uint32_t op = code[i] & 0xffff;
+		if (count == 0 || i + count > words)
+			break;
+		const uint32_t* w = code + i;
+		stats.instructions++;
+
+		if (op == OpTypeFloat) {
+			floatWidth[w[1]] = w[2];
+			components[w[1]] = 1;
+		}
+		else if (op == OpTypeInt)
+			components[w[1]] = 1;
+		else if (op == OpTypeVector) {
+			if (floatWidth.count(w[2]))
+				floatWidth[w[1]] = floatWidth[w[2]];
+			components[w[1]] = components[w[2]] * w[3];
+		}
+		else if (op == OpTypeMatrix)
+			components[w[1]] = components[w[2]] * w[3];
+		else if (op == OpTypePointer)
+			pointee[w[1]] = w[3];
+		else if (op == OpDecorate && w[2] == DecorationLocation)
+			located.insert(w[1]);
+		else if (op == OpDecorate && w[2] == DecorationBuiltIn)
+			builtins.insert(w[1]);
+		else if (op == OpVariable && (w[3] == StorageInput || w[3] == StorageOutput))
+			variables.push_back({ w[1], w[2], w[3] });
+		else if (op == OpFConvert)
+			stats.conversions++;
+		else if ((op == OpExtInst || op == OpFNegate || op == OpFAdd || op == OpFSub || op == OpFMul || op == OpFDiv ||
+				  op == OpFRem || op == OpFMod || (op >= OpVectorTimesScalar && op <= OpMatrixTimesMatrix) || op == OpDot) && floatWidth.count(w[1])) {
+			stats.floatOps++;
+			if (floatWidth[w[1]] == 16)
+				stats.halfOps++;
+		}
+
+		i += count;
+	}
+
+	for (const auto& v : variables) {
+
+		if (builtins.count(v[1]) || !located.count(v[1]))
+			continue;
+		uint32_t n = components.count(pointee[v[0]]) ? components[pointee[v[0]]] : 4;
+		(v[2] == StorageInput ? stats.inputComponents : stats.outputComponents) += n;
+	}
+
+	return stats;
+}
+
+
+/**
+*	@brief Print statistics of the embedded modules with a float16 variant and their varyings.
+*
+*	The modules are not created, so it runs without a device.
+*
+*/
+void HdaPipeline::printShaderStatistics() {
+
+	struct Module { const char* name; const uint32_t* code; size_t size; };
+	const Module modules[] = {
+		{ "shader.vert", vertexShaderSpirv, sizeof(vertexShaderSpirv) },
+		{ "instanced.vert", instancedVertexShaderSpirv, sizeof(instancedVertexShaderSpirv) },
+		{ "shader.frag", fragmentShaderSpirv, sizeof(fragmentShaderSpirv) },
+		{ "shader_fp16.frag", fragmentHalfShaderSpirv, sizeof(fragmentHalfShaderSpirv) },
+		{ "gbuffer.frag", gbufferFragmentShaderSpirv, sizeof(gbufferFragmentShaderSpirv) },
+		{ "tonemap.frag", tonemapFragmentShaderSpirv, sizeof(tonemapFragmentShaderSpirv) },
+		{ "tonemap_fp16.frag", tonemapFragmentHalfShaderSpirv, sizeof(tonemapFragmentHalfShaderSpirv) },
+	};
+
+	cout << "printShaderStatistics(): module | words | instructions | float ops | float16 ops | conversions | input | output components\n";
+	for (const Module& m : modules) {
+
+		ShaderStats s = shaderStatistics(m.code, m.size / sizeof(uint32_t));
+		cout << "  " << m.name << " | " << s.words << " | " << s.instructions << " | " << s.floatOps << " | " << s.halfOps << " | "
+			 << s.conversions << " | " << s.inputComponents << " | " << s.outputComponents << "\n";
+	}
 }
\ No newline at end of file
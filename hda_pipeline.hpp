@@ -6,20 +6,52 @@
 *
 * A class representing vulkan object - pipeline.
 *
+* Forward shading and tone mapping have a float16 variant, it is chosen when the device
+* supports float16 arithmetic and the pipelines created later use the chosen modules.
+*
 */
 
 class HdaPipeline {
 
 public:
 
+	// counts of SPIR-V module
+	struct ShaderStats {
+
+		uint32_t words = 0;
+		uint32_t instructions = 0;
+		uint32_t floatOps = 0;			// arithmetic and extended instructions with float result
+		uint32_t halfOps = 0;			// floatOps with float16 result
+		uint32_t conversions = 0;		// between float16 and float32
+		uint32_t inputComponents = 0;	// user interface with location, varyings between stages
+		uint32_t outputComponents = 0;
+	};
+
 	HdaPipeline(HdaInstanceGpu&, HdaSwapchain&);
 	~HdaPipeline();
 
 	inline vk::Pipeline getPipeline() { return pipeline; }
 	inline vk::PipelineLayout getPipelineLayout() { return pipelineLayout; }
 	inline vk::DescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout;  }
+	inline vk::ShaderModule getVertexShaderModule() { return vertexShaderModule; }
+	inline vk::ShaderModule getFragmentShaderModule() { return halfPrecision ? fragmentHalfShaderModule : fragmentShaderModule; }
 	inline vk::ShaderModule getSkyboxVertexShaderModule() { return skyboxVertexShaderModule; }
 	inline vk::ShaderModule getSkyboxFragmentShaderModule() { return skyboxFragmentShaderModule; }
+	inline vk::ShaderModule getMeshletCullShaderModule() { return meshletCullShaderModule; }
+	inline vk::ShaderModule getDepthPyramidShaderModule() { return depthPyramidShaderModule; }
+	inline vk::ShaderModule getDepthPrepassVertexShaderModule() { return depthPrepassVertexShaderModule; }
+	inline vk::ShaderModule getLightCullShaderModule() { return lightCullShaderModule; }
+	inline vk::ShaderModule getFullscreenVertexShaderModule() { return fullscreenVertexShaderModule; }
+	inline vk::ShaderModule getGbufferFragmentShaderModule() { return gbufferFragmentShaderModule; }
+	inline vk::ShaderModule getDeferredFragmentShaderModule() { return deferredFragmentShaderModule; }
+	inline vk::ShaderModule getInstancedVertexShaderModule() { return instancedVertexShaderModule; }
+	inline vk::ShaderModule getBloomDownShaderModule() { return bloomDownShaderModule; }
+	inline vk::ShaderModule getBloomUpShaderModule() { return bloomUpShaderModule; }
+	inline vk::ShaderModule getLocalGridShaderModule() { return localGridShaderModule; }
+	inline vk::ShaderModule getLocalBlurShaderModule() { return localBlurShaderModule; }
+	inline vk::ShaderModule getTonemapFragmentShaderModule() { return halfPrecision ? tonemapFragmentHalfShaderModule : tonemapFragmentShaderModule; }
+	inline bool getHalfPrecision() { return halfPrecision; }
+	void setHalfPrecision(bool);
 
 	void initPipeline();
 	void cleanupPipeline();
@@ -31,6 +63,12 @@ public:
 	vk::PipelineLayout createPipelineLayout(vk::PipelineLayoutCreateFlags flags, uint32_t layCnt, const vk::DescriptorSetLayout* descrLay, uint32_t pushConRangeCnt,
 		const vk::PushConstantRange* puConRanges);
 	vk::DescriptorSetLayout createDescriptorSetLayout(int, uint32_t);
+	vk::DescriptorSetLayout createDescriptorSetLayout(const vector<vk::DescriptorType>&, vk::ShaderStageFlags);
+	vk::DescriptorSetLayout createComputeDescriptorSetLayout(const vector<vk::DescriptorType>&);
+	vk::Pipeline createComputePipeline(vk::ShaderModule, vk::PipelineLayout);
+
+	static ShaderStats shaderStatistics(const uint32_t*, size_t);
+	static void printShaderStatistics();
 
 private:
 
@@ -51,5 +89,21 @@ private:
 	vk::ShaderModule skyboxFragmentShaderModule;
 	vk::ShaderModule hdrVertexShaderModule;
 	vk::ShaderModule hdrFragmentShaderModule;
+	vk::ShaderModule meshletCullShaderModule;
+	vk::ShaderModule depthPyramidShaderModule;
+	vk::ShaderModule depthPrepassVertexShaderModule;
+	vk::ShaderModule lightCullShaderModule;
+	vk::ShaderModule fullscreenVertexShaderModule;
+	vk::ShaderModule gbufferFragmentShaderModule;
+	vk::ShaderModule deferredFragmentShaderModule;
+	vk::ShaderModule instancedVertexShaderModule;
+	vk::ShaderModule bloomDownShaderModule;
+	vk::ShaderModule bloomUpShaderModule;
+	vk::ShaderModule localGridShaderModule;
+	vk::ShaderModule localBlurShaderModule;
+	vk::ShaderModule tonemapFragmentShaderModule;
+	vk::ShaderModule fragmentHalfShaderModule;
+	vk::ShaderModule tonemapFragmentHalfShaderModule;
+	bool halfPrecision = false;
 
 };
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "hda_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+/**
+*	@brief Sets the controller settings, the scale is clamped into the new range
+*/
+void HdaResolution::setSettings(const Settings& newSettings) {
+
+	settings = newSettings;
+	settings.maxScale = clamp(settings.maxScale, RESOLUTION_STEP, RESOLUTION_MAX_SCALE);
+	settings.minScale = clamp(settings.minScale, RESOLUTION_STEP, settings.maxScale);
+	settings.hysteresis = max(settings.hysteresis, 0.0f);
+
+	scale = clamp(scale, settings.minScale, settings.maxScale);
+}
+
+
+/**
+*	@brief Starts at the largest scale and forgets the measured time
+*/
+void HdaResolution::reset() {
+
+	scale = settings.maxScale;
+	smoothedMs = 0.0;
+	cooldown = 0;
+}
+
+
+float HdaResolution::quantize(float value) {
+
+	return round(value / RESOLUTION_STEP) * RESOLUTION_STEP;
+}
+
+
+/**
+*	@brief Feeds GPU time of one frame in ms and returns the scale of the next frame
+*/
+float HdaResolution::update(double gpuMs) {
+
+	if (gpuMs <= 0.0)
+		return scale;
+
+	smoothedMs = smoothedMs > 0.0 ? smoothedMs + RESOLUTION_SMOOTHING * (gpuMs - smoothedMs) : gpuMs;
+
+	// timestamps of the frames in flight were measured with the old scale
+	if (cooldown > 0) {
+		cooldown--;
+		return scale;
+	}
+
+	double target = settings.targetMs;
+	double wanted = scale * sqrt(target / smoothedMs);
+	float next = scale;
+
+	if (smoothedMs > target * (1.0 + settings.hysteresis))
+		next = min(quantize(float(wanted)), scale - RESOLUTION_STEP);
+
+	// one step up only if the time predicted by pixels stays under the target
+	else if (smoothedMs < target * (1.0 - settings.hysteresis) && wanted > scale) {
+		float up = quantize(scale + RESOLUTION_STEP);
+		double predicted = smoothedMs * (up * up) / (scale * scale);
+		if (predicted <= target)
+			next = up;
+	}
+
+	next = clamp(next, settings.minScale, settings.maxScale);
+	if (fabs(next - scale) > 0.5f * RESOLUTION_STEP) {
+		scale = next;
+		cooldown = RESOLUTION_COOLDOWN;
+		changes++;
+	}
+
+	return scale;
+}
+
+
+/**
+*	@brief Returns the viewport of the scene for the scale, at least one pixel
+*/
+vk::Extent2D HdaResolution::scaledExtent(vk::Extent2D extent, float scale) {
+
+	return vk::Extent2D(
+		max(uint32_t(extent.width * scale + 0.5f), 1u),
+		max(uint32_t(extent.height * scale + 0.5f), 1u)
+	);
+}
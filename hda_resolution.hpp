@@ -0,0 +1,61 @@
+#pragma once
+#include "hda_model.hpp"
+
+#define RESOLUTION_TARGET_MS (1000.0f / 60.0f)
+#define RESOLUTION_MIN_SCALE 0.5f
+#define RESOLUTION_MAX_SCALE 1.0f		// scene color has the size of swapchain, so no larger scale is possible
+#define RESOLUTION_HYSTERESIS 0.1f		// relative band around the target frame time without a change
+#define RESOLUTION_STEP 0.05f			// scales are multiples of the step, so static recordings are reused
+#define RESOLUTION_COOLDOWN 8			// frames after a change, the measured frame is PARALLEL_FRAMES old
+#define RESOLUTION_SMOOTHING 0.2f		// weight of the new sample of GPU time
+#define RESOLUTION_UPSCALE_BILINEAR 0
+#define RESOLUTION_UPSCALE_EDGE 1		// upscaleFilter of tonemap.frag, bilinear weights are reduced across luminance edges
+#define RESOLUTION_UPSCALE_FILTERS 2
+
+
+/*
+*
+* A class representing the dynamic resolution controller. The scene is rendered into a scaled
+* viewport of the scene color, which is allocated at the size of swapchain, and the tone mapping
+* pass upscales it. GPU time of the frame is smoothed by an exponential moving average, when it
+* leaves the band of hysteresis around the target, the scale follows the square root of the
+* ratio of times, because the time of scene passes grows with pixels. The scale is quantized
+* and it is not changed for a few frames after a change, so the delayed timestamps do not
+* make it oscillate. The scale grows only by one step and only when the predicted time fits
+* the target.
+*
+*/
+
+class HdaResolution {
+
+public:
+
+	struct Settings {
+
+		float targetMs = RESOLUTION_TARGET_MS;
+		float minScale = RESOLUTION_MIN_SCALE;
+		float maxScale = RESOLUTION_MAX_SCALE;
+		float hysteresis = RESOLUTION_HYSTERESIS;
+	};
+
+	void setSettings(const Settings&);
+	void reset();
+	float update(double);
+
+	static vk::Extent2D scaledExtent(vk::Extent2D, float);
+
+	inline Settings getSettings() { return settings; }
+	inline float getScale() { return scale; }
+	inline double getSmoothedMs() { return smoothedMs; }
+	inline uint32_t getChanges() { return changes; }
+
+private:
+
+	static float quantize(float);
+
+	Settings settings{};
+	float scale = RESOLUTION_MAX_SCALE;
+	double smoothedMs = 0.0;		// 0 until the first sample
+	uint32_t cooldown = 0;
+	uint32_t changes = 0;
+};
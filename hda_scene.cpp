@@ -0,0 +1,235 @@
+#include "hda_scene.hpp"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+
+/**
+*	@brief Create entity with local transform relative to its parent.
+*
+*	The parent has to be alive, so it is already in the update order before the new
+*	entity. Free slots of destroyed entities are used again with the next generation.
+*
+*/
+HdaScene::Handle HdaScene::createEntity(const glm::mat4& local, Handle parent, uint32_t renderIndex) {
+
+	uint32_t parentSlot = parent.index == UINT32_MAX ? SCENE_NO_PARENT : slot(parent);
+	uint32_t s;
+
+	if (!freeSlots.empty()) {
+
+		s = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else {
+
+		s = static_cast<uint32_t>(localTransforms.size());
+		localTransforms.emplace_back();
+		worldTransforms.emplace_back();
+		parents.emplace_back();
+		renderIndices.emplace_back();
+		generations.emplace_back(0);
+		dirtyFlags.emplace_back();
+	}
+
+	localTransforms[s] = local;
+	worldTransforms[s] = parentSlot == SCENE_NO_PARENT ? local : worldTransforms[parentSlot] * local;
+	parents[s] = parentSlot;
+	renderIndices[s] = renderIndex;
+	dirtyFlags[s] = SCENE_DIRTY_UNIFORM | SCENE_DIRTY_MATERIAL;
+	order.push_back(s);
+
+	return Handle{ s, generations[s] };
+}
+
+
+// the entity is destroyed with all its descendants
+void HdaScene::destroyEntity(Handle h) {
+
+	uint32_t s = slot(h);
+	size_t first = std::find(order.begin(), order.end(), s) - order.begin();
+
+	// descendants are behind the entity in the update order
+	std::vector<bool> removed(localTransforms.size(), false);
+	removed[s] = true;
+	for (size_t i = first + 1; i < order.size(); i++)
+		if (parents[order[i]] != SCENE_NO_PARENT && removed[parents[order[i]]])
+			removed[order[i]] = true;
+
+	size_t k = first;
+	for (size_t i = first; i < order.size(); i++) {
+
+		if (removed[order[i]]) {
+			generations[order[i]]++;
+			freeSlots.push_back(order[i]);
+		}
+		else
+			order[k++] = order[i];
+	}
+	order.resize(k);
+}
+
+
+bool HdaScene::isAlive(Handle h) const {
+
+	return h.index < generations.size() && generations[h.index] == h.generation;
+}
+
+
+void HdaScene::setLocalTransform(Handle h, const glm::mat4& local) {
+
+	uint32_t s = slot(h);
+	localTransforms[s] = local;
+	dirtyFlags[s] |= SCENE_DIRTY_TRANSFORM;
+}
+
+
+const glm::mat4& HdaScene::getWorldTransform(Handle h) const {
+
+	return worldTransforms[slot(h)];
+}
+
+
+uint32_t HdaScene::getRenderIndex(Handle h) const {
+
+	return renderIndices[slot(h)];
+}
+
+
+void HdaScene::markDirty(Handle h, uint8_t flags) {
+
+	dirtyFlags[slot(h)] |= flags;
+}
+
+
+bool HdaScene::isDirty(Handle h, uint8_t flags) const {
+
+	return (dirtyFlags[slot(h)] & flags) != 0;
+}
+
+
+void HdaScene::clearDirty(Handle h, uint8_t flags) {
+
+	dirtyFlags[slot(h)] &= static_cast<uint8_t>(~flags);
+}
+
+
+/**
+*	@brief Compute world transforms of changed entities.
+*
+*	One pass in the update order is enough, because parents are computed before their
+*	children. Entity is computed again when its local transform changed or its parent
+*	was computed in this pass. Returns the number of computed entities.
+*
+*/
+uint32_t HdaScene::updateTransforms() {
+
+	changed.clear();
+
+	for (uint32_t s : order) {
+
+		uint32_t p = parents[s];
+		bool parentChanged = p != SCENE_NO_PARENT && (dirtyFlags[p] & SCENE_DIRTY_TRANSFORM) != 0;
+		if ((dirtyFlags[s] & SCENE_DIRTY_TRANSFORM) == 0 && !parentChanged)
+			continue;
+
+		worldTransforms[s] = p == SCENE_NO_PARENT ? localTransforms[s] : worldTransforms[p] * localTransforms[s];
+		dirtyFlags[s] |= SCENE_DIRTY_TRANSFORM | SCENE_DIRTY_UNIFORM;
+		changed.push_back(s);
+	}
+
+	// the transform bit marks computed parents only during the pass
+	for (uint32_t s : changed)
+		dirtyFlags[s] &= static_cast<uint8_t>(~SCENE_DIRTY_TRANSFORM);
+
+	return static_cast<uint32_t>(changed.size());
+}
+
+
+uint32_t HdaScene::slot(Handle h) const {
+
+	if (!isAlive(h))
+		throw std::runtime_error("HdaScene: handle of destroyed entity.");
+
+	return h.index;
+}
+
+
+/**
+*	@brief Measure the costs of scene storage on CPU.
+*
+*	Every scene has groups of 16 entities - a root with 3 children, which have 4 children
+*	each. The update of all entities, of 1 % of roots, the update without changes and
+*	the iteration over world transforms are measured, the best of 5 runs is printed.
+*
+*/
+void HdaScene::benchmark(const std::vector<uint32_t>& counts) {
+
+	const int runs = 5;
+	auto ms = [](std::chrono::high_resolution_clock::time_point startT) {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startT).count();
+	};
+
+	std::cout << "\nbenchmark(): entities | create ms | full update ms | 1 % update ms | clean update ms | iteration ms\n";
+
+	for (uint32_t count : counts) {
+
+		HdaScene scene;
+		std::vector<Handle> handles(count);
+		std::vector<Handle> roots;
+		std::mt19937 generator(5678);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		auto startT = std::chrono::high_resolution_clock::now();
+		for (uint32_t i = 0; i < count; i++) {
+
+			uint32_t g = i % 16;
+			Handle parent{};
+			if (g >= 1 && g <= 3)
+				parent = handles[i - g];
+			else if (g > 3)
+				parent = handles[i - g + 1 + (g - 4) / 4];
+
+			glm::mat4 local = glm::translate(glm::mat4{ 1.0f }, glm::vec3(unit(generator), unit(generator), unit(generator)) * 10.0f);
+			handles[i] = scene.createEntity(local, parent, i);
+			if (g == 0)
+				roots.push_back(handles[i]);
+		}
+		double createT = ms(startT);
+
+		double fullT = 1e9, partialT = 1e9, cleanT = 1e9, iterT = 1e9;
+		float checksum = 0.0f;
+		for (int r = 0; r < runs; r++) {
+
+			glm::mat4 rotation = glm::rotate(glm::mat4{ 1.0f }, glm::radians(1.0f + r), glm::vec3(0, 1, 0));
+
+			for (const auto& h : roots)
+				scene.setLocalTransform(h, rotation);
+			startT = std::chrono::high_resolution_clock::now();
+			scene.updateTransforms();
+			fullT = std::min(fullT, ms(startT));
+
+			for (size_t k = 0; k < roots.size(); k += 100)
+				scene.setLocalTransform(roots[k], rotation);
+			startT = std::chrono::high_resolution_clock::now();
+			scene.updateTransforms();
+			partialT = std::min(partialT, ms(startT));
+
+			startT = std::chrono::high_resolution_clock::now();
+			scene.updateTransforms();
+			cleanT = std::min(cleanT, ms(startT));
+
+			// read the translation of every world transform as the renderer would do
+			startT = std::chrono::high_resolution_clock::now();
+			glm::vec3 sum{ 0.0f };
+			for (uint32_t s : scene.order)
+				sum += glm::vec3(scene.worldTransforms[s][3]);
+			iterT = std::min(iterT, ms(startT));
+			checksum += sum.x;
+		}
+
+		std::cout << "  " << count << " | " << createT << " | " << fullT << " | " << partialT << " | " << cleanT << " | " << iterT
+			<< " (full update " << (count > 0 ? fullT * 1e6 / count : 0.0) << " ns per entity, checksum " << checksum << ")\n";
+	}
+}
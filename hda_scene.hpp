@@ -0,0 +1,63 @@
+#pragma once
+#include "hda_model.hpp"
+
+#define SCENE_NO_PARENT UINT32_MAX
+#define SCENE_DIRTY_TRANSFORM 0x1		// local transform changed, world transform has to be computed again
+#define SCENE_DIRTY_UNIFORM 0x2			// world transform changed, uniform data of object have to be uploaded
+#define SCENE_DIRTY_MATERIAL 0x4		// material data of object have to be uploaded
+
+
+/*
+*
+* A class representing the data oriented storage of scene. Entities are referenced
+* by handles, which are slot indices with generation, so a handle of destroyed entity
+* is recognized when the slot is used again. Transforms, hierarchy and flags are stored
+* in separate tables indexed by slot. World transforms are computed only for entities
+* whose local transform or some ancestor changed, the dirty bits tell the renderer
+* which objects need their uniform data uploaded again.
+*
+*/
+
+class HdaScene {
+
+public:
+
+	struct Handle {
+
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+	};
+
+	Handle createEntity(const glm::mat4&, Handle, uint32_t);
+	void destroyEntity(Handle);
+	bool isAlive(Handle) const;
+
+	void setLocalTransform(Handle, const glm::mat4&);
+	const glm::mat4& getWorldTransform(Handle) const;
+	uint32_t getRenderIndex(Handle) const;
+
+	void markDirty(Handle, uint8_t);
+	bool isDirty(Handle, uint8_t) const;
+	void clearDirty(Handle, uint8_t);
+
+	uint32_t updateTransforms();
+	inline uint32_t getEntityCount() const { return static_cast<uint32_t>(order.size()); }
+
+	static void benchmark(const std::vector<uint32_t>&);
+
+private:
+
+	// tables indexed by slot of entity
+	std::vector<glm::mat4> localTransforms;
+	std::vector<glm::mat4> worldTransforms;
+	std::vector<uint32_t> parents;			// slot of parent or SCENE_NO_PARENT
+	std::vector<uint32_t> renderIndices;	// index of scene object drawn by entity
+	std::vector<uint32_t> generations;
+	std::vector<uint8_t> dirtyFlags;
+
+	std::vector<uint32_t> freeSlots;
+	std::vector<uint32_t> order;			// slots of alive entities, parents are before their children
+	std::vector<uint32_t> changed;			// slots with world transform computed by the last update
+
+	uint32_t slot(Handle) const;
+};
@@ -38,6 +38,13 @@ void HdaSwapchain::initSwapchain() {
 	createSwapchain();
 	createSwapchainImageViews();
 	createDepthAttachment();
+	createDepthPyramid();
+	createSceneColor();
+	createBloomChain();
+	createLocalGrid();
+	createGbuffer();
+	bindTransientMemory();
+	createTransientViews();
 	createFramebuffers();
 }
 
@@ -49,6 +56,32 @@ void HdaSwapchain::cleanupSwapchain() {
 	device.getDevice().destroy(depthImageView);
 	device.getDevice().destroy(depthImage);
 	device.getDevice().freeMemory(depthImageMem);
+	for (int i = 0; i < depthPyramidLevelViews.size(); i++) { device.getDevice().destroy(depthPyramidLevelViews[i]); }
+	depthPyramidLevelViews.clear();
+	device.getDevice().destroy(depthPyramidView);
+	device.getDevice().destroy(depthPyramidImage);
+	device.getDevice().freeMemory(depthPyramidMem);
+	device.getDevice().destroy(sceneFramebuffer);
+	device.getDevice().destroy(sceneColorView);
+	device.getDevice().destroy(sceneColorImage);
+	device.getDevice().freeMemory(sceneColorMem);
+	for (int i = 0; i < bloomLevelViews.size(); i++) { device.getDevice().destroy(bloomLevelViews[i]); }
+	bloomLevelViews.clear();
+	device.getDevice().destroy(bloomImage);
+	for (int i = 0; i < localGridImages.size(); i++) {
+		device.getDevice().destroy(localGridViews[i]);
+		device.getDevice().destroy(localGridImages[i]);
+	}
+	device.getDevice().destroy(gbufferFramebuffer);
+	device.getDevice().destroy(gbufferAlbedoView);
+	device.getDevice().destroy(gbufferAlbedo);
+	device.getDevice().destroy(gbufferNormalView);
+	device.getDevice().destroy(gbufferNormal);
+	device.getDevice().freeMemory(transientMem);
+	for (int i = 0; i < lazyMems.size(); i++) { device.getDevice().freeMemory(lazyMems[i]); }
+	lazyMems.clear();
+	transientImages.clear();
+	transientTargets.clear();
 	device.getDevice().destroy(swapchain);
 }
 
@@ -132,21 +165,21 @@ void HdaSwapchain::createSwapchainImageViews() {
 	cout << "createImageViews(): Image views are created.\n";
 }
 
+// swapchain images are written only by the tone mapping pass, the scene is drawn into sceneFramebuffer
 void HdaSwapchain::createFramebuffers() {
 
-	framebuffers.reserve(swapchainImages.size()); // + 1 depthImageView
+	framebuffers.reserve(swapchainImages.size());
 	
 	for (size_t i = 0, c = swapchainImages.size(); i < c; i++) {
-		std::array<vk::ImageView, 2> imageViews = {	// kdyztak array <x, 2>
-				swapchainImageViews[i],
-				depthImageView
+		std::array<vk::ImageView, 1> imageViews = {
+				swapchainImageViews[i]
 		};
 
 		framebuffers.emplace_back(
 			device.getDevice().createFramebuffer(
 				vk::FramebufferCreateInfo(
 					vk::FramebufferCreateFlags(),  // flags
-					device.getRenderpass(),  // renderPass
+					device.getTonemapRenderpass(),  // renderPass
 					static_cast<uint32_t>(imageViews.size()),  // attachmentCount
 					imageViews.data(), //&swapchainImageViews[i],  // pAttachments
 					surfaceExtent.width,  // width
@@ -162,6 +195,13 @@ void HdaSwapchain::createFramebuffers() {
 
 vk::ImageView HdaSwapchain::createImageView(vk::Image img, vk::Format format, vk::ImageAspectFlags aspectMask, uint32_t layerCount, vk::ImageViewType viewType) {
 
+	return createImageView(img, format, aspectMask, layerCount, viewType, static_cast<uint32_t>(0), static_cast<uint32_t>(1));
+}
+
+
+vk::ImageView HdaSwapchain::createImageView(vk::Image img, vk::Format format, vk::ImageAspectFlags aspectMask, uint32_t layerCount, vk::ImageViewType viewType,
+											uint32_t baseMip, uint32_t mipCount) {
+
 	vk::ImageView imgView =
 		device.getDevice().createImageView(
 			vk::ImageViewCreateInfo(
@@ -172,8 +212,8 @@ vk::ImageView HdaSwapchain::createImageView(vk::Image img, vk::Format format, vk
 				vk::ComponentMapping(),      // components
 				vk::ImageSubresourceRange(   // subresourceRange
 					aspectMask,  // aspectMask
-					0,  // baseMipLevel
-					1,  // levelCount
+					baseMip,  // baseMipLevel
+					mipCount,  // levelCount
 					0,  // baseArrayLayer
 					layerCount //1   // layerCount
 				)
@@ -187,14 +227,53 @@ vk::ImageView HdaSwapchain::createImageView(vk::Image img, vk::Format format, vk
 vk::Image HdaSwapchain::createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags props,
 					  vk::DeviceMemory& imgMemory, uint32_t arrLayers, vk::ImageCreateFlagBits flags) {
 
+	return createImage(width, height, format, tiling, usage, props, imgMemory, arrLayers, flags, static_cast<uint32_t>(1));
+}
+
+
+vk::Image HdaSwapchain::createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags props,
+					  vk::DeviceMemory& imgMemory, uint32_t arrLayers, vk::ImageCreateFlagBits flags, uint32_t mipLevels) {
+
+	return createImage(width, height, format, tiling, usage, props, imgMemory, arrLayers, flags, mipLevels, static_cast<uint32_t>(1));
+}
+
+
+vk::Image HdaSwapchain::createImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, vk::MemoryPropertyFlags props,
+					  vk::DeviceMemory& imgMemory, uint32_t arrLayers, vk::ImageCreateFlagBits flags, uint32_t mipLevels, uint32_t depth) {
+
+	vk::Image image = createUnboundImage(width, height, format, tiling, usage, arrLayers, flags, mipLevels, depth);
+
+	vk::MemoryRequirements memRequirements = device.getDevice().getImageMemoryRequirements(image);
+	uint32_t memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, props);
+	if (memoryTypeIndex == UINT32_MAX) {
+		throw runtime_error("Corresponding memory type not found.\n");
+	}
+
+	imgMemory =
+		device.getDevice().allocateMemory(
+			vk::MemoryAllocateInfo(
+				memRequirements.size,
+				memoryTypeIndex
+			)
+		);
+	device.getDevice().bindImageMemory(image, imgMemory, 0);
+
+	return image;
+}
+
+
+// depth above 1 creates 3D image, the memory is bound by the caller
+vk::Image HdaSwapchain::createUnboundImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageTiling tiling, vk::ImageUsageFlags usage, uint32_t arrLayers,
+										   vk::ImageCreateFlagBits flags, uint32_t mipLevels, uint32_t depth) {
+
 	vk::Image image =
 		device.getDevice().createImage(
 			vk::ImageCreateInfo(
 				flags & vk::ImageCreateFlagBits::e2DArrayCompatible ? vk::ImageCreateFlags() : flags, //vk::ImageCreateFlags(),
-				vk::ImageType::e2D,
+				depth > 1 ? vk::ImageType::e3D : vk::ImageType::e2D,
 				format,
-				vk::Extent3D(width, height, 1),
-				uint32_t(1),
+				vk::Extent3D(width, height, depth),
+				mipLevels,
 				arrLayers, //uint32_t(1),
 				vk::SampleCountFlagBits::e1,
 				tiling,
@@ -206,43 +285,283 @@ vk::Image HdaSwapchain::createImage(uint32_t width, uint32_t height, vk::Format
 			)
 		);
 
+	return image;
+}
+
 
-	vk::MemoryRequirements memRequirements = device.getDevice().getImageMemoryRequirements(image);
+// the first memory type with all properties, UINT32_MAX if there is none
+uint32_t HdaSwapchain::findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags props) {
 
 	vk::PhysicalDeviceMemoryProperties memProperties = device.getPhysDevice().getMemoryProperties();
-	uint32_t memoryTypeIndex, check = UINT32_MAX;
 	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if (check != 1) {
-			if ((memRequirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags &
-				(props)) == (props)) {
-				memoryTypeIndex = i;
-				check = 1;
-			}
-		}
+		if ((typeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & (props)) == (props))
+			return i;
 	}
-	if (check == UINT32_MAX) {
-		throw runtime_error("Corresponding memory type not found.\n");
+
+	return UINT32_MAX;
+}
+
+
+/**
+*	@brief Create image which lives only inside a frame.
+*
+*	An attachment with transient usage gets its own lazily allocated memory when the device
+*	has such type, tile-based GPUs then do not back it by memory at all. Other images are
+*	bound by bindTransientMemory() into memory shared by lifetimes [first, last] of passes.
+*
+*/
+vk::Image HdaSwapchain::createTransientImage(uint32_t width, uint32_t height, vk::Format format, vk::ImageUsageFlags usage, uint32_t mipLevels, uint32_t depth,
+											 const std::string& name, uint32_t first, uint32_t last) {
+
+	vk::Image image = createUnboundImage(width, height, format, vk::ImageTiling::eOptimal, usage, static_cast<uint32_t>(1), vk::ImageCreateFlagBits::e2DArrayCompatible,
+										 mipLevels, depth);
+	vk::MemoryRequirements memRequirements = device.getDevice().getImageMemoryRequirements(image);
+
+	uint32_t lazyType = findMemoryType(memRequirements.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eLazilyAllocated);
+	if (usage & vk::ImageUsageFlagBits::eTransientAttachment && lazyType != UINT32_MAX) {
+
+		lazyMems.push_back(device.getDevice().allocateMemory(vk::MemoryAllocateInfo(memRequirements.size, lazyType)));
+		device.getDevice().bindImageMemory(image, lazyMems.back(), 0);
+		return image;
 	}
 
-	imgMemory =
+	transientImages.push_back(image);
+	transientTargets.push_back({ name, memRequirements.size, memRequirements.alignment, first, last });
+
+	return image;
+}
+
+
+/**
+*	@brief Bind images which live only inside a frame into one allocation.
+*
+*	G-buffer lives in the scene passes, the bloom chain and local grids from their passes
+*	to tone mapping, so G-buffer shares bytes with them. Every pass starts the images
+*	in undefined layout, the dependencies of render passes and barriers of the frame
+*	graph of post processing order the writes of aliases.
+*
+*/
+void HdaSwapchain::bindTransientMemory() {
+
+	uint32_t typeBits = UINT32_MAX;
+	uint64_t dedicated = 0;
+	for (size_t i = 0; i < transientImages.size(); i++) {
+		typeBits &= device.getDevice().getImageMemoryRequirements(transientImages[i]).memoryTypeBits;
+		dedicated += transientTargets[i].size;
+	}
+
+	uint64_t size = HdaTransient::alias(transientTargets);
+	uint32_t memoryTypeIndex = findMemoryType(typeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	if (memoryTypeIndex == UINT32_MAX) {
+		throw runtime_error("Memory type of aliased images not found.\n");
+	}
+
+	transientMem =
 		device.getDevice().allocateMemory(
 			vk::MemoryAllocateInfo(
-				memRequirements.size,
+				size,
 				memoryTypeIndex
 			)
 		);
-	device.getDevice().bindImageMemory(image, imgMemory, 0);
+	for (size_t i = 0; i < transientImages.size(); i++)
+		device.getDevice().bindImageMemory(transientImages[i], transientMem, transientTargets[i].offset);
 
-	return image;
+	cout << "bindTransientMemory(): " << transientImages.size() << " frame targets share " << size / (1024.0 * 1024.0) << " MB instead of "
+		 << dedicated / (1024.0 * 1024.0) << " MB" << (lazyGbuffer ? ", G-buffer is lazily allocated.\n" : ".\n");
+}
+
+
+// memory of aliased image, 0 for images with their own memory
+uint64_t HdaSwapchain::getTransientSize(vk::Image image) {
+
+	for (size_t i = 0; i < transientImages.size(); i++)
+		if (transientImages[i] == image)
+			return transientTargets[i].size;
+	return 0;
 }
 
+
 void HdaSwapchain::createDepthAttachment() {
 
 	depthFormat = device.getFindFormatFunc(vk::ImageTiling::eOptimal);
-	depthImage = createImage(surfaceExtent.width, surfaceExtent.height, depthFormat, vk::ImageTiling::eOptimal, vk::ImageUsageFlagBits::eDepthStencilAttachment,
+	// depth is sampled by depth_pyramid.comp for occlusion culling and read as input attachment by deferred.frag
+	depthImage = createImage(surfaceExtent.width, surfaceExtent.height, depthFormat, vk::ImageTiling::eOptimal,
+							 vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eInputAttachment,
 							 vk::MemoryPropertyFlagBits::eDeviceLocal, depthImageMem, static_cast<uint32_t>(1), vk::ImageCreateFlagBits::e2DArrayCompatible);
 
 	depthImageView = createImageView(depthImage, depthFormat, vk::ImageAspectFlagBits::eDepth, static_cast<uint32_t>(1), vk::ImageViewType::e2D);
 
 	cout << "createDepthAttachment(): Depth attachment is created.\n";
+}
+
+
+/**
+*	@brief Create HDR scene color and its framebuffer.
+*
+*	The forward render passes and the lighting pass of deferred shading draw into one
+*	image with the depth attachment, the image is sampled by bloom_down.comp and
+*	tonemap.frag. The frames are ordered by the dependencies of render passes.
+*
+*/
+void HdaSwapchain::createSceneColor() {
+
+	sceneColorImage = createImage(surfaceExtent.width, surfaceExtent.height, SCENE_COLOR_FORMAT, vk::ImageTiling::eOptimal,
+								  vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal,
+								  sceneColorMem, static_cast<uint32_t>(1), vk::ImageCreateFlagBits::e2DArrayCompatible);
+	sceneColorView = createImageView(sceneColorImage, SCENE_COLOR_FORMAT, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(1), vk::ImageViewType::e2D);
+
+	std::array<vk::ImageView, 2> imageViews = { sceneColorView, depthImageView };
+
+	sceneFramebuffer =
+		device.getDevice().createFramebuffer(
+			vk::FramebufferCreateInfo(
+				vk::FramebufferCreateFlags(),  // flags
+				device.getRenderpass(),  // renderPass
+				static_cast<uint32_t>(imageViews.size()),  // attachmentCount
+				imageViews.data(),  // pAttachments
+				surfaceExtent.width,  // width
+				surfaceExtent.height,  // height
+				1  // layers
+			)
+		);
+
+	cout << "createSceneColor(): Scene color " << surfaceExtent.width << "x" << surfaceExtent.height << " is created.\n";
+}
+
+
+/**
+*	@brief Create chain of bloom levels.
+*
+*	Level 0 has half resolution of the scene color. Every level has its own view,
+*	which is sampled as the source of the next pass and written as its destination,
+*	so the image stays in general layout. The chain is not needed in the next frame,
+*	so its memory is shared with G-buffer, the views are created by createTransientViews().
+*
+*/
+void HdaSwapchain::createBloomChain() {
+
+	bloomLevels = HdaBloom::levelCount(surfaceExtent.width, surfaceExtent.height);
+	glm::uvec2 extent = HdaBloom::levelExtent(surfaceExtent.width, surfaceExtent.height, 0);
+
+	bloomImage = createTransientImage(extent.x, extent.y, BLOOM_FORMAT, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled, bloomLevels,
+									  static_cast<uint32_t>(1), "bloom chain", TRANSIENT_PASS_BLOOM, TRANSIENT_PASS_TONEMAP);
+
+	HdaBloom::BloomCost cost = HdaBloom::bloomCost(surfaceExtent.width, surfaceExtent.height, bloomLevels);
+	cout << "createBloomChain(): Bloom chain " << extent.x << "x" << extent.y << " with " << bloomLevels << " levels is created, "
+		 << cost.memory / (1024.0 * 1024.0) << " MB, " << cost.traffic / (1024.0 * 1024.0) << " MB of traffic per frame.\n";
+}
+
+
+/**
+*	@brief Create both bilateral grids of local tone mapping.
+*
+*	A cell covers LOCAL_GRID_CELL x LOCAL_GRID_CELL pixels of the scene color and the
+*	depth are bins of log luminance. Grids are written as storage images and sampled,
+*	so they stay in general layout like the bloom chain, they live only inside a frame too.
+*
+*/
+void HdaSwapchain::createLocalGrid() {
+
+	localGridExtent = HdaLocalTonemap::gridExtent(surfaceExtent.width, surfaceExtent.height);
+
+	for (int i = 0; i < localGridImages.size(); i++)
+		localGridImages[i] = createTransientImage(localGridExtent.x, localGridExtent.y, LOCAL_GRID_FORMAT, vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+												  static_cast<uint32_t>(1), static_cast<uint32_t>(LOCAL_GRID_BINS), i == 0 ? "local grid" : "local grid blurred",
+												  TRANSIENT_PASS_LOCAL, TRANSIENT_PASS_TONEMAP);
+
+	HdaLocalTonemap::LocalCost cost = HdaLocalTonemap::localCost(surfaceExtent.width, surfaceExtent.height);
+	cout << "createLocalGrid(): Bilateral grid " << localGridExtent.x << "x" << localGridExtent.y << "x" << LOCAL_GRID_BINS << " is created, "
+		 << cost.memory / 1024.0 << " KB, " << cost.traffic / (1024.0 * 1024.0) << " MB of traffic per frame.\n";
+}
+
+
+/**
+*	@brief Create G-buffer of deferred shading.
+*
+*	Both color targets are read as input attachments by the lighting subpass and they are
+*	not stored, so they are transient attachments. The position is reconstructed from
+*	the depth attachment.
+*
+*/
+void HdaSwapchain::createGbuffer() {
+
+	vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment | vk::ImageUsageFlagBits::eTransientAttachment;
+
+	size_t lazy = lazyMems.size();
+	gbufferAlbedo = createTransientImage(surfaceExtent.width, surfaceExtent.height, GBUFFER_ALBEDO_FORMAT, usage, static_cast<uint32_t>(1), static_cast<uint32_t>(1),
+										 "G-buffer albedo", TRANSIENT_PASS_SCENE, TRANSIENT_PASS_SCENE);
+	gbufferNormal = createTransientImage(surfaceExtent.width, surfaceExtent.height, GBUFFER_NORMAL_FORMAT, usage, static_cast<uint32_t>(1), static_cast<uint32_t>(1),
+										 "G-buffer normal", TRANSIENT_PASS_SCENE, TRANSIENT_PASS_SCENE);
+	lazyGbuffer = lazyMems.size() > lazy;
+
+	HdaDeferred::GbufferCost cost = HdaDeferred::gbufferCost(surfaceExtent.width, surfaceExtent.height, depthFormat, 1.0);
+	cout << "createGbuffer(): G-buffer " << surfaceExtent.width << "x" << surfaceExtent.height << " is created, "
+		 << cost.memory / (1024.0 * 1024.0) << " MB with depth" << (lazyGbuffer ? ", the color targets are lazily allocated.\n" : ".\n");
+}
+
+
+/**
+*	@brief Create views of images which live only inside a frame.
+*
+*	The views need memory bound by bindTransientMemory(). The G-buffer framebuffer has
+*	the attachments of both subpasses of deferred shading - G-buffer, depth and the scene
+*	color, which is written by the lighting subpass.
+*
+*/
+void HdaSwapchain::createTransientViews() {
+
+	bloomLevelViews.clear();
+	for (uint32_t l = 0; l < bloomLevels; l++)
+		bloomLevelViews.push_back(createImageView(bloomImage, BLOOM_FORMAT, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(1), vk::ImageViewType::e2D,
+												  l, static_cast<uint32_t>(1)));
+
+	for (int i = 0; i < localGridImages.size(); i++)
+		localGridViews[i] = createImageView(localGridImages[i], LOCAL_GRID_FORMAT, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(1), vk::ImageViewType::e3D);
+
+	gbufferAlbedoView = createImageView(gbufferAlbedo, GBUFFER_ALBEDO_FORMAT, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(1), vk::ImageViewType::e2D);
+	gbufferNormalView = createImageView(gbufferNormal, GBUFFER_NORMAL_FORMAT, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(1), vk::ImageViewType::e2D);
+
+	std::array<vk::ImageView, 4> imageViews = { gbufferAlbedoView, gbufferNormalView, depthImageView, sceneColorView };
+
+	gbufferFramebuffer =
+		device.getDevice().createFramebuffer(
+			vk::FramebufferCreateInfo(
+				vk::FramebufferCreateFlags(),  // flags
+				device.getGbufferRenderpass(),  // renderPass
+				static_cast<uint32_t>(imageViews.size()),  // attachmentCount
+				imageViews.data(),  // pAttachments
+				surfaceExtent.width,  // width
+				surfaceExtent.height,  // height
+				1  // layers
+			)
+		);
+}
+
+
+/**
+*	@brief Create depth pyramid for occlusion culling.
+*
+*	The pyramid has power of two size not larger than the depth attachment and full mip chain.
+*	Every level has its own view for writing in depth_pyramid.comp, the view of all levels is
+*	sampled in meshlet_cull.comp.
+*
+*/
+void HdaSwapchain::createDepthPyramid() {
+
+	depthPyramidExtent = HdaOcclusion::pyramidSize(surfaceExtent.width, surfaceExtent.height);
+	depthPyramidLevels = HdaOcclusion::pyramidLevels(surfaceExtent.width, surfaceExtent.height);
+
+	depthPyramidImage = createImage(depthPyramidExtent.x, depthPyramidExtent.y, vk::Format::eR32Sfloat, vk::ImageTiling::eOptimal,
+									vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled, vk::MemoryPropertyFlagBits::eDeviceLocal,
+									depthPyramidMem, static_cast<uint32_t>(1), vk::ImageCreateFlagBits::e2DArrayCompatible, depthPyramidLevels);
+
+	depthPyramidView = createImageView(depthPyramidImage, vk::Format::eR32Sfloat, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(1), vk::ImageViewType::e2D,
+									   static_cast<uint32_t>(0), depthPyramidLevels);
+
+	depthPyramidLevelViews.clear();
+	for (uint32_t l = 0; l < depthPyramidLevels; l++)
+		depthPyramidLevelViews.push_back(createImageView(depthPyramidImage, vk::Format::eR32Sfloat, vk::ImageAspectFlagBits::eColor, static_cast<uint32_t>(1),
+														 vk::ImageViewType::e2D, l, static_cast<uint32_t>(1)));
+
+	cout << "createDepthPyramid(): Depth pyramid " << depthPyramidExtent.x << "x" << depthPyramidExtent.y << " with " << depthPyramidLevels << " levels is created.\n";
 }
\ No newline at end of file
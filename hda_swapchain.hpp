@@ -1,5 +1,10 @@
 #pragma once
 #include "hda_instancegpu.hpp"
+#include "hda_occlusion.hpp"
+#include "hda_deferred.hpp"
+#include "hda_bloom.hpp"
+#include "hda_localtonemap.hpp"
+#include "hda_transient.hpp"
 
 /*
 *
@@ -17,11 +22,34 @@ public:
 	void initSwapchain();
 	void cleanupSwapchain();
 	vk::ImageView createImageView(vk::Image, vk::Format, vk::ImageAspectFlags, uint32_t, vk::ImageViewType);
+	vk::ImageView createImageView(vk::Image, vk::Format, vk::ImageAspectFlags, uint32_t, vk::ImageViewType, uint32_t, uint32_t);
 	vk::Image createImage(uint32_t, uint32_t, vk::Format, vk::ImageTiling, vk::ImageUsageFlags, vk::MemoryPropertyFlags, vk::DeviceMemory&, uint32_t, vk::ImageCreateFlagBits);
+	vk::Image createImage(uint32_t, uint32_t, vk::Format, vk::ImageTiling, vk::ImageUsageFlags, vk::MemoryPropertyFlags, vk::DeviceMemory&, uint32_t, vk::ImageCreateFlagBits, uint32_t);
+	vk::Image createImage(uint32_t, uint32_t, vk::Format, vk::ImageTiling, vk::ImageUsageFlags, vk::MemoryPropertyFlags, vk::DeviceMemory&, uint32_t, vk::ImageCreateFlagBits, uint32_t, uint32_t);
 
 	inline vk::SwapchainKHR getSwapchain() { return swapchain; }
 	inline vector<vk::Framebuffer> getFramebuffers() { return framebuffers; }
+	inline vk::Framebuffer getSceneFramebuffer() { return sceneFramebuffer; }
+	inline vk::Image getSceneColorImage() { return sceneColorImage; }
+	inline vk::ImageView getSceneColorView() { return sceneColorView; }
 	inline vk::Extent2D getSurfaceExtent() { return surfaceExtent; }
+	inline vk::ImageView getDepthImageView() { return depthImageView; }
+	inline vk::Image getDepthPyramidImage() { return depthPyramidImage; }
+	inline vk::ImageView getDepthPyramidView() { return depthPyramidView; }
+	inline vk::ImageView getDepthPyramidLevelView(uint32_t level) { return depthPyramidLevelViews[level]; }
+	inline uint32_t getDepthPyramidLevels() { return depthPyramidLevels; }
+	inline glm::uvec2 getDepthPyramidExtent() { return depthPyramidExtent; }
+	inline vk::ImageView getGbufferAlbedoView() { return gbufferAlbedoView; }
+	inline vk::ImageView getGbufferNormalView() { return gbufferNormalView; }
+	inline vk::Framebuffer getGbufferFramebuffer() { return gbufferFramebuffer; }
+	inline vk::Image getBloomImage() { return bloomImage; }
+	inline vk::ImageView getBloomLevelView(uint32_t level) { return bloomLevelViews[level]; }
+	inline uint32_t getBloomLevels() { return bloomLevels; }
+	inline vk::Image getLocalGridImage(uint32_t i) { return localGridImages[i]; }
+	inline vk::ImageView getLocalGridView(uint32_t i) { return localGridViews[i]; }
+	inline glm::uvec2 getLocalGridExtent() { return localGridExtent; }
+	inline bool getLazyGbuffer() { return lazyGbuffer; }
+	uint64_t getTransientSize(vk::Image);
 
 private:
 
@@ -29,6 +57,16 @@ private:
 	void createSwapchainImageViews();
 	void createFramebuffers();
 	void createDepthAttachment();
+	void createDepthPyramid();
+	void createSceneColor();
+	void createBloomChain();
+	void createLocalGrid();
+	void createGbuffer();
+	void bindTransientMemory();
+	void createTransientViews();
+	uint32_t findMemoryType(uint32_t, vk::MemoryPropertyFlags);
+	vk::Image createUnboundImage(uint32_t, uint32_t, vk::Format, vk::ImageTiling, vk::ImageUsageFlags, uint32_t, vk::ImageCreateFlagBits, uint32_t, uint32_t);
+	vk::Image createTransientImage(uint32_t, uint32_t, vk::Format, vk::ImageUsageFlags, uint32_t, uint32_t, const std::string&, uint32_t, uint32_t);
 
 	// TODO TODO smazat
 	//vk::ImageView createImageView(vk::Image, vk::Format, vk::ImageAspectFlags);
@@ -47,10 +85,48 @@ private:
 	vk::SwapchainKHR swapchain = vk::SwapchainKHR(nullptr);
 	vector<vk::Image> swapchainImages{};
 	vector<vk::ImageView> swapchainImageViews{};
-	vector<vk::Framebuffer> framebuffers{};
+	vector<vk::Framebuffer> framebuffers{};		// swapchain images of the tone mapping pass
 
 	vk::Image depthImage;
 	vk::ImageView depthImageView;
 	vk::Format depthFormat{};
 	vk::DeviceMemory depthImageMem;
+
+	// hierarchical depth for occlusion culling
+	vk::Image depthPyramidImage;
+	vk::ImageView depthPyramidView;
+	vector<vk::ImageView> depthPyramidLevelViews{};
+	vk::DeviceMemory depthPyramidMem;
+	uint32_t depthPyramidLevels = 0;
+	glm::uvec2 depthPyramidExtent{ 0, 0 };
+
+	// HDR color of the forward passes and the lighting pass, shares depth attachment with G-buffer
+	vk::Image sceneColorImage;
+	vk::ImageView sceneColorView;
+	vk::DeviceMemory sceneColorMem;
+	vk::Framebuffer sceneFramebuffer;
+
+	// downsample and upsample chain of bloom
+	vk::Image bloomImage;
+	vector<vk::ImageView> bloomLevelViews{};
+	uint32_t bloomLevels = 0;
+
+	// bilateral grid of local tone mapping, the splat writes the first one and the blur the second one
+	array<vk::Image, 2> localGridImages{};
+	array<vk::ImageView, 2> localGridViews{};
+	glm::uvec2 localGridExtent{ 0, 0 };
+
+	// G-buffer of deferred shading, shares depth attachment and scene color with the forward path
+	vk::Image gbufferAlbedo;
+	vk::ImageView gbufferAlbedoView;
+	vk::Image gbufferNormal;
+	vk::ImageView gbufferNormalView;
+	vk::Framebuffer gbufferFramebuffer;
+	bool lazyGbuffer = false;
+
+	// images which live only inside a frame, bloom chain, local grids and G-buffer without lazily allocated memory
+	vector<vk::Image> transientImages{};
+	vector<HdaTransient::Target> transientTargets{};
+	vk::DeviceMemory transientMem;
+	vector<vk::DeviceMemory> lazyMems{};		// dedicated lazily allocated memory of transient attachments
 };
\ No newline at end of file
@@ -0,0 +1,888 @@
+#include "hda_tonemap.hpp"
+#include "hda_localtonemap.hpp"
+#include "external/include/stb_image.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TONEMAP_X86						// SSE2 is part of x86-64, AVX2 is detected at runtime
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TONEMAP_AVX2_TARGET
+#else
+#define TONEMAP_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+
+// constants of uncharted2TMO() in tonemap.frag
+static const float u2A = 0.15f;
+static const float u2B = 0.50f;
+static const float u2C = 0.10f;
+static const float u2D = 0.20f;
+static const float u2E = 0.02f;
+static const float u2F = 0.30f;
+static const float u2W = 11.2f;
+static const float u2ExposureBias = 2.0f;
+
+// matrices of originalAcesTMO() in tonemap.frag, column-major as in GLSL
+static const glm::mat3 acesInput(
+	0.59719f, 0.07600f, 0.02840f,
+	0.35458f, 0.90834f, 0.13383f,
+	0.04823f, 0.01566f, 0.83777f
+);
+static const glm::mat3 acesOutput(
+	1.60475f, -0.10208f, -0.00327f,
+	-0.53108f, 1.10813f, -0.07276f,
+	-0.07367f, -0.00605f, 1.07602f
+);
+
+
+static float uncharted2(float x) {
+
+	return ((x * (u2A * x + u2C * u2B) + u2D * u2E) / (x * (u2A * x + u2B) + u2D * u2F)) - u2E / u2F;
+}
+
+
+/**
+*	@brief Tone map one pixel by the formulas of tonemap.frag.
+*
+*	This is the reference of the SIMD paths. The result is clamped to [0, 1] and encoded
+*	by the gamma of settings, gamma 1 leaves the value which the shader writes.
+*
+*/
+glm::vec3 HdaTonemap::tonemapPixel(glm::vec3 color, const Settings& settings) {
+
+	glm::vec3 result = color;
+
+	if (settings.hdrOnFlag == 1) {
+
+		float e = settings.exposure;
+		if (settings.chooseMethodFlag == 0) {
+
+			glm::vec3 x = color * e;
+			result = x / (1.0f + x);
+		}
+		else if (settings.chooseMethodFlag == 1) {
+
+			glm::vec3 x = glm::max(color * e - 0.004f, 0.0f);
+			result = glm::pow((x * (6.2f * x + 0.5f)) / (x * (6.2f * x + 1.7f) + 0.06f), glm::vec3(2.2f));
+		}
+		else if (settings.chooseMethodFlag == 2) {
+
+			glm::vec3 x = u2ExposureBias * color * e;
+			result = glm::vec3(uncharted2(x.r), uncharted2(x.g), uncharted2(x.b)) / uncharted2(u2W);
+		}
+		else if (settings.chooseMethodFlag == 3) {
+
+			glm::vec3 v = acesInput * (color * e);
+			glm::vec3 a = v * (v + 0.0245786f) - 0.000090537f;
+			glm::vec3 b = v * (0.983729f * v + 0.4329510f) + 0.238081f;
+			result = glm::clamp(acesOutput * (a / b), 0.0f, 1.0f);
+		}
+		else
+			result = glm::vec3(1.0f) - glm::exp(-color * e);
+	}
+
+	result = glm::clamp(result, 0.0f, 1.0f);
+	if (settings.gamma != 1.0f)
+		result = glm::pow(result, glm::vec3(1.0f / settings.gamma));
+
+	return result;
+}
+
+
+#ifdef TONEMAP_X86
+
+/*
+*
+* SIMD paths load a block of interleaved pixels as 3 vectors, all operators except ACES
+* work on every channel alone, so the vectors need no shuffles. ACES mixes the channels,
+* its block is transposed through the stack. The exponent of exp2 is added to the float
+* bits and the fraction in [-0.5, 0.5] is a Taylor series of e^(f ln2), log2 splits
+* the exponent and evaluates the mantissa in [sqrt(0.5), sqrt(2)) by the series of atanh.
+* Both have relative error about 1e-7, divisions are exact as in the reference.
+*
+*/
+
+static inline __m128 selectSse(__m128 mask, __m128 a, __m128 b) {
+
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+
+static inline __m128 exp2Sse(__m128 x) {
+
+	x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+	__m128i n = _mm_cvtps_epi32(x);
+	__m128 g = _mm_mul_ps(_mm_sub_ps(x, _mm_cvtepi32_ps(n)), _mm_set1_ps(0.693147181f));
+
+	__m128 p = _mm_set1_ps(1.0f / 720.0f);
+	p = _mm_add_ps(_mm_mul_ps(p, g), _mm_set1_ps(1.0f / 120.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, g), _mm_set1_ps(1.0f / 24.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, g), _mm_set1_ps(1.0f / 6.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, g), _mm_set1_ps(0.5f));
+	p = _mm_add_ps(_mm_mul_ps(p, g), _mm_set1_ps(1.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, g), _mm_set1_ps(1.0f));
+
+	return _mm_mul_ps(p, _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23)));
+}
+
+
+// x must be positive, pow() masks the rest
+static inline __m128 log2Sse(__m128 x) {
+
+	__m128i bits = _mm_castps_si128(x);
+	__m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+	__m128 big = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+	m = selectSse(big, _mm_mul_ps(m, _mm_set1_ps(0.5f)), m);
+	e = _mm_sub_epi32(e, _mm_castps_si128(big));
+
+	__m128 t = _mm_div_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_add_ps(m, _mm_set1_ps(1.0f)));
+	__m128 t2 = _mm_mul_ps(t, t);
+	__m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(1.0f / 7.0f), t2), _mm_set1_ps(1.0f / 5.0f));
+	s = _mm_add_ps(_mm_mul_ps(s, t2), _mm_set1_ps(1.0f / 3.0f));
+	s = _mm_add_ps(_mm_mul_ps(s, t2), _mm_set1_ps(1.0f));
+
+	return _mm_add_ps(_mm_cvtepi32_ps(e), _mm_mul_ps(_mm_mul_ps(s, t), _mm_set1_ps(2.88539008f)));	// 2 / ln2
+}
+
+
+static inline __m128 powSse(__m128 x, float y) {
+
+	__m128 r = exp2Sse(_mm_mul_ps(log2Sse(x), _mm_set1_ps(y)));
+	return _mm_and_ps(_mm_cmpgt_ps(x, _mm_setzero_ps()), r);
+}
+
+
+static inline __m128 uncharted2Sse(__m128 x) {
+
+	__m128 num = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(u2A), x), _mm_set1_ps(u2C * u2B))), _mm_set1_ps(u2D * u2E));
+	__m128 den = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(u2A), x), _mm_set1_ps(u2B))), _mm_set1_ps(u2D * u2F));
+	return _mm_sub_ps(_mm_div_ps(num, den), _mm_set1_ps(u2E / u2F));
+}
+
+
+// operators which work on every channel alone
+static inline __m128 channelSse(__m128 c, int method, float exposure, float whiteScale) {
+
+	__m128 x = _mm_mul_ps(c, _mm_set1_ps(exposure));
+	__m128 one = _mm_set1_ps(1.0f);
+
+	if (method == 0)
+		return _mm_div_ps(x, _mm_add_ps(one, x));
+	if (method == 1) {
+
+		x = _mm_max_ps(_mm_sub_ps(x, _mm_set1_ps(0.004f)), _mm_setzero_ps());
+		__m128 x62 = _mm_mul_ps(_mm_set1_ps(6.2f), x);
+		__m128 num = _mm_mul_ps(x, _mm_add_ps(x62, _mm_set1_ps(0.5f)));
+		__m128 den = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(x62, _mm_set1_ps(1.7f))), _mm_set1_ps(0.06f));
+		return powSse(_mm_div_ps(num, den), 2.2f);
+	}
+	if (method == 2)
+		return _mm_mul_ps(uncharted2Sse(_mm_mul_ps(_mm_set1_ps(u2ExposureBias), x)), _mm_set1_ps(whiteScale));
+
+	return _mm_sub_ps(one, exp2Sse(_mm_mul_ps(x, _mm_set1_ps(-1.44269504f))));	// e^-x = 2^(-x log2(e))
+}
+
+
+static inline void acesSse(__m128 rgb[3], float exposure) {
+
+	__m128 e = _mm_set1_ps(exposure);
+	__m128 c[3] = { _mm_mul_ps(rgb[0], e), _mm_mul_ps(rgb[1], e), _mm_mul_ps(rgb[2], e) };
+
+	__m128 curve[3];
+	for (int i = 0; i < 3; i++) {
+
+		__m128 v = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(acesInput[0][i]), c[0]),
+			_mm_mul_ps(_mm_set1_ps(acesInput[1][i]), c[1])),
+			_mm_mul_ps(_mm_set1_ps(acesInput[2][i]), c[2]));
+		__m128 a = _mm_sub_ps(_mm_mul_ps(v, _mm_add_ps(v, _mm_set1_ps(0.0245786f))), _mm_set1_ps(0.000090537f));
+		__m128 b = _mm_add_ps(_mm_mul_ps(v, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.983729f), v), _mm_set1_ps(0.4329510f))), _mm_set1_ps(0.238081f));
+		curve[i] = _mm_div_ps(a, b);
+	}
+
+	for (int i = 0; i < 3; i++)
+		rgb[i] = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(acesOutput[0][i]), curve[0]),
+			_mm_mul_ps(_mm_set1_ps(acesOutput[1][i]), curve[1])),
+			_mm_mul_ps(_mm_set1_ps(acesOutput[2][i]), curve[2]));
+}
+
+
+// blocks of 4 pixels, returns the number of pixels done
+static uint32_t blocksSse(const float* src, float* dst, uint32_t count, const HdaTonemap::Settings& settings, float whiteScale) {
+
+	uint32_t blocks = count / 4;
+	for (uint32_t b = 0; b < blocks; b++) {
+
+		const float* in = src + 12 * static_cast<size_t>(b);
+		float* out = dst + 12 * static_cast<size_t>(b);
+		__m128 v[3] = { _mm_loadu_ps(in), _mm_loadu_ps(in + 4), _mm_loadu_ps(in + 8) };
+
+		if (settings.hdrOnFlag == 1 && settings.chooseMethodFlag == 3) {
+
+			alignas(16) float soa[3][4];
+			for (int p = 0; p < 4; p++)
+				for (int ch = 0; ch < 3; ch++)
+					soa[ch][p] = in[3 * p + ch];
+
+			__m128 rgb[3] = { _mm_load_ps(soa[0]), _mm_load_ps(soa[1]), _mm_load_ps(soa[2]) };
+			acesSse(rgb, settings.exposure);
+			for (int ch = 0; ch < 3; ch++)
+				_mm_store_ps(soa[ch], rgb[ch]);
+
+			alignas(16) float aos[12];
+			for (int p = 0; p < 4; p++)
+				for (int ch = 0; ch < 3; ch++)
+					aos[3 * p + ch] = soa[ch][p];
+			for (int i = 0; i < 3; i++)
+				v[i] = _mm_load_ps(aos + 4 * i);
+		}
+		else if (settings.hdrOnFlag == 1) {
+
+			for (int i = 0; i < 3; i++)
+				v[i] = channelSse(v[i], settings.chooseMethodFlag, settings.exposure, whiteScale);
+		}
+
+		for (int i = 0; i < 3; i++) {
+
+			v[i] = _mm_min_ps(_mm_max_ps(v[i], _mm_setzero_ps()), _mm_set1_ps(1.0f));
+			if (settings.gamma != 1.0f)
+				v[i] = powSse(v[i], 1.0f / settings.gamma);
+			_mm_storeu_ps(out + 4 * i, v[i]);
+		}
+	}
+
+	return blocks * 4;
+}
+
+
+// the same as SSE functions with 8 lanes, helpers are inlined only into functions of the same target
+TONEMAP_AVX2_TARGET static inline __m256 exp2Avx2(__m256 x) {
+
+	x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(126.0f));
+	__m256i n = _mm256_cvtps_epi32(x);
+	__m256 g = _mm256_mul_ps(_mm256_sub_ps(x, _mm256_cvtepi32_ps(n)), _mm256_set1_ps(0.693147181f));
+
+	__m256 p = _mm256_set1_ps(1.0f / 720.0f);
+	p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(1.0f / 120.0f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(1.0f / 24.0f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(1.0f / 6.0f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(0.5f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(1.0f));
+	p = _mm256_add_ps(_mm256_mul_ps(p, g), _mm256_set1_ps(1.0f));
+
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23)));
+}
+
+
+TONEMAP_AVX2_TARGET static inline __m256 log2Avx2(__m256 x) {
+
+	__m256i bits = _mm256_castps_si256(x);
+	__m256i e = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+	__m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+
+	__m256 big = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+	m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), big);
+	e = _mm256_sub_epi32(e, _mm256_castps_si256(big));
+
+	__m256 t = _mm256_div_ps(_mm256_sub_ps(m, _mm256_set1_ps(1.0f)), _mm256_add_ps(m, _mm256_set1_ps(1.0f)));
+	__m256 t2 = _mm256_mul_ps(t, t);
+	__m256 s = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(1.0f / 7.0f), t2), _mm256_set1_ps(1.0f / 5.0f));
+	s = _mm256_add_ps(_mm256_mul_ps(s, t2), _mm256_set1_ps(1.0f / 3.0f));
+	s = _mm256_add_ps(_mm256_mul_ps(s, t2), _mm256_set1_ps(1.0f));
+
+	return _mm256_add_ps(_mm256_cvtepi32_ps(e), _mm256_mul_ps(_mm256_mul_ps(s, t), _mm256_set1_ps(2.88539008f)));
+}
+
+
+TONEMAP_AVX2_TARGET static inline __m256 powAvx2(__m256 x, float y) {
+
+	__m256 r = exp2Avx2(_mm256_mul_ps(log2Avx2(x), _mm256_set1_ps(y)));
+	return _mm256_and_ps(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ), r);
+}
+
+
+TONEMAP_AVX2_TARGET static inline __m256 uncharted2Avx2(__m256 x) {
+
+	__m256 num = _mm256_add_ps(_mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(u2A), x), _mm256_set1_ps(u2C * u2B))), _mm256_set1_ps(u2D * u2E));
+	__m256 den = _mm256_add_ps(_mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(u2A), x), _mm256_set1_ps(u2B))), _mm256_set1_ps(u2D * u2F));
+	return _mm256_sub_ps(_mm256_div_ps(num, den), _mm256_set1_ps(u2E / u2F));
+}
+
+
+TONEMAP_AVX2_TARGET static inline __m256 channelAvx2(__m256 c, int method, float exposure, float whiteScale) {
+
+	__m256 x = _mm256_mul_ps(c, _mm256_set1_ps(exposure));
+	__m256 one = _mm256_set1_ps(1.0f);
+
+	if (method == 0)
+		return _mm256_div_ps(x, _mm256_add_ps(one, x));
+	if (method == 1) {
+
+		x = _mm256_max_ps(_mm256_sub_ps(x, _mm256_set1_ps(0.004f)), _mm256_setzero_ps());
+		__m256 x62 = _mm256_mul_ps(_mm256_set1_ps(6.2f), x);
+		__m256 num = _mm256_mul_ps(x, _mm256_add_ps(x62, _mm256_set1_ps(0.5f)));
+		__m256 den = _mm256_add_ps(_mm256_mul_ps(x, _mm256_add_ps(x62, _mm256_set1_ps(1.7f))), _mm256_set1_ps(0.06f));
+		return powAvx2(_mm256_div_ps(num, den), 2.2f);
+	}
+	if (method == 2)
+		return _mm256_mul_ps(uncharted2Avx2(_mm256_mul_ps(_mm256_set1_ps(u2ExposureBias), x)), _mm256_set1_ps(whiteScale));
+
+	return _mm256_sub_ps(one, exp2Avx2(_mm256_mul_ps(x, _mm256_set1_ps(-1.44269504f))));
+}
+
+
+TONEMAP_AVX2_TARGET static inline void acesAvx2(__m256 rgb[3], float exposure) {
+
+	__m256 e = _mm256_set1_ps(exposure);
+	__m256 c[3] = { _mm256_mul_ps(rgb[0], e), _mm256_mul_ps(rgb[1], e), _mm256_mul_ps(rgb[2], e) };
+
+	__m256 curve[3];
+	for (int i = 0; i < 3; i++) {
+
+		__m256 v = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_set1_ps(acesInput[0][i]), c[0]),
+			_mm256_mul_ps(_mm256_set1_ps(acesInput[1][i]), c[1])),
+			_mm256_mul_ps(_mm256_set1_ps(acesInput[2][i]), c[2]));
+		__m256 a = _mm256_sub_ps(_mm256_mul_ps(v, _mm256_add_ps(v, _mm256_set1_ps(0.0245786f))), _mm256_set1_ps(0.000090537f));
+		__m256 b = _mm256_add_ps(_mm256_mul_ps(v, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(0.983729f), v), _mm256_set1_ps(0.4329510f))), _mm256_set1_ps(0.238081f));
+		curve[i] = _mm256_div_ps(a, b);
+	}
+
+	for (int i = 0; i < 3; i++)
+		rgb[i] = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_set1_ps(acesOutput[0][i]), curve[0]),
+			_mm256_mul_ps(_mm256_set1_ps(acesOutput[1][i]), curve[1])),
+			_mm256_mul_ps(_mm256_set1_ps(acesOutput[2][i]), curve[2]));
+}
+
+
+TONEMAP_AVX2_TARGET static uint32_t blocksAvx2(const float* src, float* dst, uint32_t count, const HdaTonemap::Settings& settings, float whiteScale) {
+
+	uint32_t blocks = count / 8;
+	for (uint32_t b = 0; b < blocks; b++) {
+
+		const float* in = src + 24 * static_cast<size_t>(b);
+		float* out = dst + 24 * static_cast<size_t>(b);
+		__m256 v[3] = { _mm256_loadu_ps(in), _mm256_loadu_ps(in + 8), _mm256_loadu_ps(in + 16) };
+
+		if (settings.hdrOnFlag == 1 && settings.chooseMethodFlag == 3) {
+
+			alignas(32) float soa[3][8];
+			for (int p = 0; p < 8; p++)
+				for (int ch = 0; ch < 3; ch++)
+					soa[ch][p] = in[3 * p + ch];
+
+			__m256 rgb[3] = { _mm256_load_ps(soa[0]), _mm256_load_ps(soa[1]), _mm256_load_ps(soa[2]) };
+			acesAvx2(rgb, settings.exposure);
+			for (int ch = 0; ch < 3; ch++)
+				_mm256_store_ps(soa[ch], rgb[ch]);
+
+			alignas(32) float aos[24];
+			for (int p = 0; p < 8; p++)
+				for (int ch = 0; ch < 3; ch++)
+					aos[3 * p + ch] = soa[ch][p];
+			for (int i = 0; i < 3; i++)
+				v[i] = _mm256_load_ps(aos + 8 * i);
+		}
+		else if (settings.hdrOnFlag == 1) {
+
+			for (int i = 0; i < 3; i++)
+				v[i] = channelAvx2(v[i], settings.chooseMethodFlag, settings.exposure, whiteScale);
+		}
+
+		for (int i = 0; i < 3; i++) {
+
+			v[i] = _mm256_min_ps(_mm256_max_ps(v[i], _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+			if (settings.gamma != 1.0f)
+				v[i] = powAvx2(v[i], 1.0f / settings.gamma);
+			_mm256_storeu_ps(out + 8 * i, v[i]);
+		}
+	}
+
+	return blocks * 8;
+}
+
+#endif
+
+
+void HdaTonemap::rowScalar(const float* src, float* dst, uint32_t count, const Settings& settings) {
+
+	for (uint32_t p = 0; p < count; p++) {
+
+		glm::vec3 c = tonemapPixel(glm::vec3(src[3 * p], src[3 * p + 1], src[3 * p + 2]), settings);
+		dst[3 * p] = c.r;
+		dst[3 * p + 1] = c.g;
+		dst[3 * p + 2] = c.b;
+	}
+}
+
+
+// pixels which do not fill the last block are done by the reference
+void HdaTonemap::rowSse(const float* src, float* dst, uint32_t count, const Settings& settings) {
+
+#ifdef TONEMAP_X86
+	uint32_t done = blocksSse(src, dst, count, settings, 1.0f / uncharted2(u2W));
+	rowScalar(src + 3 * done, dst + 3 * done, count - done, settings);
+#endif
+}
+
+
+void HdaTonemap::rowAvx2(const float* src, float* dst, uint32_t count, const Settings& settings) {
+
+#ifdef TONEMAP_X86
+	uint32_t done = blocksAvx2(src, dst, count, settings, 1.0f / uncharted2(u2W));
+	rowScalar(src + 3 * done, dst + 3 * done, count - done, settings);
+#endif
+}
+
+
+// count pixels of interleaved RGB, source and destination may be the same
+void HdaTonemap::tonemapRow(const float* src, float* dst, uint32_t count, const Settings& settings, int isa) {
+
+	if (!isaSupported(isa))
+		throw std::runtime_error("tonemapRow(): Instruction set is not supported by this CPU.\n");
+
+	if (isa == TONEMAP_ISA_AVX2)
+		rowAvx2(src, dst, count, settings);
+	else if (isa == TONEMAP_ISA_SSE)
+		rowSse(src, dst, count, settings);
+	else
+		rowScalar(src, dst, count, settings);
+}
+
+
+void HdaTonemap::tonemapImage(HdaJobs& jobs, const float* src, float* dst, uint32_t width, uint32_t height, const Settings& settings, int isa) {
+
+	if (!isaSupported(isa))
+		throw std::runtime_error("tonemapImage(): Instruction set is not supported by this CPU.\n");
+
+	jobs.parallelFor("tonemap", height, 0, [&](uint32_t begin, uint32_t end) {
+		size_t offset = 3 * static_cast<size_t>(width) * begin;
+		tonemapRow(src + offset, dst + offset, width * (end - begin), settings, isa);
+	});
+}
+
+
+bool HdaTonemap::isaSupported(int isa) {
+
+	if (isa == TONEMAP_ISA_SCALAR)
+		return true;
+
+#ifdef TONEMAP_X86
+	if (isa == TONEMAP_ISA_SSE)
+		return true;
+
+	if (isa == TONEMAP_ISA_AVX2) {
+#ifdef _MSC_VER
+		// AVX needs OS support of YMM registers, AVX2 is bit 5 of leaf 7
+		int regs[4];
+		__cpuid(regs, 1);
+		bool avx = (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+		__cpuidex(regs, 7, 0);
+		return avx && (regs[1] & (1 << 5));
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	return false;
+}
+
+
+int HdaTonemap::bestIsa() {
+
+	for (int isa = TONEMAP_ISAS - 1; isa > TONEMAP_ISA_SCALAR; isa--)
+		if (isaSupported(isa))
+			return isa;
+
+	return TONEMAP_ISA_SCALAR;
+}
+
+
+const char* HdaTonemap::isaName(int isa) {
+
+	if (isa == TONEMAP_ISA_AVX2)
+		return "AVX2";
+	if (isa == TONEMAP_ISA_SSE)
+		return "SSE2";
+
+	return "scalar";
+}
+
+
+const char* HdaTonemap::methodName(int method) {
+
+	const char* names[] = { "Reinhard", "Hejl-Dawson", "Uncharted 2", "ACES", "modified Reinhard" };
+	return names[std::clamp(method, 0, TONEMAP_METHODS - 1)];
+}
+
+
+// bin of linear displayed color, the bins are uniform after TONEMAP_GAMMA, so the dark ones are not crowded
+uint32_t HdaTonemap::statsBin(glm::vec3 color) {
+
+	float lum = std::clamp(glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f)), 0.0f, 1.0f);
+	return std::min(static_cast<uint32_t>(std::pow(lum, 1.0f / TONEMAP_GAMMA) * TONEMAP_STATS_BINS), static_cast<uint32_t>(TONEMAP_STATS_BINS - 1));
+}
+
+
+/**
+*	@brief Reduce histogram of one tile into its statistics.
+*
+*	The mean and median are linear luminance of bin centers, so they are exact to
+*	the width of bin. Crushed and clipped are fractions of the first and the last bin.
+*
+*/
+HdaTonemap::TileStats HdaTonemap::tileStats(const uint32_t* histogram) {
+
+	TileStats stats{};
+	for (uint32_t i = 0; i < TONEMAP_STATS_BINS; i++)
+		stats.samples += histogram[i];
+	if (stats.samples == 0)
+		return stats;
+
+	auto center = [](uint32_t bin) { return std::pow((bin + 0.5f) / TONEMAP_STATS_BINS, TONEMAP_GAMMA); };
+
+	double sum = 0.0;
+	uint32_t below = 0;
+	bool medianFound = false;
+	for (uint32_t i = 0; i < TONEMAP_STATS_BINS; i++) {
+
+		sum += histogram[i] * static_cast<double>(center(i));
+		below += histogram[i];
+		if (!medianFound && 2 * below >= stats.samples) {
+			stats.median = center(i);
+			medianFound = true;
+		}
+	}
+
+	stats.mean = static_cast<float>(sum / stats.samples);
+	stats.crushed = static_cast<float>(histogram[0]) / stats.samples;
+	stats.clipped = static_cast<float>(histogram[TONEMAP_STATS_BINS - 1]) / stats.samples;
+
+	return stats;
+}
+
+
+// coordinate of radiance in LUT, 0 is black and 1 is TONEMAP_LUT_MAX
+float HdaTonemap::lutShaper(float x) {
+
+	float range = std::log2(TONEMAP_LUT_MAX / TONEMAP_LUT_EPSILON + 1.0f);
+	return std::clamp(std::log2(std::max(x, 0.0f) / TONEMAP_LUT_EPSILON + 1.0f) / range, 0.0f, 1.0f);
+}
+
+
+float HdaTonemap::lutShaperInverse(float u) {
+
+	float range = std::log2(TONEMAP_LUT_MAX / TONEMAP_LUT_EPSILON + 1.0f);
+	return TONEMAP_LUT_EPSILON * (std::exp2(u * range) - 1.0f);
+}
+
+
+// white balance, saturation and contrast of display referred color
+glm::vec3 HdaTonemap::gradePixel(glm::vec3 color, const Grade& grade) {
+
+	const float middleGray = 0.18f;
+
+	glm::vec3 c = color * grade.gain;
+	float luma = glm::dot(c, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+	c = glm::max(glm::mix(glm::vec3(luma), c, grade.saturation), 0.0f);
+	if (grade.contrast != 1.0f)
+		c = middleGray * glm::pow(c / middleGray, glm::vec3(grade.contrast));
+
+	return glm::clamp(c, 0.0f, 1.0f);
+}
+
+
+/**
+*	@brief Bake tone mapping with exposure, grade and gamma into 3D LUT.
+*
+*	Texels are rgba16f with red changing fastest, which is the layout of a buffer copy
+*	into 3D image. Rows of red are tone mapped by the best SIMD path without gamma,
+*	the grade and gamma follow. Slices of blue are split among workers.
+*
+*/
+void HdaTonemap::bakeLut(HdaJobs& jobs, uint32_t size, const Settings& settings, const Grade& grade, uint16_t* texels) {
+
+	Settings linear = settings;
+	linear.gamma = 1.0f;
+	int isa = bestIsa();
+
+	std::vector<float> axis(size);
+	for (uint32_t i = 0; i < size; i++)
+		axis[i] = lutShaperInverse(static_cast<float>(i) / (size - 1));
+
+	jobs.parallelFor("bakeLut", size, 1, [&](uint32_t begin, uint32_t end) {
+
+		std::vector<float> row(3 * size), mapped(3 * size);
+		for (uint32_t b = begin; b < end; b++)
+			for (uint32_t g = 0; g < size; g++) {
+
+				for (uint32_t r = 0; r < size; r++) {
+					row[3 * r] = axis[r];
+					row[3 * r + 1] = axis[g];
+					row[3 * r + 2] = axis[b];
+				}
+				tonemapRow(row.data(), mapped.data(), size, linear, isa);
+
+				uint16_t* out = texels + 4 * (static_cast<size_t>(b) * size + g) * size;
+				for (uint32_t r = 0; r < size; r++) {
+
+					glm::vec3 c = gradePixel(glm::vec3(mapped[3 * r], mapped[3 * r + 1], mapped[3 * r + 2]), grade);
+					if (settings.gamma != 1.0f)
+						c = glm::pow(c, glm::vec3(1.0f / settings.gamma));
+
+					out[4 * r] = glm::packHalf1x16(c.r);
+					out[4 * r + 1] = glm::packHalf1x16(c.g);
+					out[4 * r + 2] = glm::packHalf1x16(c.b);
+					out[4 * r + 3] = glm::packHalf1x16(1.0f);
+				}
+			}
+	});
+}
+
+
+// trilinear filtering of texels at shaped coordinates, the same as texture() in tonemap.frag
+glm::vec3 HdaTonemap::sampleLut(const uint16_t* texels, uint32_t size, glm::vec3 color) {
+
+	uint32_t base[3];
+	float frac[3];
+	for (int ch = 0; ch < 3; ch++) {
+
+		float pos = lutShaper(color[ch]) * (size - 1);
+		base[ch] = std::min(static_cast<uint32_t>(pos), size - 2);
+		frac[ch] = pos - base[ch];
+	}
+
+	glm::vec3 result(0.0f);
+	for (uint32_t corner = 0; corner < 8; corner++) {
+
+		float weight = 1.0f;
+		uint32_t index[3];
+		for (int ch = 0; ch < 3; ch++) {
+
+			uint32_t step = (corner >> ch) & 1;
+			index[ch] = base[ch] + step;
+			weight *= step ? frac[ch] : 1.0f - frac[ch];
+		}
+
+		const uint16_t* t = texels + 4 * ((static_cast<size_t>(index[2]) * size + index[1]) * size + index[0]);
+		result += weight * glm::vec3(glm::unpackHalf1x16(t[0]), glm::unpackHalf1x16(t[1]), glm::unpackHalf1x16(t[2]));
+	}
+
+	return result;
+}
+
+
+// LUT of the size against the operator, grade and gamma of settings evaluated for every pixel
+HdaTonemap::LutError HdaTonemap::lutError(HdaJobs& jobs, uint32_t size, const Settings& settings, const Grade& grade, const std::vector<float>& image) {
+
+	std::vector<uint16_t> texels(4 * static_cast<size_t>(size) * size * size);
+	bakeLut(jobs, size, settings, grade, texels.data());
+
+	Settings linear = settings;
+	linear.gamma = 1.0f;
+
+	LutError error{};
+	double sum = 0.0;
+	for (size_t i = 0; i + 2 < image.size(); i += 3) {
+
+		glm::vec3 color(image[i], image[i + 1], image[i + 2]);
+		glm::vec3 analytic = gradePixel(tonemapPixel(color, linear), grade);
+		if (settings.gamma != 1.0f)
+			analytic = glm::pow(analytic, glm::vec3(1.0f / settings.gamma));
+
+		glm::vec3 d = glm::abs(sampleLut(texels.data(), size, color) - analytic);
+		error.max = std::max(error.max, std::max(d.r, std::max(d.g, d.b)));
+		sum += static_cast<double>(d.r) + d.g + d.b;
+	}
+	error.mean = static_cast<float>(sum / image.size());
+
+	return error;
+}
+
+
+/**
+*	@brief Tone map Radiance .hdr files and write them as binary PPM next to the source.
+*
+*	Returns the number of written files. Files which cannot be loaded are reported
+*	and skipped, OpenEXR is not supported by stb_image.
+*
+*/
+uint32_t HdaTonemap::toneMapFiles(const std::vector<std::string>& files, const Settings& settings) {
+
+	HdaJobs jobs(HdaJobs::defaultWorkerCount());
+	int isa = bestIsa();
+	uint32_t written = 0;
+
+	for (const std::string& name : files) {
+
+		std::filesystem::path file(name);
+		std::string extension = file.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+		if (extension != ".hdr") {
+			std::cout << "toneMapFiles(): " << name << " is skipped, only Radiance .hdr files are supported.\n";
+			continue;
+		}
+
+		int width, height, channels;
+		float* pixels = stbi_loadf(name.c_str(), &width, &height, &channels, STBI_rgb);
+		if (!pixels) {
+			std::cout << "toneMapFiles(): " << name << " cannot be loaded: " << stbi_failure_reason() << "\n";
+			continue;
+		}
+
+		std::vector<float> result(3 * static_cast<size_t>(width) * height);
+		auto startT = std::chrono::high_resolution_clock::now();
+		if (settings.localCompression != 1.0f)
+			HdaLocalTonemap::localTonemap(jobs, pixels, result.data(), width, height, settings);
+		else
+			tonemapImage(jobs, pixels, result.data(), width, height, settings, isa);
+		double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startT).count();
+		stbi_image_free(pixels);
+
+		// statistics of displayed luminance, the output is decoded by its gamma
+		std::vector<uint32_t> histogram(TONEMAP_STATS_BINS, 0);
+		std::vector<uint8_t> bytes(result.size());
+		for (size_t i = 0; i < result.size(); i += 3) {
+
+			for (size_t c = 0; c < 3; c++)
+				bytes[i + c] = static_cast<uint8_t>(result[i + c] * 255.0f + 0.5f);
+			histogram[statsBin(glm::vec3(std::pow(result[i], settings.gamma), std::pow(result[i + 1], settings.gamma), std::pow(result[i + 2], settings.gamma)))]++;
+		}
+		TileStats stats = tileStats(histogram.data());
+
+		file.replace_extension(".ppm");
+		std::ofstream out(file, std::ios::binary);
+		out << "P6\n" << width << " " << height << "\n255\n";
+		out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		if (!out) {
+			std::cout << "toneMapFiles(): " << file.string() << " cannot be written.\n";
+			continue;
+		}
+
+		std::cout << "toneMapFiles(): " << name << " -> " << file.string() << " | " << width << "x" << height << " | "
+			<< methodName(settings.chooseMethodFlag) << " | " << isaName(isa) << " | local compression " << settings.localCompression << " | " << time << " ms"
+			<< " | mean Y " << stats.mean << " median " << stats.median << " crushed " << 100.0f * stats.crushed << " % clipped " << 100.0f * stats.clipped << " %\n";
+		written++;
+	}
+
+	return written;
+}
+
+
+/**
+*	@brief Compare SIMD paths with the reference and measure throughput of all operators.
+*
+*	The image has radiance from 2^-10 to 2^10 with black texels and the edges of the
+*	operators at its beginning. Every operator and instruction set runs on one thread
+*	and on all workers, the best of a few runs is taken. Returns false if a SIMD path
+*	differs from the reference more than TONEMAP_TOLERANCE. LUTs of all sizes are baked
+*	as for tonemap.frag, compared with the analytic operators and their trilinear
+*	sampling on CPU is measured.
+*
+*/
+bool HdaTonemap::benchmark() {
+
+	const int runs = 5;
+	const uint32_t width = TONEMAP_BENCH_WIDTH, height = TONEMAP_BENCH_HEIGHT;
+	const size_t floats = 3 * static_cast<size_t>(width) * height;
+	auto ms = [](std::chrono::high_resolution_clock::time_point startT) {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startT).count();
+	};
+
+	std::vector<float> image(floats);
+	const float edges[] = { 0.0f, 1e-6f, 0.004f, 0.0041f, 0.18f, 0.5f, 1.0f, u2W, 100.0f, 65504.0f };
+	uint32_t state = 1;
+	for (size_t i = 0; i < floats; i++) {
+
+		state = state * 1664525u + 1013904223u;
+		if (i < sizeof(edges) / sizeof(edges[0]))
+			image[i] = edges[i];
+		else
+			image[i] = (i % 7 == 0) ? 0.0f : std::exp2((state >> 8) / 16777216.0f * 20.0f - 10.0f);
+	}
+
+	HdaJobs jobs(HdaJobs::defaultWorkerCount());
+	std::vector<float> reference(floats), result(floats);
+	bool ok = true;
+
+	std::cout << "\nbenchmark(): " << width << "x" << height << " pixels, gamma " << TONEMAP_GAMMA << "\n";
+	std::cout << "benchmark(): operator | ISA | max error | 1 thread Mpix/s | " << jobs.getWorkerCount() << " workers Mpix/s\n";
+
+	for (int method = 0; method < TONEMAP_METHODS; method++) {
+
+		Settings settings{};
+		settings.chooseMethodFlag = method;
+		tonemapRow(image.data(), reference.data(), width * height, settings, TONEMAP_ISA_SCALAR);
+
+		for (int isa = 0; isa < TONEMAP_ISAS; isa++) {
+
+			if (!isaSupported(isa))
+				continue;
+
+			double threadT = 1e9, workersT = 1e9;
+			for (int r = 0; r < runs; r++) {
+
+				auto startT = std::chrono::high_resolution_clock::now();
+				tonemapRow(image.data(), result.data(), width * height, settings, isa);
+				threadT = std::min(threadT, ms(startT));
+
+				startT = std::chrono::high_resolution_clock::now();
+				tonemapImage(jobs, image.data(), result.data(), width, height, settings, isa);
+				workersT = std::min(workersT, ms(startT));
+			}
+
+			float maxError = 0.0f;
+			for (size_t i = 0; i < floats; i++)
+				maxError = std::max(maxError, std::abs(result[i] - reference[i]));
+			if (!(maxError <= TONEMAP_TOLERANCE))
+				ok = false;
+
+			double mpixels = width * height / 1e3;
+			std::cout << "  " << methodName(method) << " | " << isaName(isa) << " | " << maxError << (maxError <= TONEMAP_TOLERANCE ? "" : " MISMATCH")
+				<< " | " << mpixels / threadT << " | " << mpixels / workersT << "\n";
+		}
+	}
+
+	std::cout << "benchmark(): operator | LUT size | bake ms | max error | mean error | 1 thread Mpix/s\n";
+	for (int method = 0; method < TONEMAP_METHODS; method++)
+		for (uint32_t size = TONEMAP_LUT_MIN_SIZE; size <= TONEMAP_LUT_MAX_SIZE; size = 2 * size - 1) {
+
+			Settings settings{};
+			settings.chooseMethodFlag = method;
+			settings.gamma = 1.0f;		// as baked for tonemap.frag
+			std::vector<uint16_t> texels(4 * static_cast<size_t>(size) * size * size);
+
+			auto startT = std::chrono::high_resolution_clock::now();
+			bakeLut(jobs, size, settings, Grade{}, texels.data());
+			double bakeT = ms(startT);
+
+			startT = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < floats; i += 3) {
+				glm::vec3 c = sampleLut(texels.data(), size, glm::vec3(image[i], image[i + 1], image[i + 2]));
+				result[i] = c.r;
+				result[i + 1] = c.g;
+				result[i + 2] = c.b;
+			}
+			double sampleT = ms(startT);
+
+			LutError error = lutError(jobs, size, settings, Grade{}, image);
+			std::cout << "  " << methodName(method) << " | " << size << " | " << bakeT << " | " << error.max << " | " << error.mean
+				<< " | " << width * height / 1e3 / sampleT << "\n";
+		}
+
+	return ok;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "hda_jobs.hpp"
+
+#include <string>
+#include <vector>
+
+#define TONEMAP_METHODS 5				// chooseMethodFlag of tonemap.frag, 4 and above is modified Reinhard
+#define TONEMAP_ISA_SCALAR 0
+#define TONEMAP_ISA_SSE 1				// SSE2, 4 pixels per block
+#define TONEMAP_ISA_AVX2 2				// 8 pixels per block
+#define TONEMAP_ISAS 3
+#define TONEMAP_GAMMA 2.2f
+#define TONEMAP_TOLERANCE 1e-4f			// largest difference of SIMD paths from the scalar reference
+#define TONEMAP_BENCH_WIDTH 1920
+#define TONEMAP_BENCH_HEIGHT 1080
+#define TONEMAP_LUT_FORMAT vk::Format::eR16G16B16A16Sfloat
+#define TONEMAP_LUT_SIZE 33				// edge of 3D LUT, the ends of shaper range are texel centers
+#define TONEMAP_LUT_MIN_SIZE 17
+#define TONEMAP_LUT_MAX_SIZE 65
+#define TONEMAP_LUT_EPSILON (1.0f / 1024.0f)	// shaper of LUT coordinates, the same as in tonemap.frag
+#define TONEMAP_LUT_MAX 4096.0f					// radiance of the last texel, larger values are clamped
+#define TONEMAP_COMPARE_MIN_TILES 2
+#define TONEMAP_COMPARE_MAX_TILES TONEMAP_METHODS	// every tile of comparison has its own operator
+#define TONEMAP_STATS_BINS 64					// bins of displayed luminance per tile, the same as in tonemap.frag
+#define TONEMAP_STATS_STRIDE 2					// every second pixel in both directions is counted by tonemap.frag
+
+
+/*
+*
+* A class representing the CPU tone mapping. The operators are the same as in tonemap.frag,
+* the scalar path is the reference written with the GLSL formulas, the SSE and AVX2 paths
+* process blocks of pixels and evaluate exp and pow by polynomials. Images are interleaved
+* float RGB, rows are split among workers of the job system. The output is clamped and
+* encoded by gamma, gamma 1 gives the same values as the shader writes.
+*
+* The operator with exposure, color grade and gamma can be baked into a 3D LUT of rgba16f
+* texels. Its coordinates are radiance after a logarithmic shaper, so black is the first
+* texel and the whole HDR range fits into a few tens of texels.
+*
+* Displayed luminance is counted into histograms with bins uniform after gamma, so the
+* operators compared side by side in tonemap.frag are reported by the same statistics
+* as the CPU output.
+*
+*/
+
+class HdaTonemap {
+
+public:
+
+	struct Settings {
+
+		int chooseMethodFlag = 0;
+		int hdrOnFlag = 1;				// 0 only clamps and encodes the input
+		float exposure = 1.0f;
+		float gamma = TONEMAP_GAMMA;
+		float localCompression = 1.0f;	// contrast of base layer of HdaLocalTonemap, 1 is the global TMO only
+		float localDetail = 1.0f;
+	};
+
+	// applied to tone mapped color before gamma, only by the LUT
+	struct Grade {
+
+		float saturation = 1.0f;
+		float contrast = 1.0f;			// power around middle gray
+		glm::vec3 gain{ 1.0f };			// white balance
+	};
+
+	// difference of sampled LUT from the analytic operator, grade and gamma
+	struct LutError {
+
+		float max = 0.0f;
+		float mean = 0.0f;
+	};
+
+	static glm::vec3 tonemapPixel(glm::vec3, const Settings&);
+	static void tonemapRow(const float*, float*, uint32_t, const Settings&, int);
+	static void tonemapImage(HdaJobs&, const float*, float*, uint32_t, uint32_t, const Settings&, int);
+
+	static bool isaSupported(int);
+	static int bestIsa();
+	static const char* isaName(int);
+	static const char* methodName(int);
+
+	static float lutShaper(float);
+	static float lutShaperInverse(float);
+	static glm::vec3 gradePixel(glm::vec3, const Grade&);
+	static void bakeLut(HdaJobs&, uint32_t, const Settings&, const Grade&, uint16_t*);
+	static glm::vec3 sampleLut(const uint16_t*, uint32_t, glm::vec3);
+	static LutError lutError(HdaJobs&, uint32_t, const Settings&, const Grade&, const std::vector<float>&);
+
+	// luminance of displayed pixels of one comparison tile
+	struct TileStats {
+
+		uint32_t samples = 0;
+		float mean = 0.0f;
+		float median = 0.0f;
+		float crushed = 0.0f;		// fraction of samples in the first bin
+		float clipped = 0.0f;		// fraction of samples in the last bin
+	};
+
+	static uint32_t statsBin(glm::vec3);
+	static TileStats tileStats(const uint32_t*);
+
+	static uint32_t toneMapFiles(const std::vector<std::string>&, const Settings&);
+	static bool benchmark();
+
+private:
+
+	static void rowScalar(const float*, float*, uint32_t, const Settings&);
+	static void rowSse(const float*, float*, uint32_t, const Settings&);
+	static void rowAvx2(const float*, float*, uint32_t, const Settings&);
+};
@@ -0,0 +1,118 @@
+#include "hda_transient.hpp"
+#include "hda_deferred.hpp"
+#include "hda_bloom.hpp"
+#include "hda_localtonemap.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+using namespace std;
+
+
+/**
+*	@brief Place targets into one allocation and return its size.
+*
+*	Targets are placed from the largest one at the lowest aligned offset, which does not
+*	collide with a placed target living in the same passes. Targets with disjoint lifetimes
+*	can share bytes, every target starts with undefined content in the frame.
+*
+*/
+uint64_t HdaTransient::alias(vector<Target>& targets) {
+
+	vector<size_t> order(targets.size());
+	iota(order.begin(), order.end(), 0);
+	stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return targets[a].size > targets[b].size; });
+
+	uint64_t total = 0;
+	vector<size_t> placed;
+	for (size_t i : order) {
+
+		Target& t = targets[i];
+
+		// bytes of placed targets which live at the same time, sorted by offset
+		vector<pair<uint64_t, uint64_t>> busy;
+		for (size_t p : placed)
+			if (targets[p].first <= t.last && t.first <= targets[p].last)
+				busy.push_back({ targets[p].offset, targets[p].offset + targets[p].size });
+		sort(busy.begin(), busy.end());
+
+		uint64_t offset = 0;
+		for (const auto& b : busy) {
+
+			if (offset + t.size <= b.first)
+				break;
+			offset = max(offset, (b.second + t.alignment - 1) / t.alignment * t.alignment);
+		}
+
+		t.offset = offset;
+		total = max(total, offset + t.size);
+		placed.push_back(i);
+	}
+
+	return total;
+}
+
+
+// estimated targets of one resolution which do not live across frames, sizes are texels of formats
+vector<HdaTransient::Target> HdaTransient::frameTargets(uint32_t width, uint32_t height) {
+
+	uint64_t pixels = static_cast<uint64_t>(width) * height;
+
+	vector<Target> targets;
+	targets.push_back({ "G-buffer albedo", pixels * (GBUFFER_COLOR_BYTES / 2), 1, TRANSIENT_PASS_SCENE, TRANSIENT_PASS_SCENE });
+	targets.push_back({ "G-buffer normal", pixels * (GBUFFER_COLOR_BYTES / 2), 1, TRANSIENT_PASS_SCENE, TRANSIENT_PASS_SCENE });
+	targets.push_back({ "bloom chain", HdaBloom::bloomCost(width, height, HdaBloom::levelCount(width, height)).memory, 1, TRANSIENT_PASS_BLOOM, TRANSIENT_PASS_TONEMAP });
+
+	uint64_t grid = HdaLocalTonemap::localCost(width, height).memory / 2;
+	targets.push_back({ "local grid", grid, 1, TRANSIENT_PASS_LOCAL, TRANSIENT_PASS_TONEMAP });
+	targets.push_back({ "local grid blurred", grid, 1, TRANSIENT_PASS_LOCAL, TRANSIENT_PASS_TONEMAP });
+
+	return targets;
+}
+
+
+/**
+*	@brief Estimate memory of frame targets for one resolution.
+*
+*	Scene color and depth are sampled after their passes, so they always have their own
+*	memory. The depth pyramid lives across frames and it is not counted.
+*
+*/
+HdaTransient::MemoryReport HdaTransient::memoryReport(uint32_t width, uint32_t height, vk::Format depthFormat) {
+
+	const uint64_t sceneTexel = 8;	// rgba16f
+	uint64_t pixels = static_cast<uint64_t>(width) * height;
+	uint64_t persistent = pixels * (sceneTexel + HdaDeferred::depthBytes(depthFormat));
+
+	vector<Target> targets = frameTargets(width, height);
+	MemoryReport report{};
+	report.dedicated = persistent;
+	report.lazy = persistent;
+	for (const Target& t : targets) {
+
+		report.dedicated += t.size;
+		if (t.first != TRANSIENT_PASS_SCENE)
+			report.lazy += t.size;
+	}
+	report.aliased = persistent + alias(targets);
+
+	return report;
+}
+
+
+// tile-based GPUs have lazily allocated memory, desktop GPUs usually alias
+void HdaTransient::printMemoryReport(vk::Format depthFormat) {
+
+	const glm::uvec2 resolutions[] = { { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+
+	cout << "printMemoryReport(): resolution | MB dedicated | MB lazily allocated G-buffer (saved) | MB aliased (saved)\n";
+	for (glm::uvec2 r : resolutions) {
+
+		MemoryReport report = memoryReport(r.x, r.y, depthFormat);
+		const double mb = 1024.0 * 1024.0;
+		cout << "  " << r.x << "x" << r.y << " | " << report.dedicated / mb
+			<< " | " << report.lazy / mb << " (" << (report.dedicated - report.lazy) / mb << ")"
+			<< " | " << report.aliased / mb << " (" << (report.dedicated - report.aliased) / mb << ")\n";
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "hda_model.hpp"
+
+#include <string>
+#include <vector>
+
+#define TRANSIENT_PASS_SCENE 0			// forward passes or both subpasses of deferred shading
+#define TRANSIENT_PASS_BLOOM 1			// passes of frame in order of recording, lifetimes of targets
+#define TRANSIENT_PASS_LOCAL 2
+#define TRANSIENT_PASS_TONEMAP 3
+
+
+/*
+*
+* A class representing memory of render targets which live only inside one frame. Attachments
+* which are not read after their render pass (G-buffer of deferred shading, it is read as input
+* attachments of the lighting subpass) are transient and lazily allocated where the device has
+* such memory, tile-based GPUs then keep them in tile memory only. Without lazily allocated memory
+* the targets are placed into one allocation, targets whose lifetimes do not overlap in a frame
+* share the same bytes.
+*
+*/
+
+class HdaTransient {
+
+public:
+
+	struct Target {
+
+		std::string name;
+		uint64_t size = 0;				// memory requirements of image
+		uint64_t alignment = 1;
+		uint32_t first = 0;				// the first and the last pass of frame which use the target
+		uint32_t last = 0;
+		uint64_t offset = 0;			// in the shared allocation, written by alias()
+	};
+
+	// bytes of frame targets for one resolution
+	struct MemoryReport {
+
+		uint64_t dedicated = 0;			// every target has its own memory
+		uint64_t lazy = 0;				// G-buffer is lazily allocated, the other targets are dedicated
+		uint64_t aliased = 0;			// transient targets share memory by lifetimes
+	};
+
+	static uint64_t alias(std::vector<Target>&);
+	static std::vector<Target> frameTargets(uint32_t, uint32_t);
+	static MemoryReport memoryReport(uint32_t, uint32_t, vk::Format);
+	static void printMemoryReport(vk::Format);
+};
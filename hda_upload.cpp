@@ -0,0 +1,340 @@
+#include "hda_upload.hpp"
+
+using namespace std;
+
+
+HdaUpload::HdaUpload(HdaInstanceGpu& device) : device{ device } {
+
+	cout << ". ";
+}
+
+HdaUpload::~HdaUpload() {
+
+	cout << "HdaUpload: Destructor\n";
+
+	if (eCh == 1)
+		cleanupUpload();
+}
+
+
+void HdaUpload::initUpload() {
+
+	eCh = 1;
+
+	commandPool =
+		device.getDevice().createCommandPool(
+			vk::CommandPoolCreateInfo(
+				vk::CommandPoolCreateFlagBits::eTransient |
+				vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+				device.getGraphicsQueueFamily()
+			)
+		);
+
+	commandBuff =
+		device.getDevice().allocateCommandBuffers(
+			vk::CommandBufferAllocateInfo(
+				commandPool,
+				vk::CommandBufferLevel::ePrimary,
+				1
+			)
+		)[0];
+
+	createArena(UPLOAD_ARENA_SIZE);
+}
+
+
+void HdaUpload::cleanupUpload() {
+
+	eCh = 0;
+
+	if (recording)
+		submit();
+	wait();
+
+	destroyArena();
+	device.getDevice().freeCommandBuffers(commandPool, commandBuff);
+	device.getDevice().destroyCommandPool(commandPool);
+}
+
+
+// host visible buffer which stays mapped for the whole run
+void HdaUpload::createArena(vk::DeviceSize size) {
+
+	arenaBuff =
+		device.getDevice().createBuffer(
+			vk::BufferCreateInfo(
+				vk::BufferCreateFlags(),
+				size,
+				vk::BufferUsageFlagBits::eTransferSrc,
+				vk::SharingMode::eExclusive
+			)
+		);
+
+	vk::MemoryRequirements memRequirements = device.getDevice().getBufferMemoryRequirements(arenaBuff);
+	vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+	vk::PhysicalDeviceMemoryProperties memProperties = device.getPhysDevice().getMemoryProperties();
+	uint32_t memoryTypeIndex = UINT32_MAX;
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount && memoryTypeIndex == UINT32_MAX; i++)
+		if ((memRequirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			memoryTypeIndex = i;
+
+	if (memoryTypeIndex == UINT32_MAX) {
+		device.getDevice().destroyBuffer(arenaBuff);
+		throw runtime_error("Corresponding memory type not found.\n");
+	}
+
+	arenaMemory =
+		device.getDevice().allocateMemory(
+			vk::MemoryAllocateInfo(
+				memRequirements.size,
+				memoryTypeIndex
+			)
+		);
+	device.getDevice().bindBufferMemory(arenaBuff, arenaMemory, 0);
+
+	arenaPointer = static_cast<char*>(device.getDevice().mapMemory(arenaMemory, 0, size, vk::MemoryMapFlags()));
+	arenaSize = size;
+	arenaOffset = 0;
+}
+
+
+void HdaUpload::destroyArena() {
+
+	device.getDevice().unmapMemory(arenaMemory);
+	device.getDevice().destroyBuffer(arenaBuff);
+	device.getDevice().freeMemory(arenaMemory);
+	arenaPointer = nullptr;
+	arenaSize = 0;
+}
+
+
+// starts recording of new batch, the previous batch must finish before its commands are reset
+void HdaUpload::begin() {
+
+	if (recording)
+		return;
+	wait();
+
+	commandBuff.reset(vk::CommandBufferResetFlags());
+	commandBuff.begin(
+		vk::CommandBufferBeginInfo(
+			vk::CommandBufferUsageFlagBits::eOneTimeSubmit,
+			nullptr  // pInheritanceInfo
+		)
+	);
+
+	recording = true;
+	transferWritten = false;
+}
+
+
+void HdaUpload::submit() {
+
+	if (!recording)
+		return;
+
+	commandBuff.end();
+	recording = false;
+
+	submittedValue = device.nextTimelineValue();
+	vk::Semaphore timeline = device.getTimeline();
+
+	device.getGraphicsQueue().submit(
+		vk::ArrayProxy<const vk::SubmitInfo>(
+			1,
+			&(const vk::SubmitInfo&)vk::SubmitInfo(
+				0, nullptr,
+				nullptr,
+				1, &commandBuff,
+				1, &timeline,	// signalSemaphoreCount + pSignalSemaphores
+				&(const vk::TimelineSemaphoreSubmitInfo&)vk::TimelineSemaphoreSubmitInfo(	// pNext
+					0, nullptr,
+					1, &submittedValue	// signalSemaphoreValueCount + pSignalSemaphoreValues
+				)
+			)
+		),
+		nullptr
+	);
+
+	pending = true;
+	stats.submits++;
+}
+
+
+// waits for the submitted batch, the arena is free afterwards
+void HdaUpload::wait() {
+
+	if (!pending)
+		return;
+
+	auto startT = chrono::high_resolution_clock::now();
+	device.waitTimeline(submittedValue);
+	stats.stallTime += chrono::duration<double, milli>(chrono::high_resolution_clock::now() - startT).count();
+
+	pending = false;
+	arenaOffset = 0;
+}
+
+
+/**
+*	@brief Copy data into staging arena.
+*
+*	Returns offset of the data in arena. If the data do not fit, the recorded copies are
+*	submitted and waited and the arena starts from the beginning, it grows only for copies
+*	which are larger than the whole arena.
+*
+*/
+vk::DeviceSize HdaUpload::stage(const void* data, vk::DeviceSize size) {
+
+	if (!recording)
+		throw runtime_error("stage(): Upload batch was not begun.\n");
+
+	vk::DeviceSize offset = (arenaOffset + UPLOAD_ALIGNMENT - 1) / UPLOAD_ALIGNMENT * UPLOAD_ALIGNMENT;
+	if (offset + size > arenaSize) {
+
+		submit();
+		wait();
+		if (size > arenaSize) {
+			destroyArena();
+			createArena(size);
+			cout << "stage(): Staging arena grows to " << size / (1024.0 * 1024.0) << " MB.\n";
+		}
+		begin();
+		offset = 0;
+	}
+
+	memcpy(arenaPointer + offset, data, static_cast<size_t>(size));
+	arenaOffset = offset + size;
+	stats.bytes += size;
+
+	return offset;
+}
+
+
+// copies of the batch which read a buffer written earlier in the same batch
+void HdaUpload::transferBarrier() {
+
+	if (!transferWritten)
+		return;
+
+	commandBuff.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(),
+		1,
+		&(const vk::MemoryBarrier&)vk::MemoryBarrier(
+			vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead
+		),
+		0, {},
+		0, {}
+	);
+
+	transferWritten = false;
+	stats.barriers++;
+}
+
+
+void HdaUpload::copyToBuffer(const void* data, vk::DeviceSize size, vk::Buffer dstBuff, vk::DeviceSize dstOffset) {
+
+	vk::DeviceSize offset = stage(data, size);
+
+	commandBuff.copyBuffer(arenaBuff, dstBuff, 1, &vk::BufferCopy({ offset, dstOffset, size }));
+
+	transferWritten = true;
+	stats.copies++;
+}
+
+
+// size is a multiple of 4 or VK_WHOLE_SIZE
+void HdaUpload::fillBuffer(vk::Buffer dstBuff, vk::DeviceSize size, uint32_t value) {
+
+	if (!recording)
+		throw runtime_error("fillBuffer(): Upload batch was not begun.\n");
+
+	commandBuff.fillBuffer(dstBuff, 0, size, value);
+
+	transferWritten = true;
+	stats.copies++;
+}
+
+
+// device to device copy, the source may be written by the same batch
+void HdaUpload::copyBuffer(vk::Buffer srcBuff, vk::Buffer dstBuff, vk::DeviceSize size) {
+
+	if (!recording)
+		throw runtime_error("copyBuffer(): Upload batch was not begun.\n");
+
+	transferBarrier();
+	commandBuff.copyBuffer(srcBuff, dstBuff, 1, &vk::BufferCopy({ 0, 0, size }));
+
+	transferWritten = true;
+	stats.copies++;
+}
+
+
+void HdaUpload::copyToImage(const void* data, vk::DeviceSize size, vk::Image dstImg, uint32_t width, uint32_t height, uint32_t baseArr) {
+
+	vk::DeviceSize offset = stage(data, size);
+
+	commandBuff.copyBufferToImage(
+		arenaBuff,
+		dstImg,
+		vk::ImageLayout::eTransferDstOptimal,
+		1,				// region count
+		&(const vk::BufferImageCopy&)vk::BufferImageCopy(	// region
+			offset, 0, 0,		// buffer offset + buffer row length + buffer image height
+			vk::ImageSubresourceLayers(
+				vk::ImageAspectFlagBits::eColor,
+				0, baseArr, 1		// mip level + base array layer + layer count
+			),
+			vk::Offset3D(0, 0, 0),
+			vk::Extent3D(width, height, 1)
+		)
+	);
+
+	stats.copies++;
+}
+
+
+/**
+*	@brief Record copies into layers of image with the barriers derived by frame graph.
+*
+*	The copy pass writes the layers in eTransferDstOptimal, the image starts in eUndefined,
+*	so its content is discarded. The last pass only declares sampling by fragment shaders,
+*	it records nothing, but its read gives the transition into eShaderReadOnlyOptimal.
+*	All layers get one barrier before the copies and one after them.
+*
+*/
+void HdaUpload::recordImageUpload(const string& name, vk::Image img, uint32_t layerCount, function<void()> copies) {
+
+	if (!recording)
+		throw runtime_error("recordImageUpload(): Upload batch was not begun.\n");
+
+	using Stage = vk::PipelineStageFlagBits2;
+	using Acc = vk::AccessFlagBits2;
+	using Layout = vk::ImageLayout;
+
+	HdaGraph graph;
+	uint32_t image = graph.addResource({ name, img, vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, layerCount), {} });
+	uint32_t sampled = graph.addResource({ "sampled by frames", vk::Image(), {}, {}, false, true });
+
+	uint32_t pass = graph.addPass("copy", [&copies](vk::CommandBuffer*) { copies(); });
+	graph.write(pass, image, { Stage::eTransfer, Acc::eTransferWrite, Layout::eTransferDstOptimal });
+
+	pass = graph.addPass("sample", nullptr);
+	graph.read(pass, image, { Stage::eFragmentShader, Acc::eShaderRead, Layout::eShaderReadOnlyOptimal });
+	graph.write(pass, sampled, { Stage::eFragmentShader, {}, Layout::eUndefined });
+
+	graph.compile();
+	graph.execute(&commandBuff, device.getPipelineBarrier2());
+
+	stats.barriers += static_cast<uint32_t>(graph.getBarriers().size());
+}
+
+
+void HdaUpload::printStatistics() {
+
+	cout << "printStatistics(): Uploaded " << stats.bytes / (1024.0 * 1024.0) << " MB by " << stats.copies << " copies and "
+		<< stats.barriers << " barriers in " << stats.submits << " submits | stall: " << stats.stallTime << " ms"
+		<< " | staging arena: " << arenaSize / (1024.0 * 1024.0) << " MB\n";
+}
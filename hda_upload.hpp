@@ -0,0 +1,80 @@
+#pragma once
+#include "hda_instancegpu.hpp"
+#include "hda_graph.hpp"
+
+#include <chrono>
+#include <functional>
+
+#define UPLOAD_ARENA_SIZE (64ull * 1024 * 1024)	// initial size of staging arena, it grows for larger copies
+#define UPLOAD_ALIGNMENT 16						// offset of copy to image is a multiple of texel size
+
+
+/*
+*
+* A class representing the upload context. Copies and layout transitions of a load batch
+* are recorded into one command buffer, transitions of images are derived by a small frame graph, source data are written into the staging arena -
+* one persistently mapped host visible buffer with a linear allocator. The batch is submitted
+* once and signals its value of the device timeline. Frames wait for the value on the GPU,
+* the host waits only when the arena is full or it is reused by the next batch.
+*
+*/
+
+class HdaUpload {
+
+public:
+
+	struct Statistics {
+
+		uint64_t bytes = 0;			// bytes written into staging arena
+		uint32_t copies = 0;
+		uint32_t barriers = 0;
+		uint32_t submits = 0;
+		double stallTime = 0.0;		// ms waited for timeline
+	};
+
+	HdaUpload(HdaInstanceGpu&);
+	~HdaUpload();
+
+	void initUpload();
+	void cleanupUpload();
+
+	void begin();
+	void submit();
+	void wait();
+
+	void copyToBuffer(const void*, vk::DeviceSize, vk::Buffer, vk::DeviceSize);
+	void fillBuffer(vk::Buffer, vk::DeviceSize, uint32_t);
+	void copyBuffer(vk::Buffer, vk::Buffer, vk::DeviceSize);
+	void copyToImage(const void*, vk::DeviceSize, vk::Image, uint32_t, uint32_t, uint32_t);
+	void recordImageUpload(const string&, vk::Image, uint32_t, function<void()>);
+
+	inline uint64_t getSubmittedValue() { return submittedValue; }
+	inline Statistics getStatistics() { return stats; }
+	void printStatistics();
+
+private:
+
+	vk::DeviceSize stage(const void*, vk::DeviceSize);
+	void createArena(vk::DeviceSize);
+	void destroyArena();
+	void transferBarrier();
+
+	HdaInstanceGpu& device;
+
+	int eCh = 0;
+
+	vk::CommandPool commandPool;
+	vk::CommandBuffer commandBuff;
+	uint64_t submittedValue = 0;	// timeline value of the last batch
+	bool recording = false;
+	bool pending = false;			// submitted batch was not waited yet
+	bool transferWritten = false;	// a copy of the batch may be the source of the next one
+
+	vk::Buffer arenaBuff;
+	vk::DeviceMemory arenaMemory;
+	char* arenaPointer = nullptr;
+	vk::DeviceSize arenaSize = 0;
+	vk::DeviceSize arenaOffset = 0;
+
+	Statistics stats{};
+};
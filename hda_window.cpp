@@ -61,6 +61,168 @@ void HdaWindow::keyCallback(GLFWwindow* window, int key, int scancode, int actio
 		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
 		hdaWin->keyPressedI = true;
 	}
+
+	if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedK = true;
+	}
+
+	if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedL = true;
+	}
+
+	if (key == GLFW_KEY_J && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedJ = true;
+	}
+
+	if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedN = true;
+	}
+
+	if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedR = true;
+	}
+
+	if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedT = true;
+	}
+
+	if (key == GLFW_KEY_U && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedU = true;
+	}
+
+	if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedV = true;
+	}
+
+	if (key == GLFW_KEY_Y && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedY = true;
+	}
+
+	if (key == GLFW_KEY_1 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed1 = true;
+	}
+
+	if (key == GLFW_KEY_2 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed2 = true;
+	}
+
+	if (key == GLFW_KEY_3 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed3 = true;
+	}
+
+	if (key == GLFW_KEY_4 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed4 = true;
+	}
+
+	if (key == GLFW_KEY_5 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed5 = true;
+	}
+
+	if (key == GLFW_KEY_6 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed6 = true;
+	}
+
+	if (key == GLFW_KEY_7 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed7 = true;
+	}
+
+	if (key == GLFW_KEY_8 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed8 = true;
+	}
+
+	if (key == GLFW_KEY_9 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed9 = true;
+	}
+
+	if (key == GLFW_KEY_0 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressed0 = true;
+	}
+
+	if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedF1 = true;
+	}
+
+	if (key == GLFW_KEY_F2 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedF2 = true;
+	}
+
+	if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedF3 = true;
+	}
+
+	if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedF4 = true;
+	}
+
+	if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedF5 = true;
+	}
+
+	if (key == GLFW_KEY_F6 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedF6 = true;
+	}
+
+	if (key == GLFW_KEY_F7 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedF7 = true;
+	}
+
+	if (key == GLFW_KEY_F8 && action == GLFW_PRESS) {
+
+		auto hdaWin = reinterpret_cast<HdaWindow*>(glfwGetWindowUserPointer(window));
+		hdaWin->keyPressedF8 = true;
+	}
 }
 
 void HdaWindow::createWindowSurface(vk::Instance instance, vk::SurfaceKHR  *winSurface) {
@@ -74,3 +236,11 @@ void HdaWindow::createWindowSurface(vk::Instance instance, vk::SurfaceKHR  *winS
 	// convert back
 	*winSurface = vk::SurfaceKHR(vkSurface);
 }
+
+
+// the label follows the name of window, an empty label restores the name
+void HdaWindow::setTitleLabel(const std::string& label) {
+
+	std::string title = label.empty() ? std::string(winName) : std::string(winName) + " | " + label;
+	glfwSetWindowTitle(window, title.c_str());
+}
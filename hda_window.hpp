@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <functional>
+#include <string>
 #include <vulkan/vulkan.hpp>
 #include <glfw-3.3.8.bin.WIN64/include/GLFW/glfw3.h>
 
@@ -40,8 +41,63 @@ public:
 	inline void setKeyPressedMFlag() { keyPressedM = false; }
 	inline bool getKeyPressedIFlag() { return keyPressedI; }
 	inline void setKeyPressedIFlag() { keyPressedI = false; }
+	inline bool getKeyPressedKFlag() { return keyPressedK; }
+	inline void setKeyPressedKFlag() { keyPressedK = false; }
+	inline bool getKeyPressedLFlag() { return keyPressedL; }
+	inline void setKeyPressedLFlag() { keyPressedL = false; }
+	inline bool getKeyPressedJFlag() { return keyPressedJ; }
+	inline void setKeyPressedJFlag() { keyPressedJ = false; }
+	inline bool getKeyPressedNFlag() { return keyPressedN; }
+	inline void setKeyPressedNFlag() { keyPressedN = false; }
+	inline bool getKeyPressedRFlag() { return keyPressedR; }
+	inline void setKeyPressedRFlag() { keyPressedR = false; }
+	inline bool getKeyPressedTFlag() { return keyPressedT; }
+	inline void setKeyPressedTFlag() { keyPressedT = false; }
+	inline bool getKeyPressedUFlag() { return keyPressedU; }
+	inline void setKeyPressedUFlag() { keyPressedU = false; }
+	inline bool getKeyPressedVFlag() { return keyPressedV; }
+	inline void setKeyPressedVFlag() { keyPressedV = false; }
+	inline bool getKeyPressedYFlag() { return keyPressedY; }
+	inline void setKeyPressedYFlag() { keyPressedY = false; }
+	inline bool getKeyPressed1Flag() { return keyPressed1; }
+	inline void setKeyPressed1Flag() { keyPressed1 = false; }
+	inline bool getKeyPressed2Flag() { return keyPressed2; }
+	inline void setKeyPressed2Flag() { keyPressed2 = false; }
+	inline bool getKeyPressed3Flag() { return keyPressed3; }
+	inline void setKeyPressed3Flag() { keyPressed3 = false; }
+	inline bool getKeyPressed4Flag() { return keyPressed4; }
+	inline void setKeyPressed4Flag() { keyPressed4 = false; }
+	inline bool getKeyPressed5Flag() { return keyPressed5; }
+	inline void setKeyPressed5Flag() { keyPressed5 = false; }
+	inline bool getKeyPressed6Flag() { return keyPressed6; }
+	inline void setKeyPressed6Flag() { keyPressed6 = false; }
+	inline bool getKeyPressed7Flag() { return keyPressed7; }
+	inline void setKeyPressed7Flag() { keyPressed7 = false; }
+	inline bool getKeyPressed8Flag() { return keyPressed8; }
+	inline void setKeyPressed8Flag() { keyPressed8 = false; }
+	inline bool getKeyPressed9Flag() { return keyPressed9; }
+	inline void setKeyPressed9Flag() { keyPressed9 = false; }
+	inline bool getKeyPressed0Flag() { return keyPressed0; }
+	inline void setKeyPressed0Flag() { keyPressed0 = false; }
+	inline bool getKeyPressedF1Flag() { return keyPressedF1; }
+	inline void setKeyPressedF1Flag() { keyPressedF1 = false; }
+	inline bool getKeyPressedF2Flag() { return keyPressedF2; }
+	inline void setKeyPressedF2Flag() { keyPressedF2 = false; }
+	inline bool getKeyPressedF3Flag() { return keyPressedF3; }
+	inline void setKeyPressedF3Flag() { keyPressedF3 = false; }
+	inline bool getKeyPressedF4Flag() { return keyPressedF4; }
+	inline void setKeyPressedF4Flag() { keyPressedF4 = false; }
+	inline bool getKeyPressedF5Flag() { return keyPressedF5; }
+	inline void setKeyPressedF5Flag() { keyPressedF5 = false; }
+	inline bool getKeyPressedF6Flag() { return keyPressedF6; }
+	inline void setKeyPressedF6Flag() { keyPressedF6 = false; }
+	inline bool getKeyPressedF7Flag() { return keyPressedF7; }
+	inline void setKeyPressedF7Flag() { keyPressedF7 = false; }
+	inline bool getKeyPressedF8Flag() { return keyPressedF8; }
+	inline void setKeyPressedF8Flag() { keyPressedF8 = false; }
 
 	void createWindowSurface(vk::Instance, vk::SurfaceKHR *);
+	void setTitleLabel(const std::string&);
 
 private:
 
@@ -54,6 +110,33 @@ private:
 	bool keyPressedX = false;
 	bool keyPressedM = false;
 	bool keyPressedI = false;
+	bool keyPressedK = false;
+	bool keyPressedL = false;
+	bool keyPressedJ = false;
+	bool keyPressedN = false;
+	bool keyPressedR = false;
+	bool keyPressedT = false;
+	bool keyPressedU = false;
+	bool keyPressedV = false;
+	bool keyPressedY = false;
+	bool keyPressed1 = false;
+	bool keyPressed2 = false;
+	bool keyPressed3 = false;
+	bool keyPressed4 = false;
+	bool keyPressed5 = false;
+	bool keyPressed6 = false;
+	bool keyPressed7 = false;
+	bool keyPressed8 = false;
+	bool keyPressed9 = false;
+	bool keyPressed0 = false;
+	bool keyPressedF1 = false;
+	bool keyPressedF2 = false;
+	bool keyPressedF3 = false;
+	bool keyPressedF4 = false;
+	bool keyPressedF5 = false;
+	bool keyPressedF6 = false;
+	bool keyPressedF7 = false;
+	bool keyPressedF8 = false;
 
 	vk::Instance instance;
 	vk::PhysicalDevice physDev;
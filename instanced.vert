@@ -0,0 +1,58 @@
+#version 450
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec3 inColor;
+layout(location = 3) in vec2 inTexture;
+
+// instance rate attributes of HdaModel::InstanceData
+layout(location = 4) in mat4 inInstanceModel;
+layout(location = 8) in vec4 inInstanceTint;
+
+layout(binding = 0) uniform ProjectionUniformData {
+
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+
+} uniformProjection;
+
+layout(binding = 1) uniform SceneUniformData {
+
+    mat4 normalMatrix;
+    mat4 normalMatrixWorld;
+    mat4 modelViewMatrix;
+    mat4 modelMatrix;       // world transform of the frame
+    int nontextureFlag;
+    int blinnPhongFlag;
+    int pointLightFlag;
+    int hdrOnFlag;
+
+} scenedata;
+
+// lighting is in world space, the camera and the view depth of cluster are taken from ClusterUniformData
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexture;
+layout(location = 2) out vec3 fragPosWorld;
+layout(location = 3) out vec3 outNormalWorld;
+layout(location = 4) out flat int tId; 
+
+layout( push_constant ) uniform constants {
+
+    vec3 cameraPosition;
+	int texId;
+
+} PushConstants;
+
+void main() {
+
+    // instance transform is applied after the model matrix of object, instances are scaled uniformly
+    mat4 model = inInstanceModel * scenedata.modelMatrix;
+    gl_Position = uniformProjection.proj * uniformProjection.view * model * vec4(inPosition, 1.0);
+
+    fragTexture = inTexture;
+    fragColor = inColor * inInstanceTint.rgb;
+    fragPosWorld = vec3(model * vec4(inPosition, 1.0));
+    outNormalWorld = mat3(model) * inNormal;
+    tId = PushConstants.texId;
+}
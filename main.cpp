@@ -1,4 +1,8 @@
 #include "hda_hdrdemoapp.hpp"
+#include "hda_localtonemap.hpp"
+#include "hda_graph.hpp"
+#include "hda_meshlet.hpp"
+#include "hda_occlusion.hpp"
 
 #include <iostream>
 #include <stdexcept>
@@ -6,15 +10,91 @@
 using namespace std;
 
 
-int main(int /*argc*/, char** /*argv*/) {
+// batch tone mapping on CPU without window, it does not wait for enter
+static int runTonemap(int argc, char** argv) {
 
-	
+	try {
+
+		if (string(argv[1]) == "--tonemap-bench") {
+			bool global = HdaTonemap::benchmark();
+			bool local = HdaLocalTonemap::benchmark();
+			return global && local ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		// the local operator takes compression of base contrast before files
+		bool local = string(argv[1]) == "--tonemap-local";
+		int first = local ? 6 : 5;
+		if (argc < first + 1) {
+			cout << "Usage: " << argv[0] << " --tonemap <method 0-4> <exposure> <gamma> <file.hdr>...\n"
+				<< "       " << argv[0] << " --tonemap-local <method 0-4> <exposure> <gamma> <compression> <file.hdr>...\n";
+			return EXIT_FAILURE;
+		}
+
+		HdaTonemap::Settings settings{};
+		settings.chooseMethodFlag = stoi(argv[2]);
+		settings.exposure = stof(argv[3]);
+		settings.gamma = stof(argv[4]);
+		if (local)
+			settings.localCompression = stof(argv[5]);
+
+		vector<string> files(argv + first, argv + argc);
+		return HdaTonemap::toneMapFiles(files, settings) == files.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	catch (exception& e) {
+
+		cout << "[ERROR] Runtime exception: " << e.what() << endl;
+		return EXIT_FAILURE;
+	}
+}
+
+
+int main(int argc, char** argv) {
+
+	if (argc > 1 && string(argv[1]).rfind("--tonemap", 0) == 0)
+		return runTonemap(argc, argv);
+
+	// the embedded SPIR-V is analyzed without window and device
+	if (argc > 1 && string(argv[1]) == "--shader-stats") {
+		HdaPipeline::printShaderStatistics();
+		return EXIT_SUCCESS;
+	}
+
+	// barriers, culling and aliasing of the frame graph are checked on CPU
+	if (argc > 1 && string(argv[1]) == "--graph-test")
+		return HdaGraph::selfTest() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	// meshlet limits, coverage of triangles and conservative culling are checked on CPU
+	if (argc > 1 && string(argv[1]) == "--meshlet-test")
+		return HdaMeshlet::selfTest() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	// depth pyramid and sphere occlusion test against scans of a synthetic depth buffer
+	if (argc > 1 && string(argv[1]) == "--occlusion-test")
+		return HdaOcclusion::selfTest() ? EXIT_SUCCESS : EXIT_FAILURE;
 
 	// catch exceptions
 	// (vulkan.hpp functions throw if they fail)
 	try {
 		
 		HdrDemoApp mainApp;
+
+		// the scene manifest can be given as an argument, --resolution turns on the dynamic resolution
+		for (int i = 1; i < argc; i++) {
+
+			if (string(argv[i]) == "--resolution") {
+				if (i + 4 >= argc)
+					throw runtime_error("Usage: --resolution <target ms> <min scale> <max scale> <hysteresis>");
+
+				HdaResolution::Settings settings{};
+				settings.targetMs = stof(argv[i + 1]);
+				settings.minScale = stof(argv[i + 2]);
+				settings.maxScale = stof(argv[i + 3]);
+				settings.hysteresis = stof(argv[i + 4]);
+				mainApp.setResolutionSettings(settings);
+				i += 4;
+			}
+			else
+				mainApp.setScenePath(argv[i]);
+		}
 		
 		mainApp.showUsage();
 		cout << "\n-       PRESS ENTER FOR START APPLICATION       -\n";
@@ -1,17 +1,25 @@
 #version 450
 
+// forward shading in world space, the same as deferred.frag; HALF_PRECISION is the variant
+// shader_fp16.frag.spv, it evaluates the diffuse term and colors in float16, positions,
+// attenuation and the specular lobe stay in float32
+#ifdef HALF_PRECISION
+#extension GL_EXT_shader_explicit_arithmetic_types_float16 : require
+#define hfloat float16_t
+#define hvec3 f16vec3
+#else
+#define hfloat float
+#define hvec3 vec3
+#endif
+
 //
 // in/out vectors
 //
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexture;
-layout(location = 2) in vec3 fragPos;
-layout(location = 3) in vec3 inNormal;
-layout(location = 4) in vec3 inView;
-layout(location = 5) in vec3 inLight;
-layout(location = 6) in vec3 inNormalWorld;
-layout(location = 7) in vec3 fragPosWorld;
-layout(location = 8) in flat int texId;
+layout(location = 2) in vec3 fragPosWorld;
+layout(location = 3) in vec3 inNormalWorld;
+layout(location = 4) in flat int texId;
 
 layout(location = 0) out vec4 outColor;
 
@@ -23,6 +31,7 @@ layout(binding = 1) uniform SceneUniformData {
     mat4 normalMatrix;
     mat4 normalMatrixWorld;
     mat4 modelViewMatrix;
+    mat4 modelMatrix;       // world transform of the frame
     int nontextureFlag;
     int blinnPhongFlag;
     int pointLightFlag;
@@ -40,8 +49,6 @@ layout(binding = 2) uniform MaterialLightUniformData {
 	vec4 materialSpecular;
 	
 	// light data
-    vec4 lightPositions[2];
-    vec4 lightDirections[2];
 	vec4 lightAmbient;
 	vec4 lightDiffuse;
 	vec4 lightSpecular;
@@ -64,6 +71,40 @@ layout(binding = 2) uniform MaterialLightUniformData {
 //
 layout(binding = 3) uniform sampler2D texSampler;
 
+//
+// clustered lights
+//
+#define CLUSTER_STRIDE 129
+#define LIGHT_TYPE_SPOT 1.0
+
+struct Light {
+
+    vec4 position;      // world space position + range
+    vec4 direction;     // direction of spotlight + type
+    vec4 color;
+    vec4 params;        // cutOff, outerCutOff
+};
+
+layout(std430, binding = 4) readonly buffer Lights {
+
+    Light lights[];
+};
+
+// light count followed by light indices of every cluster, written by light_cull.comp
+layout(std430, binding = 5) readonly buffer ClusterLights {
+
+    uint clusterLights[];
+};
+
+layout(binding = 6) uniform ClusterUniformData {
+
+    mat4 view;
+    vec4 projection;    // p00, p11, zNear, zFar
+    uvec4 grid;         // size of grid + number of lights
+    vec4 screen;        // framebuffer size + scale and bias of depth slice
+
+} clusterData;
+
 //
 // constants
 //
@@ -71,85 +112,44 @@ const vec3 LIGHT_COLOR = vec3(1.0, 0.985, 0.990);
 const float AMBIENT = 0.08;
 const float SPECULAR_STRENGTH = 0.7;
 const float SHININESS = 32;
-const int NUM_OF_POINTLIGHTS = 2;
+
+// direction towards the directional light in world space, the same as in HdaDeferred::prepareDeferredData()
+const vec3 LIGHT_DIRECTION = normalize(vec3(8.0, 2.0, 11.0));
 
 //
 // function prototypes
 //
-vec3 CalcDirectionalLight(vec3 normal, vec3 viewDir, vec3 fragP);
-vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 fragP, vec4 lightP, vec4 lightD);
-
-vec3 reinhardTMO(vec3 result, float e);
-vec3 reinhardModTMO(vec3 result, float e);
-vec3 hejlDawsonTMO(vec3 result, float e);
-vec3 uncharted2TMO(vec3 x);
-vec3 originalAcesTMO(vec3 result);
-
-// HDR PART
-const float gamma = 2.2;
-
-float A = 0.15f;
-float B = 0.50f;
-float C = 0.10f;
-float D = 0.20f;
-float E = 0.02f;
-float F = 0.30f;
-float W = 11.2f;
+vec3 CalcDirectionalLight(vec3 normal, vec3 viewDir);
+vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 fragP, Light light);
+float Specular(vec3 normal, vec3 viewDir, vec3 lightDir);
+uint ClusterIndex(float depth);
 
 void main() {
 
-    // result of hdr tone mapping
-    vec3 hdrResult;
-
-    // in view space
-    vec3 norm = normalize(inNormal);
-    vec3 viewDir = normalize(inView - fragPos);
-
-    // in world space
-    vec3 normWorld = normalize(inNormalWorld);
-    vec3 viewDirWorld = normalize(inView - fragPosWorld);
+    // the camera is the translation of inverse view matrix
+    vec3 cameraPos = -(transpose(mat3(clusterData.view)) * clusterData.view[3].xyz);
+    vec3 norm = normalize(inNormalWorld);
+    vec3 viewDir = normalize(cameraPos - fragPosWorld);
 
     // directional lighting
-    vec3 result = CalcDirectionalLight(norm, viewDir, fragPos) * fragColor;
+    vec3 result = CalcDirectionalLight(norm, viewDir) * fragColor;
 
-    // point lights 
-    int i = 0;       
-    //for(int i = 0; i < 1; i++)
+    // point lights and spotlights of the cluster of fragment
     if (scenedata.pointLightFlag == 1) {
-        result += CalcPointLight(normWorld, viewDirWorld, fragPosWorld, mlData.lightPositions[i], mlData.lightDirections[i++]);
-        result += CalcPointLight(normWorld, viewDirWorld, fragPosWorld, mlData.lightPositions[i], mlData.lightDirections[i++]);
+
+        float viewDepth = -(clusterData.view * vec4(fragPosWorld, 1.0)).z;
+        uint cluster = ClusterIndex(viewDepth) * CLUSTER_STRIDE;
+        uint lightCnt = clusterLights[cluster];
+        for (uint i = 1u; i <= lightCnt; i++)
+            result += CalcPointLight(norm, viewDir, fragPosWorld, lights[clusterLights[cluster + i]]);
     }
 
 
     if (scenedata.nontextureFlag == 0)    
         result = result * texture(texSampler, fragTexture).rgb;
 
-    if (scenedata.hdrOnFlag == 1) {
-        
-        if (scenedata.chooseMethodFlag == 0)
-            hdrResult = reinhardTMO(result, scenedata.exposure);
-        else if (scenedata.chooseMethodFlag == 1)
-            hdrResult = hejlDawsonTMO(result, scenedata.exposure);
-        else if (scenedata.chooseMethodFlag == 2) {
-        
-            result = result * scenedata.exposure;
-            float exposureBias = 2.0f;
-            vec3 curr = uncharted2TMO(exposureBias * result);
-
-            vec3 whiteScale = vec3(1.0f) / uncharted2TMO(vec3(W));
-            hdrResult = curr * whiteScale;
-        }
-        else if (scenedata.chooseMethodFlag == 3)
-            hdrResult = originalAcesTMO(result * scenedata.exposure);
-        else if (scenedata.chooseMethodFlag == 4)
-            hdrResult = reinhardModTMO(result, scenedata.exposure);
-
-        outColor = vec4(hdrResult, 1.0);
-    }
-    else {
-
-        outColor = vec4(result, 1.0);
-    }
+    // linear HDR color, tone mapping is applied by tonemap.frag after bloom
+    outColor = vec4(result, 1.0);
 }
 
 
@@ -159,162 +159,74 @@ void main() {
  *   tutorial article obtained from LearnOpenGL:
  *     https://learnopengl.com/Lighting/Basic-Lighting
  */
-vec3 CalcDirectionalLight(vec3 normal, vec3 viewDir, vec3 fragP) {
+vec3 CalcDirectionalLight(vec3 normal, vec3 viewDir) {
     
     // ambient lighting
-     vec3 ambient = vec3(mlData.lightAmbient) * vec3(mlData.materialAmbient); 
-    
-    // diffuse lighting
-    vec3 lightDir = normalize(vec3(inLight));
-
-    // Lambertian cosine law
-    float diff = max(dot(normal, lightDir), 0.0); // if dot product of vectors is greater then 90 degrees, result is negative
-                                                  // so max of these two values return values between 0 and 1
-   
-    float spec = 0.0;
-    if (diff > 0.0) {
-
-        if (scenedata.blinnPhongFlag == 1) {
-
-            // Blinn-Phong
-            vec3 halfwayDir = normalize(lightDir + viewDir);
-            float s = max(dot(normal, halfwayDir), 0.0);
-            if (s > 0.0)
-                spec = pow(s, mlData.materialShininess); //16.0);   CHANGED TODO TODO
-        } 
-        else {
-
-
-            // Phong
-            vec3 reflectDir = reflect(-lightDir, normal);
-            float s = max(dot(viewDir, reflectDir), 0.0);
-            if (s > 0.0)
-                spec = pow(s, mlData.materialShininess); //8.0);  CHANGED
-        }
-    }
-    
-    vec3 diffuse  = (diff * vec3(mlData.materialDiffuse)) * vec3(mlData.lightDiffuse);
-    vec3 specular = (spec * vec3(mlData.materialSpecular)) * vec3(mlData.lightSpecular);
+    hvec3 ambient = hvec3(mlData.lightAmbient.rgb * mlData.materialAmbient.rgb);
+
+    // Lambertian cosine law, negative cosine of the back side is clamped to zero
+    hfloat diff = max(dot(hvec3(normal), hvec3(LIGHT_DIRECTION)), hfloat(0.0));
+    float spec = diff > hfloat(0.0) ? Specular(normal, viewDir, LIGHT_DIRECTION) : 0.0;
 
-    return (ambient + diffuse + specular);
+    hvec3 diffuse = diff * hvec3(mlData.materialDiffuse.rgb * mlData.lightDiffuse.rgb);
+    hvec3 specular = hfloat(spec) * hvec3(mlData.materialSpecular.rgb * mlData.lightSpecular.rgb);
+
+    return vec3(ambient + diffuse + specular);
 }
 
-vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 fragP, vec4 lightP, vec4 lightD) {
+vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 fragP, Light light) {
     
     // the vector pointing from the fragment to the light source
-    vec3 lightDirToFrag = normalize(vec3(lightP) - fragP);
-
-    // ambient lighting
-    vec3 ambient = vec3(mlData.lightAmbient) * vec3(mlData.materialAmbient);
-
-    // check if lighting is inside the spotlight cone (lightDirection is the direction the spotlight is aiming at)
-    float theta = dot(lightDirToFrag, normalize(vec3(-lightD)));
-
-    //if(theta > mlData.cutOff) {
-
-        // diffuse lighting
-        // Lambertian cosine law
-        float diff = max(dot(normal, lightDirToFrag), 0.0); // if dot product of vectors is greater then 90 degrees, result is negative
-                                                            // so max of these two values return values between 0 and 1
-   
-        float spec = 0.0;
-        if (diff > 0.0) {
-        
-            if (scenedata.blinnPhongFlag == 1) {
-    
-                // Blinn-Phong
-                vec3 halfwayDir = normalize(lightDirToFrag + viewDir);
-                float s = max(dot(normal, halfwayDir), 0.0);
-                if (s > 0.0)
-                    spec = pow(s, mlData.materialShininess); //32.0); //mlData.materialShininess);  
-            }
-            else {
-    
-                // Phong
-                vec3 reflectDir = reflect(-lightDirToFrag, normal); // reflected light
-                float s = max(dot(viewDir, reflectDir), 0.0);
-                if (s > 0.0)
-                    spec = pow(s, mlData.materialShininess); //32.0); //mlData.materialShininess);
-            }
-        }
-    
-        vec3 diffuse  = (diff * vec3(mlData.materialDiffuse)) * vec3(mlData.lightDiffuse);
-        vec3 specular = (spec * vec3(mlData.materialSpecular)) * vec3(mlData.lightSpecular);
-
-        // spotlight soft edges
-        float epsilon = mlData.cutOff - mlData.outerCutOff;
-        float intensity = max(0.0f, min((theta - mlData.outerCutOff)/epsilon, 1.0f));
-        diffuse  *= intensity;
-        specular *= intensity;
-
-        // attenuation for point light
-        float distance = length(vec3(lightP) - fragP);
-        float attenuation = 1.0 / (mlData.kC + mlData.kL * distance + mlData.kQ * (distance * distance));
-
-
-
-        //ambient *= attenuation;  // as otherwise at large distances the light would be darker inside than outside the spotlight due the ambient term in the else branch
-        diffuse *= attenuation;
-        specular *= attenuation;
-
-        return (diffuse + specular);
-}
+    vec3 lightDirToFrag = normalize(light.position.xyz - fragP);
 
-//
-//  TONE MAPPING FUNCTIONS
-//
-vec3 reinhardTMO(vec3 result, float e) {
+    // spotlight soft edges, fragments outside the outer cone are not lit
+    float intensity = 1.0;
+    if (light.direction.w == LIGHT_TYPE_SPOT) {
 
-    result *= e; 
-    vec3 hdrResult = result / (1.0f + result);  // TODO TODO add modRein with Lw
+        // check if lighting is inside the spotlight cone (lightDirection is the direction the spotlight is aiming at)
+        float theta = dot(lightDirToFrag, normalize(-light.direction.xyz));
+        if (theta <= light.params.y)
+            return vec3(0.0);
 
-    return hdrResult;
-}
+        float epsilon = light.params.x - light.params.y;
+        intensity = min((theta - light.params.y) / epsilon, 1.0);
+    }
 
+    // attenuation for point light, the window brings it smoothly to zero at the range of light
+    float distance = length(light.position.xyz - fragP);
+    float window = clamp(1.0 - pow(distance / light.position.w, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (mlData.kC + mlData.kL * distance + mlData.kQ * (distance * distance));
+    if (attenuation == 0.0)
+        return vec3(0.0);
 
-vec3 reinhardModTMO(vec3 result, float e) {
+    // diffuse lighting by Lambertian cosine law
+    hfloat diff = max(dot(hvec3(normal), hvec3(lightDirToFrag)), hfloat(0.0));
+    float spec = diff > hfloat(0.0) ? Specular(normal, viewDir, lightDirToFrag) : 0.0;
 
-    vec3 hdrResult = vec3(1.0f) - exp(-result * e);
+    hvec3 diffuse = diff * hvec3(mlData.materialDiffuse.rgb * mlData.lightDiffuse.rgb);
+    hvec3 specular = hfloat(spec) * hvec3(mlData.materialSpecular.rgb * mlData.lightSpecular.rgb);
 
-    return hdrResult;
+    return vec3(diffuse + specular) * light.color.rgb * (intensity * attenuation);
 }
 
+// Phong or Blinn-Phong specular term, the same models as in deferred.frag; float16 cosine near 1
+// has steps of 1/2048, which the exponent turns into visible bands, so the lobe stays in float32
+float Specular(vec3 normal, vec3 viewDir, vec3 lightDir) {
 
-vec3 hejlDawsonTMO(vec3 result, float e) {
-
-   vec3 x = max(((result * e) - 0.004f), 0.0);
-   vec3 retResult = pow((x * (6.2f * x + 0.5f)) / (x * (6.2f * x + 1.7f) + 0.06f), vec3(2.2));
-   //vec3 retResult = (x * (6.2f * x + 0.5f)) / (x * (6.2f * x + 1.7f) + 0.06f);
+    float s;
+    if (scenedata.blinnPhongFlag == 1)
+        s = max(dot(normal, normalize(lightDir + viewDir)), 0.0);
+    else
+        s = max(dot(viewDir, reflect(-lightDir, normal)), 0.0);
 
-   return retResult;
+    return s > 0.0 ? pow(s, mlData.materialShininess) : 0.0;
 }
 
+// cluster of fragment - screen tile and exponential slice of view space depth, the same as in HdaLights::clusterIndex()
+uint ClusterIndex(float depth) {
 
-vec3 uncharted2TMO(vec3 x) {
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterData.screen.xy * vec2(clusterData.grid.xy)), clusterData.grid.xy - 1u);
+    int slice = clamp(int(floor(log(max(depth, clusterData.projection.z)) * clusterData.screen.z + clusterData.screen.w)), 0, int(clusterData.grid.z) - 1);
 
-   return ((x * (A * x + C * B) + D * E)/(x * (A * x + B) + D * F)) - E/F;
+    return (uint(slice) * clusterData.grid.y + tile.y) * clusterData.grid.x + tile.x;
 }
-
-
-// Based on http://www.oscars.org/science-technology/sci-tech-projects/aces
-vec3 originalAcesTMO(vec3 result) {	
-
-	mat3 m1 = mat3(
-        0.59719, 0.07600, 0.02840,
-        0.35458, 0.90834, 0.13383,
-        0.04823, 0.01566, 0.83777
-	);
-
-	mat3 m2 = mat3(
-        1.60475, -0.10208, -0.00327,
-        -0.53108,  1.10813, -0.07276,
-        -0.07367, -0.00605,  1.07602
-	);
-
-	vec3 v = m1 * result;    
-	vec3 a = v * (v + 0.0245786) - 0.000090537;
-	vec3 b = v * (0.983729 * v + 0.4329510) + 0.238081;
-
-	//return pow(clamp(m2 * (a / b), 0.0, 1.0), vec3(1.0 / 2.2));	// UVNITR ZAKOMPONOVANA I GAMA KOREKCE KTERA JE NEZADOUCI
-    return clamp(m2 * (a / b), 0.0, 1.0);	
-}
\ No newline at end of file
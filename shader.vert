@@ -18,6 +18,7 @@ layout(binding = 1) uniform SceneUniformData {
     mat4 normalMatrix;
     mat4 normalMatrixWorld;
     mat4 modelViewMatrix;
+    mat4 modelMatrix;       // world transform of the frame
     int nontextureFlag;
     int blinnPhongFlag;
     int pointLightFlag;
@@ -25,38 +26,31 @@ layout(binding = 1) uniform SceneUniformData {
 
 } scenedata;
 
+// lighting is in world space, the camera and the view depth of cluster are taken from ClusterUniformData
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexture;
-layout(location = 2) out vec3 fragPos;  
-layout(location = 3) out vec3 outNormal; 
-layout(location = 4) out vec3 outView; 
-layout(location = 5) out vec3 outLight;
-layout(location = 6) out vec3 outNormalWorld;
-layout(location = 7) out vec3 fragPosWorld; 
-layout(location = 8) out flat int tId; 
+layout(location = 2) out vec3 fragPosWorld;
+layout(location = 3) out vec3 outNormalWorld;
+layout(location = 4) out flat int tId; 
 
 layout( push_constant ) uniform constants {
 
     vec3 cameraPosition;
 	int texId;
-	mat4 modelMatrix;
 
 } PushConstants;
 
-const vec4 LIGHT_RAY_POSITION = vec4(8.0f, 2.0f, 11.0f, 0.0f);
+// the same position as in depth_prepass.vert for eEqual depth test after the prepass
+invariant gl_Position;
 
 void main() {
 
-    mat4 transformationMatrix = uniformProjection.proj * uniformProjection.view * PushConstants.modelMatrix;
+    mat4 transformationMatrix = uniformProjection.proj * uniformProjection.view * scenedata.modelMatrix;
     gl_Position = transformationMatrix * vec4(inPosition, 1.0);
    
     fragTexture = inTexture;
     fragColor = inColor;
-    fragPos = vec3(scenedata.modelViewMatrix * vec4(inPosition, 1.0));
-    fragPosWorld =  vec3(PushConstants.modelMatrix * vec4(inPosition, 1.0));                // CHANGED
-    outNormal = mat3(scenedata.normalMatrix) * inNormal;
-    outLight = vec3(uniformProjection.view * LIGHT_RAY_POSITION);
-    outView = PushConstants.cameraPosition;
-    outNormalWorld = mat3(scenedata.normalMatrixWorld) * inNormal;    // CHANGED
+    fragPosWorld = vec3(scenedata.modelMatrix * vec4(inPosition, 1.0));
+    outNormalWorld = mat3(scenedata.normalMatrixWorld) * inNormal;
     tId = PushConstants.texId;
 }
@@ -17,15 +17,15 @@ layout(location = 0) out vec3 outCube;
 
 layout( push_constant ) uniform constants {
 
-	mat4 viewMatrix;
 	mat4 modelMatrix;
 
 } PushConstants;
 
 void main() {
 
+    // the skybox is always around the camera, so the translation of view is dropped
     vec3 position = mat3(PushConstants.modelMatrix) * inPosition;
-    gl_Position = (uniformProjection.proj * PushConstants.viewMatrix * vec4( position, 1.0 )).xyww;
+    gl_Position = (uniformProjection.proj * mat4(mat3(uniformProjection.view)) * vec4( position, 1.0 )).xyww;
 
     outCube = inPosition;
 }
\ No newline at end of file
@@ -0,0 +1,298 @@
+#version 450
+
+// tone mapping of HDR scene color with bloom, the only pass which writes the swapchain image,
+// the comparison mode applies more operators to tiles of one frame; HALF_PRECISION is the variant
+// tonemap_fp16.frag.spv, the global operators are evaluated in float16
+#ifdef HALF_PRECISION
+#extension GL_EXT_shader_explicit_arithmetic_types_float16 : require
+#define hfloat float16_t
+#define hvec3 f16vec3
+#define RATIONAL_INPUT_MAX 100.0    // squares of the rational operators stay under TMO_INPUT_MAX
+#else
+#define hfloat float
+#define hvec3 vec3
+#define RATIONAL_INPUT_MAX 65504.0
+#endif
+
+// the largest float16, exposed radiance is clamped by both variants
+#define TMO_INPUT_MAX 65504.0
+layout(location = 0) in vec2 inUV;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform sampler2D sceneColor;
+layout(binding = 1) uniform sampler2D bloomColor;     // level 0 of bloom chain, half resolution
+layout(binding = 2) uniform sampler3D tonemapLut;     // TMO with exposure and grade baked by HdaTonemap::bakeLut()
+layout(binding = 3) uniform sampler3D localGrid;      // blurred bilateral grid of local TMO
+layout(binding = 4) buffer TileHistograms {            // histograms of comparison tiles of every frame
+    uint bins[];
+} tileStats;
+
+// shaper of LUT coordinates, TONEMAP_LUT_EPSILON and TONEMAP_LUT_MAX of hda_tonemap.hpp
+#define LUT_EPSILON (1.0 / 1024.0)
+#define LUT_MAX 4096.0
+
+// LOCAL_GRID_CELL, LOCAL_LOG_MIN, LOCAL_LOG_MAX and LOCAL_MIDDLE_GRAY of hda_localtonemap.hpp
+#define LOCAL_CELL 16.0
+#define LOCAL_LOG_MIN -12.0
+#define LOCAL_LOG_MAX 12.0
+#define LOCAL_MIDDLE_GRAY 0.18
+
+// TONEMAP_METHODS, TONEMAP_STATS_BINS, TONEMAP_STATS_STRIDE and TONEMAP_GAMMA of hda_tonemap.hpp
+#define METHODS 5
+#define STATS_BINS 64
+#define STATS_STRIDE 2
+#define STATS_GAMMA 2.2
+
+// weight of texels across the edge of 1 stop of luminance is 1 / (1 + UPSCALE_EDGE_SHARPNESS)
+#define UPSCALE_EDGE_SHARPNESS 4.0
+
+// squares of tile label in pixels
+#define LABEL_OFFSET 8.0
+#define LABEL_SIZE 8
+#define LABEL_STEP 12
+
+layout(push_constant) uniform constants {
+
+    float exposure;
+    int chooseMethodFlag;
+    int hdrOnFlag;
+    float bloomIntensity;   // 0 when bloom is off
+    int lutOnFlag;          // the LUT replaces TMO and exposure
+    int localOnFlag;        // the grid is sliced before TMO or LUT
+    float localCompression; // contrast of base layer
+    float localDetail;
+    int compareTiles;       // 0 is off, 2 to METHODS operators from chooseMethodFlag side by side
+    int compareGrid;        // 1 every tile shows the whole frame, 0 tiles are strips of one frame
+    int statsBase;          // first bin of the frame in tileStats
+    int upscaleFilter;      // 0 bilinear, 1 edge-adaptive
+    vec2 renderScale;       // the scene is rendered into the scaled viewport in the corner of scene color
+
+} tonemap;
+
+hvec3 reinhardTMO(hvec3 x);
+hvec3 reinhardModTMO(hvec3 x);
+hvec3 hejlDawsonTMO(hvec3 x);
+hvec3 uncharted2TMO(hvec3 x);
+vec3 originalAcesTMO(vec3 result);
+vec3 globalTMO(vec3 result, int method);
+vec3 localTMO(vec3 result, vec2 scenePos);
+vec3 upscaleScene(vec2 renderPos);
+
+// constants, so the white scale of Uncharted 2 is folded by the compiler
+const hfloat A = hfloat(0.15f);
+const hfloat B = hfloat(0.50f);
+const hfloat C = hfloat(0.10f);
+const hfloat D = hfloat(0.20f);
+const hfloat E = hfloat(0.02f);
+const hfloat F = hfloat(0.30f);
+const hfloat W = hfloat(11.2f);
+
+void main() {
+
+    vec2 size = vec2(textureSize(sceneColor, 0));
+    vec2 scenePos = gl_FragCoord.xy;    // the same as the fragment except grid tiles
+    int method = tonemap.chooseMethodFlag;
+    int tile = -1;
+    bool overlay = false;
+
+    if (tonemap.compareTiles > 0) {
+
+        // strips are exact pixels of one frame, grid tiles show the whole frame downscaled
+        ivec2 tiles = tonemap.compareGrid == 1 && tonemap.compareTiles > 3 ? ivec2((tonemap.compareTiles + 1) / 2, 2) : ivec2(tonemap.compareTiles, 1);
+        vec2 tileSize = size / vec2(tiles);
+        ivec2 tileCoord = min(ivec2(gl_FragCoord.xy / tileSize), tiles - 1);
+        vec2 inTile = gl_FragCoord.xy - vec2(tileCoord) * tileSize;
+
+        tile = tileCoord.y * tiles.x + tileCoord.x;
+        if (tile >= tonemap.compareTiles) {
+            outColor = vec4(0.0, 0.0, 0.0, 1.0);
+            return;
+        }
+        method = (tonemap.chooseMethodFlag + tile) % METHODS;
+        if (tonemap.compareGrid == 1)
+            scenePos = inTile * vec2(tiles);
+
+        // border between tiles and a label of method + 1 squares in the corner of tile
+        int square = int(inTile.x - LABEL_OFFSET) / LABEL_STEP;
+        overlay = (tileCoord.x > 0 && inTile.x < 1.0) || (tileCoord.y > 0 && inTile.y < 1.0) ||
+                  (inTile.x >= LABEL_OFFSET && inTile.y >= LABEL_OFFSET && inTile.y < LABEL_OFFSET + LABEL_SIZE &&
+                   square <= method && int(inTile.x - LABEL_OFFSET) % LABEL_STEP < LABEL_SIZE);
+    }
+
+    // pixels of the scaled viewport, the grid tiles and the dynamic resolution are upscaled
+    vec2 renderPos = scenePos * tonemap.renderScale;
+    bool upscale = (tonemap.compareGrid == 1 && tile >= 0) || any(notEqual(tonemap.renderScale, vec2(1.0)));
+    vec3 result = upscale ? upscaleScene(renderPos) : texelFetch(sceneColor, ivec2(scenePos), 0).rgb;
+
+    // bilinear upsampling of level 0 is the last step of the bloom chain
+    if (tonemap.bloomIntensity > 0.0)
+        result += texture(bloomColor, scenePos / size).rgb * tonemap.bloomIntensity;
+
+    if (tonemap.hdrOnFlag == 1 && tonemap.localOnFlag == 1)
+        result = localTMO(result, renderPos);
+
+    // the LUT has one operator baked, so the comparison uses the analytic ones
+    vec3 color;
+    if (tonemap.hdrOnFlag == 1 && tonemap.lutOnFlag == 1 && tile < 0) {
+
+        // ends of the shaper range are texel centers
+        float lutSize = float(textureSize(tonemapLut, 0).x);
+        vec3 u = log2(max(result, 0.0) / LUT_EPSILON + 1.0) / log2(LUT_MAX / LUT_EPSILON + 1.0);
+        color = texture(tonemapLut, (clamp(u, 0.0, 1.0) * (lutSize - 1.0) + 0.5) / lutSize).rgb;
+    }
+    else if (tonemap.hdrOnFlag == 1)
+        color = globalTMO(result, method);
+    else
+        color = result;
+
+    // the same as HdaTonemap::statsBin(), HdaTonemap::tileStats() reduces the histograms
+    if (tile >= 0 && all(equal(ivec2(gl_FragCoord.xy) % STATS_STRIDE, ivec2(0)))) {
+
+        float lum = clamp(dot(color, vec3(0.2126, 0.7152, 0.0722)), 0.0, 1.0);
+        int bin = min(int(pow(lum, 1.0 / STATS_GAMMA) * STATS_BINS), STATS_BINS - 1);
+        atomicAdd(tileStats.bins[tonemap.statsBase + tile * STATS_BINS + bin], 1u);
+    }
+
+    outColor = vec4(overlay ? vec3(1.0) : color, 1.0);
+}
+
+
+//
+//  TONE MAPPING FUNCTIONS
+//
+vec3 globalTMO(vec3 result, int method) {
+
+    // exposed radiance, the operators map larger values to white
+    hvec3 x = hvec3(min(result * tonemap.exposure, vec3(TMO_INPUT_MAX)));
+
+    if (method == 0)
+        return vec3(reinhardTMO(x));
+    else if (method == 1)
+        return vec3(hejlDawsonTMO(x));
+    else if (method == 2) {
+
+        hfloat exposureBias = hfloat(2.0f);
+        hvec3 curr = uncharted2TMO(exposureBias * x);
+
+        hvec3 whiteScale = hvec3(1.0f) / uncharted2TMO(hvec3(W));
+        return vec3(curr * whiteScale);
+    }
+    else if (method == 3)
+        return originalAcesTMO(vec3(x));
+
+    return vec3(reinhardModTMO(x));
+}
+
+
+// the same as HdaLocalTonemap::sliceBase() and localScale(), the result is still HDR
+vec3 localTMO(vec3 result, vec2 scenePos) {
+
+    float lum = dot(result, vec3(0.2126, 0.7152, 0.0722)) * tonemap.exposure;
+    float l = clamp(log2(max(lum, 1e-30)), LOCAL_LOG_MIN, LOCAL_LOG_MAX);
+
+    vec3 gridSize = vec3(textureSize(localGrid, 0));
+    vec3 uvw = vec3(scenePos / (gridSize.xy * LOCAL_CELL), (l - LOCAL_LOG_MIN) / (LOCAL_LOG_MAX - LOCAL_LOG_MIN));
+    vec2 cell = texture(localGrid, uvw).xy;
+    float base = cell.y > 1e-6 ? cell.x / cell.y + LOCAL_LOG_MIN : l;
+
+    float anchor = log2(LOCAL_MIDDLE_GRAY);
+    float outL = anchor + (base - anchor) * tonemap.localCompression + (l - base) * tonemap.localDetail;
+
+    return result * exp2(outL - l);
+}
+
+// bilinear or edge-adaptive, the 2x2 texels of bilinear filter are weighted down by the difference
+// of log luminance from the nearest one, so edges are not blurred; texels out of the viewport are not read
+vec3 upscaleScene(vec2 renderPos) {
+
+    vec2 size = vec2(textureSize(sceneColor, 0));
+    vec2 renderSize = floor(size * tonemap.renderScale + 0.5);
+    vec2 pos = clamp(renderPos, vec2(0.5), renderSize - 0.5);
+
+    if (tonemap.upscaleFilter == 0)
+        return texture(sceneColor, pos / size).rgb;
+
+    vec2 f = pos - 0.5 - floor(pos - 0.5);
+    ivec2 base = ivec2(floor(pos - 0.5));
+    ivec2 last = ivec2(renderSize) - 1;
+
+    vec3 c[4] = vec3[](
+        texelFetch(sceneColor, base, 0).rgb,
+        texelFetch(sceneColor, min(base + ivec2(1, 0), last), 0).rgb,
+        texelFetch(sceneColor, min(base + ivec2(0, 1), last), 0).rgb,
+        texelFetch(sceneColor, min(base + ivec2(1, 1), last), 0).rgb
+    );
+    float w[4] = float[]((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+
+    int nearest = (f.x < 0.5 ? 0 : 1) + (f.y < 0.5 ? 0 : 2);
+    float nearestL = log2(max(dot(c[nearest], vec3(0.2126, 0.7152, 0.0722)), 1e-6));
+
+    vec3 color = vec3(0.0);
+    float weightSum = 0.0;
+    for (int n = 0; n < 4; n++) {
+
+        float l = log2(max(dot(c[n], vec3(0.2126, 0.7152, 0.0722)), 1e-6));
+        float weight = w[n] / (1.0 + UPSCALE_EDGE_SHARPNESS * abs(l - nearestL));
+        color += c[n] * weight;
+        weightSum += weight;
+    }
+
+    return color / weightSum;
+}
+
+hvec3 reinhardTMO(hvec3 x) {
+
+    return x / (hfloat(1.0f) + x);  // TODO TODO add modRein with Lw
+}
+
+
+hvec3 reinhardModTMO(hvec3 x) {
+
+#ifdef HALF_PRECISION
+    // 1 - exp(-x) cancels in float16 for dark pixels, the series is used under 1/16
+    return mix(hvec3(1.0f) - exp(-x), x * (hfloat(1.0f) - hfloat(0.5f) * x), lessThan(x, hvec3(0.0625f)));
+#else
+    return vec3(1.0f) - exp(-x);
+#endif
+}
+
+
+hvec3 hejlDawsonTMO(hvec3 x) {
+
+   x = max(min(x, hvec3(RATIONAL_INPUT_MAX)) - hfloat(0.004f), hfloat(0.0f));
+   return pow((x * (hfloat(6.2f) * x + hfloat(0.5f))) / (x * (hfloat(6.2f) * x + hfloat(1.7f)) + hfloat(0.06f)), hvec3(2.2f));
+}
+
+
+// ((x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F)) - E / F with the constant terms
+// cancelled, so dark pixels do not lose precision by the subtraction
+hvec3 uncharted2TMO(hvec3 x) {
+
+   x = min(x, hvec3(RATIONAL_INPUT_MAX));
+   return x * (A * (F - E) * x + B * (C * F - E)) / (F * (x * (A * x + B) + D * F));
+}
+
+
+// Based on http://www.oscars.org/science-technology/sci-tech-projects/aces
+vec3 originalAcesTMO(vec3 result) {	
+
+	mat3 m1 = mat3(
+        0.59719, 0.07600, 0.02840,
+        0.35458, 0.90834, 0.13383,
+        0.04823, 0.01566, 0.83777
+	);
+
+	mat3 m2 = mat3(
+        1.60475, -0.10208, -0.00327,
+        -0.53108,  1.10813, -0.07276,
+        -0.07367, -0.00605,  1.07602
+	);
+
+	hvec3 v = hvec3(min(m1 * result, vec3(RATIONAL_INPUT_MAX)));
+	hvec3 a = v * (v + hfloat(0.0245786)) - hfloat(0.000090537);
+	hvec3 b = v * (hfloat(0.983729) * v + hfloat(0.4329510)) + hfloat(0.238081);
+
+	//return pow(clamp(m2 * (a / b), 0.0, 1.0), vec3(1.0 / 2.2));	// UVNITR ZAKOMPONOVANA I GAMA KOREKCE KTERA JE NEZADOUCI
+    return clamp(m2 * vec3(a / b), 0.0, 1.0);	
+}
\ No newline at end of file